@@ -0,0 +1,216 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevelGametimeSystem.h"
+#include "TiledLevelItem.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "NavigationPath.h"
+#include "NavigationSystem.h"
+#include "Builders/CubeBuilder.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Misc/AutomationTest.h"
+#include "NavMesh/NavMeshBoundsVolume.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Tests/AutomationEditorCommon.h"
+#include "UObject/Package.h"
+
+/*
+ * Gametime builds reroute navigation: in PIE, over a flat floor with a navmesh rebuilt at runtime, a straight path is found first,
+ * then a wall of blocks is built across it through BuildItem. Only the dirty areas reported by the tiled level rebuild the navmesh,
+ * and the new path must still reach the end, be longer, and never cross the wall.
+ */
+
+namespace
+{
+	struct FTiledNavRerouteTestState
+	{
+		UTiledItemSet* ItemSet = nullptr;
+		double LengthBefore = 0;
+		double WallBuiltTime = 0;
+	};
+}
+
+static constexpr double NavRebuildTimeout = 30.0;
+// in tiles, the wall is across the middle of the path
+static constexpr int32 PathDistance = 10;
+static constexpr int32 WallHalfWidth = 3;
+static constexpr float NavTestTileSize = 100.f;
+
+static UWorld* GetPIEWorld()
+{
+	for (const FWorldContext& Context : GEditor->GetWorldContexts())
+	{
+		if (Context.WorldType == EWorldType::PIE && Context.World())
+			return Context.World();
+	}
+	return nullptr;
+}
+
+static UNavigationPath* FindPath(UWorld* World)
+{
+	// tile centers on the floor, the wall goes on tile X = 1 + PathDistance / 2
+	const FVector Start(1.5f * NavTestTileSize, 0.5f * NavTestTileSize, 10.f);
+	const FVector End = Start + FVector(PathDistance * NavTestTileSize, 0, 0);
+	return UNavigationSystemV1::FindPathToLocationSynchronously(World, Start, End);
+}
+
+static FBox GetWallBox()
+{
+	const float WallX = (1 + PathDistance / 2) * NavTestTileSize;
+	return FBox(FVector(WallX, -WallHalfWidth * NavTestTileSize, -1000.f), FVector(WallX + NavTestTileSize, (WallHalfWidth + 1) * NavTestTileSize, 1000.f));
+}
+
+static void WaitUntilOrTimeout(FAutomationTestBase* Test, const FString& What, TFunction<bool()> Condition)
+{
+	TSharedRef<double> StartTime = MakeShared<double>(0.0);
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([=]()
+	{
+		if (*StartTime == 0.0)
+			*StartTime = FPlatformTime::Seconds();
+		if (Condition()) return true;
+		if (FPlatformTime::Seconds() - *StartTime > NavRebuildTimeout)
+		{
+			Test->AddError(FString::Printf(TEXT("Timed out waiting for %s"), *What));
+			return true;
+		}
+		return false;
+	}));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelNavRerouteTest, "TiledLevel.Navigation.GametimeBuildReroutesPath",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelNavRerouteTest::RunTest(const FString& Parameters)
+{
+	if (!FAutomationEditorCommonUtils::CreateNewMap())
+	{
+		AddError(TEXT("Failed to create a new map"));
+		return false;
+	}
+
+	// floor and navigation bounds, both copied to the PIE world
+	UWorld* EditorWorld = GEditor->GetEditorWorldContext().World();
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	AStaticMeshActor* Floor = EditorWorld->SpawnActor<AStaticMeshActor>(FVector(0, 0, -50), FRotator::ZeroRotator);
+	Floor->GetStaticMeshComponent()->SetStaticMesh(Cube);
+	Floor->SetActorScale3D(FVector(40, 40, 1));
+	ANavMeshBoundsVolume* Bounds = EditorWorld->SpawnActor<ANavMeshBoundsVolume>(FVector::ZeroVector, FRotator::ZeroRotator);
+	UCubeBuilder* Builder = NewObject<UCubeBuilder>();
+	Builder->X = 4000;
+	Builder->Y = 4000;
+	Builder->Z = 1000;
+	Builder->Build(EditorWorld, Bounds);
+	Bounds->PostEditChange();
+
+	TSharedRef<FTiledNavRerouteTestState> State = MakeShared<FTiledNavRerouteTestState>();
+	State->ItemSet = NewObject<UTiledItemSet>(CreatePackage(TEXT("/Temp/TiledLevelNavRerouteTest")), TEXT("ItemSet"), RF_Public | RF_Transient);
+	State->ItemSet->AddToRoot();
+	State->ItemSet->TileSizeX = NavTestTileSize;
+	State->ItemSet->TileSizeY = NavTestTileSize;
+	State->ItemSet->TileSizeZ = NavTestTileSize;
+	// taller than the agent can step up
+	State->ItemSet->AddNewItem(Cube, EPlacedType::Block, ETLStructureType::Prop, FVector(1));
+
+	ULevelEditorPlaySettings* PlaySettings = NewObject<ULevelEditorPlaySettings>();
+	PlaySettings->SetPlayNetMode(EPlayNetMode::PIE_Standalone);
+	PlaySettings->SetPlayNumberOfClients(1);
+	FRequestPlaySessionParams Params;
+	Params.WorldType = EPlaySessionWorldType::PlayInEditor;
+	Params.SessionDestination = EPlaySessionDestinationType::InProcess;
+	Params.EditorPlaySettings = PlaySettings;
+	GEditor->RequestPlaySession(Params);
+
+	WaitUntilOrTimeout(this, TEXT("PIE to begin play"), []()
+	{
+		const UWorld* World = GetPIEWorld();
+		return World && World->HasBegunPlay();
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, State]()
+	{
+		UWorld* World = GetPIEWorld();
+		UNavigationSystemV1* NavSys = World? FNavigationSystem::GetCurrent<UNavigationSystemV1>(World) : nullptr;
+		if (!TestNotNull(TEXT("navigation system"), NavSys)) return true;
+		// spawns the navmesh for the bounds
+		NavSys->Build();
+		TActorIterator<ARecastNavMesh> NavMesh(World);
+		if (!TestTrue(TEXT("navmesh"), static_cast<bool>(NavMesh))) return true;
+		// the project may only generate navigation in the editor, gametime builds need it rebuilt at runtime
+		FEnumProperty* RuntimeGeneration = CastField<FEnumProperty>(ANavigationData::StaticClass()->FindPropertyByName(TEXT("RuntimeGeneration")));
+		if (!TestNotNull(TEXT("navmesh runtime generation property"), RuntimeGeneration)) return true;
+		*RuntimeGeneration->ContainerPtrToValuePtr<ERuntimeGenerationType>(*NavMesh) = ERuntimeGenerationType::Dynamic;
+		NavSys->Build();
+
+		UNavigationPath* PathBefore = FindPath(World);
+		if (!TestTrue(TEXT("full path before building"), PathBefore && PathBefore->IsValid() && !PathBefore->IsPartial())) return true;
+		State->LengthBefore = PathBefore->GetPathLength();
+		TestTrue(FString::Printf(TEXT("straight path before building (%.0f)"), State->LengthBefore), State->LengthBefore < PathDistance * NavTestTileSize * 1.1f);
+
+		UTiledLevelGametimeSystem* System = World->GetGameInstance()->GetSubsystem<UTiledLevelGametimeSystem>();
+		System->TileSize = State->ItemSet->GetTileSize();
+		System->InitializeGametimeSystem(World, State->ItemSet, TArray<ATiledLevel*>(), true);
+		System->ActivatePreviewItem(State->ItemSet->GetItemSet()[0]);
+		const FBox WallBox = GetWallBox();
+		int32 NumBuilt = 0;
+		for (int32 i = -WallHalfWidth; i <= WallHalfWidth; i++)
+		{
+			const FVector TileCenter(WallBox.Min.X + NavTestTileSize / 2, (i + 0.5f) * NavTestTileSize, NavTestTileSize / 2);
+			if (!System->MovePreviewItemToWorldPosition(TileCenter)) continue;
+			const int32 NumBefore = System->GametimeData.Num();
+			System->BuildItem();
+			NumBuilt += System->GametimeData.Num() - NumBefore;
+		}
+		TestEqual(TEXT("wall pieces built"), NumBuilt, 2 * WallHalfWidth + 1);
+		State->WallBuiltTime = FPlatformTime::Seconds();
+		return true;
+	}));
+
+	// dirty areas are handed to the generator on its next tick, give it a moment before checking the build is done
+	WaitUntilOrTimeout(this, TEXT("navmesh rebuild of the wall tiles"), [State]()
+	{
+		UWorld* World = GetPIEWorld();
+		UNavigationSystemV1* NavSys = World? FNavigationSystem::GetCurrent<UNavigationSystemV1>(World) : nullptr;
+		if (!NavSys || State->WallBuiltTime == 0.0) return true;
+		return FPlatformTime::Seconds() - State->WallBuiltTime > 0.5 && !NavSys->IsNavigationBuildInProgress();
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, State]()
+	{
+		UWorld* World = GetPIEWorld();
+		if (!World || State->WallBuiltTime == 0.0) return true;
+		UNavigationPath* PathAfter = FindPath(World);
+		if (!TestTrue(TEXT("full path after building"), PathAfter && PathAfter->IsValid() && !PathAfter->IsPartial())) return true;
+		const double LengthAfter = PathAfter->GetPathLength();
+		AddInfo(FString::Printf(TEXT("path length %.0f -> %.0f, %d points"), State->LengthBefore, LengthAfter, PathAfter->PathPoints.Num()));
+		TestTrue(TEXT("path is longer"), LengthAfter > State->LengthBefore + NavTestTileSize);
+		TestTrue(TEXT("path has corners"), PathAfter->PathPoints.Num() > 2);
+		const FBox WallBox = GetWallBox();
+		for (int32 i = 1; i < PathAfter->PathPoints.Num(); i++)
+		{
+			const FVector& A = PathAfter->PathPoints[i - 1];
+			const FVector& B = PathAfter->PathPoints[i];
+			TestFalse(FString::Printf(TEXT("path segment %d goes through the wall"), i), FMath::LineBoxIntersection(WallBox, A, B, B - A));
+		}
+		return true;
+	}));
+
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([State]()
+	{
+		State->ItemSet->RemoveFromRoot();
+		State->ItemSet->MarkAsGarbage();
+		return true;
+	}));
+	return true;
+}
+
+#endif
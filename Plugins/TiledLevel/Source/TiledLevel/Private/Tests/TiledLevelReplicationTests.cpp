@@ -0,0 +1,257 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevel.h"
+#include "TiledLevelGametimeSystem.h"
+#include "TiledLevelItem.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StaticMesh.h"
+#include "Misc/AutomationTest.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Tests/AutomationEditorCommon.h"
+#include "UObject/Package.h"
+
+/*
+ * Gametime placements replicated to 2 clients of a listen server, all PIE instances in this process (runs headless with -nullrhi).
+ * Stacked placements (same item at the same position, different transforms) share a handle, removing one of them
+ * must remove exactly that one on every client, and the other one must still be removable afterwards.
+ */
+
+namespace
+{
+	struct FTiledReplicationTestState
+	{
+		UTiledItemSet* ItemSet = nullptr;
+		TWeakObjectPtr<UTiledLevelGametimeSystem> ServerSystem;
+		TWeakObjectPtr<ATiledLevel> ServerLevel;
+		// what every client should end up with after each step
+		TArray<FTilePlacement> Expected;
+	};
+}
+
+static constexpr int32 NumClients = 2;
+static constexpr double ReplicationTimeout = 30.0;
+
+static UWorld* GetPIEWorlds(TArray<UWorld*>& OutClients)
+{
+	UWorld* Server = nullptr;
+	for (const FWorldContext& Context : GEditor->GetWorldContexts())
+	{
+		UWorld* World = Context.World();
+		if (Context.WorldType != EWorldType::PIE || !World) continue;
+		if (World->GetNetMode() == NM_ListenServer)
+			Server = World;
+		else if (World->GetNetMode() == NM_Client)
+			OutClients.Add(World);
+	}
+	return Server;
+}
+
+static ATiledLevel* FindTiledLevel(UWorld* World)
+{
+	TActorIterator<ATiledLevel> It(World);
+	return It? *It : nullptr;
+}
+
+static FTilePlacement MakeStackedPlacement(const UTiledLevelItem* Item, const FIntVector& Position, float Yaw)
+{
+	FTilePlacement P;
+	P.ItemSet = Cast<UTiledItemSet>(Item->GetOuter());
+	P.ItemID = Item->ItemID;
+	P.GridPosition = Position;
+	P.Extent = FIntVector(1);
+	P.TileObjectTransform = FTransform(FRotator(0, Yaw, 0), FVector(Position) * 100 + FVector(50, 50, 0));
+	return P;
+}
+
+// data and instances of the client level are the expected placements, transforms included
+static bool IsReplicated(const ATiledLevel* Level, const TArray<FTilePlacement>& Expected)
+{
+	const TArray<FTilePlacement>& Placements = Level->GametimeData.BlockPlacements;
+	if (Placements.Num() != Expected.Num()) return false;
+	for (const FTilePlacement& P : Expected)
+	{
+		if (!Placements.ContainsByPredicate([&P](const FTilePlacement& Other) { return Other == P && Other.TileObjectTransform.Equals(P.TileObjectTransform); }))
+			return false;
+	}
+	int32 NumInstances = 0;
+	for (const auto& Elem : Level->TiledObjectPartitions)
+	{
+		if (Elem.Value)
+			NumInstances += Elem.Value->GetInstanceCount();
+	}
+	return NumInstances == Expected.Num();
+}
+
+static void WaitUntil(FAutomationTestBase* Test, const FString& What, TFunction<bool()> Condition)
+{
+	TSharedRef<double> StartTime = MakeShared<double>(0.0);
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([=]()
+	{
+		if (*StartTime == 0.0)
+			*StartTime = FPlatformTime::Seconds();
+		if (Condition()) return true;
+		if (FPlatformTime::Seconds() - *StartTime > ReplicationTimeout)
+		{
+			Test->AddError(FString::Printf(TEXT("Timed out waiting for %s"), *What));
+			return true;
+		}
+		return false;
+	}));
+}
+
+static void WaitForClients(FAutomationTestBase* Test, const FString& What, TSharedRef<FTiledReplicationTestState> State)
+{
+	WaitUntil(Test, What, [State]()
+	{
+		TArray<UWorld*> Clients;
+		GetPIEWorlds(Clients);
+		if (Clients.Num() != NumClients) return false;
+		for (UWorld* Client : Clients)
+		{
+			const ATiledLevel* Level = FindTiledLevel(Client);
+			if (!Level || !IsReplicated(Level, State->Expected)) return false;
+		}
+		return true;
+	});
+}
+
+// server side change, the same way the gametime system replicates builds and removals
+static void ChangeOnServer(FAutomationTestBase* Test, TSharedRef<FTiledReplicationTestState> State, TFunction<void(ATiledLevel*, UTiledLevelGametimeSystem*)> Change)
+{
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([=]()
+	{
+		if (!State->ServerLevel.IsValid() || !State->ServerSystem.IsValid())
+		{
+			Test->AddError(TEXT("Server gametime level is gone"));
+			return true;
+		}
+		Change(State->ServerLevel.Get(), State->ServerSystem.Get());
+		State->ServerLevel->ForceNetUpdate();
+		return true;
+	}));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelStackedReplicationTest, "TiledLevel.Replication.StackedPlacementsMultiClient",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelStackedReplicationTest::RunTest(const FString& Parameters)
+{
+	if (!FAutomationEditorCommonUtils::CreateNewMap())
+	{
+		AddError(TEXT("Failed to create a new map"));
+		return false;
+	}
+
+	TSharedRef<FTiledReplicationTestState> State = MakeShared<FTiledReplicationTestState>();
+	// clients resolve the item set of replicated placements by path, only loaded objects are sent that way
+	UPackage* Package = CreatePackage(TEXT("/Temp/TiledLevelReplicationTest"));
+	State->ItemSet = NewObject<UTiledItemSet>(Package, TEXT("ItemSet"), RF_Public | RF_Transient);
+	State->ItemSet->SetFlags(RF_WasLoaded);
+	State->ItemSet->AddToRoot();
+	State->ItemSet->TileSizeX = 100;
+	State->ItemSet->TileSizeY = 100;
+	State->ItemSet->TileSizeZ = 100;
+	State->ItemSet->AddNewItem(LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube")), EPlacedType::Block, ETLStructureType::Prop, FVector(1));
+	const UTiledLevelItem* Item = State->ItemSet->GetItemSet()[0];
+	const FTilePlacement StackedA = MakeStackedPlacement(Item, FIntVector(0, 0, 0), 0);
+	const FTilePlacement StackedB = MakeStackedPlacement(Item, FIntVector(0, 0, 0), 90);
+	const FTilePlacement StackedC = MakeStackedPlacement(Item, FIntVector(0, 0, 0), 180);
+	const FTilePlacement Single = MakeStackedPlacement(Item, FIntVector(3, 1, 0), 0);
+
+	ULevelEditorPlaySettings* PlaySettings = NewObject<ULevelEditorPlaySettings>();
+	PlaySettings->SetPlayNetMode(EPlayNetMode::PIE_ListenServer);
+	// the listen server counts as one
+	PlaySettings->SetPlayNumberOfClients(NumClients + 1);
+	PlaySettings->bLaunchSeparateServer = false;
+	PlaySettings->SetRunUnderOneProcess(true);
+	FRequestPlaySessionParams Params;
+	Params.WorldType = EPlaySessionWorldType::PlayInEditor;
+	Params.SessionDestination = EPlaySessionDestinationType::InProcess;
+	Params.EditorPlaySettings = PlaySettings;
+	GEditor->RequestPlaySession(Params);
+
+	WaitUntil(this, TEXT("server and clients to connect"), []()
+	{
+		TArray<UWorld*> Clients;
+		const UWorld* Server = GetPIEWorlds(Clients);
+		return Server && Server->GetNumPlayerControllers() == NumClients + 1 && Clients.Num() == NumClients;
+	});
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, State, StackedA, StackedB, Single]()
+	{
+		TArray<UWorld*> Clients;
+		UWorld* Server = GetPIEWorlds(Clients);
+		UTiledLevelGametimeSystem* System = Server? Server->GetGameInstance()->GetSubsystem<UTiledLevelGametimeSystem>() : nullptr;
+		if (!System) return true;
+		System->TileSize = State->ItemSet->GetTileSize();
+		FTiledLevelGameData Data;
+		Data.AddPlacement(StackedA, EPlacedType::Block);
+		Data.AddPlacement(StackedB, EPlacedType::Block);
+		Data.AddPlacement(Single, EPlacedType::Block);
+		System->InitializeGametimeSystemFromData(Server, State->ItemSet, Data, {}, true);
+		ATiledLevel* Level = FindTiledLevel(Server);
+		if (!TestNotNull(TEXT("server gametime level"), Level)) return true;
+		// clients may have no pawn near the origin in an empty map
+		Level->bAlwaysRelevant = true;
+		Level->ForceNetUpdate();
+		State->ServerSystem = System;
+		State->ServerLevel = Level;
+		State->Expected = {StackedA, StackedB, Single};
+		return true;
+	}));
+	WaitForClients(this, TEXT("initial placements on clients"), State);
+
+	// the first of the stacked ones, it used to take the last one added at that handle
+	ChangeOnServer(this, State, [State, StackedA, StackedB, Single](ATiledLevel* Level, UTiledLevelGametimeSystem* System)
+	{
+		System->GametimeData.RemovePlacement(StackedA.TileObjectTransform, StackedA.ItemID);
+		Level->ReplicatePlacementRemoved(FTiledActorHandle(StackedA), StackedA.TileObjectTransform);
+		State->Expected = {StackedB, Single};
+	});
+	WaitForClients(this, TEXT("first stacked placement removed on clients"), State);
+
+	// stacked again, on top of the one left
+	ChangeOnServer(this, State, [State, StackedB, StackedC, Single](ATiledLevel* Level, UTiledLevelGametimeSystem* System)
+	{
+		System->GametimeData.AddPlacement(StackedC, EPlacedType::Block);
+		Level->ReplicatePlacementAdded(FTiledNetPlacement(StackedC, EPlacedType::Block));
+		State->Expected = {StackedB, StackedC, Single};
+	});
+	WaitForClients(this, TEXT("stacked placement added on clients"), State);
+
+	// the one left from the start, its index must have survived the removal above
+	ChangeOnServer(this, State, [State, StackedB, StackedC, Single](ATiledLevel* Level, UTiledLevelGametimeSystem* System)
+	{
+		System->GametimeData.RemovePlacement(StackedB.TileObjectTransform, StackedB.ItemID);
+		Level->ReplicatePlacementRemoved(FTiledActorHandle(StackedB), StackedB.TileObjectTransform);
+		State->Expected = {StackedC, Single};
+	});
+	WaitForClients(this, TEXT("second stacked placement removed on clients"), State);
+
+	ChangeOnServer(this, State, [State, StackedC, Single](ATiledLevel* Level, UTiledLevelGametimeSystem* System)
+	{
+		System->GametimeData.RemovePlacement(StackedC.TileObjectTransform, StackedC.ItemID);
+		Level->ReplicatePlacementRemoved(FTiledActorHandle(StackedC), StackedC.TileObjectTransform);
+		State->Expected = {Single};
+	});
+	WaitForClients(this, TEXT("last stacked placement removed on clients"), State);
+
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([State]()
+	{
+		State->ItemSet->RemoveFromRoot();
+		State->ItemSet->MarkAsGarbage();
+		return true;
+	}));
+	return true;
+}
+
+#endif
@@ -0,0 +1,64 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelItem.h"
+#include "TiledThumbnailCache.h"
+#include "Engine/StaticMesh.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+/*
+ * Content hash of a tiled level asset with placements whose item is gone from the item set (ex: deleted after placing):
+ * hashing must not touch the missing item, and such placements still change the hash like any other placement.
+ */
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledThumbnailMissingItemTest, "TiledLevel.Thumbnail.HashWithMissingItems",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledThumbnailMissingItemTest::RunTest(const FString& Parameters)
+{
+	UTiledItemSet* ItemSet = NewObject<UTiledItemSet>(GetTransientPackage());
+	ItemSet->TileSizeX = 100;
+	ItemSet->TileSizeY = 100;
+	ItemSet->TileSizeZ = 100;
+	ItemSet->AddNewItem(LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube")), EPlacedType::Block, ETLStructureType::Structure, FVector(1));
+	UTiledLevelAsset* Asset = NewObject<UTiledLevelAsset>(GetTransientPackage());
+	Asset->SetTileSize(ItemSet->GetTileSize());
+	Asset->ConfirmTileSize();
+	Asset->SetActiveItemSet(ItemSet);
+	if (!Asset->IsFloorExists(0))
+		Asset->AddNewFloor(0);
+
+	auto MakePlacement = [ItemSet](const FGuid& ItemID, int32 X)
+	{
+		FTilePlacement P;
+		P.ItemSet = ItemSet;
+		P.ItemID = ItemID;
+		P.GridPosition = FIntVector(X, 0, 0);
+		P.Extent = FIntVector(1);
+		P.TileObjectTransform = FTransform(FVector(X * 100 + 50, 50, 0));
+		return P;
+	};
+	Asset->AddNewTilePlacement(MakePlacement(ItemSet->GetItemSet()[0]->ItemID, 0));
+	const FString ValidHash = FTiledThumbnailCache::GetContentHash(Asset);
+
+	// added straight to the floor, AddNewTilePlacement refuses them
+	FTiledFloor* Floor = Asset->GetFloorFromPosition(0);
+	Floor->BlockPlacements.Add(MakePlacement(FGuid::NewGuid(), 1));
+	const FString MissingHash = FTiledThumbnailCache::GetContentHash(Asset);
+	Floor->BlockPlacements.Last().ItemID = FGuid::NewGuid();
+	const FString OtherMissingHash = FTiledThumbnailCache::GetContentHash(Asset);
+
+	bool Result = TestFalse(TEXT("hash of valid placements"), ValidHash.IsEmpty());
+	Result &= TestFalse(TEXT("hash with a missing item"), MissingHash.IsEmpty());
+	Result &= TestNotEqual(TEXT("missing item changes the hash"), MissingHash, ValidHash);
+	Result &= TestNotEqual(TEXT("another missing item gives another hash"), OtherMissingHash, MissingHash);
+	return Result;
+}
+
+#endif
@@ -5,6 +5,8 @@
 #include "TiledLevelEditorLog.h"
 #include "TiledLevelEditor/TiledLevelEdMode.h"
 #include "TiledLevelItem.h"
+#include "TiledLevelStats.h"
+#include "TiledThumbnailCache.h"
 #include "CanvasTypes.h"
 #include "TiledLevelRestrictionHelper.h"
 
@@ -21,6 +23,14 @@ void UTiledItem_ThumbnailRenderer::Draw(UObject* Object, int32 X, int32 Y, uint3
 	FRenderTarget* Viewport, FCanvas* Canvas, bool bAdditionalViewFamily)
 {
 	UTiledLevelItem* Item = Cast<UTiledLevelItem>(Object);
+	// restriction items are just text, no need to cache them
+	const bool bShouldCache = !Cast<UTiledLevelRestrictionItem>(Object);
+	const FString ContentHash = bShouldCache ? FTiledThumbnailCache::GetContentHash(Item) : FString();
+	if (FTiledThumbnailCache::Get().Draw(ContentHash, X, Y, Width, Height, Canvas))
+		return;
+
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_ThumbnailRender);
+	INC_DWORD_STAT(STAT_TiledLevel_ThumbnailsRendered);
 	
 	if (Cast<UTiledLevelRestrictionItem>(Object))
 	{
@@ -63,6 +73,7 @@ void UTiledItem_ThumbnailRenderer::Draw(UObject* Object, int32 X, int32 Y, uint3
 		RenderViewFamily(Canvas, &ViewFamily, StaticMeshThumbnailScene->CreateView(&ViewFamily, X, Y, Width, Height));
 		StaticMeshThumbnailScene->SetStaticMesh(nullptr);
 		StaticMeshThumbnailScene->SetOverrideMaterials(TArray<class UMaterialInterface*>());
+		FTiledThumbnailCache::Get().Store(ContentHash, X, Y, Width, Height, Viewport);
 	}
 	else if (Item->TiledActor)
 	{
@@ -88,6 +99,7 @@ void UTiledItem_ThumbnailRenderer::Draw(UObject* Object, int32 X, int32 Y, uint3
 			ViewFamily.EngineShowFlags.MotionBlur = 0;
 		
 			RenderViewFamily(Canvas,&ViewFamily, ThumbnailScene->CreateView(&ViewFamily, X, Y, Width, Height));
+			FTiledThumbnailCache::Get().Store(ContentHash, X, Y, Width, Height, Viewport);
 		}
 	}
 
@@ -0,0 +1,262 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelCommandlet.h"
+#include "TiledLevel.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelEditorLog.h"
+#include "TiledLevelEditorUtility.h"
+#include "TiledLevelItem.h"
+#include "PreviewScene.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/StaticMesh.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Policies/PrettyJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/SavePackage.h"
+
+// assets loaded, merged and garbage collected together, bounds the memory on big projects
+static constexpr int32 CommandletBatchSize = 16;
+
+struct FTiledAssetReport
+{
+	FString AssetPath;
+	int32 NumPlacements = 0;
+	int32 NumMissingItems = 0; // item not found in its item set
+	int32 NumWrongType = 0; // item placed type is not the placement list it is in
+	int32 NumWrongFloor = 0; // position is not on the floor it is in, only reported
+	bool bFixed = false;
+	FString MeshPath;
+	bool bMerged = false;
+	FTiledBatchMergeResult Merge;
+
+	bool HasInvalidPlacements() const { return NumMissingItems > 0 || NumWrongType > 0; }
+};
+
+static int32 GetPlacementFloor(const FTilePlacement& P) { return P.GridPosition.Z; }
+static int32 GetPlacementFloor(const FEdgePlacement& P) { return P.Edge.Z; }
+static int32 GetPlacementFloor(const FPointPlacement& P) { return P.GridPosition.Z; }
+
+template <typename T>
+static void ValidatePlacements(const TArray<T>& Placements, EPlacedType ExpectedType, int32 FloorPosition, FTiledAssetReport& Report, TArray<T>& OutWrongType)
+{
+	for (const T& P : Placements)
+	{
+		Report.NumPlacements++;
+		const UTiledLevelItem* Item = P.GetItem();
+		if (!Item)
+		{
+			Report.NumMissingItems++;
+			continue;
+		}
+		if (Item->PlacedType != ExpectedType)
+		{
+			Report.NumWrongType++;
+			OutWrongType.Add(P);
+		}
+		if (GetPlacementFloor(P) != FloorPosition)
+			Report.NumWrongFloor++;
+	}
+}
+
+static void ValidateAsset(UTiledLevelAsset* Asset, bool bFix, FTiledAssetReport& Report)
+{
+	TArray<FTilePlacement> WrongTiles;
+	TArray<FEdgePlacement> WrongEdges;
+	TArray<FPointPlacement> WrongPoints;
+	for (const FTiledFloor& F : Asset->TiledFloors)
+	{
+		ValidatePlacements(F.BlockPlacements, EPlacedType::Block, F.FloorPosition, Report, WrongTiles);
+		ValidatePlacements(F.FloorPlacements, EPlacedType::Floor, F.FloorPosition, Report, WrongTiles);
+		ValidatePlacements(F.WallPlacements, EPlacedType::Wall, F.FloorPosition, Report, WrongEdges);
+		ValidatePlacements(F.EdgePlacements, EPlacedType::Edge, F.FloorPosition, Report, WrongEdges);
+		ValidatePlacements(F.PillarPlacements, EPlacedType::Pillar, F.FloorPosition, Report, WrongPoints);
+		ValidatePlacements(F.PointPlacements, EPlacedType::Point, F.FloorPosition, Report, WrongPoints);
+	}
+	if (!bFix || !Report.HasInvalidPlacements()) return;
+	
+	Asset->Modify();
+	Asset->RemovePlacements(WrongTiles);
+	Asset->RemovePlacements(WrongEdges);
+	Asset->RemovePlacements(WrongPoints);
+	Asset->ClearInvalidPlacements();
+	Asset->MarkOccupancyIndexDirty();
+	Asset->VersionNumber++;
+	Report.bFixed = true;
+}
+
+static bool SaveAssetPackage(UObject* Asset)
+{
+	UPackage* Package = Asset->GetOutermost();
+	const FString FileName = FPackageName::LongPackageNameToFilename(Package->GetName(), FPackageName::GetAssetPackageExtension());
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.Error = GWarn;
+	return UPackage::SavePackage(Package, Asset, *FileName, SaveArgs);
+}
+
+static void MergeAssets(const TArray<UTiledLevelAsset*>& Assets, const FString& OutputPath, TArray<FTiledAssetReport*>& Reports)
+{
+	// merge reads actors spawned by the host level, so every asset gets one in a preview world
+	FPreviewScene PreviewScene;
+	TArray<ATiledLevel*> HostLevels;
+	TArray<FString> MeshPackageNames;
+	for (int32 i = 0; i < Assets.Num(); i++)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.bNoFail = true;
+		ATiledLevel* Level = PreviewScene.GetWorld()->SpawnActor<ATiledLevel>(SpawnParams);
+		Level->SetActiveAsset(Assets[i]);
+		Level->ResetAllInstance(true);
+		Assets[i]->HostLevel = Level;
+		HostLevels.Add(Level);
+		const FString MeshPath = OutputPath.IsEmpty()? FPackageName::GetLongPackagePath(Assets[i]->GetOutermost()->GetName()) : OutputPath;
+		MeshPackageNames.Add(MeshPath / Assets[i]->GetName() + TEXT("_Merged"));
+	}
+
+	const TArray<FTiledBatchMergeResult> Results = FTiledLevelEditorUtility::MergeTiledLevelAssets(Assets, MeshPackageNames);
+	for (int32 i = 0; i < Assets.Num(); i++)
+	{
+		FTiledAssetReport& Report = *Reports[i];
+		Report.Merge = Results[i];
+		Report.MeshPath = MeshPackageNames[i];
+		Report.bMerged = Results[i].Mesh && SaveAssetPackage(Results[i].Mesh);
+		Assets[i]->HostLevel = nullptr;
+		HostLevels[i]->Destroy();
+	}
+}
+
+// asset and package paths can hold anything, the writer takes care of escaping
+static FString ReportsToJson(const TArray<FTiledAssetReport>& Reports, const FString& Path, double TotalSeconds)
+{
+	FString Json;
+	const TSharedRef<TJsonWriter<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TPrettyJsonPrintPolicy<TCHAR>>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Writer->WriteValue(TEXT("path"), Path);
+	Writer->WriteValue(TEXT("total_seconds"), TotalSeconds);
+	Writer->WriteArrayStart(TEXT("assets"));
+	for (const FTiledAssetReport& R : Reports)
+	{
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("asset"), R.AssetPath);
+		Writer->WriteValue(TEXT("placements"), R.NumPlacements);
+		Writer->WriteValue(TEXT("missing_items"), R.NumMissingItems);
+		Writer->WriteValue(TEXT("wrong_type"), R.NumWrongType);
+		Writer->WriteValue(TEXT("wrong_floor"), R.NumWrongFloor);
+		Writer->WriteValue(TEXT("fixed"), R.bFixed);
+		Writer->WriteValue(TEXT("mesh"), R.MeshPath);
+		Writer->WriteValue(TEXT("merged"), R.bMerged);
+		Writer->WriteValue(TEXT("prepare_ms"), R.Merge.PrepareSeconds * 1000.0);
+		Writer->WriteValue(TEXT("build_ms"), R.Merge.BuildSeconds * 1000.0);
+		Writer->WriteValue(TEXT("finish_ms"), R.Merge.FinishSeconds * 1000.0);
+		Writer->WriteArrayStart(TEXT("triangles"));
+		for (const int32 NumTriangles : R.Merge.NumTriangles)
+			Writer->WriteValue(NumTriangles);
+		Writer->WriteArrayEnd();
+		Writer->WriteObjectEnd();
+	}
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+	Writer->Close();
+	return Json;
+}
+
+UTiledLevelCommandlet::UTiledLevelCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UTiledLevelCommandlet::Main(const FString& Params)
+{
+	FString Path = TEXT("/Game");
+	FString OutputPath;
+	FString ReportFile = FPaths::ProjectSavedDir() / TEXT("TiledLevelReports") /
+		FString::Printf(TEXT("TiledLevelCommandlet-%s.json"), *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+	FParse::Value(*Params, TEXT("path="), Path);
+	FParse::Value(*Params, TEXT("output="), OutputPath);
+	FParse::Value(*Params, TEXT("report="), ReportFile);
+	const bool bFix = FParse::Param(*Params, TEXT("fix"));
+	const bool bMerge = FParse::Param(*Params, TEXT("merge"));
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	AssetRegistry.SearchAllAssets(true);
+	FARFilter Filter;
+	Filter.PackagePaths.Add(*Path);
+	Filter.bRecursivePaths = true;
+	Filter.ClassPaths.Add(UTiledLevelAsset::StaticClass()->GetClassPathName());
+	TArray<FAssetData> AssetDatas;
+	AssetRegistry.GetAssets(Filter, AssetDatas);
+	AssetDatas.Sort([](const FAssetData& A, const FAssetData& B) { return A.PackageName.LexicalLess(B.PackageName); });
+	DEV_LOGF("TiledLevel commandlet: %d tiled level assets in %s%s%s", AssetDatas.Num(), *Path, bFix? TEXT(", fix") : TEXT(""), bMerge? TEXT(", merge") : TEXT(""))
+
+	const double StartTime = FPlatformTime::Seconds();
+	TArray<FTiledAssetReport> Reports;
+	Reports.SetNum(AssetDatas.Num());
+	int32 NumErrors = 0;
+	for (int32 BatchStart = 0; BatchStart < AssetDatas.Num(); BatchStart += CommandletBatchSize)
+	{
+		TArray<UTiledLevelAsset*> AssetsToMerge;
+		TArray<FTiledAssetReport*> MergeReports;
+		for (int32 i = BatchStart; i < FMath::Min(BatchStart + CommandletBatchSize, AssetDatas.Num()); i++)
+		{
+			FTiledAssetReport& Report = Reports[i];
+			Report.AssetPath = AssetDatas[i].GetObjectPathString();
+			UTiledLevelAsset* Asset = Cast<UTiledLevelAsset>(AssetDatas[i].GetAsset());
+			if (!Asset)
+			{
+				UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to load %s"), *Report.AssetPath);
+				NumErrors++;
+				continue;
+			}
+			ValidateAsset(Asset, bFix, Report);
+			if (Report.bFixed && !SaveAssetPackage(Asset))
+			{
+				UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to save fixed %s"), *Report.AssetPath);
+				NumErrors++;
+			}
+			else if (Report.HasInvalidPlacements() && !Report.bFixed)
+			{
+				UE_LOG(LogTiledLevelDev, Error, TEXT("%s: %d placements with missing items, %d with wrong placed type (run with -fix to remove them)"),
+					*Report.AssetPath, Report.NumMissingItems, Report.NumWrongType);
+				NumErrors++;
+			}
+			// placements with missing items have nothing to merge, leave the asset alone until it is fixed
+			if (bMerge && Asset->GetNumOfAllPlacements() > 0 && !(Report.HasInvalidPlacements() && !Report.bFixed))
+			{
+				AssetsToMerge.Add(Asset);
+				MergeReports.Add(&Report);
+			}
+		}
+		if (AssetsToMerge.Num() > 0)
+			MergeAssets(AssetsToMerge, OutputPath, MergeReports);
+		for (const FTiledAssetReport* Report : MergeReports)
+		{
+			if (Report->bMerged)
+			{
+				DEV_LOGF("%s: merged into %s, %d LODs, LOD0 %d triangles, build %.1f ms", *Report->AssetPath, *Report->MeshPath,
+					Report->Merge.NumTriangles.Num(), Report->Merge.NumTriangles.Num() > 0? Report->Merge.NumTriangles[0] : 0, Report->Merge.BuildSeconds * 1000.0)
+			}
+			else
+			{
+				UE_LOG(LogTiledLevelDev, Error, TEXT("%s: failed to merge into %s"), *Report->AssetPath, *Report->MeshPath);
+				NumErrors++;
+			}
+		}
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	const double TotalSeconds = FPlatformTime::Seconds() - StartTime;
+	if (!FFileHelper::SaveStringToFile(ReportsToJson(Reports, Path, TotalSeconds), *ReportFile))
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to write report to %s"), *ReportFile);
+		NumErrors++;
+	}
+	DEV_LOGF("TiledLevel commandlet done in %.1f s, %d errors, report: %s", TotalSeconds, NumErrors, *FPaths::ConvertRelativePathToFull(ReportFile))
+	return NumErrors > 0? 1 : 0;
+}
@@ -0,0 +1,24 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TiledLevelCommandlet.generated.h"
+
+/*
+ * Validate and merge tiled level assets without the editor UI, for build machines:
+ * UnrealEditor-Cmd <Project> -run=TiledLevel -path=/Game/Levels [-fix] [-merge] [-output=/Game/Merged] [-report=File] -nullrhi -unattended
+ * -fix: remove invalid placements and save the fixed assets
+ * -merge: merge every asset into <output>/<AssetName>_Merged (next to the asset by default) and save the meshes
+ * The report (json) has validation results, merge timings and triangle counts of each asset.
+ */
+UCLASS()
+class UTiledLevelCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTiledLevelCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
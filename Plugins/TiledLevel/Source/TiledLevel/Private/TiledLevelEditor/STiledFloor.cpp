@@ -20,6 +20,7 @@ void STiledFloor::Construct(const FArguments& InArgs, int32 InPosition, class UT
 	EyeOpened = FTiledLevelStyle::Get().GetBrush(EyeOpenedBrushName);
 
 	OnResetInstances = InArgs._OnResetInstances;
+	OnUpdateFloorVisibility = InArgs._OnUpdateFloorVisibility;
 
 	ChildSlot
 	[
@@ -70,7 +71,11 @@ FReply STiledFloor::OnToggleVisibility()
 	
  	FTiledFloor* MyFloor = GetMyFloor();
  	MyFloor->ShouldRenderInEditor = !MyFloor->ShouldRenderInEditor;
-	OnResetInstances.ExecuteIfBound();
+	// floors are instanced even when hidden, only need to flip the visibility
+	if (OnUpdateFloorVisibility.IsBound())
+		OnUpdateFloorVisibility.Execute();
+	else
+		OnResetInstances.ExecuteIfBound();
 	return FReply::Handled();
 }
 
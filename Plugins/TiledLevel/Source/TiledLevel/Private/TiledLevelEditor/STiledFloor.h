@@ -10,6 +10,7 @@ class TILEDLEVEL_API STiledFloor : public SCompoundWidget
 public:
 	SLATE_BEGIN_ARGS(STiledFloor) {}
 		SLATE_EVENT(FSimpleDelegate, OnResetInstances)
+		SLATE_EVENT(FSimpleDelegate, OnUpdateFloorVisibility)
 	SLATE_END_ARGS()
 
 	/** Constructs this widget with InArgs */
@@ -28,5 +29,6 @@ protected:
 	FSlateColor GetForegroundColorForVisibilityButton() const;
 	FReply OnToggleVisibility();
 	FSimpleDelegate OnResetInstances;
+	FSimpleDelegate OnUpdateFloorVisibility;
 	
 };
@@ -16,6 +16,7 @@ void STiledFloorList::Construct(const FArguments& InArgs, UTiledLevelAsset* InTi
 	TiledLevelAssetPtr = InTiledLevel;
 	NotifyHook = InNotifyHook;
 	OnResetInstances = InArgs._OnResetInstances;
+	OnUpdateFloorVisibility = InArgs._OnUpdateFloorVisibility;
 
 	FTiledLevelCommands::Register();
 	const FTiledLevelCommands& TiledLevelCommands = FTiledLevelCommands::Get();
@@ -257,7 +258,7 @@ TSharedRef<ITableRow> STiledFloorList::OnGenerateLayerListRow(FMirrorEntry Item,
 	TSharedRef<RowType> NewRow = SNew(RowType, OwnerTable)
 		.Style(&FTiledLevelStyle::Get().GetWidgetStyle<FTableRowStyle>("TiledLevel.LayerBrowser.TableViewRow"));
 	FIsSelected IsSelectedDelegate = FIsSelected::CreateSP(NewRow, &RowType::IsSelectedExclusively);
-	NewRow->SetContent(SNew(STiledFloor, *Item, TiledLevelAssetPtr.Get(), IsSelectedDelegate).OnResetInstances(OnResetInstances));
+	NewRow->SetContent(SNew(STiledFloor, *Item, TiledLevelAssetPtr.Get(), IsSelectedDelegate).OnResetInstances(OnResetInstances).OnUpdateFloorVisibility(OnUpdateFloorVisibility));
 	return NewRow;
 }
 
@@ -358,6 +359,7 @@ void STiledFloorList::ChangeFloorOrdering(int32 OldPosition, int32 NewPosition)
 					F.UpdatePosition(OldPosition, TiledLevelAsset->TileSizeZ);
 				}
 			}
+			TiledLevelAsset->MarkOccupancyIndexDirty();
 			PostEditNotifications(true);
 		}
 		TiledLevelAsset->VersionNumber += 1;
@@ -503,7 +505,7 @@ void STiledFloorList::HideAllFloors()
 		{
 			Floor.ShouldRenderInEditor = false;
 		}
-		PostEditNotifications(true);
+		PostFloorVisibilityChanged();
 	}
 }
 
@@ -518,7 +520,7 @@ void STiledFloorList::UnhideAllFloors()
 		{
 			Floor.ShouldRenderInEditor = true;
 		}
-		PostEditNotifications(true);
+		PostFloorVisibilityChanged();
 	}
 }
 
@@ -534,7 +536,7 @@ void STiledFloorList::HideOtherFloors()
 			if (Floor.FloorPosition != GetActiveFloor()->FloorPosition)
 				Floor.ShouldRenderInEditor = false;
 		}
-		PostEditNotifications(true);
+		PostFloorVisibilityChanged();
 	}
 }
 
@@ -550,7 +552,7 @@ void STiledFloorList::UnhideOtherFloors()
 			if (Floor.FloorPosition != GetActiveFloor()->FloorPosition)
 				Floor.ShouldRenderInEditor = true;
 		}
-		PostEditNotifications(true);
+		PostFloorVisibilityChanged();
 	}
 }
 
@@ -609,9 +611,21 @@ void STiledFloorList::ClearFloorContent() const
 	GetActiveFloor()->EdgePlacements.Empty();
 	GetActiveFloor()->PillarPlacements.Empty();
 	GetActiveFloor()->PointPlacements.Empty();
+	TiledLevelAssetPtr.Get()->MarkOccupancyIndexDirty();
 	OnResetInstances.Execute();
 }
 
+void STiledFloorList::PostFloorVisibilityChanged()
+{
+	if (!OnUpdateFloorVisibility.IsBound())
+	{
+		PostEditNotifications(true);
+		return;
+	}
+	PostEditNotifications(false);
+	OnUpdateFloorVisibility.Execute();
+}
+
 void STiledFloorList::PostEditNotifications(bool ShouldResetInstances)
 {
 	RefreshMirrorList();
@@ -18,6 +18,7 @@ class STiledFloorList : public SCompoundWidget, public FEditorUndoClient
 public:
 	SLATE_BEGIN_ARGS(STiledFloorList) {}
 		SLATE_EVENT(FSimpleDelegate, OnResetInstances)
+		SLATE_EVENT(FSimpleDelegate, OnUpdateFloorVisibility)
 	SLATE_END_ARGS()
 
 	void Construct(const FArguments& InArgs, UTiledLevelAsset* InTiledLevel, FNotifyHook* InNotifyHook, TSharedPtr<class FUICommandList> InParentCommandList );
@@ -46,6 +47,7 @@ private:
 	TWeakObjectPtr<UTiledLevelAsset> TiledLevelAssetPtr;
 	FNotifyHook* NotifyHook = nullptr;
 	FSimpleDelegate OnResetInstances;
+	FSimpleDelegate OnUpdateFloorVisibility;
 	TSharedPtr<class SExpandableArea> FloorListArea;
 	
 	int32 GetSelectionPosition() const;	
@@ -73,6 +75,7 @@ private:
 	bool HasOtherFloors() const;
 	void OnSelectionChanged(FMirrorEntry ItemChangingState, ESelectInfo::Type SelectInfo);
 	void ClearFloorContent() const;
+	void PostFloorVisibilityChanged();
 	void PostEditNotifications(bool ShouldResetInstances = false); // Called after edits are finished
 
 };
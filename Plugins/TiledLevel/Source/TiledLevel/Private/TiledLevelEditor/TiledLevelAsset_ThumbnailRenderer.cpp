@@ -6,7 +6,8 @@
 #include "TiledLevel.h"
 #include "TiledLevelAsset.h"
 #include "TiledLevelItem.h"
-#include "Kismet/GameplayStatics.h"
+#include "TiledLevelStats.h"
+#include "TiledThumbnailCache.h"
 #include "ThumbnailRendering/SceneThumbnailInfo.h"
 
 
@@ -14,18 +15,21 @@ FTiledLevelAsset_ThumbnailScene::FTiledLevelAsset_ThumbnailScene()
     : FThumbnailPreviewScene()
 {
     bForceAllUsedMipsResident = false;
+    // one preview level for every asset, SetAsset only swaps what it shows
+    FActorSpawnParameters SpawnParameters;
+    SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    SpawnParameters.bNoFail = true;
+    SpawnParameters.ObjectFlags = RF_Transactional;
+    PreviewActor = GetWorld()->SpawnActor<ATiledLevel>(SpawnParameters);
 }
 
 void FTiledLevelAsset_ThumbnailScene::SetAsset(UTiledLevelAsset* InTiledLevelAsset)
 {
     if (InTiledLevelAsset)
     {
-        FActorSpawnParameters SpawnParameters;
-        SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-        SpawnParameters.bNoFail = true;
-        SpawnParameters.ObjectFlags = RF_Transactional;
-        PreviewActor = GetWorld()->SpawnActor<ATiledLevel>(SpawnParameters);
+        // instances are diffed against what the previous asset left, the ones from shared items are kept
         PreviewActor->SetActiveAsset(InTiledLevelAsset);
+        PreviewActor->SetActorLocation(FVector::ZeroVector);
         PreviewActor->ResetAllInstance(true);
         FVector Origin, Extent;
         PreviewActor->GetActorBounds(false, Origin, Extent, true);
@@ -101,26 +105,20 @@ void UTiledLevelAsset_ThumbnailRenderer::Draw(UObject* Object, int32 X, int32 Y,
     }
 	if (TLA)
 	{
+		// unchanged content is drawn from the cache, no preview level involved
+		const FString ContentHash = FTiledThumbnailCache::GetContentHash(TLA);
+		if (FTiledThumbnailCache::Get().Draw(ContentHash, X, Y, Width, Height, Canvas))
+			return;
+
+		TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_ThumbnailRender);
+		INC_DWORD_STAT(STAT_TiledLevel_ThumbnailsRendered);
+		INC_DWORD_STAT_BY(STAT_TiledLevel_ThumbnailPlacements, TLA->GetNumOfAllPlacements());
 		if ( ThumbnailScene == nullptr )
 		{
 			ThumbnailScene = new FTiledLevelAsset_ThumbnailScene();
-            ThumbnailScene->SetAsset(TLA);
 		}
-	    if (ThumbnailScene->GetPreviewActor()->GetAsset() != TLA)
-	    {
-	        ThumbnailScene->SetAsset(TLA);
-	    }
-	    // Fix unknown issue that tiled level actor is stacked in same scene...
-	    if (UWorld* World = ThumbnailScene->GetPreviewActor()->GetWorld())
-	    {
-	        TArray<AActor*> OutActors;
-            UGameplayStatics::GetAllActorsOfClass(World, ATiledLevel::StaticClass(), OutActors);
-	        for (AActor* A : OutActors)
-	        {
-	            if (A != ThumbnailScene->GetPreviewActor())
-	                A->Destroy();
-	        }
-	    }
+		// a cache miss on the same asset means its content changed
+		ThumbnailScene->SetAsset(TLA);
 
 		FSceneViewFamilyContext ViewFamily( FSceneViewFamily::ConstructionValues( Viewport, ThumbnailScene->GetScene(), FEngineShowFlags(ESFIM_Game) )
 			.SetTime(UThumbnailRenderer::GetTime())
@@ -132,7 +130,7 @@ void UTiledLevelAsset_ThumbnailRenderer::Draw(UObject* Object, int32 X, int32 Y,
 
 		
 		RenderViewFamily(Canvas,&ViewFamily, ThumbnailScene->CreateView(&ViewFamily, X, Y, Width, Height));
-	    
+		FTiledThumbnailCache::Get().Store(ContentHash, X, Y, Width, Height, Viewport);
 	}
 
 }
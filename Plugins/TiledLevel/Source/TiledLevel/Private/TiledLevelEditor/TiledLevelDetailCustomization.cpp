@@ -189,6 +189,7 @@ void FTiledLevelDetailCustomization::CustomizeDetails(IDetailLayoutBuilder& Deta
 			[
 				SAssignNew(FloorListWidget, STiledFloorList, TiledLevelAsset, NotifyHook, CommandList)
 				.OnResetInstances(this, &FTiledLevelDetailCustomization::OnResetInstances)
+				.OnUpdateFloorVisibility(this, &FTiledLevelDetailCustomization::OnUpdateFloorVisibility)
 			]
 		];
 	}
@@ -374,6 +375,14 @@ void FTiledLevelDetailCustomization::OnResetInstances()
 	}
 }
 
+void FTiledLevelDetailCustomization::OnUpdateFloorVisibility()
+{
+	if (ATiledLevel* TiledLevelActor = TiledLevelActorPtr.Get())
+	{
+		TiledLevelActor->UpdateFloorVisibility();
+	}
+}
+
 FText FTiledLevelDetailCustomization::GetFloorSettingsHeadingText() const
 {
 	if (FloorListWidget.IsValid())
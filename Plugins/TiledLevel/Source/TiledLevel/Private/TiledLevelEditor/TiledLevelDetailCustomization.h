@@ -17,6 +17,7 @@ private:
 	TSharedPtr<class STiledFloorList> FloorListWidget;
 	
 	void OnResetInstances();
+	void OnUpdateFloorVisibility();
 	FText GetFloorSettingsHeadingText() const;
 	bool IsInstanced() const;
 	bool IsInEditor() const;
@@ -1419,56 +1419,29 @@ void FTiledLevelEdMode::EnterNewGrid(FIntVector NewTilePosition)
     if (ActiveEditTool == ETiledLevelEditTool::Fill)
     {
         if (SelectedItems.Num() == 0) return;
-        FIntPoint BoardSize = {ActiveAsset->X_Num, ActiveAsset->Y_Num};
         if (IsFillTiles)
         {
             CandidateFillTiles.Empty();
             if (IsTileAsFillBoundary)
             {
-                SetupFillBoardFromTiles();
-                FTiledLevelUtility::FloodFill(Board, BoardSize,CurrentTilePosition.X, CurrentTilePosition.Y, CandidateFillTiles);
+                UpdateFillBoardCache(EFillBoardType::TileBoundary);
+                Board = CachedFillBoard;
+                FTiledLevelUtility::FloodFill(Board, CurrentTilePosition.X, CurrentTilePosition.Y, CandidateFillTiles);
             }
             else
             {
-                // Init board
-                Board.Empty();
-                BoardSize = { ActiveAsset->X_Num,ActiveAsset->Y_Num };
-                TArray<int> Zeros;
-                Zeros.Init(0, ActiveAsset->Y_Num);
-                for (int i = 0; i < ActiveAsset->X_Num; i++)
-                    Board.Add(Zeros);
-                if (NeedGround)
-                    UpdateFillBoardFromGround();
-                // extract edge from 2D-shape placement
-                TArray<FTiledLevelEdge> BlockingEdges;
-                for (auto EdgePlacement : ActiveAsset->GetActiveFloor()->Get2DShapePlacements())
-                {
-                    int Extent = EdgePlacement.GetItem()->Extent.X;
-                    FTiledLevelEdge FirstEdge = EdgePlacement.Edge;
-                    FirstEdge.Z = 1;
-                    BlockingEdges.AddUnique(FirstEdge);            
-                    if (Extent != 1)
-                    {
-                        for (int e = 1; e < Extent; e++)
-                        {
-                            FTiledLevelEdge NewEdge = EdgePlacement.Edge.EdgeType == EEdgeType::Horizontal?
-                                FTiledLevelEdge(FirstEdge.X + e, FirstEdge.Y, 1, EEdgeType::Horizontal) :
-                                FTiledLevelEdge(FirstEdge.X, FirstEdge.Y + e, 1, EEdgeType::Vertical);
-                            BlockingEdges.AddUnique(NewEdge);
-                        }
-                    }
-                }
-                // implement fill
-                CandidateFillTiles.Empty();
-                FTiledLevelUtility::FloodFillByEdges(BlockingEdges, Board, BoardSize, CurrentTilePosition.X, CurrentTilePosition.Y, CandidateFillTiles);
+                UpdateFillBoardCache(EFillBoardType::EdgeBoundary);
+                Board = CachedFillBoard;
+                FTiledLevelUtility::FloodFillByEdges(CachedBlockingEdges, Board, CurrentTilePosition.X, CurrentTilePosition.Y, CandidateFillTiles);
             }
             Helper->UpdateFillPreviewGrids(CandidateFillTiles, ActiveAsset->ActiveFloorPosition, MaxZInFillItems);
         }
         else
         {
             CandidateFillTiles.Empty();
-            SetupFillBoardFromTiles();
-            FTiledLevelUtility::GetConsecutiveTiles(Board, BoardSize, CurrentTilePosition.X, CurrentTilePosition.Y, CandidateFillTiles);
+            UpdateFillBoardCache(EFillBoardType::Consecutive);
+            Board = CachedFillBoard;
+            FTiledLevelUtility::GetConsecutiveTiles(Board, CurrentTilePosition.X, CurrentTilePosition.Y, CandidateFillTiles);
             const TSet<FIntPoint> Region = TSet<FIntPoint>(CandidateFillTiles);
             CandidateFillEdges = FTiledLevelUtility::GetAreaEdges(Region, ActiveAsset->ActiveFloorPosition, true);
             CandidateFillEdges.Sort();
@@ -1630,7 +1603,7 @@ void FTiledLevelEdMode::SelectionStart(FEditorViewportClient* ViewportClient)
             }
         }
     }
-    ActiveLevel->ResetAllInstance(true);
+    ActiveLevel->UpdateFloorVisibility();
     SelectionHelper->Hide();
 }
 
@@ -1647,7 +1620,7 @@ void FTiledLevelEdMode::SelectionEnd(FEditorViewportClient* ViewportClient)
         F.ShouldRenderInEditor = CachedFloorsVisibility[i];
         i++;
     }
-    ActiveLevel->ResetAllInstance(true);
+    ActiveLevel->UpdateFloorVisibility();
     SelectionHelper->PopulateCopied();
     SelectionHelper->Unhide();
 }
@@ -1668,7 +1641,7 @@ void FTiledLevelEdMode::SelectionCanceled()
             F.ShouldRenderInEditor = CachedFloorsVisibility[i];
             i++;
         }
-        ActiveLevel->ResetAllInstance(true);
+        ActiveLevel->UpdateFloorVisibility();
     }
 }
 
@@ -1785,20 +1758,14 @@ void FTiledLevelEdMode::PaintCopiedInstances(bool bForTemplate)
     }
     
     for (FTilePlacement NewTile : NewTiles)
-    {
         ActiveAsset->AddNewTilePlacement(NewTile);
-        ActiveLevel->PopulateSinglePlacement(NewTile);
-    }
     for (FEdgePlacement NewEdge : NewEdges)
-    {
         ActiveAsset->AddNewEdgePlacement(NewEdge);
-        ActiveLevel->PopulateSinglePlacement(NewEdge);
-    }
     for (FPointPlacement NewPoint : NewPoints)
-    {
         ActiveAsset->AddNewPointPlacement(NewPoint);
-        ActiveLevel->PopulateSinglePlacement(NewPoint);
-    }
+    ActiveLevel->PopulatePlacements(NewTiles);
+    ActiveLevel->PopulatePlacements(NewEdges);
+    ActiveLevel->PopulatePlacements(NewPoints);
     UpdateStatics();
     
 }
@@ -1898,9 +1865,8 @@ void FTiledLevelEdMode::PaintItemInstance()
 }
 
 /*
-*  TODO: performance issue...
-*  Could have some performance issue when under stressful scene...
-*  However, I can not find room to improve...
+*  Overlapped placements come from asset occupancy index,
+*  so the cost depends on brush size rather than the number of placements in the level
 */
 bool FTiledLevelEdMode::PaintItemPreparation()
 {
@@ -1933,21 +1899,7 @@ bool FTiledLevelEdMode::PaintItemPreparation()
             for (auto& F: LastPlacedTiles)
                 if (FTiledLevelUtility::IsTilePlacementOverlapping(F, TestPlacement)) return false;
 
-            TArray<FTilePlacement> OverlappingPlacements;
-            if (ActiveItem->PlacedType == EPlacedType::Block)
-            {
-                OverlappingPlacements = ActiveAsset->GetAllBlockPlacements().FilterByPredicate([=](const FTilePlacement& Block)
-                {
-                    return FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Block);
-                });
-            }
-            else
-            {
-                OverlappingPlacements = ActiveAsset->GetAllFloorPlacements().FilterByPredicate([=](const FTilePlacement& Floor)
-                {
-                    return FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Floor);
-                });
-            }
+            TArray<FTilePlacement> OverlappingPlacements = ActiveAsset->GetOccupancyIndex().FindOverlappingTiles(TestPlacement.GridPosition, TestPlacement.Extent, ActiveItem->PlacedType);
         
             // check no placement -> pass
             if (OverlappingPlacements.Num() == 0)
@@ -1998,21 +1950,7 @@ bool FTiledLevelEdMode::PaintItemPreparation()
                     return false;
                 }
             }
-            TArray<FEdgePlacement> OverlappingPlacements;
-            if (ActiveItem->PlacedType == EPlacedType::Wall)
-            {
-                OverlappingPlacements = ActiveAsset->GetAllWallPlacements().FilterByPredicate([=](const FEdgePlacement& Wall)
-                {
-                    return FTiledLevelUtility::IsEdgePlacementOverlapping(TestPlacement, Wall);
-                });
-            }
-            else
-            {
-                OverlappingPlacements = ActiveAsset->GetAllEdgePlacements().FilterByPredicate([=](const FEdgePlacement& Wall)
-                {
-                    return FTiledLevelUtility::IsEdgePlacementOverlapping(TestPlacement, Wall);
-                });
-            }
+            TArray<FEdgePlacement> OverlappingPlacements = ActiveAsset->GetOccupancyIndex().FindOverlappingEdges(CurrentEdge, FIntVector(ActiveItem->Extent), ActiveItem->PlacedType);
             // Empty wall, pass
             if (OverlappingPlacements.Num() == 0)
             {
@@ -2059,21 +1997,7 @@ bool FTiledLevelEdMode::PaintItemPreparation()
             // const FIntVector ItemExtent = FIntVector(ActiveItem->Extent);
             for (auto& F: LastPlacedPoints)
                 if (FTiledLevelUtility::IsPointPlacementOverlapping(F, F.GetItem()->Extent.Z, TestPlacement, ActiveItem->Extent.Z)) return false;
-            TArray<FPointPlacement> OverlappingPlacements;
-            if (ActiveItem->PlacedType == EPlacedType::Pillar)
-            {
-                OverlappingPlacements = ActiveAsset->GetAllPillarPlacements().FilterByPredicate([=](const FPointPlacement& Pillar)
-                {
-                    return FTiledLevelUtility::IsPointPlacementOverlapping(TestPlacement, ActiveItem->Extent.Z, Pillar, Pillar.GetItem()->Extent.Z );
-                });
-            }
-            else
-            {
-                OverlappingPlacements = ActiveAsset->GetAllPointPlacements().FilterByPredicate([=](const FPointPlacement& Point)
-                {
-                    return FTiledLevelUtility::IsPointPlacementOverlapping(TestPlacement, ActiveItem->Extent.Z, Point, Point.GetItem()->Extent.Z);
-                });
-            }
+            TArray<FPointPlacement> OverlappingPlacements = ActiveAsset->GetOccupancyIndex().FindOverlappingPoints(CurrentTilePosition, ActiveItem->Extent.Z, ActiveItem->PlacedType);
         
             // check no placement -> pass
             if (OverlappingPlacements.Num() == 0)
@@ -2261,6 +2185,8 @@ void FTiledLevelEdMode::PerformFillTile()
     }
     
     TArray<FIntPoint> PointsToFill = CandidateFillTiles; // make a copy
+    // instances are added per pass in one batch, overlay items can still snap onto the normal ones
+    TArray<FTilePlacement> FilledTiles;
     
     bool CanPutFillItemInBoard = true;
     // fill normal items
@@ -2291,7 +2217,7 @@ void FTiledLevelEdMode::PerformFillTile()
                 
                 // populate instance and add new placement data
                 ActiveAsset->AddNewTilePlacement(NewTile);
-                ActiveLevel->PopulateSinglePlacement(NewTile); // must still populate placement one by one in order to make auto-snap work...
+                FilledTiles.Add(NewTile);
             }
             else
             {
@@ -2308,6 +2234,7 @@ void FTiledLevelEdMode::PerformFillTile()
             break;
         }
     }
+    ActiveLevel->PopulatePlacements(FilledTiles);
     
      // handle overlay items
     TArray<UTiledLevelItem*> OverlayItems = SelectedItems.FilterByPredicate([=](const UTiledLevelItem* Item)
@@ -2318,6 +2245,7 @@ void FTiledLevelEdMode::PerformFillTile()
     for (UTiledLevelItem* Item : OverlayItems)
     {
         PointsToFill = CandidateFillTiles;
+        FilledTiles.Reset();
         while (PointsToFill.Num() > 0)
         {
             RandValue = FMath::FRand();
@@ -2347,9 +2275,10 @@ void FTiledLevelEdMode::PerformFillTile()
                 
                 // populate instance and add new placement data
                 ActiveAsset->AddNewTilePlacement(NewTile);
-                ActiveLevel->PopulateSinglePlacement(NewTile);
+                FilledTiles.Add(NewTile);
             }
         }
+        ActiveLevel->PopulatePlacements(FilledTiles);
     }
     Helper->ResetBrush();
 }
@@ -2404,6 +2333,7 @@ void FTiledLevelEdMode::PerformFillEdge()
 
     
     TArray<FTiledLevelEdge> EdgesToFill = CandidateFillEdges; // make a copy
+    TArray<FEdgePlacement> FilledEdges;
     
     bool CanPutFillItemInBoard = true;
     // fill normal items
@@ -2437,7 +2367,7 @@ void FTiledLevelEdMode::PerformFillEdge()
                 NewEdge.TileObjectTransform = G.GetRelativeTransform(ActiveLevel->GetTransform());
                 // populate instance and add new placement data
                 ActiveAsset->AddNewEdgePlacement(NewEdge);
-                ActiveLevel->PopulateSinglePlacement(NewEdge);
+                FilledEdges.Add(NewEdge);
             }
             else
             {
@@ -2454,6 +2384,7 @@ void FTiledLevelEdMode::PerformFillEdge()
             break;
         }
     }
+    ActiveLevel->PopulatePlacements(FilledEdges);
     
      // handle overlay items
     TArray<UTiledLevelItem*> OverlayItems = SelectedItems.FilterByPredicate([=](const UTiledLevelItem* Item)
@@ -2463,6 +2394,7 @@ void FTiledLevelEdMode::PerformFillEdge()
     for (UTiledLevelItem* Item : OverlayItems)
     {
         EdgesToFill = CandidateFillEdges;
+        FilledEdges.Reset();
         while (EdgesToFill.Num() > 0)
         {
             RandValue = FMath::FRand();
@@ -2495,24 +2427,63 @@ void FTiledLevelEdMode::PerformFillEdge()
                 
                 // populate instance and add new placement data
                 ActiveAsset->AddNewEdgePlacement(NewEdge);
-                ActiveLevel->PopulateSinglePlacement(NewEdge);
+                FilledEdges.Add(NewEdge);
             }
         }
+        ActiveLevel->PopulatePlacements(FilledEdges);
     }
     Helper->ResetBrush();
     
 }
 
+void FTiledLevelEdMode::UpdateFillBoardCache(EFillBoardType BoardType)
+{
+    FFillBoardCacheKey NewKey;
+    NewKey.Asset = ActiveAsset;
+    NewKey.PlacementRevision = ActiveAsset->GetPlacementRevision();
+    NewKey.AssetVersion = ActiveAsset->VersionNumber;
+    NewKey.FloorPosition = ActiveAsset->ActiveFloorPosition;
+    NewKey.Size = FIntPoint(ActiveAsset->X_Num, ActiveAsset->Y_Num);
+    NewKey.BoardType = BoardType;
+    NewKey.NeedGround = NeedGround;
+    if (NewKey == FillBoardCacheKey) return;
+    FillBoardCacheKey = NewKey;
+
+    CachedBlockingEdges.Reset();
+    if (BoardType != EFillBoardType::EdgeBoundary)
+    {
+        SetupFillBoardFromTiles();
+        return;
+    }
+    CachedFillBoard.Init(NewKey.Size);
+    if (NeedGround)
+        UpdateFillBoardFromGround();
+    // extract edge from 2D-shape placement
+    for (auto EdgePlacement : ActiveAsset->GetActiveFloor()->Get2DShapePlacements())
+    {
+        int Extent = EdgePlacement.GetItem()->Extent.X;
+        FTiledLevelEdge FirstEdge = EdgePlacement.Edge;
+        FirstEdge.Z = 1;
+        CachedBlockingEdges.Add(FirstEdge);            
+        if (Extent != 1)
+        {
+            for (int e = 1; e < Extent; e++)
+            {
+                FTiledLevelEdge NewEdge = EdgePlacement.Edge.EdgeType == EEdgeType::Horizontal?
+                    FTiledLevelEdge(FirstEdge.X + e, FirstEdge.Y, 1, EEdgeType::Horizontal) :
+                    FTiledLevelEdge(FirstEdge.X, FirstEdge.Y + e, 1, EEdgeType::Vertical);
+                CachedBlockingEdges.Add(NewEdge);
+            }
+        }
+    }
+}
+
 void FTiledLevelEdMode::SetupFillBoardFromTiles()
 {
     // Init board
-    Board.Empty();
-    TArray<int> Zeros;
-    Zeros.Init(0, ActiveAsset->Y_Num);
-    for (int i = 0; i < ActiveAsset->X_Num; i++)
-        Board.Add(Zeros);
+    CachedFillBoard.Init(FIntPoint(ActiveAsset->X_Num, ActiveAsset->Y_Num));
     // fill in board value by tile placements
-    for (auto Block : ActiveAsset->GetActiveFloor()->GetTilePlacements())
+    for (const FTilePlacement& Block : ActiveAsset->GetActiveFloor()->GetTilePlacements())
     {
         int tile_x = Block.GridPosition.X;
         int tile_y = Block.GridPosition.Y;
@@ -2520,7 +2491,8 @@ void FTiledLevelEdMode::SetupFillBoardFromTiles()
         {
             for (int y = tile_y; y < tile_y + Block.Extent.Y; y++)
             {
-                Board[x][y] = 1;
+                if (CachedFillBoard.IsInside(x, y))
+                    CachedFillBoard.Set(x, y, true);
             } 
         }
     }
@@ -2535,8 +2507,9 @@ void FTiledLevelEdMode::UpdateFillBoardFromGround()
 {
     if (FTiledFloor* BelowFloor = ActiveAsset->GetBelowActiveFloor())
     {
-        TArray<FIntPoint> ExistingBelowTiles;
-        for (auto Block : BelowFloor->GetTilePlacements())
+        // mark the tiles below first, instead of searching them for every tile
+        FTiledFillBoard BelowTiles(CachedFillBoard.GetSize());
+        for (const FTilePlacement& Block : BelowFloor->GetTilePlacements())
         {
             int tile_x = Block.GridPosition.X;
             int tile_y = Block.GridPosition.Y;
@@ -2544,7 +2517,8 @@ void FTiledLevelEdMode::UpdateFillBoardFromGround()
             {
                 for (int y = tile_y; y < tile_y + Block.Extent.Y; y++)
                 {
-                    ExistingBelowTiles.AddUnique(FIntPoint(x, y));
+                    if (BelowTiles.IsInside(x, y))
+                        BelowTiles.Set(x, y, true);
                 } 
             }
         }
@@ -2552,8 +2526,8 @@ void FTiledLevelEdMode::UpdateFillBoardFromGround()
         {
             for (int y = 0; y < ActiveAsset->Y_Num; y++)
             {
-                if (!ExistingBelowTiles.Contains(FIntPoint(x, y)))
-                    Board[x][y] = 1;
+                if (!BelowTiles.Get(x, y))
+                    CachedFillBoard.Set(x, y, true);
             } 
         }
     }
@@ -3,6 +3,7 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "TiledLevelTypes.h"
+#include "TiledLevelUtility.h"
 #include "EdMode.h"
 
 class UTiledLevelItem;
@@ -23,6 +24,14 @@ enum ETiledLevelEditTool
 	Fill
 };
 
+// what occupies the fill board, tiles block tile fill / are the region of edge fill, edges block tile fill
+enum class EFillBoardType : uint8
+{
+	TileBoundary,
+	EdgeBoundary,
+	Consecutive
+};
+
 enum ETiledLevelBrushAction
 {
 	None,
@@ -158,6 +167,7 @@ private:
 	void PerformEyedropper();
 	void PerformFillTile();
 	void PerformFillEdge();
+	void UpdateFillBoardCache(EFillBoardType BoardType);
 	void SetupFillBoardFromTiles();
 	void UpdateFillBoardFromGround();
 	template <typename T>
@@ -213,7 +223,27 @@ private:
 	TArray<bool> CachedFloorsVisibility;
 
 	// Fill tool params
-	TArray<TArray<int>> Board;
+	FTiledFillBoard Board;
+	// occupancy part of the fill board, only rebuilt when anything in its key changes, hover just floods a copy of it
+	struct FFillBoardCacheKey
+	{
+		const UTiledLevelAsset* Asset = nullptr;
+		uint32 PlacementRevision = 0;
+		uint32 AssetVersion = 0;
+		int32 FloorPosition = 0;
+		FIntPoint Size = FIntPoint(0, 0);
+		EFillBoardType BoardType = EFillBoardType::TileBoundary;
+		bool NeedGround = false;
+
+		bool operator==(const FFillBoardCacheKey& Other) const
+		{
+			return Asset == Other.Asset && PlacementRevision == Other.PlacementRevision && AssetVersion == Other.AssetVersion &&
+				FloorPosition == Other.FloorPosition && Size == Other.Size && BoardType == Other.BoardType && NeedGround == Other.NeedGround;
+		}
+	};
+	FFillBoardCacheKey FillBoardCacheKey;
+	FTiledFillBoard CachedFillBoard;
+	TSet<FTiledLevelEdge> CachedBlockingEdges;
 	TArray<FIntPoint> CandidateFillTiles;
 	TArray<FTiledLevelEdge> CandidateFillEdges;
 	int MaxZInFillItems = 1;
@@ -4,6 +4,8 @@
 #include "TiledLevelEditorUtility.h"
 #include "TiledLevelAsset.h"
 #include "TiledLevel.h"
+#include "TiledLevelEditorLog.h"
+#include "TiledLevelUtility.h"
 
 #include "AssetToolsModule.h"
 #include "KismetProceduralMeshLibrary.h"
@@ -13,10 +15,148 @@
 #include "AssetRegistry/AssetRegistryModule.h"
 #include "Dialogs/DlgPickAssetPath.h"
 #include "UObject/SavePackage.h"
+#include "DerivedDataCacheInterface.h"
+#include "HAL/IConsoleManager.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "ScopedTransaction.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Containers/Ticker.h"
+#include "Framework/Notifications/NotificationManager.h"
+#include "Widgets/Notifications/SNotificationList.h"
 
 #define LOCTEXT_NAMESPACE "TiledLevel"
 
-UStaticMesh* FTiledLevelEditorUtility::MergeTiledLevelAsset(UTiledLevelAsset* TargetAsset)
+// Change this guid when the merge output or the cached data layout changes
+#define TILEDLEVEL_MERGE_DERIVEDDATA_VER TEXT("8E2C4B1A7F3D4E9A9C6B5D2E1F0A3B47")
+
+static TAutoConsoleVariable<bool> CVarUseMergeCache(
+	TEXT("TiledLevel.UseMergeCache"),
+	true,
+	TEXT("Reuse merged tiled level mesh data from the derived data cache when the asset content is unchanged."));
+
+// what a merged LOD needs from the proc mesh
+struct FTiledMergedLODData
+{
+	FMeshDescription MeshDescription;
+	TArray<TArray<FVector>> ConvexVertices;
+	TArray<FString> SectionMaterials;
+};
+
+static void SaveMergedLOD(FTiledMergedLODData& Data, TArray<uint8>& OutBytes)
+{
+	// mesh description depends on custom versions, which a plain memory archive doesn't store
+	TArray<uint8> MeshBytes;
+	FMemoryWriter MeshWriter(MeshBytes, true);
+	Data.MeshDescription.Serialize(MeshWriter);
+	FCustomVersionContainer MeshVersions = MeshWriter.GetCustomVersions();
+
+	FMemoryWriter Writer(OutBytes, true);
+	MeshVersions.Serialize(Writer);
+	Writer << MeshBytes;
+	Writer << Data.ConvexVertices;
+	Writer << Data.SectionMaterials;
+}
+
+static bool LoadMergedLOD(const TArray<uint8>& Bytes, FTiledMergedLODData& OutData)
+{
+	FMemoryReader Reader(Bytes, true);
+	FCustomVersionContainer MeshVersions;
+	MeshVersions.Serialize(Reader);
+	TArray<uint8> MeshBytes;
+	Reader << MeshBytes;
+	Reader << OutData.ConvexVertices;
+	Reader << OutData.SectionMaterials;
+	if (Reader.IsError()) return false;
+
+	FMemoryReader MeshReader(MeshBytes, true);
+	MeshReader.SetCustomVersions(MeshVersions);
+	OutData.MeshDescription.Serialize(MeshReader);
+	return !MeshReader.IsError();
+}
+
+// One merge: prepared on game thread, LODs built on any thread, and the asset created back on game thread
+struct FTiledMergeJob
+{
+	TWeakObjectPtr<UTiledLevelAsset> Asset;
+	FString AssetName;
+	FString PackageName;
+	FName MeshName;
+	FString ContentHash;
+	TArray<TSharedRef<FTiledMergeSource>> Sources; // per LOD
+	TArray<FTiledMergedLODData> Results; // per LOD
+	TAtomic<bool> bCancelled{false};
+	TAtomic<bool> bFinished{false};
+	TAtomic<int32> NumBuiltLODs{0};
+	// async finish on game thread: the created mesh, built and then collision cooked before it's handed out
+	TWeakObjectPtr<UStaticMesh> Mesh;
+	bool bMeshCreated = false;
+	bool bCookingCollision = false;
+	bool bCollisionCooked = false;
+};
+
+static void BuildMergedLOD(FTiledMergeJob& Job, int LOD)
+{
+	FTiledMergedLODData& OutData = Job.Results[LOD];
+	const bool bUseCache = CVarUseMergeCache.GetValueOnAnyThread();
+	const FString CacheKey = FDerivedDataCacheInterface::BuildCacheKey(TEXT("TILEDLEVELMERGE"), TILEDLEVEL_MERGE_DERIVEDDATA_VER,
+		*FString::Printf(TEXT("%s_LOD%d"), *Job.ContentHash, LOD));
+	if (bUseCache)
+	{
+		TArray<uint8> CachedBytes;
+		if (GetDerivedDataCacheRef().GetSynchronous(*CacheKey, CachedBytes, Job.AssetName) && LoadMergedLOD(CachedBytes, OutData))
+		{
+			DEV_LOGF("Merge %s LOD %d: use cached data", *Job.AssetName, LOD)
+			return;
+		}
+		OutData = FTiledMergedLODData();
+	}
+
+	OutData.MeshDescription = FTiledLevelUtility::BuildMergedMeshDescription(*Job.Sources[LOD], OutData.ConvexVertices, OutData.SectionMaterials, &Job.bCancelled);
+	if (Job.bCancelled) return;
+
+	if (bUseCache)
+	{
+		TArray<uint8> Bytes;
+		SaveMergedLOD(OutData, Bytes);
+		GetDerivedDataCacheRef().Put(*CacheKey, Bytes, Job.AssetName);
+	}
+}
+
+static void RunMergeJob(FTiledMergeJob& Job)
+{
+	for (int LOD = 0; LOD < Job.Sources.Num(); LOD++)
+	{
+		if (Job.bCancelled) break;
+		BuildMergedLOD(Job, LOD);
+		Job.NumBuiltLODs++;
+	}
+	Job.bFinished = true;
+}
+
+static TSharedPtr<FTiledMergeJob> MakeMergeJob(UTiledLevelAsset* TargetAsset, const FString& PackageName, FName MeshName)
+{
+	int MaxLOD = 1;
+	for ( UStaticMesh* SMPtr : TargetAsset->GetUsedStaticMeshSet())
+	{
+		MaxLOD = FMath::Max(SMPtr->GetNumLODs(), MaxLOD);
+	}
+
+	TSharedPtr<FTiledMergeJob> Job = MakeShared<FTiledMergeJob>();
+	Job->Asset = TargetAsset;
+	Job->AssetName = TargetAsset->GetName();
+	Job->PackageName = PackageName;
+	Job->MeshName = MeshName;
+	Job->ContentHash = FTiledLevelUtility::GetMergeContentHash(TargetAsset);
+	for (int LOD = 0; LOD < MaxLOD; LOD ++)
+		Job->Sources.Add(FTiledLevelUtility::PrepareMergeSource(TargetAsset, LOD));
+	Job->Results.SetNum(MaxLOD);
+	return Job;
+}
+
+static TSharedPtr<FTiledMergeJob> PrepareMergeJob(UTiledLevelAsset* TargetAsset)
 {
 	// if it's empty asset, just stop here
 	if (TargetAsset->GetNumOfAllPlacements() == 0)
@@ -34,93 +174,251 @@ UStaticMesh* FTiledLevelEditorUtility::MergeTiledLevelAsset(UTiledLevelAsset* Ta
 		 .Title(LOCTEXT("ConvertToStaticMeshPickName", "Choose New StaticMesh Location"))
 		 .DefaultAssetPath(FText::FromString(PackageName));
 
-	if (PickAssetPathWidget->ShowModal() == EAppReturnType::Ok)
+	if (PickAssetPathWidget->ShowModal() != EAppReturnType::Ok)
+		return nullptr;
+	
+	// Get the full name of where we want to create the physics asset.
+	FString UserPackageName = PickAssetPathWidget->GetFullAssetPath().ToString();
+	FName MeshName(*FPackageName::GetLongPackageAssetName(UserPackageName));
+
+	// Check if the user inputed a valid asset name, if they did not, give it the generated default name
+	if (MeshName == NAME_None)
 	{
-		 // Get the full name of where we want to create the physics asset.
-		 FString UserPackageName = PickAssetPathWidget->GetFullAssetPath().ToString();
-		 FName MeshName(*FPackageName::GetLongPackageAssetName(UserPackageName));
-
-		 // Check if the user inputed a valid asset name, if they did not, give it the generated default name
-		 if (MeshName == NAME_None)
-		 {
-			 // Use the defaults that were already generated.
-			 UserPackageName = PackageName;
-			 MeshName = *Name;
-		 }
-		int MaxLOD = 1;
-		for ( UStaticMesh* SMPtr : TargetAsset->GetUsedStaticMeshSet())
+		// Use the defaults that were already generated.
+		UserPackageName = PackageName;
+		MeshName = *Name;
+	}
+	return MakeMergeJob(TargetAsset, UserPackageName, MeshName);
+}
+
+// new mesh asset from the merged LODs, neither its render data nor its collision is built yet
+static UStaticMesh* CreateMergedMesh(FTiledMergeJob& Job)
+{
+	if (Job.bCancelled || !Job.Asset.IsValid())
+		return nullptr;
+	
+	// Then find/create it.
+	UPackage* Package = CreatePackage(*Job.PackageName);
+	check(Package);
+
+	// Create StaticMesh object
+	UStaticMesh* StaticMesh = NewObject<UStaticMesh>(Package, Job.MeshName, RF_Public | RF_Standalone);
+	StaticMesh->InitResources();
+
+	StaticMesh->SetLightingGuid(FGuid::NewGuid());
+	for (int LOD = 0; LOD < Job.Results.Num(); LOD ++)
+	{
+		FTiledMergedLODData& LODData = Job.Results[LOD];
+		FMeshDescription& MeshDescription = LODData.MeshDescription;
+
+		// If we got some valid data.
+		if (MeshDescription.Polygons().Num() == 0) continue;
+		
+		// Add source to new StaticMesh
+		FStaticMeshSourceModel& SrcModel = StaticMesh->AddSourceModel();
+		SrcModel.BuildSettings.bRecomputeNormals = false;
+		SrcModel.BuildSettings.bRecomputeTangents = false;
+		SrcModel.BuildSettings.bRemoveDegenerates = false;
+		SrcModel.BuildSettings.bUseHighPrecisionTangentBasis = false;
+		SrcModel.BuildSettings.bUseFullPrecisionUVs = false;
+		SrcModel.BuildSettings.bGenerateLightmapUVs = true;
+		SrcModel.BuildSettings.SrcLightmapIndex = 0;
+		SrcModel.BuildSettings.DstLightmapIndex = 1;
+		StaticMesh->CreateMeshDescription(LOD, MoveTemp(MeshDescription));
+		StaticMesh->CommitMeshDescription(LOD);
+
+		//// SIMPLE COLLISION
+
+		StaticMesh->CreateBodySetup();
+		UBodySetup* NewBodySetup = StaticMesh->GetBodySetup();
+		NewBodySetup->BodySetupGuid = FGuid::NewGuid();
+		NewBodySetup->AggGeom.ConvexElems.Reset();
+		for (const TArray<FVector>& ConvexVerts : LODData.ConvexVertices)
+		{
+			// same as UProceduralMeshComponent::AddCollisionConvexMesh
+			FKConvexElem NewConvexElem;
+			NewConvexElem.VertexData = ConvexVerts;
+			NewConvexElem.ElemBox = FBox(NewConvexElem.VertexData);
+			NewBodySetup->AggGeom.ConvexElems.Add(NewConvexElem);
+		}
+		NewBodySetup->bGenerateMirroredCollision = false;
+		NewBodySetup->bDoubleSidedGeometry = true;
+		NewBodySetup->CollisionTraceFlag = CTF_UseDefault;
+
+		//// MATERIALS
+		TSet<UMaterialInterface*> UniqueMaterials;
+		for (const FString& MaterialPath : LODData.SectionMaterials)
+		{
+			UMaterialInterface *Material = MaterialPath.IsEmpty()? nullptr : LoadObject<UMaterialInterface>(nullptr, *MaterialPath);
+			UniqueMaterials.Add(Material);
+		}
+		// Copy materials to new mesh
+		for (auto* Material : UniqueMaterials)
 		{
-			MaxLOD = FMath::Max(SMPtr->GetNumLODs(), MaxLOD);
+			StaticMesh->GetStaticMaterials().Add(FStaticMaterial(Material));
 		}
-		// Then find/create it.
-		UPackage* Package = CreatePackage(*UserPackageName);
-		check(Package);
 
-		// Create StaticMesh object
-		UStaticMesh* StaticMesh = NewObject<UStaticMesh>(Package, MeshName, RF_Public | RF_Standalone);
-		StaticMesh->InitResources();
+		//Set the Imported version before calling the build
+		StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
+	}
+	return StaticMesh;
+}
+
+static UStaticMesh* FinishMergeJob(FTiledMergeJob& Job)
+{
+	UStaticMesh* StaticMesh = CreateMergedMesh(Job);
+	if (!StaticMesh)
+		return nullptr;
+	if (UBodySetup* BodySetup = StaticMesh->GetBodySetup())
+		BodySetup->CreatePhysicsMeshes();
+	// Build mesh from source
+	StaticMesh->Build(false);
+	StaticMesh->PostEditChange();
+
+	// Notify asset registry of new asset
+	FAssetRegistryModule::AssetCreated(StaticMesh);
+	return StaticMesh;
+}
 
-		StaticMesh->SetLightingGuid(FGuid::NewGuid());
-		for (int LOD = 0; LOD < MaxLOD; LOD ++)
+// FinishMergeJob spread over ticks: render data is built by the static mesh compiling manager and collision is cooked
+// in background (complex collision needs the render data, so after it). Returns false until the mesh is ready
+static bool TickFinishMergeJob(const TSharedPtr<FTiledMergeJob>& Job)
+{
+	if (!Job->bMeshCreated)
+	{
+		Job->bMeshCreated = true;
+		Job->Mesh = CreateMergedMesh(*Job);
+		// doesn't wait for the build when async static mesh compilation is on
+		if (Job->Mesh.IsValid())
+			Job->Mesh->Build(true);
+	}
+	UStaticMesh* StaticMesh = Job->Mesh.Get();
+	if (!StaticMesh)
+		return true;
+	if (StaticMesh->IsCompiling())
+		return false;
+	UBodySetup* BodySetup = StaticMesh->GetBodySetup();
+	if (BodySetup && !Job->bCollisionCooked)
+	{
+		if (!Job->bCookingCollision)
 		{
-			UProceduralMeshComponent* ProcMeshComp = FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(TargetAsset, LOD);
-			FMeshDescription MeshDescription = FTiledLevelUtility::BuildMeshDescription(ProcMeshComp);
-
-			 // If we got some valid data.
-			if (MeshDescription.Polygons().Num() == 0) continue;
-			
-			 // Add source to new StaticMesh
-			 FStaticMeshSourceModel& SrcModel = StaticMesh->AddSourceModel();
-			 SrcModel.BuildSettings.bRecomputeNormals = false;
-			 SrcModel.BuildSettings.bRecomputeTangents = false;
-			 SrcModel.BuildSettings.bRemoveDegenerates = false;
-			 SrcModel.BuildSettings.bUseHighPrecisionTangentBasis = false;
-			 SrcModel.BuildSettings.bUseFullPrecisionUVs = false;
-			 SrcModel.BuildSettings.bGenerateLightmapUVs = true;
-			 SrcModel.BuildSettings.SrcLightmapIndex = 0;
-			 SrcModel.BuildSettings.DstLightmapIndex = 1;
-			 StaticMesh->CreateMeshDescription(LOD, MoveTemp(MeshDescription));
-			 StaticMesh->CommitMeshDescription(LOD);
-
-			 //// SIMPLE COLLISION
-
-			  StaticMesh->CreateBodySetup();
-			  UBodySetup* NewBodySetup = StaticMesh->GetBodySetup();
-			  NewBodySetup->BodySetupGuid = FGuid::NewGuid();
-			  NewBodySetup->AggGeom.ConvexElems = ProcMeshComp->ProcMeshBodySetup->AggGeom.ConvexElems;
-			  NewBodySetup->bGenerateMirroredCollision = false;
-			  NewBodySetup->bDoubleSidedGeometry = true;
-			  NewBodySetup->CollisionTraceFlag = CTF_UseDefault;
-			  NewBodySetup->CreatePhysicsMeshes();
-
-			 //// MATERIALS
-			 TSet<UMaterialInterface*> UniqueMaterials;
-			 const int32 NumSections = ProcMeshComp->GetNumSections();
-			 for (int32 SectionIdx = 0; SectionIdx < NumSections; SectionIdx++)
-			 {
-				 FProcMeshSection *ProcSection =
-					  ProcMeshComp->GetProcMeshSection(SectionIdx);
-				 UMaterialInterface *Material = ProcMeshComp->GetMaterial(SectionIdx);
-				 UniqueMaterials.Add(Material);
-			 }
-			 // Copy materials to new mesh
-			 for (auto* Material : UniqueMaterials)
-			 {
-				 StaticMesh->GetStaticMaterials().Add(FStaticMaterial(Material));
-			 }
-
-			 //Set the Imported version before calling the build
-			 StaticMesh->ImportVersion = EImportStaticMeshVersion::LastVersion;
+			Job->bCookingCollision = true;
+			BodySetup->CreatePhysicsMeshesAsync(FOnAsyncPhysicsCookFinished::CreateLambda([Job](bool)
+			{
+				Job->bCollisionCooked = true;
+			}));
 		}
-		// Build mesh from source
-		StaticMesh->Build(false);
-		StaticMesh->PostEditChange();
+		return false;
+	}
+	// no PostEditChange, it would build the mesh again and wait for it
+	StaticMesh->MarkPackageDirty();
+	return true;
+}
 
-		// Notify asset registry of new asset
-		FAssetRegistryModule::AssetCreated(StaticMesh);
-		return StaticMesh;
+UStaticMesh* FTiledLevelEditorUtility::MergeTiledLevelAsset(UTiledLevelAsset* TargetAsset)
+{
+	TSharedPtr<FTiledMergeJob> Job = PrepareMergeJob(TargetAsset);
+	if (!Job) return nullptr;
+	RunMergeJob(*Job);
+	return FinishMergeJob(*Job);
+}
+
+TArray<FTiledBatchMergeResult> FTiledLevelEditorUtility::MergeTiledLevelAssets(const TArray<UTiledLevelAsset*>& TargetAssets,
+	const TArray<FString>& MeshPackageNames)
+{
+	check(TargetAssets.Num() == MeshPackageNames.Num());
+	TArray<FTiledBatchMergeResult> Results;
+	Results.SetNum(TargetAssets.Num());
+	TArray<TSharedPtr<FTiledMergeJob>> Jobs;
+	Jobs.SetNum(TargetAssets.Num());
+	for (int32 i = 0; i < TargetAssets.Num(); i++)
+	{
+		if (!TargetAssets[i] || !TargetAssets[i]->HostLevel || TargetAssets[i]->GetNumOfAllPlacements() == 0) continue;
+		const double StartTime = FPlatformTime::Seconds();
+		Jobs[i] = MakeMergeJob(TargetAssets[i], MeshPackageNames[i], *FPackageName::GetLongPackageAssetName(MeshPackageNames[i]));
+		Results[i].PrepareSeconds = FPlatformTime::Seconds() - StartTime;
+	}
+
+	// one asset per task, each one is parallel inside as well (TiledLevel.ParallelMeshMerge)
+	ParallelFor(Jobs.Num(), [&Jobs, &Results](int32 i)
+	{
+		if (!Jobs[i]) return;
+		const double StartTime = FPlatformTime::Seconds();
+		RunMergeJob(*Jobs[i]);
+		Results[i].BuildSeconds = FPlatformTime::Seconds() - StartTime;
+	});
+
+	for (int32 i = 0; i < Jobs.Num(); i++)
+	{
+		if (!Jobs[i]) continue;
+		for (const FTiledMergedLODData& LODData : Jobs[i]->Results)
+			Results[i].NumTriangles.Add(LODData.MeshDescription.Triangles().Num());
+		const double StartTime = FPlatformTime::Seconds();
+		Results[i].Mesh = FinishMergeJob(*Jobs[i]);
+		Results[i].FinishSeconds = FPlatformTime::Seconds() - StartTime;
 	}
-	return nullptr;
+	return Results;
+}
+
+void FTiledLevelEditorUtility::MergeTiledLevelAssetAsync(UTiledLevelAsset* TargetAsset, TFunction<void(UStaticMesh*)> OnMerged,
+	const FText& TransactionName)
+{
+	TSharedPtr<FTiledMergeJob> Job = PrepareMergeJob(TargetAsset);
+	if (!Job) return;
+
+	FNotificationInfo Info(FText::Format(LOCTEXT("MergeInProgress", "Merging {0}..."), FText::FromString(Job->AssetName)));
+	Info.bFireAndForget = false;
+	Info.ExpireDuration = 3.0f;
+	Info.ButtonDetails.Add(FNotificationButtonInfo(
+		LOCTEXT("CancelMerge", "Cancel"),
+		LOCTEXT("CancelMergeTooltip", "Stop merging, no mesh asset will be created"),
+		FSimpleDelegate::CreateLambda([Job]() { Job->bCancelled = true; }),
+		SNotificationItem::CS_Pending));
+	TSharedPtr<SNotificationItem> Notification = FSlateNotificationManager::Get().AddNotification(Info);
+	if (Notification)
+		Notification->SetCompletionState(SNotificationItem::CS_Pending);
+
+	// the ticker below owns the job, so it (and the meshes its sources keep from GC) is released on game thread
+	FTiledMergeJob* RunningJob = Job.Get();
+	Async(EAsyncExecution::ThreadPool, [RunningJob]() { RunMergeJob(*RunningJob); });
+
+	// poll on game thread for progress, and create the asset once the background part is done
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Job, Notification, OnMerged, TransactionName](float)
+	{
+		if (!Job->bFinished)
+		{
+			if (Notification && !Job->bCancelled)
+			{
+				Notification->SetText(FText::Format(LOCTEXT("MergeProgress", "Merging {0}... (LOD {1}/{2})"),
+					FText::FromString(Job->AssetName), FText::AsNumber(Job->NumBuiltLODs + 1), FText::AsNumber(Job->Sources.Num())));
+			}
+			return true;
+		}
+		
+		if (!TickFinishMergeJob(Job))
+		{
+			if (Notification)
+				Notification->SetText(FText::Format(LOCTEXT("MergeBuilding", "Building {0}..."), FText::FromName(Job->MeshName)));
+			return true;
+		}
+
+		// the transaction can't span the background part, so it's opened here where the mesh is registered and actors are created
+		UStaticMesh* NewMesh = Job->Mesh.Get();
+		FScopedTransaction Transaction(TransactionName, !TransactionName.IsEmpty() && NewMesh);
+		if (NewMesh)
+			FAssetRegistryModule::AssetCreated(NewMesh);
+		if (Notification)
+		{
+			Notification->SetText(NewMesh?
+				FText::Format(LOCTEXT("MergeDone", "Merged {0} into {1}"), FText::FromString(Job->AssetName), FText::FromName(Job->MeshName)) :
+				FText::Format(LOCTEXT("MergeCanceled", "Merging {0} canceled"), FText::FromString(Job->AssetName)));
+			Notification->SetCompletionState(NewMesh? SNotificationItem::CS_Success : SNotificationItem::CS_Fail);
+			Notification->ExpireAndFadeout();
+		}
+		if (OnMerged)
+			OnMerged(NewMesh);
+		return false;
+	}));
 }
 
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
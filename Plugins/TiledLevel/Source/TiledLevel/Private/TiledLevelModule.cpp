@@ -220,19 +220,21 @@ void FTiledLevelModule::BreakTiledLevel(ATiledLevel* TargetTiledLevel)
 
 void FTiledLevelModule::MergeTiledLevel(ATiledLevel* TargetTiledLevel)
 {
-	FScopedTransaction Transaction(LOCTEXT("MergeTransaction", "Merge tiled level"));
 	if (!TargetTiledLevel->GetAsset()->HostLevel)
 		TargetTiledLevel->GetAsset()->HostLevel = TargetTiledLevel;
-	FTiledLevelEditorUtility::MergeTiledLevelAsset(TargetTiledLevel->GetAsset());
+	FTiledLevelEditorUtility::MergeTiledLevelAssetAsync(TargetTiledLevel->GetAsset(), nullptr, LOCTEXT("MergeTransaction", "Merge tiled level"));
 }
 
 void FTiledLevelModule::MergeTiledLevelAndReplace(ATiledLevel* TargetTiledLevel)
 {
-	FScopedTransaction Transaction(LOCTEXT("MergeInplaceTransaction", "Merge and replace"));
 	if (!TargetTiledLevel->GetAsset()->HostLevel)
 		TargetTiledLevel->GetAsset()->HostLevel = TargetTiledLevel;
-	if (UStaticMesh* NewMeshAsset = FTiledLevelEditorUtility::MergeTiledLevelAsset(TargetTiledLevel->GetAsset()))
+	// the level could be deleted while merging in background
+	TWeakObjectPtr<ATiledLevel> WeakTiledLevel = TargetTiledLevel;
+	FTiledLevelEditorUtility::MergeTiledLevelAssetAsync(TargetTiledLevel->GetAsset(), [WeakTiledLevel](UStaticMesh* NewMeshAsset)
 	{
+		ATiledLevel* TargetTiledLevel = WeakTiledLevel.Get();
+		if (!NewMeshAsset || !TargetTiledLevel) return;
 		FActorSpawnParameters Params;
 		Params.bNoFail = 1;
 		
@@ -245,7 +247,7 @@ void FTiledLevelModule::MergeTiledLevelAndReplace(ATiledLevel* TargetTiledLevel)
 		for (AActor* A : Attached)
 			A->Destroy();
 		TargetTiledLevel->Destroy();
-	}
+	}, LOCTEXT("MergeInplaceTransaction", "Merge and replace"));
 }
 
 void FTiledLevelModule::RevertStaticTiledLevel(AStaticTiledLevel* TargetStaticTiledLevel)
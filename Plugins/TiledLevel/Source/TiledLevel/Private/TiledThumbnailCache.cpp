@@ -0,0 +1,255 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledThumbnailCache.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelItem.h"
+#include "TiledLevelStats.h"
+
+#include "CanvasTypes.h"
+#include "DerivedDataCacheInterface.h"
+#include "Engine/Blueprint.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/Texture2D.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Materials/MaterialInterface.h"
+#include "Misc/PackageName.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "ThumbnailRendering/SceneThumbnailInfo.h"
+
+// Change this guid when the thumbnail rendering or the hashed content changes
+#define TILEDLEVEL_THUMBNAIL_DERIVEDDATA_VER TEXT("8C1E5F2A7B3D4E96A0F4C2B7D9E1A365")
+
+static TAutoConsoleVariable<bool> CVarUseThumbnailCache(
+	TEXT("TiledLevel.UseThumbnailCache"),
+	true,
+	TEXT("Reuse rendered thumbnails of tiled level assets and items from memory and the derived data cache while their content is unchanged."));
+
+// textures kept in memory, the rest is reloaded from the derived data cache, 256x256 thumbnails take 256 KB each
+static constexpr int32 MaxCachedTextures = 256;
+
+static void UpdateString(FSHA1& Hash, const FString& String)
+{
+	Hash.UpdateWithString(*String, String.Len());
+}
+
+static void UpdateGuid(FSHA1& Hash, const FGuid& Guid)
+{
+	Hash.Update(reinterpret_cast<const uint8*>(&Guid), sizeof(FGuid));
+}
+
+static void UpdateThumbnailInfo(FSHA1& Hash, UThumbnailInfo* ThumbnailInfo)
+{
+	if (const USceneThumbnailInfo* SceneInfo = Cast<USceneThumbnailInfo>(ThumbnailInfo))
+	{
+		const float Orbit[3] = { SceneInfo->OrbitPitch, SceneInfo->OrbitYaw, SceneInfo->OrbitZoom };
+		Hash.Update(reinterpret_cast<const uint8*>(Orbit), sizeof(Orbit));
+	}
+}
+
+// an edited mesh or material gets a new lighting guid
+static void UpdateMaterial(FSHA1& Hash, UMaterialInterface* Material)
+{
+	UpdateString(Hash, GetPathNameSafe(Material));
+	if (Material)
+		UpdateGuid(Hash, Material->GetLightingGuid());
+}
+
+static void UpdateMesh(FSHA1& Hash, UStaticMesh* Mesh)
+{
+	UpdateString(Hash, Mesh->GetPathName());
+	UpdateGuid(Hash, Mesh->GetLightingGuid());
+	for (const FStaticMaterial& Material : Mesh->GetStaticMaterials())
+		UpdateMaterial(Hash, Material.MaterialInterface);
+	UpdateThumbnailInfo(Hash, Mesh->ThumbnailInfo);
+}
+
+// blueprints have nothing like a lighting guid, use the saved file instead and give up while it has unsaved changes
+static bool UpdateBlueprint(FSHA1& Hash, UBlueprint* Blueprint)
+{
+	UPackage* Package = Blueprint->GetOutermost();
+	if (Package->IsDirty()) return false;
+	FString Filename;
+	if (!FPackageName::DoesPackageExist(Package->GetName(), &Filename)) return false;
+	const int64 TimeStamp = IFileManager::Get().GetTimeStamp(*Filename).GetTicks();
+	UpdateString(Hash, Blueprint->GetPathName());
+	Hash.Update(reinterpret_cast<const uint8*>(&TimeStamp), sizeof(int64));
+	UpdateThumbnailInfo(Hash, Blueprint->ThumbnailInfo);
+	return true;
+}
+
+static bool UpdateAsset(FSHA1& Hash, UTiledLevelAsset* Asset, int32 Depth);
+
+static bool UpdateItem(FSHA1& Hash, UTiledLevelItem* Item, int32 Depth)
+{
+	UpdateString(Hash, GetPathNameSafe(Item));
+	if (!Item || Item->IsA<UTiledLevelRestrictionItem>()) return true;
+	if (const UTiledLevelTemplateItem* TemplateItem = Cast<UTiledLevelTemplateItem>(Item))
+	{
+		UTiledLevelAsset* TemplateAsset = TemplateItem->GetAsset();
+		// templates of templates... deep enough, just don't cache it
+		return !TemplateAsset || UpdateAsset(Hash, TemplateAsset, Depth + 1);
+	}
+	if (Item->TiledMesh)
+	{
+		UpdateMesh(Hash, Item->TiledMesh);
+		for (UMaterialInterface* Material : Item->OverrideMaterials)
+			UpdateMaterial(Hash, Material);
+	}
+	if (UBlueprint* Blueprint = Cast<UBlueprint>(Item->TiledActor))
+		return UpdateBlueprint(Hash, Blueprint);
+	UpdateString(Hash, GetPathNameSafe(Item->TiledActor));
+	return true;
+}
+
+static bool UpdateAsset(FSHA1& Hash, UTiledLevelAsset* Asset, int32 Depth)
+{
+	if (Depth > 4) return false;
+	const FVector TileSize = Asset->GetTileSize();
+	Hash.Update(reinterpret_cast<const uint8*>(&TileSize), sizeof(FVector));
+	UpdateString(Hash, GetPathNameSafe(Asset->GetItemSetAsset()));
+	UpdateThumbnailInfo(Hash, Asset->ThumbnailInfo);
+
+	TArray<UTiledLevelItem*> UsedItems;
+	auto UpdatePlacements = [&Hash, &UsedItems](const auto& Placements)
+	{
+		for (const FItemPlacement& P : Placements)
+		{
+			// the id still tells placements apart when the item is gone from its item set
+			UpdateGuid(Hash, P.ItemID);
+			if (UTiledLevelItem* Item = P.GetItem())
+				UsedItems.AddUnique(Item);
+			const FVector Translation = P.TileObjectTransform.GetTranslation();
+			const FQuat Rotation = P.TileObjectTransform.GetRotation();
+			const FVector Scale = P.TileObjectTransform.GetScale3D();
+			Hash.Update(reinterpret_cast<const uint8*>(&Translation), sizeof(FVector));
+			Hash.Update(reinterpret_cast<const uint8*>(&Rotation), sizeof(FQuat));
+			Hash.Update(reinterpret_cast<const uint8*>(&Scale), sizeof(FVector));
+		}
+	};
+	for (const FTiledFloor& F : Asset->TiledFloors)
+	{
+		UpdatePlacements(F.BlockPlacements);
+		UpdatePlacements(F.FloorPlacements);
+		UpdatePlacements(F.WallPlacements);
+		UpdatePlacements(F.PillarPlacements);
+		UpdatePlacements(F.EdgePlacements);
+		UpdatePlacements(F.PointPlacements);
+	}
+
+	// what the used items look like, in a stable order
+	UsedItems.Sort([](const UTiledLevelItem& A, const UTiledLevelItem& B) { return A.GetPathName() < B.GetPathName(); });
+	for (UTiledLevelItem* Item : UsedItems)
+	{
+		if (!UpdateItem(Hash, Item, Depth)) return false;
+	}
+	return true;
+}
+
+static FString FinishHash(FSHA1& Hash)
+{
+	Hash.Final();
+	FSHAHash Result;
+	Hash.GetHash(Result.Hash);
+	return Result.ToString();
+}
+
+static FString MakeCacheKey(const FString& ContentHash, uint32 Width, uint32 Height)
+{
+	return FDerivedDataCacheInterface::BuildCacheKey(TEXT("TILEDLEVELTHUMB"), TILEDLEVEL_THUMBNAIL_DERIVEDDATA_VER,
+		*FString::Printf(TEXT("%s_%ux%u"), *ContentHash, Width, Height));
+}
+
+FTiledThumbnailCache& FTiledThumbnailCache::Get()
+{
+	static FTiledThumbnailCache Instance;
+	return Instance;
+}
+
+FString FTiledThumbnailCache::GetContentHash(UTiledLevelAsset* Asset)
+{
+	if (!Asset || !CVarUseThumbnailCache.GetValueOnGameThread()) return FString();
+	FSHA1 Hash;
+	UpdateString(Hash, TEXT("Asset"));
+	return UpdateAsset(Hash, Asset, 0) ? FinishHash(Hash) : FString();
+}
+
+FString FTiledThumbnailCache::GetContentHash(UTiledLevelItem* Item)
+{
+	if (!Item || !CVarUseThumbnailCache.GetValueOnGameThread()) return FString();
+	FSHA1 Hash;
+	UpdateString(Hash, TEXT("Item"));
+	return UpdateItem(Hash, Item, 0) ? FinishHash(Hash) : FString();
+}
+
+bool FTiledThumbnailCache::Draw(const FString& ContentHash, int32 X, int32 Y, uint32 Width, uint32 Height, FCanvas* Canvas)
+{
+	if (ContentHash.IsEmpty()) return false;
+	const FString Key = MakeCacheKey(ContentHash, Width, Height);
+	UTexture2D* Texture = nullptr;
+	if (UTexture2D** Found = Textures.Find(Key))
+	{
+		Texture = *Found;
+		TextureKeys.Remove(Key);
+		TextureKeys.Add(Key);
+	}
+	else
+	{
+		TArray<uint8> Bytes;
+		if (!GetDerivedDataCacheRef().GetSynchronous(*Key, Bytes, ContentHash)) return false;
+		TArray<FColor> Pixels;
+		FMemoryReader Reader(Bytes, true);
+		Reader << Pixels;
+		if (Reader.IsError() || Pixels.Num() != static_cast<int32>(Width * Height)) return false;
+		Texture = AddTexture(Key, Pixels, Width, Height);
+	}
+	if (!Texture) return false;
+
+	Canvas->DrawTile(X, Y, Width, Height, 0.f, 0.f, 1.f, 1.f, FLinearColor::White, Texture->GetResource(), false);
+	INC_DWORD_STAT(STAT_TiledLevel_ThumbnailCacheHits);
+	return true;
+}
+
+void FTiledThumbnailCache::Store(const FString& ContentHash, int32 X, int32 Y, uint32 Width, uint32 Height, FRenderTarget* Viewport)
+{
+	if (ContentHash.IsEmpty()) return;
+	// flushes rendering, only paid once per content change
+	TArray<FColor> Pixels;
+	if (!Viewport->ReadPixels(Pixels, FReadSurfaceDataFlags(), FIntRect(X, Y, X + Width, Y + Height))) return;
+	if (Pixels.Num() != static_cast<int32>(Width * Height)) return;
+	for (FColor& Pixel : Pixels)
+		Pixel.A = 255;
+
+	const FString Key = MakeCacheKey(ContentHash, Width, Height);
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes, true);
+	Writer << Pixels;
+	GetDerivedDataCacheRef().Put(*Key, Bytes, ContentHash);
+	if (!Textures.Contains(Key))
+		AddTexture(Key, Pixels, Width, Height);
+}
+
+UTexture2D* FTiledThumbnailCache::AddTexture(const FString& Key, const TArray<FColor>& Pixels, uint32 Width, uint32 Height)
+{
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	if (!Texture) return nullptr;
+	FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+	FMemory::Memcpy(Mip.BulkData.Lock(LOCK_READ_WRITE), Pixels.GetData(), Pixels.Num() * sizeof(FColor));
+	Mip.BulkData.Unlock();
+	Texture->UpdateResource();
+
+	if (TextureKeys.Num() >= MaxCachedTextures)
+	{
+		Textures.Remove(TextureKeys[0]);
+		TextureKeys.RemoveAt(0);
+	}
+	Textures.Add(Key, Texture);
+	TextureKeys.Add(Key);
+	return Texture;
+}
+
+void FTiledThumbnailCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObjects(Textures);
+}
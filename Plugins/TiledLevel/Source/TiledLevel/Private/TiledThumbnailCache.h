@@ -0,0 +1,34 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+/*
+ * Rendered thumbnails of tiled level assets and items, keyed by a hash of what the thumbnail shows.
+ * Kept in memory for the session and in the derived data cache (on disk) across sessions,
+ * so the preview scene is only rendered again when the content hash changes.
+ */
+class FTiledThumbnailCache : public FGCObject
+{
+public:
+	static FTiledThumbnailCache& Get();
+
+	// empty when the thumbnail should not be cached: cache disabled, or something it shows is unsaved and can't be hashed
+	static FString GetContentHash(class UTiledLevelAsset* Asset);
+	static FString GetContentHash(class UTiledLevelItem* Item);
+
+	// draw the cached thumbnail to the canvas, false on a miss
+	bool Draw(const FString& ContentHash, int32 X, int32 Y, uint32 Width, uint32 Height, class FCanvas* Canvas);
+	// read back the thumbnail just rendered to the viewport and keep it
+	void Store(const FString& ContentHash, int32 X, int32 Y, uint32 Width, uint32 Height, class FRenderTarget* Viewport);
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return "FTiledThumbnailCache"; }
+
+private:
+	class UTexture2D* AddTexture(const FString& Key, const TArray<FColor>& Pixels, uint32 Width, uint32 Height);
+
+	TMap<FString, class UTexture2D*> Textures;
+	TArray<FString> TextureKeys; // least recently used first
+};
@@ -4,6 +4,15 @@
 
 #include "CoreMinimal.h"
 
+struct FTiledBatchMergeResult
+{
+	class UStaticMesh* Mesh = nullptr; // nullptr if the asset is skipped (empty or no host level) or failed
+	double PrepareSeconds = 0; // game thread, gather placements and source meshes
+	double BuildSeconds = 0; // worker thread, fill sections and make mesh descriptions (or load them from cache)
+	double FinishSeconds = 0; // game thread, create and build the static mesh
+	TArray<int32> NumTriangles; // per LOD
+};
+
 /**
  * 
  */
@@ -11,5 +20,14 @@ class TILEDLEVEL_API FTiledLevelEditorUtility
 {
 public:
 	static class UStaticMesh* MergeTiledLevelAsset(class UTiledLevelAsset* TargetAsset);
+	// Same as above, but the mesh data is built on a background thread with a progress notification that can cancel it.
+	// OnMerged is called on game thread with the new mesh, or nullptr if it's canceled.
+	// Creating the mesh and OnMerged share one transaction named TransactionName (none if empty)
+	static void MergeTiledLevelAssetAsync(class UTiledLevelAsset* TargetAsset, TFunction<void(class UStaticMesh*)> OnMerged = nullptr,
+		const FText& TransactionName = FText::GetEmpty());
+	// No dialog or notification, for commandlets: every asset (HostLevel must be set) is merged into a new mesh at the
+	// package of the same index, and mesh data of all assets is built in parallel. Meshes are created but not saved
+	static TArray<FTiledBatchMergeResult> MergeTiledLevelAssets(const TArray<class UTiledLevelAsset*>& TargetAssets,
+		const TArray<FString>& MeshPackageNames);
  };
  
\ No newline at end of file
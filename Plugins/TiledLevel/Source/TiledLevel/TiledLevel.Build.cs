@@ -34,6 +34,9 @@ public class TiledLevel : ModuleRules
 				"KismetWidgets",
 				"AdvancedPreviewScene",
 				"EditorFramework",
+				"DerivedDataCache",
+				"NavigationSystem",
+				"Json",
 				"TiledLevelRuntime",
 				// ... add other public dependencies that you statically link with here ...
 			}
@@ -0,0 +1,63 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevelItem.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+/*
+ * Item lookup by ID through the item set's map, against the linear scan it replaced, on generated sets of 10, 100 and 1000 items.
+ * Runs with the rest of the benchmarks: Automation RunTests TiledLevel.Benchmark
+ */
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTiledItemLookupBenchmarkTest, "TiledLevel.Benchmark.ItemLookup",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FTiledItemLookupBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (int32 NumItems : {10, 100, 1000})
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("Items%d"), NumItems));
+		OutTestCommands.Add(LexToString(NumItems));
+	}
+}
+
+bool FTiledItemLookupBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 NumItems = FMath::Max(FCString::Atoi(*Parameters), 1);
+	const int32 NumLookups = 100000;
+	UTiledItemSet* ItemSet = NewObject<UTiledItemSet>(GetTransientPackage());
+	for (int32 i = 0; i < NumItems; i++)
+		ItemSet->AddNewItem(static_cast<UStaticMesh*>(nullptr), EPlacedType::Block, ETLStructureType::Structure, FVector(1));
+	const TArray<UTiledLevelItem*> Items = ItemSet->GetItemSet();
+	TArray<FGuid> LookupIDs;
+	LookupIDs.Reserve(NumLookups);
+	FRandomStream Random(NumItems);
+	for (int32 n = 0; n < NumLookups; n++)
+		LookupIDs.Add(Items[Random.RandRange(0, NumItems - 1)]->ItemID);
+
+	int32 NumFound = 0;
+	double StartTime = FPlatformTime::Seconds();
+	for (const FGuid& ID : LookupIDs)
+		if (ItemSet->GetItem(ID)) NumFound++;
+	const double MapMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	int32 NumScanFound = 0;
+	StartTime = FPlatformTime::Seconds();
+	for (const FGuid& ID : LookupIDs)
+		if (Items.FindByPredicate([&ID](const UTiledLevelItem* I) { return I->ItemID == ID; })) NumScanFound++;
+	const double ScanMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	AddInfo(FString::Printf(TEXT("%4d items, %d lookups: map %.3f ms (%.1f ns each), linear scan %.3f ms (%.1f ns each)"),
+		NumItems, NumLookups, MapMs, MapMs * 1e6 / NumLookups, ScanMs, ScanMs * 1e6 / NumLookups));
+	ItemSet->MarkAsGarbage();
+	bool Result = TestEqual(TEXT("Items found through the map"), NumFound, NumLookups);
+	Result &= TestEqual(TEXT("Items found by the scan"), NumScanFound, NumLookups);
+	return Result;
+}
+
+#endif
@@ -0,0 +1,75 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevel.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelItem.h"
+#include "Misc/AutomationTest.h"
+
+/*
+ * Stacked placements (same item and position, different transforms) share one actor handle.
+ * Each of them must keep its own actor in the registry, through erase and incremental reset.
+ */
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelStackedActorRegistryTest, "TiledLevel.ActorRegistry.StackedPlacements",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelStackedActorRegistryTest::RunTest(const FString& Parameters)
+{
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet();
+	UTiledLevelAsset* Asset = FTiledLevelTestUtility::MakeEmptyAsset(ItemSet, 8, 1);
+	FRandomStream Random(77);
+
+	// mirrored ones are spawned as actors
+	FTilePlacement Lower = FTiledLevelTestUtility::MakeTilePlacement(FTiledLevelTestUtility::FindItems(ItemSet, EPlacedType::Block)[0], Random, 8, 1);
+	Lower.IsMirrored = true;
+	FTilePlacement Upper = Lower;
+	Upper.TileObjectTransform.AddToTranslation(FVector(0, 0, 40));
+	Upper.TileObjectTransform.SetRotation(FRotator(0, 45, 0).Quaternion());
+	Asset->AddNewTilePlacement(Lower);
+	Asset->AddNewTilePlacement(Upper);
+	const FTiledActorHandle Handle(Lower);
+
+	FTiledLevelTestWorld TestWorld;
+	ATiledLevel* Level = TestWorld.SpawnTiledLevel(Asset);
+	Level->ResetAllInstance(true);
+
+	AActor* LowerActor = Level->FindTiledActor(Handle, Lower.TileObjectTransform);
+	AActor* UpperActor = Level->FindTiledActor(Handle, Upper.TileObjectTransform);
+	bool Result = TestEqual(TEXT("Spawned actors"), Level->SpawnedTiledActors.Num(), 2);
+	Result &= TestTrue(TEXT("Both stacked actors are registered"), LowerActor && UpperActor && LowerActor != UpperActor);
+	if (!Result) return false;
+	Result &= TestTrue(TEXT("Lower actor handle"), Level->FindTiledActorHandle(LowerActor) && *Level->FindTiledActorHandle(LowerActor) == Handle);
+	Result &= TestTrue(TEXT("Upper actor handle"), Level->FindTiledActorHandle(UpperActor) && *Level->FindTiledActorHandle(UpperActor) == Handle);
+
+	// erase one of them, the other stays reachable
+	Level->DestroyTiledActorByPlacement(Upper);
+	Result &= TestFalse(TEXT("Erased actor is destroyed"), IsValid(UpperActor));
+	Result &= TestTrue(TEXT("Remaining actor is kept"), IsValid(LowerActor));
+	Result &= TestEqual(TEXT("Spawned actors after erase"), Level->SpawnedTiledActors.Num(), 1);
+	Result &= TestTrue(TEXT("Remaining actor is found"), Level->FindTiledActor(Handle, Lower.TileObjectTransform) == LowerActor);
+
+	// both placements are still in the asset, the reset keeps the remaining actor and respawns the erased one
+	Level->ResetAllInstance(true);
+	Result &= TestEqual(TEXT("Spawned actors after reset"), Level->SpawnedTiledActors.Num(), 2);
+	Result &= TestTrue(TEXT("Remaining actor is kept by reset"), Level->FindTiledActor(Handle, Lower.TileObjectTransform) == LowerActor);
+	UpperActor = Level->FindTiledActor(Handle, Upper.TileObjectTransform);
+	Result &= TestTrue(TEXT("Erased actor is respawned"), IsValid(UpperActor) && UpperActor != LowerActor);
+	for (AActor* SpawnedActor : Level->SpawnedTiledActors)
+		Result &= TestNotNull(TEXT("Every spawned actor is registered"), Level->FindTiledActorHandle(SpawnedActor));
+
+	// nothing left behind once the placements are gone
+	Asset->RemovePlacements(TArray<FTilePlacement>{Lower});
+	Level->ResetAllInstance(true);
+	Result &= TestEqual(TEXT("Spawned actors after removing the placements"), Level->SpawnedTiledActors.Num(), 0);
+	Result &= TestFalse(TEXT("Lower actor is destroyed"), IsValid(LowerActor));
+	Result &= TestFalse(TEXT("Upper actor is destroyed"), IsValid(UpperActor));
+	Result &= TestNull(TEXT("Handle is no longer registered"), Level->FindTiledActor(Handle, Lower.TileObjectTransform));
+	return Result;
+}
+
+#endif
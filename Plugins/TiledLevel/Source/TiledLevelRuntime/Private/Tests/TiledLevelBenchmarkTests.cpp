@@ -0,0 +1,468 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevel.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelEditorHelper.h"
+#include "TiledLevelGametimeSystem.h"
+#include "TiledLevelItem.h"
+#include "TiledLevelUtility.h"
+#include "ProceduralMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+/*
+ * Deterministic benchmarks of the hot paths, for gating plugin upgrades. One test case per level size, each writes its results as json.
+ * Everything is generated from fixed seeds, so runs are comparable between builds and machines of the same kind.
+ * Headless: UnrealEditor <Project> -nullrhi -unattended -ExecCmds="Automation RunTests TiledLevel.Benchmark; Quit"
+ * Optional: -TiledLevelBenchmarkIterations=N, -TiledLevelBenchmarkDir=<results directory>
+ */
+
+struct FTiledBenchmarkResult
+{
+	FString Name;
+	int32 Size = 0;
+	int32 NumPlacements = 0;
+	TArray<double> SamplesMs;
+	// what the timed code produced (instances, erased placements, filled tiles, triangles, checks), to spot broken runs
+	int64 Output = 0;
+
+	double GetMin() const { return SamplesMs.Num() > 0? FMath::Min(SamplesMs) : 0; }
+	double GetMax() const { return SamplesMs.Num() > 0? FMath::Max(SamplesMs) : 0; }
+	double GetMedian() const
+	{
+		if (SamplesMs.Num() == 0) return 0;
+		TArray<double> Sorted = SamplesMs;
+		Sorted.Sort();
+		const int32 Mid = Sorted.Num() / 2;
+		return Sorted.Num() % 2 == 1? Sorted[Mid] : (Sorted[Mid - 1] + Sorted[Mid]) * 0.5;
+	}
+};
+
+static const FIntVector BenchmarkBlockExtent(2, 2, 1);
+static constexpr int32 BenchmarkNumFloors = 3;
+
+static UTiledItemSet* MakeBenchmarkItemSet(const FVector& TileSize)
+{
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!Cube) return nullptr;
+	UTiledItemSet* ItemSet = NewObject<UTiledItemSet>(GetTransientPackage());
+	ItemSet->TileSizeX = TileSize.X;
+	ItemSet->TileSizeY = TileSize.Y;
+	ItemSet->TileSizeZ = TileSize.Z;
+	ItemSet->AddNewItem(Cube, EPlacedType::Block, ETLStructureType::Structure, FVector(BenchmarkBlockExtent));
+	ItemSet->AddNewItem(Cube, EPlacedType::Floor, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Wall, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Pillar, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Point, ETLStructureType::Prop, FVector(1, 1, 1));
+	return ItemSet;
+}
+
+static UTiledLevelItem* FindBenchmarkItem(UTiledItemSet* ItemSet, EPlacedType PlacedType)
+{
+	for (UTiledLevelItem* Item : ItemSet->GetItemSet())
+		if (Item->PlacedType == PlacedType) return Item;
+	return nullptr;
+}
+
+// Size x Size tiles on each floor: a floor everywhere, blocks on a quarter of the 2x2 cells, walls and pillars scattered
+static UTiledLevelAsset* MakeBenchmarkAsset(int32 Size, UTiledItemSet* ItemSet)
+{
+	const FVector TileSize = ItemSet->GetTileSize();
+	UTiledLevelAsset* Asset = NewObject<UTiledLevelAsset>(GetTransientPackage());
+	Asset->SetTileSize(TileSize);
+	Asset->ConfirmTileSize();
+	Asset->SetActiveItemSet(ItemSet);
+	Asset->X_Num = Size;
+	Asset->Y_Num = Size;
+	for (int32 Z = 0; Z < BenchmarkNumFloors; Z++)
+		Asset->AddNewFloor(Z);
+
+	UTiledLevelItem* BlockItem = FindBenchmarkItem(ItemSet, EPlacedType::Block);
+	UTiledLevelItem* FloorItem = FindBenchmarkItem(ItemSet, EPlacedType::Floor);
+	UTiledLevelItem* WallItem = FindBenchmarkItem(ItemSet, EPlacedType::Wall);
+	UTiledLevelItem* PillarItem = FindBenchmarkItem(ItemSet, EPlacedType::Pillar);
+	UTiledLevelItem* PointItem = FindBenchmarkItem(ItemSet, EPlacedType::Point);
+	FRandomStream Random(Size);
+	for (int32 Z = 0; Z < BenchmarkNumFloors; Z++)
+	{
+		for (int32 Y = 0; Y < Size; Y++)
+		{
+			for (int32 X = 0; X < Size; X++)
+			{
+				const FIntVector Position(X, Y, Z);
+				const FVector Origin = FVector(Position) * TileSize;
+				const FQuat Rotation = FRotator(0, 90 * Random.RandRange(0, 3), 0).Quaternion();
+
+				FTilePlacement Floor;
+				Floor.ItemSet = ItemSet;
+				Floor.ItemID = FloorItem->ItemID;
+				Floor.GridPosition = Position;
+				Floor.Extent = FIntVector(1, 1, 1);
+				Floor.TileObjectTransform = FTransform(Rotation, Origin + TileSize * FVector(0.5, 0.5, 0));
+				Asset->AddNewTilePlacement(Floor);
+
+				if (X % BenchmarkBlockExtent.X == 0 && Y % BenchmarkBlockExtent.Y == 0 && X + BenchmarkBlockExtent.X <= Size &&
+					Y + BenchmarkBlockExtent.Y <= Size && Random.FRand() < 0.25f)
+				{
+					FTilePlacement Block;
+					Block.ItemSet = ItemSet;
+					Block.ItemID = BlockItem->ItemID;
+					Block.GridPosition = Position;
+					Block.Extent = BenchmarkBlockExtent;
+					Block.TileObjectTransform = FTransform(Rotation, Origin + FVector(BenchmarkBlockExtent) * TileSize * FVector(0.5, 0.5, 0));
+					Asset->AddNewTilePlacement(Block);
+				}
+				const float Roll = Random.FRand();
+				if (Roll < 0.2f)
+				{
+					FEdgePlacement Wall;
+					Wall.ItemSet = ItemSet;
+					Wall.ItemID = WallItem->ItemID;
+					Wall.Edge = FTiledLevelEdge(Position, Random.FRand() < 0.5f? EEdgeType::Horizontal : EEdgeType::Vertical);
+					Wall.TileObjectTransform = FTransform(Rotation, Origin);
+					Asset->AddNewEdgePlacement(Wall);
+				}
+				else if (Roll < 0.3f)
+				{
+					FPointPlacement Point;
+					Point.ItemSet = ItemSet;
+					Point.ItemID = Roll < 0.25f? PillarItem->ItemID : PointItem->ItemID;
+					Point.GridPosition = Position;
+					Point.TileObjectTransform = FTransform(Rotation, Origin);
+					Asset->AddNewPointPlacement(Point);
+				}
+			}
+		}
+	}
+	return Asset;
+}
+
+static ATiledLevel* SpawnBenchmarkLevel(UWorld* World, UTiledLevelAsset* Asset)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.bNoFail = true;
+	ATiledLevel* Level = World->SpawnActor<ATiledLevel>(ATiledLevel::StaticClass(), FVector(0), FRotator(0), SpawnParams);
+	Level->SetActiveAsset(Asset);
+	return Level;
+}
+
+static int32 GetNumInstances(const ATiledLevel* Level)
+{
+	int32 Num = 0;
+	for (const auto& elem : Level->TiledObjectPartitions)
+		if (elem.Value) Num += elem.Value->GetInstanceCount();
+	return Num;
+}
+
+static void BenchmarkResetAllInstance(UWorld* World, UTiledLevelAsset* Asset, int32 Iterations, FTiledBenchmarkResult& Full, FTiledBenchmarkResult& Incremental)
+{
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		ATiledLevel* Level = SpawnBenchmarkLevel(World, Asset);
+		double StartTime = FPlatformTime::Seconds();
+		Level->ResetAllInstance(true);
+		Full.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Full.Output = GetNumInstances(Level);
+
+		// nothing changed, only the diff against existing instances is done
+		StartTime = FPlatformTime::Seconds();
+		Level->ResetAllInstance(true);
+		Incremental.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Incremental.Output = GetNumInstances(Level);
+		Level->Destroy();
+	}
+}
+
+// a single tile edit (add + remove one instance, each followed by a sync cluster tree build) x16, with the given instance chunk size
+static void BenchmarkChunkedEdit(UWorld* World, UTiledLevelAsset* Asset, int32 ChunkSize, int32 Iterations, FTiledBenchmarkResult& Result)
+{
+	UTiledLevelAsset* Copy = Asset->CloneAsset(GetTransientPackage());
+	Copy->InstanceChunkSize = ChunkSize;
+	ATiledLevel* Level = SpawnBenchmarkLevel(World, Copy);
+	Level->ResetAllInstance(true);
+	for (auto& elem : Level->TiledObjectPartitions)
+	{
+		if (elem.Value)
+			elem.Value->BuildTreeIfOutdated(false, true);
+	}
+	// the edited placement: a block in the middle of the level
+	const FTilePlacement* Target = nullptr;
+	const FIntVector Center(Copy->X_Num / 2, Copy->Y_Num / 2, 0);
+	for (const FTilePlacement& P : Copy->TiledFloors[0].BlockPlacements)
+	{
+		if (!Target || (P.GridPosition - Center).Size() < (Target->GridPosition - Center).Size())
+			Target = &P;
+	}
+	UHierarchicalInstancedStaticMeshComponent* HISM = nullptr;
+	TArray<float> InstanceData;
+	if (Target)
+	{
+		InstanceData = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(*Target);
+		HISM = Level->TiledObjectPartitions.FindRef(Level->MakeInstancePartition(Target->GetItem()->TiledMesh, InstanceData));
+	}
+	if (HISM)
+	{
+		const FTransform TargetTransform = Target->TileObjectTransform;
+		for (int32 i = 0; i < Iterations; i++)
+		{
+			// the instance is appended and removed from the end, so nothing is swapped and the lookup stays valid
+			const double StartTime = FPlatformTime::Seconds();
+			for (int32 n = 0; n < 16; n++)
+			{
+				const int32 Index = HISM->AddInstance(TargetTransform);
+				HISM->SetCustomData(Index, InstanceData);
+				HISM->BuildTreeIfOutdated(false, true);
+				HISM->RemoveInstance(Index);
+				HISM->BuildTreeIfOutdated(false, true);
+			}
+			Result.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+		// instances rebuilt by each edit
+		Result.Output = HISM->GetInstanceCount();
+	}
+	Level->Destroy();
+}
+
+// erase 4x4 areas of both blocks and floors scattered over every floor, on a copy so the source asset is untouched
+static void BenchmarkEraseItem(UWorld* World, UTiledLevelAsset* Asset, int32 Iterations, FTiledBenchmarkResult& Result)
+{
+	const int32 Size = Asset->X_Num;
+	const FIntVector EraseExtent(4, 4, 1);
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		UTiledLevelAsset* Copy = Asset->CloneAsset(GetTransientPackage());
+		ATiledLevel* Level = SpawnBenchmarkLevel(World, Copy);
+		Level->ResetAllInstance(true);
+		const int32 NumBefore = Copy->GetNumOfAllPlacements();
+		FRandomStream Random(Size + 1);
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 n = 0; n < 64; n++)
+		{
+			const FIntVector Pos(Random.RandRange(0, Size - EraseExtent.X), Random.RandRange(0, Size - EraseExtent.Y), Random.RandRange(0, BenchmarkNumFloors - 1));
+			Level->EraseItem(Pos, EraseExtent, false, true);
+		}
+		Result.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Result.Output = NumBefore - Copy->GetNumOfAllPlacements();
+		Level->Destroy();
+	}
+}
+
+// 4 times the level size on each axis with 30% obstacles, filled from the first open tile
+static void BenchmarkFloodFill(int32 Size, int32 Iterations, FTiledBenchmarkResult& Result)
+{
+	const int32 BoardSize = Size * 4;
+	FTiledFillBoard Source(FIntPoint(BoardSize));
+	FRandomStream Random(Size + 2);
+	for (int32 Y = 0; Y < BoardSize; Y++)
+		for (int32 X = 0; X < BoardSize; X++)
+			Source.Set(X, Y, Random.FRand() < 0.3f);
+	Source.Set(0, 0, false);
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		FTiledFillBoard Board = Source;
+		TArray<FIntPoint> Filled;
+		const double StartTime = FPlatformTime::Seconds();
+		FTiledLevelUtility::FloodFill(Board, 0, 0, Filled);
+		Result.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Result.Output = Filled.Num();
+	}
+}
+
+static void BenchmarkMerge(UTiledLevelAsset* Asset, int32 Iterations, FTiledBenchmarkResult& Result)
+{
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		UProceduralMeshComponent* ProcMesh = FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(Asset, 0, GetTransientPackage());
+		Result.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		int64 NumTriangles = 0;
+		for (int32 s = 0; s < ProcMesh->GetNumSections(); s++)
+			NumTriangles += ProcMesh->GetProcMeshSection(s)->ProcIndexBuffer.Num() / 3;
+		Result.Output = NumTriangles;
+		ProcMesh->MarkAsGarbage();
+	}
+}
+
+// build checks go through moving the preview item, every move runs HasEnoughSpaceToBuild once
+static bool BenchmarkHasEnoughSpaceToBuild(UWorld* World, UTiledItemSet* ItemSet, UTiledLevelAsset* Asset, int32 Iterations, FTiledBenchmarkResult& Result)
+{
+	UGameInstance* GameInstance = World->GetGameInstance();
+	UTiledLevelGametimeSystem* System = GameInstance? GameInstance->GetSubsystem<UTiledLevelGametimeSystem>() : nullptr;
+	if (!System) return false;
+
+	ATiledLevel* Level = SpawnBenchmarkLevel(World, Asset);
+	const FTiledLevelGameData Data = Level->MakeGametimeData();
+	Level->Destroy();
+	System->InitializeGametimeSystemFromData(World, ItemSet, Data, {});
+	System->ActivatePreviewItem(FindBenchmarkItem(ItemSet, EPlacedType::Block));
+	if (!System->IsPreviewItemActivated()) return false;
+
+	const int32 Size = Asset->X_Num;
+	const FVector TileSize = ItemSet->GetTileSize();
+	const int32 NumChecks = 256;
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		FRandomStream Random(Size + 3);
+		int32 NumFound = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 n = 0; n < NumChecks; n++)
+		{
+			// a different tile every time, the same position is ignored by the system
+			const FVector Location = (FVector(Random.RandRange(0, Size - 1), Random.RandRange(0, Size - 1), Random.RandRange(0, BenchmarkNumFloors - 1)) +
+				FVector(0.5, 0.5, 0.5)) * TileSize;
+			if (System->MovePreviewItemToWorldPosition(Location)) NumFound++;
+		}
+		Result.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Result.Output = NumFound;
+	}
+	System->DeactivatePreviewItem();
+	return true;
+}
+
+// fill preview of a 4 times level size square region: first build, then hovering (the region moves by one tile per update)
+static void BenchmarkFillPreview(UWorld* World, int32 Size, int32 Iterations, FTiledBenchmarkResult& Build, FTiledBenchmarkResult& Hover)
+{
+	const int32 RegionSize = Size * 4;
+	const int32 NumMoves = 16;
+	auto MakeRegion = [RegionSize](int32 OffsetX)
+	{
+		TArray<FIntPoint> Region;
+		Region.Reserve(RegionSize * RegionSize);
+		for (int32 Y = 0; Y < RegionSize; Y++)
+			for (int32 X = 0; X < RegionSize; X++)
+				Region.Emplace(X + OffsetX, Y);
+		return Region;
+	};
+	TArray<TArray<FIntPoint>> Regions;
+	for (int32 i = 0; i <= NumMoves; i++)
+		Regions.Add(MakeRegion(i));
+
+	for (int32 i = 0; i < Iterations; i++)
+	{
+		ATiledLevelEditorHelper* Helper = World->SpawnActor<ATiledLevelEditorHelper>();
+		Helper->SetTileSize(FVector(100));
+		double StartTime = FPlatformTime::Seconds();
+		Helper->UpdateFillPreviewGrids(Regions[0]);
+		Build.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Build.Output = Helper->FillPreviewGrids->GetInstanceCount();
+
+		StartTime = FPlatformTime::Seconds();
+		for (int32 n = 1; n <= NumMoves; n++)
+			Helper->UpdateFillPreviewGrids(Regions[n]);
+		Hover.SamplesMs.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		Hover.Output = Helper->FillPreviewGrids->GetInstanceCount();
+		Helper->Destroy();
+	}
+}
+
+static FString ResultsToJson(const TArray<FTiledBenchmarkResult>& Results, int32 Iterations)
+{
+	FString Json = FString::Printf(TEXT("{\n\t\"timestamp\": \"%s\",\n\t\"platform\": \"%s\",\n\t\"build\": \"%s\",\n\t\"iterations\": %d,\n\t\"results\": [\n"),
+		*FDateTime::UtcNow().ToIso8601(), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()), LexToString(FApp::GetBuildConfiguration()), Iterations);
+	for (int32 i = 0; i < Results.Num(); i++)
+	{
+		const FTiledBenchmarkResult& R = Results[i];
+		Json += FString::Printf(TEXT("\t\t{\"name\": \"%s\", \"size\": %d, \"placements\": %d, \"median_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, \"output\": %lld}%s\n"),
+			*R.Name, R.Size, R.NumPlacements, R.GetMedian(), R.GetMin(), R.GetMax(), R.Output, i < Results.Num() - 1? TEXT(",") : TEXT(""));
+	}
+	Json += TEXT("\t]\n}\n");
+	return Json;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTiledLevelBenchmarkTest, "TiledLevel.Benchmark",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FTiledLevelBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (int32 Size : {16, 32, 64, 128})
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("Size%d"), Size));
+		OutTestCommands.Add(LexToString(Size));
+	}
+}
+
+// time reset, erase, single edits, flood fill, merge, fill preview and build checks on a generated level of the given size
+bool FTiledLevelBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 Size = FMath::Clamp(FCString::Atoi(*Parameters), 4, 1024);
+	int32 Iterations = 5;
+	FParse::Value(FCommandLine::Get(), TEXT("TiledLevelBenchmarkIterations="), Iterations);
+	Iterations = FMath::Max(Iterations, 1);
+	FString OutDir = FPaths::ProjectSavedDir() / TEXT("TiledLevelBenchmarks");
+	FParse::Value(FCommandLine::Get(), TEXT("TiledLevelBenchmarkDir="), OutDir);
+	const FString OutFile = OutDir / FString::Printf(TEXT("Results-%d-%s.json"), Size, *FDateTime::Now().ToString(TEXT("%Y%m%d-%H%M%S")));
+
+	const FVector TileSize(100);
+	UTiledItemSet* ItemSet = MakeBenchmarkItemSet(TileSize);
+	if (!TestNotNull(TEXT("benchmark item set from /Engine/BasicShapes/Cube"), ItemSet)) return false;
+	ItemSet->AddToRoot();
+	UTiledLevelAsset* Asset = MakeBenchmarkAsset(Size, ItemSet);
+	Asset->AddToRoot();
+	const int32 NumPlacements = Asset->GetNumOfAllPlacements();
+
+	bool Result = true;
+	TArray<FTiledBenchmarkResult> Results;
+	Results.Reserve(11); // benchmarks hold references to their results
+	auto AddResult = [&](const FString& Name) -> FTiledBenchmarkResult&
+	{
+		FTiledBenchmarkResult& R = Results.AddDefaulted_GetRef();
+		R.Name = Name;
+		R.Size = Size;
+		R.NumPlacements = NumPlacements;
+		return R;
+	};
+	{
+		// the build check initializes the gametime system with its own data
+		FTiledLevelTestWorld TestWorld;
+		UWorld* World = TestWorld.GetWorld();
+		UTiledLevelGametimeSystem* System = TestWorld.GetGameInstance()->GetSubsystem<UTiledLevelGametimeSystem>();
+		if (TestNotNull(TEXT("gametime system"), System))
+			System->TileSize = TileSize;
+
+		BenchmarkResetAllInstance(World, Asset, Iterations, AddResult(TEXT("ResetAllInstance")), AddResult(TEXT("ResetAllInstance_Unchanged")));
+		BenchmarkEraseItem(World, Asset, Iterations, AddResult(TEXT("EraseItem_x64")));
+		for (int32 ChunkSize : {0, 8, 32})
+			BenchmarkChunkedEdit(World, Asset, ChunkSize, Iterations, AddResult(FString::Printf(TEXT("SingleEdit_x16_Chunk%d"), ChunkSize)));
+		BenchmarkFloodFill(Size, Iterations, AddResult(TEXT("FloodFill")));
+		BenchmarkMerge(Asset, Iterations, AddResult(TEXT("ConvertTiledLevelAssetToProcMesh")));
+		BenchmarkFillPreview(World, Size, Iterations, AddResult(TEXT("FillPreview_Build")), AddResult(TEXT("FillPreview_Hover_x16")));
+		if (!BenchmarkHasEnoughSpaceToBuild(World, ItemSet, Asset, Iterations, AddResult(TEXT("HasEnoughSpaceToBuild_x256"))))
+		{
+			Results.Pop();
+			Result = false;
+			AddError(TEXT("Build checks could not be benchmarked, the preview item was not activated"));
+		}
+	}
+	Asset->RemoveFromRoot();
+	ItemSet->RemoveFromRoot();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+	for (const FTiledBenchmarkResult& R : Results)
+	{
+		AddInfo(FString::Printf(TEXT("%-34s size %4d, %7d placements: median %9.3f ms, min %9.3f ms, max %9.3f ms, output %lld"),
+			*R.Name, R.Size, R.NumPlacements, R.GetMedian(), R.GetMin(), R.GetMax(), R.Output));
+		// nothing produced means the timed code did nothing, the timing is meaningless
+		Result &= TestTrue(FString::Printf(TEXT("%s output"), *R.Name), R.Output > 0);
+	}
+	Result &= TestTrue(FString::Printf(TEXT("results written to %s"), *FPaths::ConvertRelativePathToFull(OutFile)),
+		FFileHelper::SaveStringToFile(ResultsToJson(Results, Iterations), *OutFile));
+	return Result;
+}
+
+#endif
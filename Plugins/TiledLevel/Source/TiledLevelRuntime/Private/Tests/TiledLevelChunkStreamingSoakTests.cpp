@@ -0,0 +1,146 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevelGametimeSystem.h"
+#include "TiledLevelItem.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/GameInstance.h"
+#include "Engine/TargetPoint.h"
+#include "Misc/AutomationTest.h"
+
+/*
+ * Chunk streaming soak: a streaming source walks along X building a grid of blocks in every chunk, then walks back.
+ * Chunk files are written and read on workers, so the game thread is pumped each step to apply their results the way
+ * a running game does. Loaded chunks, loaded placements and memory must stay flat however far it goes,
+ * and every chunk must come back from disk with what was built there.
+ */
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelChunkStreamingSoakTest, "TiledLevel.GametimeSystem.ChunkStreamingSoak",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelChunkStreamingSoakTest::RunTest(const FString& Parameters)
+{
+	const FVector TileSize(100);
+	const int32 ChunkSize = 32;
+	const int32 NumSteps = 200;
+	const int32 Columns = ChunkSize / 2;
+	const int32 BuildsPerChunk = Columns * Columns;
+	const int32 WarmUpSteps = 20;
+	const double MaxGrowthMB = 32.0;
+
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet(TileSize);
+	const TArray<UTiledLevelItem*> Blocks = FTiledLevelTestUtility::FindItems(ItemSet, EPlacedType::Block);
+	if (!TestTrue(TEXT("block item"), Blocks.Num() > 0)) return false;
+
+	FTiledLevelTestWorld TestWorld;
+	UTiledLevelGametimeSystem* System = TestWorld.GetGameInstance()->GetSubsystem<UTiledLevelGametimeSystem>();
+	if (!TestNotNull(TEXT("gametime system"), System)) return false;
+	System->TileSize = TileSize;
+	System->bStreamChunks = true;
+	System->StreamingChunkSize = ChunkSize;
+	const float ChunkLength = TileSize.X * ChunkSize;
+	System->StreamingLoadRadius = ChunkLength * 1.5f;
+	System->StreamingUnloadRadius = ChunkLength * 2.5f;
+	System->InitializeGametimeSystem(TestWorld.GetWorld(), ItemSet, TArray<ATiledLevel*>(), true);
+	if (!TestTrue(TEXT("streaming chunks"), System->IsStreamingChunks())) return false;
+	System->ActivatePreviewItem(Blocks[0]);
+	ATargetPoint* Source = TestWorld.GetWorld()->SpawnActor<ATargetPoint>();
+	System->AddStreamingSource(Source);
+
+	// a chunk can be loaded when any part of it is inside the unload radius
+	const int32 MaxChunksAcross = FMath::CeilToInt(2 * System->StreamingUnloadRadius / ChunkLength) + 2;
+	const int32 MaxLoadedChunks = MaxChunksAcross * MaxChunksAcross;
+	auto GetUsedMB = []() { return FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0); };
+	auto PumpGameThread = []() { FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread); };
+	auto GetChunkOrigin = [&](int32 Step) { return FVector(Step * ChunkLength, ChunkLength * 4, TileSize.Z * 0.5f); };
+	auto CountPlacementsInChunk = [&](int32 Step)
+	{
+		const FIntPoint Chunk(Step, 4);
+		int32 Num = 0;
+		for (const FTilePlacement& P : System->GametimeData.BlockPlacements)
+			Num += FTiledLevelGameData::GetChunk(P.GridPosition, ChunkSize) == Chunk? 1 : 0;
+		return Num;
+	};
+	auto MoveSource = [&](int32 Step, int32& PeakLoadedChunks, int32& PeakLoadedPlacements)
+	{
+		Source->SetActorLocation(GetChunkOrigin(Step) + FVector(ChunkLength / 2, ChunkLength / 2, 0));
+		System->UpdateStreaming();
+		PumpGameThread();
+		PeakLoadedChunks = FMath::Max(PeakLoadedChunks, System->GetNumLoadedChunks());
+		PeakLoadedPlacements = FMath::Max(PeakLoadedPlacements, System->GametimeData.Num());
+	};
+
+	bool Result = true;
+	TArray<int32> BuiltInChunk;
+	int32 PeakLoadedChunks = 0;
+	int32 PeakLoadedPlacements = 0;
+	double BaselineMB = 0;
+	double PeakMB = 0;
+	const double StartTime = FPlatformTime::Seconds();
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		MoveSource(Step, PeakLoadedChunks, PeakLoadedPlacements);
+		int32& NumBuilt = BuiltInChunk.Add_GetRef(0);
+		for (int32 i = 0; i < BuildsPerChunk; i++)
+		{
+			const FVector Offset(((i % Columns) * 2 + 0.5f) * TileSize.X, ((i / Columns) * 2 + 0.5f) * TileSize.Y, 0);
+			if (!System->MovePreviewItemToWorldPosition(GetChunkOrigin(Step) + Offset)) continue;
+			const int32 NumBefore = System->GametimeData.Num();
+			System->BuildItem();
+			NumBuilt += System->GametimeData.Num() - NumBefore;
+		}
+		if (Step == WarmUpSteps)
+		{
+			System->FlushStreaming();
+			PumpGameThread();
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+			BaselineMB = PeakMB = GetUsedMB();
+		}
+		else if (Step > WarmUpSteps)
+		{
+			PeakMB = FMath::Max(PeakMB, GetUsedMB());
+		}
+	}
+
+	// walk back, chunks are read from disk on workers and applied when the game thread picks them up
+	int32 NumMissing = 0;
+	for (int32 Step = NumSteps - 1; Step >= 0; Step--)
+	{
+		MoveSource(Step, PeakLoadedChunks, PeakLoadedPlacements);
+		System->FlushStreaming();
+		NumMissing += FMath::Abs(CountPlacementsInChunk(Step) - BuiltInChunk[Step]);
+		PeakMB = FMath::Max(PeakMB, GetUsedMB());
+	}
+
+	System->FlushStreaming();
+	PumpGameThread();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	const double EndMB = GetUsedMB();
+	int32 TotalBuilt = 0;
+	for (int32 NumBuilt : BuiltInChunk)
+		TotalBuilt += NumBuilt;
+	AddInfo(FString::Printf(TEXT("%d placements built over %.1f km and back in %.1f s: peak %d loaded chunks, peak %d loaded placements, %d chunks on disk, %+.1f MB peak and %+.1f MB at the end after warm up"),
+		TotalBuilt, NumSteps * ChunkLength / 100000.f, FPlatformTime::Seconds() - StartTime, PeakLoadedChunks, PeakLoadedPlacements,
+		System->GetNumChunksOnDisk(), PeakMB - BaselineMB, EndMB - BaselineMB));
+
+	Result &= TestTrue(TEXT("built in every chunk"), !BuiltInChunk.Contains(0));
+	Result &= TestTrue(TEXT("far chunks streamed out to disk"), System->GetNumChunksOnDisk() >= NumSteps - MaxChunksAcross);
+	Result &= TestTrue(FString::Printf(TEXT("loaded chunks stay bounded (peak %d, max %d)"), PeakLoadedChunks, MaxLoadedChunks),
+		PeakLoadedChunks <= MaxLoadedChunks);
+	Result &= TestTrue(FString::Printf(TEXT("loaded placements stay bounded (peak %d, max %d)"), PeakLoadedPlacements, MaxLoadedChunks * BuildsPerChunk),
+		PeakLoadedPlacements <= MaxLoadedChunks * BuildsPerChunk);
+	Result &= TestEqual(TEXT("placements missing or duplicated after loading chunks back"), NumMissing, 0);
+	Result &= TestEqual(TEXT("no chunk file read or write left"), System->GetNumPendingChunks(), 0);
+	Result &= TestTrue(FString::Printf(TEXT("memory stays flat (%+.1f MB peak, %+.1f MB at the end, max %+.1f MB)"), PeakMB - BaselineMB, EndMB - BaselineMB, MaxGrowthMB),
+		PeakMB - BaselineMB < MaxGrowthMB && EndMB - BaselineMB < MaxGrowthMB);
+
+	System->RemoveStreamingSource(Source);
+	Source->Destroy();
+	return Result;
+}
+
+#endif
@@ -0,0 +1,167 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledLevelUtility.h"
+#include "Misc/AutomationTest.h"
+
+/*
+ * The scanline fills on worst-case boards (full board, 1-tile spiral corridor, checkerboard, edge serpentine),
+ * checked against the known tile count of each board and a plain 4-way BFS.
+ */
+
+static TSet<FIntPoint> ReferenceFill(FTiledFillBoard Board, bool bTargetValue, int X, int Y, const TSet<FTiledLevelEdge>* BlockingEdges)
+{
+	TSet<FIntPoint> Result;
+	if (!Board.IsInside(X, Y) || Board.Get(X, Y) != bTargetValue) return Result;
+	TArray<FIntPoint> Queue = {FIntPoint(X, Y)};
+	Board.Set(X, Y, !bTargetValue);
+	for (int Head = 0; Head < Queue.Num(); Head++)
+	{
+		const FIntPoint P = Queue[Head];
+		Result.Add(P);
+		const FIntPoint Steps[4] = {{1, 0}, {-1, 0}, {0, -1}, {0, 1}};
+		const FTiledLevelEdge Blockers[4] = {
+			FTiledLevelEdge(P.X + 1, P.Y, 1, EEdgeType::Vertical), FTiledLevelEdge(P.X, P.Y, 1, EEdgeType::Vertical),
+			FTiledLevelEdge(P.X, P.Y, 1, EEdgeType::Horizontal), FTiledLevelEdge(P.X, P.Y + 1, 1, EEdgeType::Horizontal)};
+		for (int i = 0; i < 4; i++)
+		{
+			const FIntPoint N = P + Steps[i];
+			if (!Board.IsInside(N.X, N.Y) || Board.Get(N.X, N.Y) != bTargetValue) continue;
+			if (BlockingEdges && BlockingEdges->Contains(Blockers[i])) continue;
+			Board.Set(N.X, N.Y, !bTargetValue);
+			Queue.Add(N);
+		}
+	}
+	return Result;
+}
+
+static int32 CountTiles(const FTiledFillBoard& Board, bool bValue)
+{
+	int32 Count = 0;
+	for (int y = 0; y < Board.GetSize().Y; y++)
+		for (int x = 0; x < Board.GetSize().X; x++)
+			Count += Board.Get(x, y) == bValue? 1 : 0;
+	return Count;
+}
+
+// fill from (X, Y), the result must be ExpectedNum unique tiles, the same ones as the BFS, and flip them on the board
+static bool CheckFill(FAutomationTestBase& Test, const TCHAR* CaseName, const FTiledFillBoard& Board, int X, int Y, bool bConsecutive,
+	const TSet<FTiledLevelEdge>* BlockingEdges, int32 ExpectedNum)
+{
+	FTiledFillBoard Filled = Board;
+	TArray<FIntPoint> Tiles;
+	if (bConsecutive)
+		FTiledLevelUtility::GetConsecutiveTiles(Filled, X, Y, Tiles);
+	else if (BlockingEdges)
+		FTiledLevelUtility::FloodFillByEdges(*BlockingEdges, Filled, X, Y, Tiles);
+	else
+		FTiledLevelUtility::FloodFill(Filled, X, Y, Tiles);
+
+	const TSet<FIntPoint> Actual(Tiles);
+	const TSet<FIntPoint> Expected = ReferenceFill(Board, bConsecutive, X, Y, BlockingEdges);
+	bool Result = Test.TestEqual(FString::Printf(TEXT("%s: filled tiles"), CaseName), Tiles.Num(), ExpectedNum);
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: unique filled tiles"), CaseName), Actual.Num(), Tiles.Num());
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: same tiles as BFS"), CaseName), Actual.Num() == Expected.Num() && Actual.Includes(Expected));
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: flipped tiles"), CaseName), CountTiles(Filled, bConsecutive), CountTiles(Board, bConsecutive) - ExpectedNum);
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelFloodFillFullBoardTest, "TiledLevel.FloodFill.FullBoard",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelFloodFillFullBoardTest::RunTest(const FString& Parameters)
+{
+	// the worst case for depth of the old recursion
+	const FIntPoint MaxSize(1024, 1024);
+	bool Result = CheckFill(*this, TEXT("FullBoard"), FTiledFillBoard(MaxSize), 512, 512, false, nullptr, MaxSize.X * MaxSize.Y);
+	Result &= CheckFill(*this, TEXT("FullBoardConsecutive"), FTiledFillBoard(MaxSize, true), 0, 0, true, nullptr, MaxSize.X * MaxSize.Y);
+	// nothing to fill from an occupied tile
+	FTiledFillBoard Occupied(FIntPoint(8, 8));
+	Occupied.Set(3, 3, true);
+	Result &= CheckFill(*this, TEXT("OccupiedSeed"), Occupied, 3, 3, false, nullptr, 0);
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelFloodFillSpiralTest, "TiledLevel.FloodFill.Spiral",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelFloodFillSpiralTest::RunTest(const FString& Parameters)
+{
+	// square spiral wall, leaves a 1-tile wide corridor winding to the center
+	const int N = 255;
+	FTiledFillBoard Spiral(FIntPoint(N, N));
+	int Left = 1, Top = 1, Right = N - 2, Bottom = N - 2;
+	int Side = 0;
+	while (Left <= Right && Top <= Bottom)
+	{
+		switch (Side % 4)
+		{
+			case 0: for (int x = Left - 1; x <= Right; x++) Spiral.Set(x, Top, true); Top += 2; break;
+			case 1: for (int y = Top - 1; y <= Bottom; y++) Spiral.Set(Right, y, true); Right -= 2; break;
+			case 2: for (int x = Right + 1; x >= Left; x--) Spiral.Set(x, Bottom, true); Bottom -= 2; break;
+			default: for (int y = Bottom + 1; y >= Top; y--) Spiral.Set(Left, y, true); Left += 2; break;
+		}
+		Side++;
+	}
+	// both the corridor and the wall are one connected region each
+	bool Result = CheckFill(*this, TEXT("Spiral"), Spiral, 0, 0, false, nullptr, CountTiles(Spiral, false));
+	Result &= CheckFill(*this, TEXT("SpiralConsecutive"), Spiral, 0, 1, true, nullptr, CountTiles(Spiral, true));
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelFloodFillCheckerboardTest, "TiledLevel.FloodFill.Checkerboard",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelFloodFillCheckerboardTest::RunTest(const FString& Parameters)
+{
+	// every fill is a single tile but every step hits a neighbour check
+	FTiledFillBoard Checker(FIntPoint(256, 256));
+	for (int y = 0; y < 256; y++)
+		for (int x = 0; x < 256; x++)
+			Checker.Set(x, y, (x + y) % 2 == 1);
+	bool Result = CheckFill(*this, TEXT("Checkerboard"), Checker, 10, 10, false, nullptr, 1);
+	Result &= CheckFill(*this, TEXT("CheckerboardConsecutive"), Checker, 11, 10, true, nullptr, 1);
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelFloodFillByEdgesTest, "TiledLevel.FloodFill.ByEdges",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelFloodFillByEdgesTest::RunTest(const FString& Parameters)
+{
+	// serpentine made of vertical edges with alternating gaps at top and bottom, the whole board is one corridor
+	const int N = 256;
+	TSet<FTiledLevelEdge> Walls;
+	for (int x = 1; x < N; x++)
+	{
+		const int GapY = x % 2 == 0? 0 : N - 1;
+		for (int y = 0; y < N; y++)
+		{
+			if (y != GapY)
+				Walls.Add(FTiledLevelEdge(x, y, 1, EEdgeType::Vertical));
+		}
+	}
+	bool Result = CheckFill(*this, TEXT("EdgeSerpentine"), FTiledFillBoard(FIntPoint(N, N)), 0, 0, false, &Walls, N * N);
+
+	// a horizontal wall across the first column cuts it in half
+	Walls.Add(FTiledLevelEdge(0, N / 2, 1, EEdgeType::Horizontal));
+	Result &= CheckFill(*this, TEXT("EdgeSerpentineCut"), FTiledFillBoard(FIntPoint(N, N)), 0, 0, false, &Walls, N / 2);
+
+	// closed 10x10 room
+	TSet<FTiledLevelEdge> Room;
+	for (int i = 0; i < 10; i++)
+	{
+		Room.Add(FTiledLevelEdge(5 + i, 5, 1, EEdgeType::Horizontal));
+		Room.Add(FTiledLevelEdge(5 + i, 15, 1, EEdgeType::Horizontal));
+		Room.Add(FTiledLevelEdge(5, 5 + i, 1, EEdgeType::Vertical));
+		Room.Add(FTiledLevelEdge(15, 5 + i, 1, EEdgeType::Vertical));
+	}
+	Result &= CheckFill(*this, TEXT("EdgeRoomInside"), FTiledFillBoard(FIntPoint(32, 32)), 9, 9, false, &Room, 100);
+	Result &= CheckFill(*this, TEXT("EdgeRoomOutside"), FTiledFillBoard(FIntPoint(32, 32)), 0, 0, false, &Room, 32 * 32 - 100);
+	return Result;
+}
+
+#endif
@@ -0,0 +1,247 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledLevelUtility.h"
+#include "Misc/AutomationTest.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+
+/*
+ * Binary game data (save games, chunk streaming): a round trip must give back the exact same data,
+ * and broken data must be rejected without crashing.
+ */
+
+static bool IsSameBits(const FVector& A, const FVector& B)
+{
+	return FMemory::Memcmp(&A, &B, sizeof(FVector)) == 0;
+}
+
+static bool IsSameItem(const FItemPlacement& A, const FItemPlacement& B)
+{
+	return A.ItemID == B.ItemID && A.ItemSet == B.ItemSet && A.IsMirrored == B.IsMirrored &&
+		IsSameBits(A.TileObjectTransform.GetTranslation(), B.TileObjectTransform.GetTranslation()) &&
+		IsSameBits(A.TileObjectTransform.GetScale3D(), B.TileObjectTransform.GetScale3D()) &&
+		FMemory::Memcmp(&A.TileObjectTransform.GetRotation(), &B.TileObjectTransform.GetRotation(), sizeof(FQuat)) == 0;
+}
+
+// generated floor by floor, row by row, the same order the data is saved in, so arrays are compared directly
+static bool IsSamePlacements(const TArray<FTilePlacement>& A, const TArray<FTilePlacement>& B)
+{
+	if (A.Num() != B.Num()) return false;
+	for (int32 i = 0; i < A.Num(); i++)
+		if (!IsSameItem(A[i], B[i]) || A[i].GridPosition != B[i].GridPosition || A[i].Extent != B[i].Extent) return false;
+	return true;
+}
+
+static bool IsSamePlacements(const TArray<FEdgePlacement>& A, const TArray<FEdgePlacement>& B)
+{
+	if (A.Num() != B.Num()) return false;
+	for (int32 i = 0; i < A.Num(); i++)
+		if (!IsSameItem(A[i], B[i]) || A[i].Edge != B[i].Edge) return false;
+	return true;
+}
+
+static bool IsSamePlacements(const TArray<FPointPlacement>& A, const TArray<FPointPlacement>& B)
+{
+	if (A.Num() != B.Num()) return false;
+	for (int32 i = 0; i < A.Num(); i++)
+		if (!IsSameItem(A[i], B[i]) || A[i].GridPosition != B[i].GridPosition) return false;
+	return true;
+}
+
+static bool TestRoundTrip(FAutomationTestBase& Test, const FTiledLevelGameData& Data, const FVector& TileSize, const FString& Context)
+{
+	TArray<uint8> Bytes;
+	Data.SaveToBinary(TileSize, Bytes);
+	FTiledLevelGameData Loaded;
+	FVector LoadedTileSize;
+	if (!Test.TestTrue(FString::Printf(TEXT("%s: loaded"), *Context), Loaded.LoadFromBinary(Bytes, LoadedTileSize)))
+		return false;
+
+	bool Result = Test.TestTrue(FString::Printf(TEXT("%s: tile size"), *Context), IsSameBits(LoadedTileSize, TileSize));
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: hidden floors"), *Context), Loaded.HiddenFloors == Data.HiddenFloors);
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: boundaries"), *Context), Loaded.Boundaries == Data.Boundaries);
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: blocks"), *Context), IsSamePlacements(Loaded.BlockPlacements, Data.BlockPlacements));
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: floors"), *Context), IsSamePlacements(Loaded.FloorPlacements, Data.FloorPlacements));
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: walls"), *Context), IsSamePlacements(Loaded.WallPlacements, Data.WallPlacements));
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: edges"), *Context), IsSamePlacements(Loaded.EdgePlacements, Data.EdgePlacements));
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: pillars"), *Context), IsSamePlacements(Loaded.PillarPlacements, Data.PillarPlacements));
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: points"), *Context), IsSamePlacements(Loaded.PointPlacements, Data.PointPlacements));
+
+	// saving the loaded data again gives the same bytes
+	TArray<uint8> SavedAgain;
+	Loaded.SaveToBinary(LoadedTileSize, SavedAgain);
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: same bytes when saved again"), *Context), SavedAgain == Bytes);
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelGameDataRoundTripTest, "TiledLevel.GameData.Binary.RoundTrip",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelGameDataRoundTripTest::RunTest(const FString& Parameters)
+{
+	const FVector TileSize(100, 100, 200);
+	bool Result = TestRoundTrip(*this, FTiledLevelGameData(), TileSize, TEXT("Empty"));
+	for (const int32 NumPlacements : {1, 37, 5000, 100000})
+	{
+		Result &= TestRoundTrip(*this, FTiledLevelUtility::MakeBenchmarkGameData(NumPlacements, TileSize), TileSize,
+			FString::Printf(TEXT("%d placements"), NumPlacements));
+	}
+	// a tile size that isn't float exact
+	const FVector OddTileSize(100.1, 33.3, 250);
+	Result &= TestRoundTrip(*this, FTiledLevelUtility::MakeBenchmarkGameData(1000, OddTileSize), OddTileSize, TEXT("Odd tile size"));
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelGameDataTruncatedTest, "TiledLevel.GameData.Binary.Truncated",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelGameDataTruncatedTest::RunTest(const FString& Parameters)
+{
+	const FVector TileSize(100, 100, 200);
+	FVector LoadedTileSize;
+	bool Result = true;
+
+	// every cut of small data
+	{
+		TArray<uint8> Bytes;
+		FTiledLevelUtility::MakeBenchmarkGameData(37, TileSize).SaveToBinary(TileSize, Bytes);
+		int32 NumAccepted = 0;
+		for (int32 Length = 0; Length < Bytes.Num(); Length++)
+		{
+			const TArray<uint8> Truncated(Bytes.GetData(), Length);
+			FTiledLevelGameData Rejected;
+			if (Rejected.LoadFromBinary(Truncated, LoadedTileSize))
+			{
+				AddError(FString::Printf(TEXT("Data cut at %d of %d bytes is accepted"), Length, Bytes.Num()));
+				NumAccepted++;
+			}
+		}
+		Result &= NumAccepted == 0;
+	}
+
+	// a few cuts of big data
+	{
+		TArray<uint8> Bytes;
+		FTiledLevelUtility::MakeBenchmarkGameData(100000, TileSize).SaveToBinary(TileSize, Bytes);
+		for (const int32 Length : {4, Bytes.Num() / 3, Bytes.Num() / 2, Bytes.Num() - 1})
+		{
+			const TArray<uint8> Truncated(Bytes.GetData(), Length);
+			FTiledLevelGameData Rejected;
+			Result &= TestFalse(FString::Printf(TEXT("Data cut at %d of %d bytes is rejected"), Length, Bytes.Num()),
+				Rejected.LoadFromBinary(Truncated, LoadedTileSize));
+		}
+	}
+	return Result;
+}
+
+// placements of Data in Chunk, the slow way
+template <typename T>
+static TArray<T> FilterChunkPlacements(const TArray<T>& Placements, const FIntPoint& Chunk, int32 ChunkSize)
+{
+	return Placements.FilterByPredicate([&](const T& P)
+	{
+		return FTiledLevelGameData::GetChunk(FTiledActorHandle(P).Position, ChunkSize) == Chunk;
+	});
+}
+
+static bool TestTakenChunk(FAutomationTestBase& Test, const FTiledLevelGameData& Before, const FTiledLevelGameData& Taken,
+	const FIntPoint& Chunk, int32 ChunkSize)
+{
+	const FString Context = FString::Printf(TEXT("Chunk (%d, %d)"), Chunk.X, Chunk.Y);
+	bool Result = Test.TestTrue(Context + TEXT(": blocks"), FTiledLevelTestUtility::IsSamePlacements(Taken.BlockPlacements, FilterChunkPlacements(Before.BlockPlacements, Chunk, ChunkSize)));
+	Result &= Test.TestTrue(Context + TEXT(": floors"), FTiledLevelTestUtility::IsSamePlacements(Taken.FloorPlacements, FilterChunkPlacements(Before.FloorPlacements, Chunk, ChunkSize)));
+	Result &= Test.TestTrue(Context + TEXT(": walls"), FTiledLevelTestUtility::IsSamePlacements(Taken.WallPlacements, FilterChunkPlacements(Before.WallPlacements, Chunk, ChunkSize)));
+	Result &= Test.TestTrue(Context + TEXT(": edges"), FTiledLevelTestUtility::IsSamePlacements(Taken.EdgePlacements, FilterChunkPlacements(Before.EdgePlacements, Chunk, ChunkSize)));
+	Result &= Test.TestTrue(Context + TEXT(": pillars"), FTiledLevelTestUtility::IsSamePlacements(Taken.PillarPlacements, FilterChunkPlacements(Before.PillarPlacements, Chunk, ChunkSize)));
+	Result &= Test.TestTrue(Context + TEXT(": points"), FTiledLevelTestUtility::IsSamePlacements(Taken.PointPlacements, FilterChunkPlacements(Before.PointPlacements, Chunk, ChunkSize)));
+	return Result;
+}
+
+// TakeChunk works from a chunk index kept through adds, erases and other takes, it must take what a full scan would
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelGameDataTakeChunkTest, "TiledLevel.GameData.TakeChunk",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelGameDataTakeChunkTest::RunTest(const FString& Parameters)
+{
+	const int32 ChunkSize = 8;
+	FTiledLevelGameData Data = FTiledLevelUtility::MakeBenchmarkGameData(5000, FVector(100, 100, 200));
+	const int32 NumAll = Data.Num();
+	TSet<FIntPoint> Chunks;
+	Data.GetChunks(ChunkSize, Chunks);
+	FRandomStream Random(20);
+	TArray<FTiledLevelGameData> TakenChunks;
+	bool Result = true;
+	for (const FIntPoint& Chunk : Chunks)
+	{
+		// erase a few and add some back, as gametime edits do between chunk unloads
+		for (int32 i = 0; i < 3 && Data.FloorPlacements.Num() > 0; i++)
+		{
+			const FTilePlacement Erased = Data.FloorPlacements[Random.RandHelper(Data.FloorPlacements.Num())];
+			Result &= TestTrue(TEXT("Placement is erased"), Data.RemovePlacement(Erased.TileObjectTransform, Erased.ItemID));
+			if (i > 0)
+				Data.AddPlacement(Erased, EPlacedType::Floor);
+		}
+		const FTiledLevelGameData Before = Data;
+		const FTiledLevelGameData Taken = Data.TakeChunk(Chunk, ChunkSize);
+		Result &= TestTakenChunk(*this, Before, Taken, Chunk, ChunkSize);
+		Result &= TestEqual(TEXT("Nothing is lost"), Data.Num() + Taken.Num(), Before.Num());
+		TakenChunks.Add(Taken);
+		// load every other chunk back right away
+		if (TakenChunks.Num() % 2 == 0)
+			Data.AppendChunk(TakenChunks.Pop());
+	}
+	for (const FTiledLevelGameData& Taken : TakenChunks)
+		Data.AppendChunk(Taken);
+	Result &= TestEqual(TEXT("All placements are back"), Data.Num(), NumAll - Chunks.Num());
+	return Result;
+}
+
+// Size and time of the binary game data against tagged serialization, the usual save game way, on generated data
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FTiledLevelGameDataSaveBenchmarkTest, "TiledLevel.Benchmark.GameDataSave",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+void FTiledLevelGameDataSaveBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (int32 NumPlacements : {10000, 100000})
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("Placements%d"), NumPlacements));
+		OutTestCommands.Add(LexToString(NumPlacements));
+	}
+}
+
+bool FTiledLevelGameDataSaveBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 NumPlacements = FMath::Max(FCString::Atoi(*Parameters), 1);
+	const FVector TileSize(100, 100, 200);
+	const FTiledLevelGameData Data = FTiledLevelUtility::MakeBenchmarkGameData(NumPlacements, TileSize);
+
+	double StartTime = FPlatformTime::Seconds();
+	TArray<uint8> Bytes;
+	Data.SaveToBinary(TileSize, Bytes);
+	const double SaveMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	StartTime = FPlatformTime::Seconds();
+	FTiledLevelGameData Loaded;
+	FVector LoadedTileSize;
+	const bool bLoaded = Loaded.LoadFromBinary(Bytes, LoadedTileSize);
+	const double LoadMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	TArray<uint8> TaggedBytes;
+	FMemoryWriter TaggedWriter(TaggedBytes);
+	FObjectAndNameAsStringProxyArchive TaggedArchive(TaggedWriter, false);
+	StartTime = FPlatformTime::Seconds();
+	FTiledLevelGameData::StaticStruct()->SerializeItem(TaggedArchive, const_cast<FTiledLevelGameData*>(&Data), nullptr);
+	const double TaggedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	AddInfo(FString::Printf(TEXT("%d placements: %d bytes (%.1f per placement), save %.2f ms, load %.2f ms; tagged serialization %d bytes, %.2f ms"),
+		NumPlacements, Bytes.Num(), static_cast<float>(Bytes.Num()) / NumPlacements, SaveMs, LoadMs, TaggedBytes.Num(), TaggedMs));
+	bool Result = TestTrue(TEXT("Saved data is loaded back"), bLoaded);
+	Result &= TestTrue(TEXT("Binary data is smaller than tagged serialization"), Bytes.Num() < TaggedBytes.Num());
+	return Result;
+}
+
+#endif
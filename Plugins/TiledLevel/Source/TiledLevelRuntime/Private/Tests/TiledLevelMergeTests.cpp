@@ -0,0 +1,163 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "MeshDescription.h"
+#include "ProceduralMeshComponent.h"
+#include "TiledItemSet.h"
+#include "TiledLevel.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelUtility.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+/*
+ * The parallel section fill must give exactly the same merge result as the serial one (TiledLevel.ParallelMeshMerge 0),
+ * for both the proc mesh conversion and the off game thread mesh description build.
+ * Placements whose item is gone from the item set are skipped, also for assets not placed in any level (commandlet merge).
+ */
+
+namespace
+{
+	// the merge cvar for the scope, restored afterwards
+	struct FScopedParallelMeshMerge
+	{
+		IConsoleVariable* CVar;
+		bool bOriginal;
+
+		explicit FScopedParallelMeshMerge(bool bParallel)
+			: CVar(IConsoleManager::Get().FindConsoleVariable(TEXT("TiledLevel.ParallelMeshMerge")))
+			, bOriginal(CVar && CVar->GetBool())
+		{
+			if (CVar) CVar->Set(bParallel, ECVF_SetByCode);
+		}
+
+		~FScopedParallelMeshMerge()
+		{
+			if (CVar) CVar->Set(bOriginal, ECVF_SetByCode);
+		}
+	};
+
+	struct FMergeResult
+	{
+		UProceduralMeshComponent* ProcMesh = nullptr;
+		FMeshDescription MeshDescription;
+		TArray<TArray<FVector>> ConvexVertices;
+		TArray<FString> SectionMaterials;
+	};
+}
+
+static FMergeResult MergeAsset(UTiledLevelAsset* Asset, bool bParallel)
+{
+	FScopedParallelMeshMerge ScopedCVar(bParallel);
+	FMergeResult Result;
+	Result.ProcMesh = FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(Asset, 0, GetTransientPackage());
+	Result.MeshDescription = FTiledLevelUtility::BuildMergedMeshDescription(FTiledLevelUtility::PrepareMergeSource(Asset).Get(),
+		Result.ConvexVertices, Result.SectionMaterials);
+	return Result;
+}
+
+static bool IsSameProcSection(const FProcMeshSection& A, const FProcMeshSection& B)
+{
+	if (A.ProcIndexBuffer != B.ProcIndexBuffer || A.ProcVertexBuffer.Num() != B.ProcVertexBuffer.Num()) return false;
+	for (int32 v = 0; v < A.ProcVertexBuffer.Num(); v++)
+	{
+		const FProcMeshVertex& VA = A.ProcVertexBuffer[v];
+		const FProcMeshVertex& VB = B.ProcVertexBuffer[v];
+		if (VA.Position != VB.Position || VA.Normal != VB.Normal || VA.UV0 != VB.UV0 || VA.Color != VB.Color ||
+			VA.Tangent.TangentX != VB.Tangent.TangentX || VA.Tangent.bFlipTangentY != VB.Tangent.bFlipTangentY)
+			return false;
+	}
+	return true;
+}
+
+static bool CompareMergeResults(FAutomationTestBase& Test, FMergeResult& Serial, FMergeResult& Parallel, const FString& Context)
+{
+	bool Result = Test.TestEqual(FString::Printf(TEXT("%s: proc mesh sections"), *Context), Parallel.ProcMesh->GetNumSections(), Serial.ProcMesh->GetNumSections());
+	if (!Result) return false;
+	for (int32 s = 0; s < Serial.ProcMesh->GetNumSections(); s++)
+	{
+		Result &= Test.TestTrue(FString::Printf(TEXT("%s: proc mesh section %d"), *Context, s),
+			IsSameProcSection(*Serial.ProcMesh->GetProcMeshSection(s), *Parallel.ProcMesh->GetProcMeshSection(s)));
+		Result &= Test.TestEqual(FString::Printf(TEXT("%s: proc mesh material %d"), *Context, s),
+			Parallel.ProcMesh->GetMaterial(s), Serial.ProcMesh->GetMaterial(s));
+	}
+
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: section materials"), *Context), Parallel.SectionMaterials == Serial.SectionMaterials);
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: convex collisions"), *Context), Parallel.ConvexVertices == Serial.ConvexVertices);
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: triangles"), *Context),
+		Parallel.MeshDescription.Triangles().Num(), Serial.MeshDescription.Triangles().Num());
+	const auto SerialPositions = Serial.MeshDescription.GetVertexPositions();
+	const auto ParallelPositions = Parallel.MeshDescription.GetVertexPositions();
+	bool IsSamePositions = SerialPositions.GetNumElements() == ParallelPositions.GetNumElements();
+	for (const FVertexID VertexID : Serial.MeshDescription.Vertices().GetElementIDs())
+	{
+		if (!IsSamePositions) break;
+		IsSamePositions = SerialPositions[VertexID] == ParallelPositions[VertexID];
+	}
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: mesh description vertices"), *Context), IsSamePositions);
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelParallelMergeTest, "TiledLevel.Merge.ParallelMatchesSerial",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelParallelMergeTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Size = 24;
+	constexpr int32 NumFloors = 3;
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet();
+	UTiledLevelAsset* Asset = FTiledLevelTestUtility::MakeEmptyAsset(ItemSet, Size, NumFloors);
+	FRandomStream Random(2468);
+
+	// merge reads the spawned (mirrored) actors from the host level
+	FTiledLevelTestWorld TestWorld;
+	ATiledLevel* Level = TestWorld.SpawnTiledLevel(Asset);
+	Asset->HostLevel = Level;
+
+	bool Result = true;
+	for (const int32 NumPlacements : {100, 3000})
+	{
+		FTiledLevelTestUtility::AddRandomPlacements(Asset, Random, NumPlacements, 0.1f);
+		Level->ResetAllInstance(true);
+		FMergeResult Serial = MergeAsset(Asset, false);
+		FMergeResult Parallel = MergeAsset(Asset, true);
+		Result &= TestTrue(TEXT("Merged anything"), Serial.ProcMesh->GetNumSections() > 0);
+		Result &= CompareMergeResults(*this, Serial, Parallel, FString::Printf(TEXT("%d more placements"), NumPlacements));
+	}
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelMergeMissingItemsTest, "TiledLevel.Merge.SkipsMissingItems",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelMergeMissingItemsTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Size = 16;
+	constexpr int32 NumFloors = 2;
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet();
+	// no host level, the same as assets loaded by the commandlet
+	UTiledLevelAsset* Asset = FTiledLevelTestUtility::MakeEmptyAsset(ItemSet, Size, NumFloors);
+	FRandomStream Random(1357);
+	FTiledLevelTestUtility::AddRandomPlacements(Asset, Random, 300);
+	FMergeResult Valid = MergeAsset(Asset, true);
+
+	// added straight to the floors, AddNewTilePlacement refuses them
+	UTiledLevelItem* Item = FTiledLevelTestUtility::FindItems(ItemSet, EPlacedType::Block)[0];
+	for (int32 i = 0; i < 20; i++)
+	{
+		FTilePlacement P = FTiledLevelTestUtility::MakeTilePlacement(Item, Random, Size, NumFloors);
+		P.ItemID = FGuid::NewGuid();
+		Asset->GetFloorFromPosition(P.GridPosition.Z)->BlockPlacements.Add(P);
+	}
+	FMergeResult WithMissing = MergeAsset(Asset, true);
+
+	bool Result = TestTrue(TEXT("Merged anything"), Valid.ProcMesh->GetNumSections() > 0);
+	Result &= CompareMergeResults(*this, Valid, WithMissing, TEXT("missing items"));
+	return Result;
+}
+
+#endif
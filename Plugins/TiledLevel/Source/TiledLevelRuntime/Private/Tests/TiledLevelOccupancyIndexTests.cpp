@@ -0,0 +1,278 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelItem.h"
+#include "TiledLevelUtility.h"
+#include "Misc/AutomationTest.h"
+
+/*
+ * Random placements and queries, every index query must return exactly what a scan of all placements finds.
+ * Edits between the rounds go through the incremental add / remove paths, the bulk ones mark the index dirty.
+ */
+
+namespace
+{
+	template <typename T>
+	struct TTypedPlacement
+	{
+		T Placement;
+		EPlacedType PlacedType;
+	};
+
+	// every placement with its placed type, the brute force side of the comparison
+	struct FAllPlacements
+	{
+		TArray<TTypedPlacement<FTilePlacement>> Tiles;
+		TArray<TTypedPlacement<FEdgePlacement>> Edges;
+		TArray<TTypedPlacement<FPointPlacement>> Points;
+
+		template <typename T>
+		static void Append(TArray<TTypedPlacement<T>>& To, const TArray<T>& From, EPlacedType PlacedType)
+		{
+			for (const T& P : From)
+				To.Add({P, PlacedType});
+		}
+
+		void Append(const TArray<FTilePlacement>& Blocks, const TArray<FTilePlacement>& Floors, const TArray<FEdgePlacement>& Walls,
+			const TArray<FEdgePlacement>& EdgeProps, const TArray<FPointPlacement>& Pillars, const TArray<FPointPlacement>& PointProps)
+		{
+			Append(Tiles, Blocks, EPlacedType::Block);
+			Append(Tiles, Floors, EPlacedType::Floor);
+			Append(Edges, Walls, EPlacedType::Wall);
+			Append(Edges, EdgeProps, EPlacedType::Edge);
+			Append(Points, Pillars, EPlacedType::Pillar);
+			Append(Points, PointProps, EPlacedType::Point);
+		}
+	};
+
+	bool IsMatchedType(EPlacedType EntryType, EPlacedType QueryType)
+	{
+		return QueryType == EPlacedType::Any || EntryType == QueryType;
+	}
+
+	FIntVector GetItemExtent(const FItemPlacement& P)
+	{
+		const UTiledLevelItem* Item = P.GetItem();
+		return Item? FIntVector(Item->Extent) : FIntVector(1);
+	}
+
+	EPlacedType RandomQueryType(FRandomStream& Random, EPlacedType A, EPlacedType B)
+	{
+		const int32 Roll = Random.RandRange(0, 2);
+		return Roll == 0? A : Roll == 1? B : EPlacedType::Any;
+	}
+}
+
+static bool CompareQueries(FAutomationTestBase& Test, const FTiledLevelOccupancyIndex& Index, const FAllPlacements& All, FRandomStream& Random,
+	int32 Size, int32 NumFloors, int32 NumQueries, const FString& Context)
+{
+	for (int32 q = 0; q < NumQueries; q++)
+	{
+		const FIntVector Position(Random.RandRange(-2, Size), Random.RandRange(-2, Size), Random.RandRange(0, NumFloors - 1));
+		const FIntVector Extent(Random.RandRange(1, 4), Random.RandRange(1, 4), Random.RandRange(1, 2));
+
+		// tiles
+		{
+			const EPlacedType QueryType = RandomQueryType(Random, EPlacedType::Block, EPlacedType::Floor);
+			FTilePlacement TestPlacement;
+			TestPlacement.GridPosition = Position;
+			TestPlacement.Extent = Extent;
+			TArray<FTilePlacement> Expected;
+			for (const auto& E : All.Tiles)
+			{
+				if (IsMatchedType(E.PlacedType, QueryType) && FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, E.Placement))
+					Expected.Add(E.Placement);
+			}
+			if (!FTiledLevelTestUtility::IsSamePlacements(Index.FindOverlappingTiles(Position, Extent, QueryType), Expected))
+			{
+				Test.AddError(FString::Printf(TEXT("%s: FindOverlappingTiles %s %s differs from brute force"), *Context, *Position.ToString(), *Extent.ToString()));
+				return false;
+			}
+		}
+		// edges
+		{
+			const EPlacedType QueryType = RandomQueryType(Random, EPlacedType::Wall, EPlacedType::Edge);
+			const FTiledLevelEdge Edge(Position, Random.FRand() < 0.5f? EEdgeType::Horizontal : EEdgeType::Vertical);
+			TArray<FEdgePlacement> Expected;
+			for (const auto& E : All.Edges)
+			{
+				if (IsMatchedType(E.PlacedType, QueryType) && FTiledLevelUtility::IsEdgeOverlapping(Edge, FVector(Extent), E.Placement.Edge, FVector(GetItemExtent(E.Placement))))
+					Expected.Add(E.Placement);
+			}
+			if (!FTiledLevelTestUtility::IsSamePlacements(Index.FindOverlappingEdges(Edge, Extent, QueryType), Expected))
+			{
+				Test.AddError(FString::Printf(TEXT("%s: FindOverlappingEdges %s %s differs from brute force"), *Context, *Position.ToString(), *Extent.ToString()));
+				return false;
+			}
+		}
+		// points
+		{
+			const EPlacedType QueryType = RandomQueryType(Random, EPlacedType::Pillar, EPlacedType::Point);
+			TArray<FPointPlacement> Expected;
+			for (const auto& E : All.Points)
+			{
+				if (IsMatchedType(E.PlacedType, QueryType) && FTiledLevelUtility::IsPointOverlapping(Position, Extent.Z, E.Placement.GridPosition, GetItemExtent(E.Placement).Z))
+					Expected.Add(E.Placement);
+			}
+			if (!FTiledLevelTestUtility::IsSamePlacements(Index.FindOverlappingPoints(Position, Extent.Z, QueryType), Expected))
+			{
+				Test.AddError(FString::Printf(TEXT("%s: FindOverlappingPoints %s %d differs from brute force"), *Context, *Position.ToString(), Extent.Z));
+				return false;
+			}
+		}
+		// eraser
+		{
+			TArray<FEdgePlacement> ExpectedEdges;
+			for (const auto& E : All.Edges)
+			{
+				if (FTiledLevelUtility::IsEdgeInsideTile(E.Placement.Edge, GetItemExtent(E.Placement), Position, Extent))
+					ExpectedEdges.Add(E.Placement);
+			}
+			TArray<FPointPlacement> ExpectedPoints;
+			for (const auto& E : All.Points)
+			{
+				if (FTiledLevelUtility::IsPointInsideTile(E.Placement.GridPosition, GetItemExtent(E.Placement).Z, Position, Extent))
+					ExpectedPoints.Add(E.Placement);
+			}
+			if (!FTiledLevelTestUtility::IsSamePlacements(Index.FindEdgesInsideTile(Position, Extent), ExpectedEdges) ||
+				!FTiledLevelTestUtility::IsSamePlacements(Index.FindPointsInsideTile(Position, Extent), ExpectedPoints))
+			{
+				Test.AddError(FString::Printf(TEXT("%s: Find*InsideTile %s %s differs from brute force"), *Context, *Position.ToString(), *Extent.ToString()));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static FAllPlacements GetAllPlacements(const UTiledLevelAsset* Asset)
+{
+	FAllPlacements All;
+	for (const FTiledFloor& F : Asset->TiledFloors)
+		All.Append(F.BlockPlacements, F.FloorPlacements, F.WallPlacements, F.EdgePlacements, F.PillarPlacements, F.PointPlacements);
+	return All;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelOccupancyIndexAssetTest, "TiledLevel.OccupancyIndex.Asset",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelOccupancyIndexAssetTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Size = 24;
+	constexpr int32 NumFloors = 3;
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet();
+	UTiledLevelAsset* Asset = FTiledLevelTestUtility::MakeEmptyAsset(ItemSet, Size, NumFloors);
+	const TArray<UTiledLevelItem*> Items = ItemSet->GetItemSet();
+	FRandomStream Random(1234);
+
+	// build it once, everything after this must be kept up to date without a rebuild
+	Asset->GetOccupancyIndex();
+	for (int32 Round = 0; Round < 5; Round++)
+	{
+		FTiledLevelTestUtility::AddRandomPlacements(Asset, Random, 400);
+		// a brush stroke bumps the version, which must not matter to the index
+		Asset->VersionNumber += 1;
+
+		const FAllPlacements Before = GetAllPlacements(Asset);
+		TArray<FTilePlacement> TilesToDelete;
+		TArray<FEdgePlacement> EdgesToDelete;
+		TArray<FPointPlacement> PointsToDelete;
+		for (const auto& E : Before.Tiles)
+			if (Random.FRand() < 0.2f) TilesToDelete.Add(E.Placement);
+		for (const auto& E : Before.Edges)
+			if (Random.FRand() < 0.2f) EdgesToDelete.Add(E.Placement);
+		for (const auto& E : Before.Points)
+			if (Random.FRand() < 0.2f) PointsToDelete.Add(E.Placement);
+		Asset->RemovePlacements(TilesToDelete);
+		Asset->RemovePlacements(EdgesToDelete);
+		Asset->RemovePlacements(PointsToDelete);
+
+		if (!CompareQueries(*this, Asset->GetOccupancyIndex(), GetAllPlacements(Asset), Random, Size, NumFloors, 300, FString::Printf(TEXT("Round %d"), Round)))
+			return false;
+	}
+
+	// bulk edits
+	Asset->ClearItem(Items[1]->ItemID);
+	if (!CompareQueries(*this, Asset->GetOccupancyIndex(), GetAllPlacements(Asset), Random, Size, NumFloors, 300, TEXT("ClearItem")))
+		return false;
+	Asset->EmptyFloor(1);
+	if (!CompareQueries(*this, Asset->GetOccupancyIndex(), GetAllPlacements(Asset), Random, Size, NumFloors, 300, TEXT("EmptyFloor")))
+		return false;
+	Asset->MoveAllFloors(true);
+	return CompareQueries(*this, Asset->GetOccupancyIndex(), GetAllPlacements(Asset), Random, Size, NumFloors + 1, 300, TEXT("MoveAllFloors"));
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelOccupancyIndexGameDataTest, "TiledLevel.OccupancyIndex.GameData",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelOccupancyIndexGameDataTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Size = 24;
+	constexpr int32 NumFloors = 3;
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet();
+	const TArray<UTiledLevelItem*> Items = ItemSet->GetItemSet();
+	FRandomStream Random(5678);
+	FTiledLevelGameData Data;
+	TArray<TPair<FTransform, FGuid>> Added;
+
+	auto GetAll = [&Data]()
+	{
+		FAllPlacements All;
+		All.Append(Data.BlockPlacements, Data.FloorPlacements, Data.WallPlacements, Data.EdgePlacements, Data.PillarPlacements, Data.PointPlacements);
+		return All;
+	};
+
+	Data.GetOccupancyIndex();
+	for (int32 Round = 0; Round < 5; Round++)
+	{
+		for (int32 n = 0; n < 400; n++)
+		{
+			UTiledLevelItem* Item = Items[Random.RandRange(0, Items.Num() - 1)];
+			if (Item->PlacedType == EPlacedType::Block || Item->PlacedType == EPlacedType::Floor)
+			{
+				const FTilePlacement P = FTiledLevelTestUtility::MakeTilePlacement(Item, Random, Size, NumFloors);
+				Data.AddPlacement(P, Item->PlacedType);
+				Added.Add({P.TileObjectTransform, P.ItemID});
+			}
+			else if (Item->PlacedType == EPlacedType::Wall || Item->PlacedType == EPlacedType::Edge)
+			{
+				const FEdgePlacement P = FTiledLevelTestUtility::MakeEdgePlacement(Item, Random, Size, NumFloors);
+				Data.AddPlacement(P, Item->PlacedType);
+				Added.Add({P.TileObjectTransform, P.ItemID});
+			}
+			else
+			{
+				// stacked points: same position and item, different transform
+				const FPointPlacement P = FTiledLevelTestUtility::MakePointPlacement(Item, Random, Size, NumFloors);
+				Data.AddPlacement(P, Item->PlacedType);
+				Added.Add({P.TileObjectTransform, P.ItemID});
+				FPointPlacement Stacked = P;
+				Stacked.TileObjectTransform.AddToTranslation(FVector(0, 0, 10));
+				Data.AddPlacement(Stacked, Item->PlacedType);
+				Added.Add({Stacked.TileObjectTransform, Stacked.ItemID});
+			}
+		}
+		// gametime erase removes one placement at a time
+		for (int32 n = 0; n < 150 && Added.Num() > 0; n++)
+		{
+			const int32 i = Random.RandRange(0, Added.Num() - 1);
+			if (!Data.RemovePlacement(Added[i].Key, Added[i].Value))
+			{
+				AddError(TEXT("RemovePlacement didn't find an added placement"));
+				return false;
+			}
+			Added.RemoveAtSwap(i);
+		}
+
+		if (!CompareQueries(*this, Data.GetOccupancyIndex(), GetAll(), Random, Size, NumFloors, 300, FString::Printf(TEXT("Round %d"), Round)))
+			return false;
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,176 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevel.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelItem.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Misc/AutomationTest.h"
+
+/*
+ * Edit the asset, then an incremental ResetAllInstance on a level that was already populated must end up
+ * with the same instances and actors as a fresh level populated from scratch.
+ */
+
+namespace
+{
+	struct FTiledInstanceState
+	{
+		TArray<float> CustomData;
+		FTransform Transform;
+	};
+
+	struct FTiledActorState
+	{
+		UClass* Class;
+		FTransform Transform;
+	};
+}
+
+// instances of each non empty partition
+static TMap<FTiledInstancePartition, TArray<FTiledInstanceState>> GetInstanceStates(const ATiledLevel* Level)
+{
+	TMap<FTiledInstancePartition, TArray<FTiledInstanceState>> States;
+	for (auto& elem : Level->TiledObjectPartitions)
+	{
+		const UHierarchicalInstancedStaticMeshComponent* HISM = elem.Value;
+		if (!HISM || HISM->GetInstanceCount() == 0) continue;
+		TArray<FTiledInstanceState>& Instances = States.Add(elem.Key);
+		for (int32 i = 0; i < HISM->GetInstanceCount(); i++)
+		{
+			FTiledInstanceState& State = Instances.AddDefaulted_GetRef();
+			State.CustomData.Append(&HISM->PerInstanceSMCustomData[i * HISM->NumCustomDataFloats], HISM->NumCustomDataFloats);
+			HISM->GetInstanceTransform(i, State.Transform, false);
+		}
+	}
+	return States;
+}
+
+static TArray<FTiledActorState> GetActorStates(const ATiledLevel* Level)
+{
+	TArray<FTiledActorState> States;
+	for (const AActor* Actor : Level->SpawnedTiledActors)
+	{
+		if (!IsValid(Actor)) continue;
+		States.Add({Actor->GetClass(), Actor->GetRootComponent()->GetRelativeTransform()});
+	}
+	return States;
+}
+
+// every element of A matches one element of B
+template <typename T, typename Pred>
+static bool IsSameStates(const TArray<T>& A, TArray<T> B, Pred IsMatched)
+{
+	if (A.Num() != B.Num()) return false;
+	for (const T& State : A)
+	{
+		const int32 Found = B.IndexOfByPredicate([&](const T& Other) { return IsMatched(State, Other); });
+		if (Found == INDEX_NONE) return false;
+		B.RemoveAtSwap(Found);
+	}
+	return true;
+}
+
+static bool CompareWithFullRebuild(FAutomationTestBase& Test, const FTiledLevelTestWorld& TestWorld, ATiledLevel* Level, const FString& Context)
+{
+	Level->ResetAllInstance(true);
+	ATiledLevel* Rebuilt = TestWorld.SpawnTiledLevel(Level->GetAsset());
+	Rebuilt->ResetAllInstance(true);
+
+	const auto Incremental = GetInstanceStates(Level);
+	const auto Full = GetInstanceStates(Rebuilt);
+	bool Result = Test.TestEqual(FString::Printf(TEXT("%s: number of partitions"), *Context), Incremental.Num(), Full.Num());
+	for (auto& elem : Full)
+	{
+		const TArray<FTiledInstanceState>* Instances = Incremental.Find(elem.Key);
+		if (!Instances)
+		{
+			Test.AddError(FString::Printf(TEXT("%s: missing partition %s, floor %d, chunk %s"), *Context,
+				*GetNameSafe(elem.Key.Mesh), elem.Key.Floor, *elem.Key.Chunk.ToString()));
+			Result = false;
+			continue;
+		}
+		const bool IsSame = IsSameStates(*Instances, elem.Value, [](const FTiledInstanceState& A, const FTiledInstanceState& B)
+		{
+			return A.CustomData == B.CustomData && A.Transform.Equals(B.Transform);
+		});
+		Result &= Test.TestTrue(FString::Printf(TEXT("%s: instances of %s, floor %d, chunk %s"), *Context,
+			*GetNameSafe(elem.Key.Mesh), elem.Key.Floor, *elem.Key.Chunk.ToString()), IsSame);
+	}
+
+	const bool IsSameActors = IsSameStates(GetActorStates(Level), GetActorStates(Rebuilt), [](const FTiledActorState& A, const FTiledActorState& B)
+	{
+		return A.Class == B.Class && A.Transform.Equals(B.Transform);
+	});
+	Result &= Test.TestTrue(FString::Printf(TEXT("%s: spawned actors"), *Context), IsSameActors);
+
+	// takes its spawned actors with it
+	Rebuilt->Destroy();
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelIncrementalResetTest, "TiledLevel.ResetAllInstance.IncrementalMatchesFullRebuild",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelIncrementalResetTest::RunTest(const FString& Parameters)
+{
+	constexpr int32 Size = 24;
+	constexpr int32 NumFloors = 3;
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet();
+	UTiledLevelAsset* Asset = FTiledLevelTestUtility::MakeEmptyAsset(ItemSet, Size, NumFloors);
+	const TArray<UTiledLevelItem*> Items = ItemSet->GetItemSet();
+	FRandomStream Random(4321);
+
+	FTiledLevelTestWorld TestWorld;
+	ATiledLevel* Level = TestWorld.SpawnTiledLevel(Asset);
+	Level->ResetAllInstance(true);
+
+	bool Result = true;
+	for (int32 Round = 0; Round < 4; Round++)
+	{
+		// mirrored ones are spawned as actors
+		FTiledLevelTestUtility::AddRandomPlacements(Asset, Random, 300, 0.1f);
+		Result &= CompareWithFullRebuild(*this, TestWorld, Level, FString::Printf(TEXT("Add, round %d"), Round));
+
+		TArray<FTilePlacement> TilesToDelete;
+		TArray<FEdgePlacement> EdgesToDelete;
+		TArray<FPointPlacement> PointsToDelete;
+		for (const FTiledFloor& F : Asset->TiledFloors)
+		{
+			for (const FTilePlacement& P : F.BlockPlacements)
+				if (Random.FRand() < 0.3f) TilesToDelete.Add(P);
+			for (const FEdgePlacement& P : F.WallPlacements)
+				if (Random.FRand() < 0.3f) EdgesToDelete.Add(P);
+			for (const FPointPlacement& P : F.PointPlacements)
+				if (Random.FRand() < 0.3f) PointsToDelete.Add(P);
+		}
+		Asset->RemovePlacements(TilesToDelete);
+		Asset->RemovePlacements(EdgesToDelete);
+		Asset->RemovePlacements(PointsToDelete);
+		Result &= CompareWithFullRebuild(*this, TestWorld, Level, FString::Printf(TEXT("Remove, round %d"), Round));
+	}
+
+	Asset->ClearItem(Items[0]->ItemID);
+	Result &= CompareWithFullRebuild(*this, TestWorld, Level, TEXT("ClearItem"));
+
+	// every partition changes
+	Asset->InstanceChunkSize = 8;
+	Result &= CompareWithFullRebuild(*this, TestWorld, Level, TEXT("Chunk size"));
+
+	Asset->MoveAllFloors(true);
+	Result &= CompareWithFullRebuild(*this, TestWorld, Level, TEXT("MoveAllFloors"));
+
+	Asset->EmptyFloor(1);
+	Result &= CompareWithFullRebuild(*this, TestWorld, Level, TEXT("EmptyFloor"));
+
+	Asset->InstanceChunkSize = 0;
+	FTiledLevelTestUtility::AddRandomPlacements(Asset, Random, 300, 0.1f);
+	Result &= CompareWithFullRebuild(*this, TestWorld, Level, TEXT("Chunking off"));
+	return Result;
+}
+
+#endif
@@ -0,0 +1,199 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledLevelRestrictionHelper.h"
+#include "Misc/AutomationTest.h"
+
+/*
+ * Restriction area hint mesh: the greedy rectangles must cover exactly the exposed tile faces, all wound the same way,
+ * and the UV outline must follow the edge of the region only, never the seams between rectangles.
+ */
+
+namespace
+{
+	struct FTiledHintMesh
+	{
+		TArray<FVector> Vertices;
+		TArray<int32> Triangles;
+		TArray<FVector> Normals;
+		TArray<FVector2D> UVs;
+
+		FTiledHintMesh(const TArray<FIntVector>& Positions, const FVector& TileSize)
+		{
+			ATiledLevelRestrictionHelper::BuildAreaHintMesh(Positions, TileSize, Vertices, Triangles, Normals, UVs);
+		}
+	};
+}
+
+// UV at a point on a face plane, false if no triangle facing Normal covers it
+static bool SampleUV(const FTiledHintMesh& Mesh, const FVector& Point, const FVector& Normal, FVector2D& OutUV)
+{
+	for (int32 t = 0; t < Mesh.Triangles.Num(); t += 3)
+	{
+		const int32 I0 = Mesh.Triangles[t], I1 = Mesh.Triangles[t + 1], I2 = Mesh.Triangles[t + 2];
+		if (!Mesh.Normals[I0].Equals(Normal)) continue;
+		if (FMath::Abs(FVector::DotProduct(Point - Mesh.Vertices[I0], Normal)) > 0.01) continue;
+		const FVector Bary = FMath::ComputeBaryCentric2D(Point, Mesh.Vertices[I0], Mesh.Vertices[I1], Mesh.Vertices[I2]);
+		if (Bary.GetMin() < -1e-4) continue;
+		OutUV = Mesh.UVs[I0] * Bary.X + Mesh.UVs[I1] * Bary.Y + Mesh.UVs[I2] * Bary.Z;
+		return true;
+	}
+	return false;
+}
+
+// inside the border the outline material draws (it's at most a quarter tile wide)
+static bool IsBorder(const FVector2D& UV)
+{
+	return FMath::Min(FMath::Min(UV.X, 1 - UV.X), FMath::Min(UV.Y, 1 - UV.Y)) < 0.25f;
+}
+
+static bool CheckHintMesh(FAutomationTestBase& Test, const TArray<FIntVector>& Positions, const FVector& TileSize, const FString& Context)
+{
+	const FTiledHintMesh Mesh(Positions, TileSize);
+	const TSet<FIntVector> Cells(Positions);
+	bool Result = Test.TestTrue(FString::Printf(TEXT("%s: not empty"), *Context), Positions.Num() == 0 || Mesh.Triangles.Num() > 0);
+
+	// every triangle winds the same way around its normal (clockwise seen from the outside)
+	double Area[3] = {0, 0, 0};
+	int32 NumMiswound = 0;
+	for (int32 t = 0; t < Mesh.Triangles.Num(); t += 3)
+	{
+		const FVector& A = Mesh.Vertices[Mesh.Triangles[t]];
+		const FVector Cross = FVector::CrossProduct(Mesh.Vertices[Mesh.Triangles[t + 1]] - A, Mesh.Vertices[Mesh.Triangles[t + 2]] - A);
+		const FVector& Normal = Mesh.Normals[Mesh.Triangles[t]];
+		if (FVector::DotProduct(Cross, Normal) >= 0)
+			NumMiswound++;
+		Area[FMath::Abs(Normal.X) > 0.5? 0 : FMath::Abs(Normal.Y) > 0.5? 1 : 2] += Cross.Size() / 2;
+	}
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: triangles wound the other way"), *Context), NumMiswound, 0);
+
+	auto IsExposed = [&Cells](const FIntVector& Cell, const FIntVector& Step) { return Cells.Contains(Cell) && !Cells.Contains(Cell + Step); };
+	int32 NumFaces[3] = {0, 0, 0};
+	int32 NumUncovered = 0;
+	int32 NumWrongCenters = 0;
+	int32 NumWrongEdges = 0;
+	for (const FIntVector& Cell : Cells)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			for (int32 Sign = -1; Sign <= 1; Sign += 2)
+			{
+				FIntVector Step(0);
+				Step[Axis] = Sign;
+				if (!IsExposed(Cell, Step)) continue;
+				NumFaces[Axis]++;
+				FVector Normal(0);
+				Normal[Axis] = Sign;
+				FVector Center = (FVector(Cell) + 0.5) * TileSize;
+				Center[Axis] = (Cell[Axis] + (Sign > 0? 1 : 0)) * TileSize[Axis];
+
+				FVector2D UV;
+				if (!SampleUV(Mesh, Center, Normal, UV))
+				{
+					NumUncovered++;
+					continue;
+				}
+				if (IsBorder(UV))
+					NumWrongCenters++;
+				// a tenth of a tile inside each side: border exactly when the region ends there
+				for (int32 SideAxis = 0; SideAxis < 3; SideAxis++)
+				{
+					if (SideAxis == Axis) continue;
+					for (int32 Side = -1; Side <= 1; Side += 2)
+					{
+						FIntVector Neighbor = Cell;
+						Neighbor[SideAxis] += Side;
+						FVector Point = Center;
+						Point[SideAxis] += Side * 0.4 * TileSize[SideAxis];
+						if (!SampleUV(Mesh, Point, Normal, UV))
+							NumUncovered++;
+						else if (IsBorder(UV) == IsExposed(Neighbor, Step))
+							NumWrongEdges++;
+					}
+				}
+			}
+		}
+	}
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: uncovered face samples"), *Context), NumUncovered, 0);
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: face centers inside a border"), *Context), NumWrongCenters, 0);
+	Result &= Test.TestEqual(FString::Printf(TEXT("%s: face sides with the wrong border"), *Context), NumWrongEdges, 0);
+
+	// covered once, no overlapping rectangles
+	const double FaceAreas[3] = {TileSize.Y * TileSize.Z, TileSize.X * TileSize.Z, TileSize.X * TileSize.Y};
+	for (int32 Axis = 0; Axis < 3; Axis++)
+		Result &= Test.TestEqual(FString::Printf(TEXT("%s: area facing axis %d"), *Context, Axis), Area[Axis], NumFaces[Axis] * FaceAreas[Axis], 0.01 * FaceAreas[Axis]);
+	return Result;
+}
+
+static TArray<FIntVector> MakeRect(const FIntVector& Min, const FIntVector& Size)
+{
+	TArray<FIntVector> Positions;
+	for (int32 Z = 0; Z < Size.Z; Z++)
+		for (int32 Y = 0; Y < Size.Y; Y++)
+			for (int32 X = 0; X < Size.X; X++)
+				Positions.Add(Min + FIntVector(X, Y, Z));
+	return Positions;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelRestrictionBordersTest, "TiledLevel.RestrictionVisual.BordersOnRegionEdge",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelRestrictionBordersTest::RunTest(const FString& Parameters)
+{
+	const FVector TileSize(100, 100, 300);
+	bool Result = CheckHintMesh(*this, {}, TileSize, TEXT("empty"));
+	Result &= CheckHintMesh(*this, {FIntVector(0)}, TileSize, TEXT("single tile"));
+	Result &= CheckHintMesh(*this, MakeRect(FIntVector(0), FIntVector(6, 4, 1)), TileSize, TEXT("rectangle"));
+
+	// greedy meshing splits these into several rectangles per plane
+	TArray<FIntVector> Plus = MakeRect(FIntVector(2, 0, 0), FIntVector(2, 6, 1));
+	Plus.Append(MakeRect(FIntVector(0, 2, 0), FIntVector(2, 2, 1)));
+	Plus.Append(MakeRect(FIntVector(4, 2, 0), FIntVector(2, 2, 1)));
+	Result &= CheckHintMesh(*this, Plus, TileSize, TEXT("plus"));
+
+	TArray<FIntVector> Ring = MakeRect(FIntVector(0), FIntVector(7, 7, 1));
+	Ring.RemoveAll([](const FIntVector& P) { return P.X >= 2 && P.X <= 4 && P.Y >= 3 && P.Y <= 4; });
+	Result &= CheckHintMesh(*this, Ring, TileSize, TEXT("ring"));
+
+	// side faces half covered by the floor above
+	TArray<FIntVector> Stacked = MakeRect(FIntVector(0), FIntVector(5, 5, 1));
+	Stacked.Append(MakeRect(FIntVector(1, 2, 1), FIntVector(3, 3, 1)));
+	Result &= CheckHintMesh(*this, Stacked, TileSize, TEXT("stacked floors"));
+
+	FRandomStream Random(19);
+	for (int32 Case = 0; Case < 4; Case++)
+	{
+		TArray<FIntVector> Blob;
+		for (const FIntVector& P : MakeRect(FIntVector(-6, -6, 0), FIntVector(12, 12, 3)))
+		{
+			if (Random.FRand() < 0.6f)
+				Blob.Add(P);
+		}
+		Result &= CheckHintMesh(*this, Blob, TileSize, FString::Printf(TEXT("random blob %d"), Case));
+	}
+	return Result;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelRestrictionLargeAreaTest, "TiledLevel.RestrictionVisual.LargeArea",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelRestrictionLargeAreaTest::RunTest(const FString& Parameters)
+{
+	const int32 Size = 256;
+	const TArray<FIntVector> Positions = MakeRect(FIntVector(0), FIntVector(Size, Size, 1));
+	const double StartTime = FPlatformTime::Seconds();
+	const FTiledHintMesh Mesh(Positions, FVector(100, 100, 300));
+	const double BuildMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	// faces one quad per exposed tile face would end up with
+	const int32 TileFaces = 2 * Size * Size + 4 * Size;
+	AddInfo(FString::Printf(TEXT("restriction visual %dx%d: rebuild %.3f ms, %d vertices, %d triangles (per tile faces would be %d vertices, %d triangles)"),
+		Size, Size, BuildMs, Mesh.Vertices.Num(), Mesh.Triangles.Num() / 3, TileFaces * 4, TileFaces * 2));
+	// one rectangle per side, 3x3 slices on top and bottom, 2x3 on the sides
+	return TestEqual(TEXT("triangles of a single box"), Mesh.Triangles.Num() / 3, 2 * (2 * 9 + 4 * 6));
+}
+
+#endif
@@ -0,0 +1,197 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevelGametimeSystem.h"
+#include "TiledLevelSnapshot.h"
+#include "TiledLevelUtility.h"
+#include "Engine/GameInstance.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/*
+ * Gametime system started from a snapshot: instances come straight from the mapped records, and the placements are
+ * only decoded a chunk at a time when needed, so init must not hold a decoded copy of the whole snapshot.
+ * Time and memory of the full init path are logged next to the binary save path for comparison,
+ * and saving right after init must still give back all the data.
+ */
+
+// same elements in any order, sorted first since the pairwise check of the test utility is too slow at this size
+template <typename T>
+static bool IsSameUnordered(TArray<T> A, TArray<T> B)
+{
+	if (A.Num() != B.Num()) return false;
+	auto Less = [](const T& L, const T& R)
+	{
+		const FTiledActorHandle HL(L), HR(R);
+		for (int32 i = 0; i < 3; i++)
+		{
+			if (HL.Position[i] != HR.Position[i]) return HL.Position[i] < HR.Position[i];
+			if (HL.ExtraInfo[i] != HR.ExtraInfo[i]) return HL.ExtraInfo[i] < HR.ExtraInfo[i];
+		}
+		if (HL.ItemID != HR.ItemID) return HL.ItemID < HR.ItemID;
+		const FVector TL = L.TileObjectTransform.GetTranslation(), TR = R.TileObjectTransform.GetTranslation();
+		for (int32 i = 0; i < 3; i++)
+			if (TL[i] != TR[i]) return TL[i] < TR[i];
+		return false;
+	};
+	A.Sort(Less);
+	B.Sort(Less);
+	for (int32 i = 0; i < A.Num(); i++)
+	{
+		if (!(A[i] == B[i]) || A[i].IsMirrored != B[i].IsMirrored || !A[i].TileObjectTransform.Equals(B[i].TileObjectTransform, 0.0))
+			return false;
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelSnapshotInitTest, "TiledLevel.GametimeSystem.SnapshotInit",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FTiledLevelSnapshotInitTest::RunTest(const FString& Parameters)
+{
+	const int32 NumPlacements = 200000;
+	const FVector TileSize(100);
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("TiledLevel/Tests");
+	const FString BinaryFile = Directory / TEXT("SnapshotInit.tlgd");
+	const FString SnapshotFile = Directory / TEXT("SnapshotInit.snapshot");
+	const FString SavedFile = Directory / TEXT("SnapshotInitSaved.snapshot");
+
+	UTiledItemSet* ItemSet = FTiledLevelTestUtility::MakeItemSet(TileSize);
+	const FTiledLevelGameData Data = FTiledLevelUtility::MakeBenchmarkGameData(NumPlacements, TileSize, ItemSet);
+	TArray<uint8> Bytes;
+	Data.SaveToBinary(TileSize, Bytes);
+	if (!TestTrue(TEXT("binary written"), FFileHelper::SaveArrayToFile(Bytes, *BinaryFile)) ||
+		!TestTrue(TEXT("snapshot written"), FTiledLevelSnapshot::Write(Data, TileSize, SnapshotFile)))
+		return false;
+	Bytes.Empty();
+
+	auto GetUsedMB = []() { return FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0); };
+	bool Result = true;
+	{
+		FTiledLevelTestWorld TestWorld;
+		UTiledLevelGametimeSystem* System = TestWorld.GetGameInstance()->GetSubsystem<UTiledLevelGametimeSystem>();
+		if (!TestNotNull(TEXT("gametime system"), System)) return false;
+		System->TileSize = TileSize;
+
+		double StartMB = GetUsedMB();
+		double StartTime = FPlatformTime::Seconds();
+		Result &= TestTrue(TEXT("init from binary"), System->InitializeGametimeSystemFromFile(TestWorld.GetWorld(), ItemSet, BinaryFile));
+		const double BinaryMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		const double BinaryMB = GetUsedMB() - StartMB;
+
+		StartMB = GetUsedMB();
+		StartTime = FPlatformTime::Seconds();
+		Result &= TestTrue(TEXT("init from snapshot"), System->InitializeGametimeSystemFromSnapshot(TestWorld.GetWorld(), ItemSet, SnapshotFile));
+		const double SnapshotMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		const double SnapshotMB = GetUsedMB() - StartMB;
+		AddInfo(FString::Printf(TEXT("Full init of %d placements: binary %.2f ms, %+.1f MB used; snapshot %.2f ms, %+.1f MB used (previous level released in between)"),
+			NumPlacements, BinaryMs, BinaryMB, SnapshotMs, SnapshotMB));
+
+		// nothing built or erased yet, so nothing is decoded
+		Result &= TestEqual(TEXT("decoded placements after snapshot init"), System->GametimeData.Num(), 0);
+		Result &= TestTrue(TEXT("saved after snapshot init"), System->SaveAsSnapshot(SavedFile));
+	}
+
+	FTiledLevelSnapshot Saved;
+	if (TestTrue(TEXT("saved snapshot opened"), Saved.Open(SavedFile)))
+	{
+		const FTiledLevelGameData SavedData = Saved.ToGameData();
+		// chunks are decoded in any order
+		Result &= TestTrue(TEXT("blocks"), IsSameUnordered(SavedData.BlockPlacements, Data.BlockPlacements));
+		Result &= TestTrue(TEXT("floors"), IsSameUnordered(SavedData.FloorPlacements, Data.FloorPlacements));
+		Result &= TestTrue(TEXT("walls"), IsSameUnordered(SavedData.WallPlacements, Data.WallPlacements));
+		Result &= TestTrue(TEXT("edges"), IsSameUnordered(SavedData.EdgePlacements, Data.EdgePlacements));
+		Result &= TestTrue(TEXT("pillars"), IsSameUnordered(SavedData.PillarPlacements, Data.PillarPlacements));
+		Result &= TestTrue(TEXT("points"), IsSameUnordered(SavedData.PointPlacements, Data.PointPlacements));
+		Saved.Close();
+	}
+	else
+	{
+		Result = false;
+	}
+
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	return Result;
+}
+
+// Load time and memory of the binary save against the mapped snapshot alone (no gametime system), on generated data
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FTiledLevelSnapshotLoadBenchmarkTest, "TiledLevel.Benchmark.SnapshotLoad",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::PerfFilter)
+
+bool FTiledLevelSnapshotLoadBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const int32 NumPlacements = 100000;
+	const FVector TileSize(100, 100, 200);
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("TiledLevel/Tests");
+	const FString BinaryFile = Directory / TEXT("SnapshotLoad.tlgd");
+	const FString SnapshotFile = Directory / TEXT("SnapshotLoad.snapshot");
+	{
+		const FTiledLevelGameData Data = FTiledLevelUtility::MakeBenchmarkGameData(NumPlacements, TileSize);
+		TArray<uint8> Bytes;
+		Data.SaveToBinary(TileSize, Bytes);
+		if (!TestTrue(TEXT("binary written"), FFileHelper::SaveArrayToFile(Bytes, *BinaryFile)) ||
+			!TestTrue(TEXT("snapshot written"), FTiledLevelSnapshot::Write(Data, TileSize, SnapshotFile)))
+			return false;
+	}
+	auto GetUsedMB = []() { return FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0); };
+	// touch every transform, as populating instances would
+	auto SumTranslations = [](const FTiledLevelGameData& Data)
+	{
+		double Sum = 0;
+		for (const FTilePlacement& P : Data.BlockPlacements) Sum += P.TileObjectTransform.GetTranslation().X;
+		for (const FTilePlacement& P : Data.FloorPlacements) Sum += P.TileObjectTransform.GetTranslation().X;
+		for (const FEdgePlacement& P : Data.WallPlacements) Sum += P.TileObjectTransform.GetTranslation().X;
+		for (const FEdgePlacement& P : Data.EdgePlacements) Sum += P.TileObjectTransform.GetTranslation().X;
+		for (const FPointPlacement& P : Data.PillarPlacements) Sum += P.TileObjectTransform.GetTranslation().X;
+		for (const FPointPlacement& P : Data.PointPlacements) Sum += P.TileObjectTransform.GetTranslation().X;
+		return Sum;
+	};
+
+	bool Result = true;
+	double BinarySum = 0;
+	double StartMB = GetUsedMB();
+	double StartTime = FPlatformTime::Seconds();
+	double BinaryMB;
+	{
+		TArray<uint8> Bytes;
+		FTiledLevelGameData Loaded;
+		FVector LoadedTileSize;
+		FFileHelper::LoadFileToArray(Bytes, *BinaryFile);
+		Result &= TestTrue(TEXT("binary loaded"), Loaded.LoadFromBinary(Bytes, LoadedTileSize));
+		BinarySum = SumTranslations(Loaded);
+		BinaryMB = GetUsedMB() - StartMB;
+	}
+	const double BinaryMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	double SnapshotSum = 0;
+	StartMB = GetUsedMB();
+	StartTime = FPlatformTime::Seconds();
+	double SnapshotMB;
+	bool IsMapped;
+	{
+		FTiledLevelSnapshot Snapshot;
+		Result &= TestTrue(TEXT("snapshot opened"), Snapshot.Open(SnapshotFile));
+		IsMapped = Snapshot.IsMapped();
+		for (int32 Type = 0; Type < 6; Type++)
+			for (const FTiledSnapshotPlacement& Record : Snapshot.GetPlacements(static_cast<EPlacedType>(Type)))
+				SnapshotSum += Record.Translation[0];
+		SnapshotMB = GetUsedMB() - StartMB;
+	}
+	const double SnapshotMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+	AddInfo(FString::Printf(TEXT("%d placements: binary %lld bytes, load %.2f ms, %+.1f MB used; snapshot (%s) %lld bytes, open and read %.2f ms, %+.1f MB used (file backed pages when mapped)"),
+		NumPlacements, IFileManager::Get().FileSize(*BinaryFile), BinaryMs, BinaryMB, IsMapped? TEXT("mapped") : TEXT("not mapped, read whole"),
+		IFileManager::Get().FileSize(*SnapshotFile), SnapshotMs, SnapshotMB));
+	// summed in a different order
+	Result &= TestEqual(TEXT("same data from binary and snapshot"), SnapshotSum, BinarySum, FMath::Abs(BinarySum) * 1e-9 + 1e-3);
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	return Result;
+}
+
+#endif
@@ -0,0 +1,163 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelTestUtility.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledItemSet.h"
+#include "TiledLevel.h"
+#include "TiledLevelAsset.h"
+#include "TiledLevelItem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "UObject/Package.h"
+
+UTiledItemSet* FTiledLevelTestUtility::MakeItemSet(const FVector& TileSize)
+{
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	UTiledItemSet* ItemSet = NewObject<UTiledItemSet>(GetTransientPackage());
+	ItemSet->TileSizeX = TileSize.X;
+	ItemSet->TileSizeY = TileSize.Y;
+	ItemSet->TileSizeZ = TileSize.Z;
+	ItemSet->AddNewItem(Cube, EPlacedType::Block, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Block, ETLStructureType::Structure, FVector(2, 2, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Block, ETLStructureType::Prop, FVector(1, 2, 2));
+	ItemSet->AddNewItem(Cube, EPlacedType::Floor, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Floor, ETLStructureType::Structure, FVector(3, 2, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Wall, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Wall, ETLStructureType::Structure, FVector(2, 1, 2));
+	ItemSet->AddNewItem(Cube, EPlacedType::Edge, ETLStructureType::Prop, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Pillar, ETLStructureType::Structure, FVector(1, 1, 1));
+	ItemSet->AddNewItem(Cube, EPlacedType::Pillar, ETLStructureType::Structure, FVector(1, 1, 3));
+	ItemSet->AddNewItem(Cube, EPlacedType::Point, ETLStructureType::Prop, FVector(1, 1, 1));
+	return ItemSet;
+}
+
+TArray<UTiledLevelItem*> FTiledLevelTestUtility::FindItems(UTiledItemSet* ItemSet, EPlacedType PlacedType)
+{
+	return ItemSet->GetItemSet().FilterByPredicate([PlacedType](const UTiledLevelItem* Item) { return Item->PlacedType == PlacedType; });
+}
+
+UTiledLevelAsset* FTiledLevelTestUtility::MakeEmptyAsset(UTiledItemSet* ItemSet, int32 Size, int32 NumFloors)
+{
+	UTiledLevelAsset* Asset = NewObject<UTiledLevelAsset>(GetTransientPackage());
+	Asset->SetTileSize(ItemSet->GetTileSize());
+	Asset->ConfirmTileSize();
+	Asset->SetActiveItemSet(ItemSet);
+	Asset->X_Num = Size;
+	Asset->Y_Num = Size;
+	for (int32 Z = 0; Z < NumFloors; Z++)
+	{
+		if (!Asset->IsFloorExists(Z))
+			Asset->AddNewFloor(Z);
+	}
+	return Asset;
+}
+
+static FTransform MakeTestTransform(FRandomStream& Random, const FIntVector& Position)
+{
+	// random offset and yaw, so stacked placements at the same position still have different transforms
+	const FRotator Rotation(0, 90 * Random.RandRange(0, 3), 0);
+	return FTransform(Rotation, FVector(Position) * 100 + FVector(Random.FRandRange(0, 50), Random.FRandRange(0, 50), 0));
+}
+
+FTilePlacement FTiledLevelTestUtility::MakeTilePlacement(UTiledLevelItem* Item, FRandomStream& Random, int32 Size, int32 NumFloors)
+{
+	FTilePlacement P;
+	P.ItemSet = Cast<UTiledItemSet>(Item->GetOuter());
+	P.ItemID = Item->ItemID;
+	P.Extent = FIntVector(Item->Extent);
+	if (Random.FRand() < 0.5f)
+		Swap(P.Extent.X, P.Extent.Y); // rotated
+	P.GridPosition = FIntVector(Random.RandRange(0, Size - P.Extent.X), Random.RandRange(0, Size - P.Extent.Y), Random.RandRange(0, NumFloors - 1));
+	P.TileObjectTransform = MakeTestTransform(Random, P.GridPosition);
+	return P;
+}
+
+FEdgePlacement FTiledLevelTestUtility::MakeEdgePlacement(UTiledLevelItem* Item, FRandomStream& Random, int32 Size, int32 NumFloors)
+{
+	FEdgePlacement P;
+	P.ItemSet = Cast<UTiledItemSet>(Item->GetOuter());
+	P.ItemID = Item->ItemID;
+	const FIntVector Position(Random.RandRange(0, Size - 1), Random.RandRange(0, Size - 1), Random.RandRange(0, NumFloors - 1));
+	P.Edge = FTiledLevelEdge(Position, Random.FRand() < 0.5f? EEdgeType::Horizontal : EEdgeType::Vertical);
+	P.TileObjectTransform = MakeTestTransform(Random, Position);
+	return P;
+}
+
+FPointPlacement FTiledLevelTestUtility::MakePointPlacement(UTiledLevelItem* Item, FRandomStream& Random, int32 Size, int32 NumFloors)
+{
+	FPointPlacement P;
+	P.ItemSet = Cast<UTiledItemSet>(Item->GetOuter());
+	P.ItemID = Item->ItemID;
+	P.GridPosition = FIntVector(Random.RandRange(0, Size), Random.RandRange(0, Size), Random.RandRange(0, NumFloors - 1));
+	P.TileObjectTransform = MakeTestTransform(Random, P.GridPosition);
+	return P;
+}
+
+void FTiledLevelTestUtility::AddRandomPlacements(UTiledLevelAsset* Asset, FRandomStream& Random, int32 Num, float MirroredChance)
+{
+	const TArray<UTiledLevelItem*> Items = Asset->GetItemSet();
+	const int32 Size = Asset->X_Num;
+	const int32 NumFloors = Asset->TiledFloors.Num();
+	for (int32 n = 0; n < Num; n++)
+	{
+		UTiledLevelItem* Item = Items[Random.RandRange(0, Items.Num() - 1)];
+		const bool IsMirrored = Random.FRand() < MirroredChance;
+		switch (Item->PlacedType)
+		{
+		case EPlacedType::Block:
+		case EPlacedType::Floor:
+			{
+				FTilePlacement P = MakeTilePlacement(Item, Random, Size, NumFloors);
+				P.IsMirrored = IsMirrored;
+				Asset->AddNewTilePlacement(P);
+				break;
+			}
+		case EPlacedType::Wall:
+		case EPlacedType::Edge:
+			{
+				FEdgePlacement P = MakeEdgePlacement(Item, Random, Size, NumFloors);
+				P.IsMirrored = IsMirrored;
+				Asset->AddNewEdgePlacement(P);
+				break;
+			}
+		default:
+			{
+				FPointPlacement P = MakePointPlacement(Item, Random, Size, NumFloors);
+				P.IsMirrored = IsMirrored;
+				Asset->AddNewPointPlacement(P);
+				break;
+			}
+		}
+	}
+}
+
+FTiledLevelTestWorld::FTiledLevelTestWorld()
+{
+	GameInstance = NewObject<UGameInstance>(GEngine);
+	GameInstance->AddToRoot();
+	GameInstance->InitializeStandalone();
+	World = GameInstance->GetWorld();
+}
+
+FTiledLevelTestWorld::~FTiledLevelTestWorld()
+{
+	GameInstance->Shutdown();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	GameInstance->RemoveFromRoot();
+}
+
+ATiledLevel* FTiledLevelTestWorld::SpawnTiledLevel(UTiledLevelAsset* Asset) const
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.bNoFail = true;
+	ATiledLevel* Level = World->SpawnActor<ATiledLevel>(ATiledLevel::StaticClass(), FVector(0), FRotator(0), SpawnParams);
+	Level->SetActiveAsset(Asset);
+	return Level;
+}
+
+#endif
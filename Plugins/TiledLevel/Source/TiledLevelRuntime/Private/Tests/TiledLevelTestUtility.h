@@ -0,0 +1,58 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "TiledLevelTypes.h"
+
+// Transient item sets and assets for the automation tests
+struct FTiledLevelTestUtility
+{
+	// cube items of every placed type, some of them with larger extents
+	static class UTiledItemSet* MakeItemSet(const FVector& TileSize = FVector(100));
+	static TArray<class UTiledLevelItem*> FindItems(class UTiledItemSet* ItemSet, EPlacedType PlacedType);
+	// empty asset with floors 0 ~ NumFloors-1
+	static class UTiledLevelAsset* MakeEmptyAsset(class UTiledItemSet* ItemSet, int32 Size, int32 NumFloors);
+
+	// random placement of Item inside Size x Size x NumFloors, with a random transform so stacked ones differ
+	static FTilePlacement MakeTilePlacement(class UTiledLevelItem* Item, FRandomStream& Random, int32 Size, int32 NumFloors);
+	static FEdgePlacement MakeEdgePlacement(class UTiledLevelItem* Item, FRandomStream& Random, int32 Size, int32 NumFloors);
+	static FPointPlacement MakePointPlacement(class UTiledLevelItem* Item, FRandomStream& Random, int32 Size, int32 NumFloors);
+
+	// Num random placements of random items (from the asset's item set), some of them mirrored
+	static void AddRandomPlacements(class UTiledLevelAsset* Asset, FRandomStream& Random, int32 Num, float MirroredChance = 0.f);
+
+	// same elements (with duplicates) in any order
+	template <typename T>
+	static bool IsSamePlacements(const TArray<T>& A, TArray<T> B)
+	{
+		if (A.Num() != B.Num()) return false;
+		for (const T& P : A)
+		{
+			const int32 Found = B.IndexOfByKey(P);
+			if (Found == INDEX_NONE) return false;
+			B.RemoveAtSwap(Found);
+		}
+		return true;
+	}
+};
+
+// Standalone game instance (with its subsystems) and world, torn down when out of scope
+class FTiledLevelTestWorld
+{
+public:
+	FTiledLevelTestWorld();
+	~FTiledLevelTestWorld();
+
+	UWorld* GetWorld() const { return World; }
+	class UGameInstance* GetGameInstance() const { return GameInstance; }
+	class ATiledLevel* SpawnTiledLevel(class UTiledLevelAsset* Asset) const;
+
+private:
+	class UGameInstance* GameInstance = nullptr;
+	UWorld* World = nullptr;
+};
+
+#endif
@@ -23,7 +23,7 @@ void UTiledItemSet::AddNewItem(UStaticMesh* TiledMesh, const EPlacedType& Placed
 	NewItem->Extent = Extent;
 	NewItem->bAutoPlacement = DefaultAutoPlacement;
 	NewItem->PivotPosition = GetDefaultPivotPosition(PlacedType);
-	ItemSet.Add(NewItem);
+	RegisterNewItem(NewItem);
 }
 
 void UTiledItemSet::AddNewItem(UObject* NewActorObject, const EPlacedType& PlacedType, const ETLStructureType& StructureType,
@@ -38,7 +38,7 @@ void UTiledItemSet::AddNewItem(UObject* NewActorObject, const EPlacedType& Place
 	NewItem->Extent = Extent;
 	NewItem->bAutoPlacement = DefaultAutoPlacement;
 	NewItem->PivotPosition = GetDefaultPivotPosition(PlacedType);
-	ItemSet.Add(NewItem);
+	RegisterNewItem(NewItem);
 }
 
 void UTiledItemSet::AddSpecialItem_Restriction()
@@ -52,7 +52,7 @@ void UTiledItemSet::AddSpecialItem_Restriction()
 	NewItem->Extent = FVector(1);
 	NewItem->bAutoPlacement = false;
 	NewItem->PivotPosition = EPivotPosition::Center;
-	ItemSet.Add(NewItem);
+	RegisterNewItem(NewItem);
 }
 
 void UTiledItemSet::AddSpecialItem_Template()
@@ -65,7 +65,7 @@ void UTiledItemSet::AddSpecialItem_Template()
 	NewItem->Extent = FVector(1);
 	NewItem->bAutoPlacement = false;
 	NewItem->PivotPosition = EPivotPosition::Corner;
-	ItemSet.Add(NewItem);
+	RegisterNewItem(NewItem);
 }
 
 void UTiledItemSet::RemoveItem(UTiledLevelItem* ItemPtr)
@@ -77,16 +77,45 @@ void UTiledItemSet::RemoveItem(UTiledLevelItem* ItemPtr)
 		Asset->VersionNumber += 100;
 	}
 	ItemSet.Remove(ItemPtr);
+	RebuildItemMap();
 }
 
 UTiledLevelItem* UTiledItemSet::GetItem(const FGuid& ItemID) const
 {
+	if (ItemMapSourceNum != ItemSet.Num())
+		RebuildItemMap();
+	if (UTiledLevelItem* const* Found = ItemMap.Find(ItemID))
+	{
+		if (*Found && (*Found)->ItemID == ItemID)
+			return *Found;
+		// mapped item changed without going through this set (ex: undo/redo with same number of items)
+		RebuildItemMap();
+		Found = ItemMap.Find(ItemID);
+		return Found? *Found : nullptr;
+	}
+	return nullptr;
+}
+
+void UTiledItemSet::RegisterNewItem(UTiledLevelItem* NewItem)
+{
+	ItemSet.Add(NewItem);
+	if (ItemMapSourceNum == ItemSet.Num() - 1)
+	{
+		ItemMap.FindOrAdd(NewItem->ItemID, NewItem);
+		ItemMapSourceNum = ItemSet.Num();
+	}
+}
+
+void UTiledItemSet::RebuildItemMap() const
+{
+	ItemMap.Empty(ItemSet.Num());
 	for (UTiledLevelItem* I : ItemSet)
 	{
+		// keep the first one if ID is somehow duplicated, same as previous linear search
 		if (I)
-			if (I->ItemID == ItemID) return I;
+			ItemMap.FindOrAdd(I->ItemID, I);
 	}
-	return nullptr;
+	ItemMapSourceNum = ItemSet.Num();
 }
 
 TSet<UStaticMesh*> UTiledItemSet::GetAllItemMeshes() const
@@ -119,6 +148,18 @@ void UTiledItemSet::GetAssetRegistryTags(TArray<FAssetRegistryTag>& AssetRegistr
 	UObject::GetAssetRegistryTags(AssetRegistryTags);
 }
 
+void UTiledItemSet::PostLoad()
+{
+	Super::PostLoad();
+	RebuildItemMap();
+}
+
+void UTiledItemSet::PostDuplicate(bool bDuplicateForPIE)
+{
+	Super::PostDuplicate(bDuplicateForPIE);
+	RebuildItemMap();
+}
+
 #if WITH_EDITOR
 
 void UTiledItemSet::InitializeData()
@@ -154,6 +195,7 @@ void UTiledItemSet::InitializeData()
 
 void UTiledItemSet::PostEditUndo()
 {
+	RebuildItemMap();
 	ItemSetPostUndo.Broadcast();
 	UObject::PostEditUndo();
 }
@@ -6,8 +6,10 @@
 #include "TiledLevelAsset.h"
 #include "TiledLevelEditorLog.h"
 #include "TiledLevelItem.h"
+#include "TiledLevelSnapshot.h"
 #include "TiledLevelTypes.h"
 #include "TiledLevelUtility.h"
+#include "AI/NavigationSystemBase.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/StaticMesh.h"
@@ -15,7 +17,9 @@
 #include "ProceduralMeshComponent.h"
 #include "TiledLevelRestrictionHelper.h"
 #include "Net/UnrealNetwork.h"
+#include "HAL/IConsoleManager.h"
 #include "UObject/ObjectSaveContext.h"
+#include "EngineUtils.h"
 
 #define LOCTEXT_NAMESPACE "TiledLevel"
 
@@ -26,14 +30,16 @@ ATiledLevel::ATiledLevel()
 	SetRootComponent(Root);
 	Root->Mobility = EComponentMobility::Movable;
 	bReplicates = true;
+	ReplicatedPlacements.OwnerLevel = this;
 }
 
-// void ATiledLevel::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
-// {
-// 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-//
-// 	DOREPLIFETIME(ATiledLevel, GametimeData);
-// }
+void ATiledLevel::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// the whole GametimeData would be resent on every change, only placement deltas are replicated
+	DOREPLIFETIME(ATiledLevel, ReplicatedPlacements);
+}
 
 void ATiledLevel::OnConstruction(const FTransform& Transform)
 {
@@ -50,6 +56,12 @@ void ATiledLevel::BeginPlay()
 	
 }
 
+void ATiledLevel::PostLoad()
+{
+	Super::PostLoad();
+	bNeedsActorRegistryMigration = TiledActorRegistry.Num() == 0 && SpawnedTiledActors.Num() > 0;
+}
+
 #if WITH_EDITOR
 
 // void ATiledLevel::PostDuplicate(bool bDuplicateForPIE)
@@ -79,6 +91,14 @@ void ATiledLevel::PreSave(FObjectPreSaveContext ObjectSaveContext)
 	PreSaveTiledLevelActor.ExecuteIfBound();
 }
 
+void ATiledLevel::PostEditUndo()
+{
+	Super::PostEditUndo();
+	// HISMs are transactional, their instances may be restored in any order
+	InstanceLookups.Empty();
+	bTiledActorHandlesDirty = true;
+}
+
 #endif
 
 void ATiledLevel::Destroyed()
@@ -93,42 +113,101 @@ void ATiledLevel::Destroyed()
 void ATiledLevel::RemoveAsset()
 {
 	ActiveAsset = nullptr;
-	for (AActor* SpawnedActor : SpawnedTiledActors)
-	{
-		if (SpawnedActor)
-			SpawnedActor->Destroy();
-	}
-	SpawnedTiledActors.Empty();
+	ClearTiledActors();
+	TiledObjectPartitions.Empty();
+	HISMPartitions.Empty();
 	TiledObjectSpawner.Empty();
-    
+	InstanceLookups.Empty();
+	UpdatePartitionStats();
 }
 
 void ATiledLevel::ClearItemInstances(const UStaticMesh* MeshPtr)
 {
-	if (TiledObjectSpawner.Contains(MeshPtr))
+	for (auto& elem : TiledObjectPartitions)
 	{
-		// TiledObjectSpawner[MeshPtr]->ClearInstances();
-		int32 count = TiledObjectSpawner[MeshPtr]->GetInstanceCount();
+		if (elem.Key.Mesh != MeshPtr || !elem.Value) continue;
+		// elem.Value->ClearInstances();
+		int32 count = elem.Value->GetInstanceCount();
 		TArray<int32> AllIndices;
 		for (int i = 0; i <count; i++)
 			AllIndices.Add(i);
-		TiledObjectSpawner[MeshPtr]->RemoveInstances(AllIndices);
+		const FBox DirtyArea = GetInstancesBounds(elem.Value, AllIndices);
+		elem.Value->RemoveInstances(AllIndices);
+		MarkNavigationDirty(elem.Value, DirtyArea);
+		INC_DWORD_STAT_BY(STAT_TiledLevel_InstancesRemoved, count);
+		InstanceLookups.Remove(elem.Key);
 	}
+	UpdatePartitionStats();
 }
 
-void ATiledLevel::RemoveInstances(const TMap<UStaticMesh*, TArray<int32>>& TargetInstancesData)
+void ATiledLevel::RemoveInstances(const TMap<FTiledInstancePartition, TArray<int32>>& TargetInstancesData)
 {
-	TArray<UStaticMesh*> KeysToDelete;
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_RemoveInstances);
+	TArray<FTiledInstancePartition> KeysToDelete;
 	for (auto& elem : TargetInstancesData)
 	{
-		TiledObjectSpawner[elem.Key]->RemoveInstances(elem.Value);
-		if (TiledObjectSpawner[elem.Key]->GetInstanceCount() == 0)
+		UHierarchicalInstancedStaticMeshComponent** HISM = TiledObjectPartitions.Find(elem.Key);
+		if (!HISM || !*HISM) continue;
+		// sync the lookup first, it needs to know which keys are going to be swapped
+		RemoveFromInstanceLookup(elem.Key, elem.Value);
+		const FBox DirtyArea = GetInstancesBounds(*HISM, elem.Value);
+		(*HISM)->RemoveInstances(elem.Value);
+		MarkNavigationDirty(*HISM, DirtyArea);
+		INC_DWORD_STAT_BY(STAT_TiledLevel_InstancesRemoved, elem.Value.Num());
+		if ((*HISM)->GetInstanceCount() == 0)
 			KeysToDelete.Add(elem.Key);
+		else if (const FTiledInstanceLookup* Lookup = InstanceLookups.Find(elem.Key))
+		{
+			if (Lookup->IndexToKey.Num() != (*HISM)->GetInstanceCount())
+				InstanceLookups.Remove(elem.Key);
+		}
 	}
-	for (const UStaticMesh* MeshPtr : KeysToDelete)
+	for (const FTiledInstancePartition& Partition : KeysToDelete)
+	{
+		DestroyPartition(Partition);
+	}
+	UpdatePartitionStats();
+}
+
+void ATiledLevel::RemoveInstance(UHierarchicalInstancedStaticMeshComponent* HISM, int32 InstanceIndex)
+{
+	const FTiledInstancePartition* Partition = FindPartition(HISM);
+	if (!Partition) return;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
+	TargetInstanceData.Add(*Partition, {InstanceIndex});
+	RemoveInstances(TargetInstanceData);
+}
+
+void ATiledLevel::FindInstanceIndexByPlacement(TMap<FTiledInstancePartition, TArray<int32>>& FoundIndices, UStaticMesh* MeshPtr, const TArray<float>& SearchData)
+{
+	if (SearchData.Num() != 6) return;
+	const FTiledInstancePartition Partition = MakeInstancePartition(MeshPtr, SearchData);
+	UHierarchicalInstancedStaticMeshComponent** HISM = TiledObjectPartitions.Find(Partition);
+	if (!HISM || !*HISM) return;
+	const FTiledInstanceKey Key(SearchData.GetData());
+	const TArray<float>& CustomData = (*HISM)->PerInstanceSMCustomData;
+	TArray<int32>& FoundIndex = FoundIndices.FindOrAdd(Partition);
+
+	// at most 2 tries, the second one is after rebuilding a stale lookup
+	for (int Attempt = 0; Attempt < 2; Attempt++)
 	{
-		TiledObjectSpawner[MeshPtr]->DestroyComponent();
-		TiledObjectSpawner.Remove(MeshPtr);
+		TArray<int32, TInlineAllocator<4>> Candidates;
+		GetInstanceLookup(Partition).KeyToIndex.MultiFind(Key, Candidates);
+		bool IsStale = false;
+		for (int32 Index : Candidates)
+		{
+			if (!CustomData.IsValidIndex(Index * 6 + 5) || FTiledInstanceKey(&CustomData[Index * 6]) != Key)
+			{
+				IsStale = true;
+				break;
+			}
+			// stacked instances share the same key, don't take the same one twice
+			if (Candidates.Num() > 1 && FoundIndex.Contains(Index)) continue;
+			FoundIndex.Add(Index);
+			return;
+		}
+		if (!IsStale) return;
+		RebuildInstanceLookup(Partition);
 	}
 }
 
@@ -144,6 +223,7 @@ void ATiledLevel::DestroyTiledActorByPlacement(const FTilePlacement& Placement)
 				if (Arh->GetSourceItem() == RestrictionItem)
 				{
 					Arh->RemoveTargetedPositions(Placement.GridPosition);
+					MarkRestrictionIndexDirty();
 					if (Arh->TargetedTilePositions.Num() > 0)
 						return;
 					ActorToRemove = Arh;
@@ -154,22 +234,12 @@ void ATiledLevel::DestroyTiledActorByPlacement(const FTilePlacement& Placement)
 	}
 	else
 	{
-		FVector ActorTilePosition;
-		FVector ActorTileExtent;
-		for (AActor* SpawnedActor : SpawnedTiledActors)
-		{
-			const int NTags = SpawnedActor->Tags.Num();
-			ActorTilePosition.InitFromString(SpawnedActor->Tags[NTags - 3].ToString());
-			ActorTileExtent.InitFromString(SpawnedActor->Tags[NTags - 2].ToString());
-			if (FVector(Placement.GridPosition) == ActorTilePosition && FVector(Placement.Extent) == ActorTileExtent && SpawnedActor->Tags[NTags - 1] == FName(Placement.ItemID.ToString()))
-			{
-				ActorToRemove = SpawnedActor;
-				break;
-			}
-		}
+		DestroyTiledActorByHandle(FTiledActorHandle(Placement), Placement.TileObjectTransform);
+		return;
 	}
 	if (ActorToRemove)
 	{
+		UnregisterTiledActor(ActorToRemove);
 		ActorToRemove->Destroy();
 		SpawnedTiledActors.Remove(ActorToRemove);
 	}
@@ -177,90 +247,155 @@ void ATiledLevel::DestroyTiledActorByPlacement(const FTilePlacement& Placement)
 
 void ATiledLevel::DestroyTiledActorByPlacement( const FEdgePlacement& Placement)
 {
-	FVector ActorTilePosition;
-	FVector ActorEdgeExtraInfo;
-	AActor* ActorToRemove = nullptr;
-	for (AActor* SpawnedActor : SpawnedTiledActors)
+	DestroyTiledActorByHandle(FTiledActorHandle(Placement), Placement.TileObjectTransform);
+}
+
+void ATiledLevel::DestroyTiledActorByPlacement(const FPointPlacement& Placement)
+{
+	DestroyTiledActorByHandle(FTiledActorHandle(Placement), Placement.TileObjectTransform);
+}
+
+AActor* ATiledLevel::FindTiledActor(const FTiledActorHandle& Handle, const FTransform& Transform)
+{
+	if (bNeedsActorRegistryMigration)
+		MigrateTiledActorRegistry();
+	const FTiledRegisteredActors* Found = TiledActorRegistry.Find(Handle);
+	if (!Found) return nullptr;
+	if (Found->Entries.Num() == 1)
+		return Found->Entries[0].Actor;
+	for (const FTiledRegisteredActor& Entry : Found->Entries)
 	{
-		const int NTags = SpawnedActor->Tags.Num();
-		FVector EdgeExtraInfo = FVector(Placement.GetItem()->Extent.X, Placement.GetItem()->Extent.Z, Placement.Edge.EdgeType == EEdgeType::Horizontal? -1 : 0);
-		ActorTilePosition.InitFromString(SpawnedActor->Tags[NTags - 3].ToString());
-		ActorEdgeExtraInfo.InitFromString(SpawnedActor->Tags[NTags - 2].ToString());
-		if (Placement.GetEdgePosition() == ActorTilePosition && EdgeExtraInfo == ActorEdgeExtraInfo && SpawnedActor->Tags[NTags - 1] == FName(Placement.ItemID.ToString()))
+		if (Entry.Actor && Entry.Transform.Equals(Transform))
+			return Entry.Actor;
+	}
+	return nullptr;
+}
+
+const FTiledActorHandle* ATiledLevel::FindTiledActorHandle(const AActor* SpawnedActor)
+{
+	if (bNeedsActorRegistryMigration)
+		MigrateTiledActorRegistry();
+	if (bTiledActorHandlesDirty)
+	{
+		TiledActorHandles.Reset();
+		for (auto& elem : TiledActorRegistry)
 		{
-			ActorToRemove = SpawnedActor;
-			break;
+			for (const FTiledRegisteredActor& Entry : elem.Value.Entries)
+			{
+				if (Entry.Actor)
+					TiledActorHandles.Add(Entry.Actor, elem.Key);
+			}
 		}
+		bTiledActorHandlesDirty = false;
 	}
-	if (ActorToRemove)
+	return TiledActorHandles.Find(SpawnedActor);
+}
+
+void ATiledLevel::RegisterTiledActor(const FTiledActorHandle& Handle, const FTransform& Transform, AActor* SpawnedActor)
+{
+	if (!SpawnedActor) return;
+	// stacked placements add up, never replace each other
+	TiledActorRegistry.FindOrAdd(Handle).Entries.Add({SpawnedActor, Transform});
+	TiledActorHandles.Add(SpawnedActor, Handle);
+}
+
+void ATiledLevel::UnregisterTiledActor(const AActor* SpawnedActor)
+{
+	const FTiledActorHandle* Found = FindTiledActorHandle(SpawnedActor);
+	if (!Found) return;
+	const FTiledActorHandle Handle = *Found;
+	TiledActorHandles.Remove(SpawnedActor);
+	if (FTiledRegisteredActors* Registered = TiledActorRegistry.Find(Handle))
 	{
-		ActorToRemove->Destroy();
-		SpawnedTiledActors.Remove(ActorToRemove);
+		Registered->Entries.RemoveAll([SpawnedActor](const FTiledRegisteredActor& Entry) { return Entry.Actor == SpawnedActor; });
+		if (Registered->Entries.Num() == 0)
+			TiledActorRegistry.Remove(Handle);
 	}
 }
 
-void ATiledLevel::DestroyTiledActorByPlacement(const FPointPlacement& Placement)
+void ATiledLevel::DestroyTiledActorByHandle(const FTiledActorHandle& Handle, const FTransform& Transform)
 {
-	FVector ActorTilePosition;
-	FVector ActorTileExtent;
-	AActor* ActorToRemove = nullptr;
+	AActor* ActorToRemove = FindTiledActor(Handle, Transform);
+	if (!ActorToRemove) return;
+	UnregisterTiledActor(ActorToRemove);
+	ActorToRemove->Destroy();
+	SpawnedTiledActors.Remove(ActorToRemove);
+}
+
+void ATiledLevel::ClearTiledActors()
+{
+	for (AActor* SpawnedActor : SpawnedTiledActors)
+	{
+		if (SpawnedActor)
+			SpawnedActor->Destroy();
+	}
+	SpawnedTiledActors.Empty();
+	MarkRestrictionIndexDirty();
+	TiledActorRegistry.Empty();
+	TiledActorHandles.Empty();
+	bTiledActorHandlesDirty = false;
+	bNeedsActorRegistryMigration = false;
+}
+
+// parse the old tags once, then everything goes through the registry
+void ATiledLevel::MigrateTiledActorRegistry()
+{
+	bNeedsActorRegistryMigration = false;
+	UTiledItemSet* ItemSet = ActiveAsset? ActiveAsset->GetItemSetAsset() : nullptr;
+	if (!ItemSet) return;
 	for (AActor* SpawnedActor : SpawnedTiledActors)
 	{
+		if (!SpawnedActor || SpawnedActor->Tags.Num() < 3) continue;
 		const int NTags = SpawnedActor->Tags.Num();
-		ActorTilePosition.InitFromString(SpawnedActor->Tags[NTags - 3].ToString());
-		ActorTileExtent.InitFromString(SpawnedActor->Tags[NTags - 2].ToString());
-		if (FVector(Placement.GridPosition) == ActorTilePosition && SpawnedActor->Tags[NTags - 1] == FName(Placement.ItemID.ToString()))
+		FTiledActorHandle Handle;
+		if (!FGuid::Parse(SpawnedActor->Tags[NTags - 1].ToString(), Handle.ItemID)) continue;
+		UTiledLevelItem* Item = ItemSet->GetItem(Handle.ItemID);
+		if (!Item) continue;
+		FVector TagPosition;
+		FVector TagExtraInfo;
+		TagPosition.InitFromString(SpawnedActor->Tags[NTags - 3].ToString());
+		TagExtraInfo.InitFromString(SpawnedActor->Tags[NTags - 2].ToString());
+		Handle.Position = FIntVector(FMath::RoundToInt(TagPosition.X), FMath::RoundToInt(TagPosition.Y), FMath::RoundToInt(TagPosition.Z));
+		switch (FTiledLevelUtility::PlacedTypeToShape(Item->PlacedType))
 		{
-			ActorToRemove = SpawnedActor;
-			break;
+			case Shape3D:
+				Handle.ExtraInfo = FIntVector(FMath::RoundToInt(TagExtraInfo.X), FMath::RoundToInt(TagExtraInfo.Y), FMath::RoundToInt(TagExtraInfo.Z));
+				break;
+			case Shape2D:
+				// -1 for horizontal, 0 for vertical
+				Handle.ExtraInfo = FIntVector(0, 0, static_cast<int32>(TagExtraInfo.Z < -0.5f? EEdgeType::Horizontal : EEdgeType::Vertical));
+				break;
+			default:
+				break;
 		}
+		// the spawned actor sits at the placement transform
+		const FTransform Transform = SpawnedActor->GetRootComponent()? SpawnedActor->GetRootComponent()->GetRelativeTransform() : FTransform::Identity;
+		TiledActorRegistry.FindOrAdd(Handle).Entries.Add({SpawnedActor, Transform});
 	}
-	if (ActorToRemove)
-	{
-		ActorToRemove->Destroy();
-		SpawnedTiledActors.Remove(ActorToRemove);
-	}
+	bTiledActorHandlesDirty = true;
 }
 
 void ATiledLevel::EraseItem(FIntVector Pos, FIntVector Extent, bool bIsFloor, bool Both)
 {
-	FTilePlacement TestPlacement;
-	TestPlacement.GridPosition = Pos;
-	TestPlacement.Extent = Extent;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	TArray<FTilePlacement> TilesToDelete;
-	TArray<FTilePlacement> TargetPlacements;
-	if (Both)
-	{
-		TargetPlacements.Append(ActiveAsset->GetAllBlockPlacements());
-		TargetPlacements.Append(ActiveAsset->GetAllFloorPlacements());
-	} else
-	{
-		if (bIsFloor)
-			TargetPlacements = ActiveAsset->GetAllFloorPlacements();
-		else
-			TargetPlacements = ActiveAsset->GetAllBlockPlacements();
-	}
+	const EPlacedType TargetType = Both? EPlacedType::Any : bIsFloor? EPlacedType::Floor : EPlacedType::Block;
+	TArray<FTilePlacement> TargetPlacements = ActiveAsset->GetOccupancyIndex().FindOverlappingTiles(Pos, Extent, TargetType);
+	const TArray<UTiledLevelItem*> EraserActiveItems = GetEraserActiveItems();
 
 	for (FTilePlacement& Placement : TargetPlacements)
 	{
-		if (FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Placement) && GetEraserActiveItems().Contains(Placement.GetItem()))
+		if (EraserActiveItems.Contains(Placement.GetItem()))
 		{
 			TilesToDelete.Add(Placement);
-			// if that placement is in hidden floor, don't remove it's instance, just remove data only...
-			if (!ActiveAsset->GetFloorFromPosition(Placement.GridPosition.Z)->ShouldRenderInEditor)
-				continue;
 			if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			{
 				DestroyTiledActorByPlacement(Placement);
 			}
 			else
 			{
-				 UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-				 if (!TargetInstanceData.Contains(TiledMesh))				
-					  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
 				 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-				 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+				 FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			}
 		}
 	}
@@ -271,39 +406,24 @@ void ATiledLevel::EraseItem(FIntVector Pos, FIntVector Extent, bool bIsFloor, bo
 void ATiledLevel::EraseItem(FTiledLevelEdge Edge, FIntVector Extent, bool bIsEdge, bool Both)
 {
 	TArray<FEdgePlacement> EdgesToDelete;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
-	TArray<FEdgePlacement> TargetPlacements;
-	if (Both)
-	{
-		TargetPlacements.Append(ActiveAsset->GetAllWallPlacements());
-		TargetPlacements.Append(ActiveAsset->GetAllEdgePlacements());
-	} else
-	{
-		if (bIsEdge)
-			TargetPlacements = ActiveAsset->GetAllEdgePlacements();
-		else
-			TargetPlacements = ActiveAsset->GetAllWallPlacements();
-	}
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
+	const EPlacedType TargetType = Both? EPlacedType::Any : bIsEdge? EPlacedType::Edge : EPlacedType::Wall;
+	TArray<FEdgePlacement> TargetPlacements = ActiveAsset->GetOccupancyIndex().FindOverlappingEdges(Edge, Extent, TargetType);
+	const TArray<UTiledLevelItem*> EraserActiveItems = GetEraserActiveItems();
 
 	for (FEdgePlacement& Placement : TargetPlacements)
 	{
-		if (FTiledLevelUtility::IsEdgeOverlapping(Edge, FVector(Extent), Placement.Edge, Placement.GetItem()->Extent)
-			&& GetEraserActiveItems().Contains(Placement.GetItem()))
+		if (EraserActiveItems.Contains(Placement.GetItem()))
 		{
 			EdgesToDelete.Add(Placement);
-			// if that placement is in hidden floor, don't remove it's instance, just remove data only...
-			if (!ActiveAsset->GetFloorFromPosition(Placement.Edge.Z)->ShouldRenderInEditor)
-				continue;
 			UTiledLevelItem* Item = Placement.GetItem();
 			if (Item->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			{
 				DestroyTiledActorByPlacement(Placement);
 			} else
 			{
-				 if (!TargetInstanceData.Contains(Item->TiledMesh))				
-					  TargetInstanceData.Add(Item->TiledMesh, TArray<int32>{});
 				 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-				 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[Item->TiledMesh],TiledObjectSpawner[Item->TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+				 FindInstanceIndexByPlacement(TargetInstanceData, Item->TiledMesh, TargetInfo);
 			}
 		}
 	}
@@ -313,31 +433,16 @@ void ATiledLevel::EraseItem(FTiledLevelEdge Edge, FIntVector Extent, bool bIsEdg
 
 void ATiledLevel::EraseItem(FIntVector Pos, int ZExtent, bool bIsPoint, bool Both)
 {
-	FPointPlacement TestPlacement;
-	TestPlacement.GridPosition = Pos;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	TArray<FPointPlacement> PointsToDelete;
-	TArray<FPointPlacement> TargetPlacements;
-	if (Both)
-	{
-		TargetPlacements.Append(ActiveAsset->GetAllPillarPlacements());
-		TargetPlacements.Append(ActiveAsset->GetAllPointPlacements());
-	} else
-	{
-		if (bIsPoint)
-			TargetPlacements = ActiveAsset->GetAllPointPlacements();
-		else
-			TargetPlacements = ActiveAsset->GetAllPillarPlacements();
-	}
+	const EPlacedType TargetType = Both? EPlacedType::Any : bIsPoint? EPlacedType::Point : EPlacedType::Pillar;
+	TArray<FPointPlacement> TargetPlacements = ActiveAsset->GetOccupancyIndex().FindOverlappingPoints(Pos, ZExtent, TargetType);
+	const TArray<UTiledLevelItem*> EraserActiveItems = GetEraserActiveItems();
 
 	for (FPointPlacement& Placement : TargetPlacements)
 	{
-		if (FTiledLevelUtility::IsPointPlacementOverlapping(TestPlacement, ZExtent, Placement, Placement.GetItem()->Extent.Z) &&
-			GetEraserActiveItems().Contains(Placement.GetItem()))
+		if (EraserActiveItems.Contains(Placement.GetItem()))
 		{
-			// if that placement is in hidden floor, don't remove it's instance, just remove data only...
-			if (!ActiveAsset->GetFloorFromPosition(Placement.GridPosition.Z)->ShouldRenderInEditor)
-				continue;
 			PointsToDelete.Add(Placement);
 			if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			{
@@ -345,11 +450,8 @@ void ATiledLevel::EraseItem(FIntVector Pos, int ZExtent, bool bIsPoint, bool Bot
 			}
 			else
 			{
-				 UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-				 if (!TargetInstanceData.Contains(TiledMesh))				
-					  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
 				 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-				 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+				 FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			}
 		}
 	}
@@ -359,37 +461,27 @@ void ATiledLevel::EraseItem(FIntVector Pos, int ZExtent, bool bIsPoint, bool Bot
 
 void ATiledLevel::EraseItem_Any(FIntVector Pos, FIntVector Extent)
 {
-	FTilePlacement TestPlacement;
-	TestPlacement.GridPosition = Pos;
-	TestPlacement.Extent = Extent;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
+	const FTiledLevelOccupancyIndex& OccupancyIndex = ActiveAsset->GetOccupancyIndex();
 	TArray<FTilePlacement> TileToDelete;
-	TArray<FTilePlacement> TargetTilePlacements;
-	TargetTilePlacements.Append(ActiveAsset->GetAllBlockPlacements());
-	TargetTilePlacements.Append(ActiveAsset->GetAllFloorPlacements());
+	TArray<FTilePlacement> TargetTilePlacements = OccupancyIndex.FindOverlappingTiles(Pos, Extent);
 	TArray<FEdgePlacement> WallToDelete;
-	TArray<FEdgePlacement> TargetWallPlacements;
-	TargetWallPlacements.Append(ActiveAsset->GetAllWallPlacements());
-	TargetWallPlacements.Append(ActiveAsset->GetAllEdgePlacements());
+	TArray<FEdgePlacement> TargetWallPlacements = OccupancyIndex.FindEdgesInsideTile(Pos, Extent);
 	TArray<FPointPlacement> PointToDelete;
-	TArray<FPointPlacement>  TargetPointPlacements;
-	TargetPointPlacements.Append(ActiveAsset->GetAllPillarPlacements());
-	TargetPointPlacements.Append(ActiveAsset->GetAllPointPlacements());
+	TArray<FPointPlacement>  TargetPointPlacements = OccupancyIndex.FindPointsInsideTile(Pos, Extent);
+	const TArray<UTiledLevelItem*> EraserActiveItems = GetEraserActiveItems();
 	
 	for (FTilePlacement& Placement : TargetTilePlacements)
 	{
-		if (FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Placement) && GetEraserActiveItems().Contains(Placement.GetItem()))
+		if (EraserActiveItems.Contains(Placement.GetItem()))
 		{
 			if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			{
 				DestroyTiledActorByPlacement(Placement);
 			} else
 			{
-				 UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-				 if (!TargetInstanceData.Contains(TiledMesh))				
-					  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
 				 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-				 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+				 FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			}
 			TileToDelete.Add(Placement);
 		}
@@ -397,8 +489,7 @@ void ATiledLevel::EraseItem_Any(FIntVector Pos, FIntVector Extent)
 
 	for (FEdgePlacement& Placement : TargetWallPlacements)
 	{
-		if (FTiledLevelUtility::IsEdgeInsideTile(Placement.Edge, FIntVector(Placement.GetItem()->Extent), Pos, Extent)
-			&& GetEraserActiveItems().Contains(Placement.GetItem()))
+		if (EraserActiveItems.Contains(Placement.GetItem()))
 		{
 			UTiledLevelItem* Item = Placement.GetItem();
 			if (Item->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
@@ -406,10 +497,8 @@ void ATiledLevel::EraseItem_Any(FIntVector Pos, FIntVector Extent)
 				DestroyTiledActorByPlacement(Placement);
 			} else
 			{
-				  if (!TargetInstanceData.Contains(Item->TiledMesh))				
-					  TargetInstanceData.Add(Item->TiledMesh, TArray<int32>{});
 				  TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-				  FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[Item->TiledMesh],TiledObjectSpawner[Item->TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+				  FindInstanceIndexByPlacement(TargetInstanceData, Item->TiledMesh, TargetInfo);
 			}
 			WallToDelete.Add(Placement);
 		}
@@ -417,19 +506,15 @@ void ATiledLevel::EraseItem_Any(FIntVector Pos, FIntVector Extent)
 	
 	for (FPointPlacement& Placement : TargetPointPlacements)
 	{
-		if (FTiledLevelUtility::IsPointInsideTile(Placement.GridPosition, Placement.GetItem()->Extent.Z, Pos, Extent) &&
-			GetEraserActiveItems().Contains(Placement.GetItem()))
+		if (EraserActiveItems.Contains(Placement.GetItem()))
 		{
 			if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			{
 				DestroyTiledActorByPlacement(Placement);
 			} else
 			{
-				 UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-				 if (!TargetInstanceData.Contains(TiledMesh))				
-					  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
 				 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-				 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+				 FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			}
 			PointToDelete.Add(Placement);
 		}
@@ -446,7 +531,7 @@ void ATiledLevel::EraseSingleItem(FIntVector Pos, FIntVector Extent, FGuid Targe
 	FTilePlacement TestPlacement;
 	TestPlacement.GridPosition = Pos;
 	TestPlacement.Extent = Extent;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	TArray<int32> ActorIndicesToRemove;
 	TArray<FTilePlacement> TilesToDelete;
 	UTiledLevelItem* Item = GetAsset()->GetItemSetAsset()->GetItem(TargetID);
@@ -469,10 +554,8 @@ void ATiledLevel::EraseSingleItem(FIntVector Pos, FIntVector Extent, FGuid Targe
 				} else
 				{
 					 // find placement instance ID, and its mesh
-					 if (!TargetInstanceData.Contains(Item->TiledMesh))				
-						  TargetInstanceData.Add(Item->TiledMesh, TArray<int32>{});
 					 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-					 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[Item->TiledMesh],TiledObjectSpawner[Item->TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+					 FindInstanceIndexByPlacement(TargetInstanceData, Item->TiledMesh, TargetInfo);
 				}
 				TilesToDelete.Add(Placement);
 			}
@@ -486,7 +569,7 @@ void ATiledLevel::EraseSingleItem(FIntVector Pos, FIntVector Extent, FGuid Targe
 void ATiledLevel::EraseSingleItem(FTiledLevelEdge Edge, FIntVector Extent, FGuid TargetID)
 {
 	TArray<FEdgePlacement> WallsToDelete;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	UTiledLevelItem* Item = ActiveAsset->GetItemSetAsset()->GetItem(TargetID);
 	for (int L = Edge.Z ; L < Edge.Z + Extent.Z; L ++)
 	{
@@ -507,10 +590,8 @@ void ATiledLevel::EraseSingleItem(FTiledLevelEdge Edge, FIntVector Extent, FGuid
 					DestroyTiledActorByPlacement(Placement);
 				} else
 				{
-					 if (!TargetInstanceData.Contains(Item->TiledMesh))				
-						  TargetInstanceData.Add(Item->TiledMesh, TArray<int32>{});
 					 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-					 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[Item->TiledMesh],TiledObjectSpawner[Item->TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+					 FindInstanceIndexByPlacement(TargetInstanceData, Item->TiledMesh, TargetInfo);
 				}
 				WallsToDelete.Add(Placement);
 			}
@@ -526,7 +607,7 @@ void ATiledLevel::EraseSingleItem(FIntVector Pos, int ZExtent, FGuid TargetID)
 {
 	FPointPlacement TestPlacement;
 	TestPlacement.GridPosition = Pos;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	TArray<int32> ActorIndicesToRemove;
 	TArray<FPointPlacement> PointsToDelete;
 	UTiledLevelItem* Item = GetAsset()->GetItemSetAsset()->GetItem(TargetID);
@@ -550,10 +631,8 @@ void ATiledLevel::EraseSingleItem(FIntVector Pos, int ZExtent, FGuid TargetID)
 				} else
 				{
 					 // find placement instance ID, and its mesh
-					 if (!TargetInstanceData.Contains(Item->TiledMesh))				
-						  TargetInstanceData.Add(Item->TiledMesh, TArray<int32>{});
 					 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-					 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[Item->TiledMesh],TiledObjectSpawner[Item->TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+					 FindInstanceIndexByPlacement(TargetInstanceData, Item->TiledMesh, TargetInfo);
 				}
 				PointsToDelete.Add(Placement);
 			}
@@ -564,6 +643,42 @@ void ATiledLevel::EraseSingleItem(FIntVector Pos, int ZExtent, FGuid TargetID)
 		RemoveInstances(TargetInstanceData);
 }
 
+// what ResetAllInstance should end up with
+struct FTiledResetTargets
+{
+	// partition -> (custom data key -> transforms), the same key can be stacked
+	TMap<FTiledInstancePartition, TMap<FTiledInstanceKey, TArray<FTransform, TInlineAllocator<1>>>> Instances;
+	TMap<UStaticMesh*, TArray<UMaterialInterface*>> Materials;
+	TArray<const FTilePlacement*> TileActors;
+	TArray<const FEdgePlacement*> EdgeActors;
+	TArray<const FPointPlacement*> PointActors;
+};
+
+template <typename T>
+static void CollectResetTargets(const TArray<T>& Placements, int32 ChunkSize, FTiledResetTargets& Targets, TArray<const T*>& OutActorPlacements)
+{
+	for (const T& Placement : Placements)
+	{
+		UTiledLevelItem* Item = Placement.GetItem();
+		if (Item->SourceType == ETLSourceType::Actor)
+		{
+			if (IsValid(Item->TiledActor))
+				OutActorPlacements.Add(&Placement);
+		}
+		else if (Placement.IsMirrored)
+		{
+			OutActorPlacements.Add(&Placement);
+		}
+		else if (Item->TiledMesh)
+		{
+			const TArray<float> InstanceData = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
+			const FTiledInstancePartition Partition(Item->TiledMesh, InstanceData.GetData(), ChunkSize);
+			Targets.Instances.FindOrAdd(Partition).FindOrAdd(FTiledInstanceKey(InstanceData.GetData())).Add(Placement.TileObjectTransform);
+			Targets.Materials.Add(Item->TiledMesh, Item->OverrideMaterials);
+		}
+	}
+}
+
 void ATiledLevel::ResetAllInstance(bool IgnoreVersion)
 {
 	if (!ActiveAsset) return;
@@ -571,65 +686,180 @@ void ATiledLevel::ResetAllInstance(bool IgnoreVersion)
 	{
 		if (ActiveAsset->VersionNumber <= VersionNumber) return;
 	}
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_ResetAllInstance);
 	
 	VersionNumber = ActiveAsset->VersionNumber;
+	ActiveAsset->ClearInvalidPlacements();
+	INC_DWORD_STAT_BY(STAT_TiledLevel_PlacementsPopulated, ActiveAsset->GetNumOfAllPlacements());
+
+	// only apply the difference between current instances and the asset, a full rebuild hitches on big levels
+	// hidden floors are instanced as well, their partitions are just invisible
+	// a changed chunk size just shows up as different partitions, old ones are destroyed while applying
+	const int32 ChunkSize = GetInstanceChunkSize();
+	FTiledResetTargets Targets;
+	for (FTiledFloor& F : ActiveAsset->TiledFloors)
+	{
+		CollectResetTargets(F.BlockPlacements, ChunkSize, Targets, Targets.TileActors);
+		CollectResetTargets(F.FloorPlacements, ChunkSize, Targets, Targets.TileActors);
+		CollectResetTargets(F.PillarPlacements, ChunkSize, Targets, Targets.PointActors);
+		CollectResetTargets(F.WallPlacements, ChunkSize, Targets, Targets.EdgeActors);
+		CollectResetTargets(F.EdgePlacements, ChunkSize, Targets, Targets.EdgeActors);
+		CollectResetTargets(F.PointPlacements, ChunkSize, Targets, Targets.PointActors);
+	}
+	ApplyResetTargets(Targets);
+	UpdateFloorVisibility();
+	UpdatePartitionStats();
+}
+
+void ATiledLevel::ApplyResetTargets(const FTiledResetTargets& Targets)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_ApplyResetTargets);
+	// actors: keep the ones still up to date, restriction helpers are shared by placements so just respawn them
+	if (bNeedsActorRegistryMigration)
+		MigrateTiledActorRegistry();
+	TSet<AActor*> KeptActors;
+	auto GetActorsToSpawn = [this, &KeptActors](const auto& ActorPlacements)
+	{
+		auto ToSpawn = ActorPlacements;
+		ToSpawn.RemoveAll([this, &KeptActors](const auto* P)
+		{
+			if (P->GetItem()->IsA(UTiledLevelRestrictionItem::StaticClass())) return false;
+			const FTiledRegisteredActors* Registered = TiledActorRegistry.Find(FTiledActorHandle(*P));
+			if (!Registered) return false;
+			// any of the stacked ones not taken yet
+			for (const FTiledRegisteredActor& Entry : Registered->Entries)
+			{
+				if (Entry.Actor && !KeptActors.Contains(Entry.Actor) && IsTiledActorUpToDate(Entry.Actor, *P))
+				{
+					KeptActors.Add(Entry.Actor);
+					return true;
+				}
+			}
+			return false;
+		});
+		return ToSpawn;
+	};
+	const TArray<const FTilePlacement*> TilesToSpawn = GetActorsToSpawn(Targets.TileActors);
+	const TArray<const FEdgePlacement*> EdgesToSpawn = GetActorsToSpawn(Targets.EdgeActors);
+	const TArray<const FPointPlacement*> PointsToSpawn = GetActorsToSpawn(Targets.PointActors);
 	for (AActor* SpawnedActor : SpawnedTiledActors)
 	{
-		if (SpawnedActor)
+		if (SpawnedActor && !KeptActors.Contains(SpawnedActor))
 			SpawnedActor->Destroy();
 	}
-	SpawnedTiledActors.Empty();
-	for (auto& elem : TiledObjectSpawner)
+	SpawnedTiledActors = KeptActors.Array();
+	for (auto It = TiledActorRegistry.CreateIterator(); It; ++It)
 	{
-		if (elem.Value)
+		It.Value().Entries.RemoveAll([&KeptActors](const FTiledRegisteredActor& Entry) { return !KeptActors.Contains(Entry.Actor); });
+		if (It.Value().Entries.Num() == 0)
+			It.RemoveCurrent();
+	}
+	bTiledActorHandlesDirty = true;
+
+	// partitions no longer used
+	ClearLegacySpawner();
+	TArray<FTiledInstancePartition> UnusedPartitions;
+	for (auto& elem : TiledObjectPartitions)
+	{
+		if (!elem.Value || !Targets.Instances.Contains(elem.Key))
+			UnusedPartitions.Add(elem.Key);
+	}
+	for (const FTiledInstancePartition& Partition : UnusedPartitions)
+	{
+		DestroyPartition(Partition);
+	}
+
+	for (auto& elem : Targets.Instances)
+	{
+		const FTiledInstancePartition& Partition = elem.Key;
+		auto Remaining = elem.Value;
+		UHierarchicalInstancedStaticMeshComponent* HISM = CreateNewHISM(Partition, Targets.Materials[Partition.Mesh]);
+
+		// match existing instances by key, prefer the one with the same transform
+		TArray<int32> InstancesToRemove;
+		bool IsTransformChanged = false;
+		const FTiledInstanceLookup& Lookup = GetInstanceLookup(Partition);
+		for (int32 i = 0; i < Lookup.IndexToKey.Num(); i++)
 		{
-			TArray<int> AllIndices;
-			for (int i=0;i<elem.Value->GetInstanceCount();i++)
+			auto* Transforms = Remaining.Find(Lookup.IndexToKey[i]);
+			if (!Transforms || Transforms->Num() == 0)
 			{
-				AllIndices.Add(i);
+				InstancesToRemove.Add(i);
+				continue;
+			}
+			FTransform CurrentTransform;
+			HISM->GetInstanceTransform(i, CurrentTransform, false);
+			const int32 Found = Transforms->IndexOfByPredicate([&CurrentTransform](const FTransform& T)
+			{
+				return T.Equals(CurrentTransform);
+			});
+			if (Found == INDEX_NONE)
+			{
+				HISM->UpdateInstanceTransform(i, Transforms->Last(), false, false, true);
+				Transforms->Pop(false);
+				IsTransformChanged = true;
+			}
+			else
+			{
+				Transforms->RemoveAtSwap(Found, 1, false);
 			}
-			elem.Value->RemoveInstances(AllIndices);
 		}
-	}
 
-	// TODO: don't empty spawner... Just ignore it will be fine?
-	// TiledObjectSpawner.Empty();
-	
-	ActiveAsset->ClearInvalidPlacements();
-	
-	for (FTiledFloor& F : ActiveAsset->TiledFloors)
-	{
-		if (!F.ShouldRenderInEditor) continue;
-		for (FTilePlacement& Placement : F.BlockPlacements)
-			PopulateSinglePlacement(Placement);
-		for (FTilePlacement& Placement : F.FloorPlacements)
-			PopulateSinglePlacement(Placement);
-		for (FPointPlacement& Placement : F.PillarPlacements)
-			PopulateSinglePlacement(Placement);
-		for (FEdgePlacement& Placement : F.WallPlacements)
-			PopulateSinglePlacement(Placement);
-		for (FEdgePlacement& Placement : F.EdgePlacements)
-			PopulateSinglePlacement(Placement);
-		for (FPointPlacement& Placement : F.PointPlacements)
-			PopulateSinglePlacement(Placement);
+		// add before remove, so this HISM won't be emptied and destroyed in between
+		FTiledInstanceBatch Batch;
+		for (auto& Entry : Remaining)
+		{
+			for (const FTransform& T : Entry.Value)
+			{
+				Batch.Transforms.Add(T);
+				Batch.CustomData.Append(Entry.Key.Data, 6);
+			}
+		}
+		AddInstanceBatch(Partition, HISM, Batch);
+		if (InstancesToRemove.Num() > 0)
+		{
+			RemoveFromInstanceLookup(Partition, InstancesToRemove);
+			const FBox DirtyArea = GetInstancesBounds(HISM, InstancesToRemove);
+			HISM->RemoveInstances(InstancesToRemove);
+			MarkNavigationDirty(HISM, DirtyArea);
+			INC_DWORD_STAT_BY(STAT_TiledLevel_InstancesRemoved, InstancesToRemove.Num());
+		}
+		if (IsTransformChanged)
+			HISM->MarkRenderStateDirty();
 	}
 
+	for (const FTilePlacement* P : TilesToSpawn)
+		PopulateSinglePlacement(*P);
+	for (const FEdgePlacement* P : EdgesToSpawn)
+		PopulateSinglePlacement(*P);
+	for (const FPointPlacement* P : PointsToSpawn)
+		PopulateSinglePlacement(*P);
+
 	for (AActor* Actor : SpawnedTiledActors)
 	{
 		Actor->AttachToActor(this, FAttachmentTransformRules::KeepRelativeTransform);
 	}
-	
 }
 
-void ATiledLevel::ResetAllInstanceFromData()
+bool ATiledLevel::IsTiledActorUpToDate(const AActor* SpawnedActor, const FItemPlacement& Placement) const
 {
-	for (AActor* SpawnedActor : SpawnedTiledActors)
+	if (!IsValid(SpawnedActor) || !SpawnedActor->GetRootComponent()) return false;
+	if (!SpawnedActor->GetRootComponent()->GetRelativeTransform().Equals(Placement.TileObjectTransform)) return false;
+	UTiledLevelItem* Item = Placement.GetItem();
+	if (Item->SourceType == ETLSourceType::Actor)
 	{
-		if (SpawnedActor)
-			SpawnedActor->Destroy();
+		const UBlueprint* BP = Cast<UBlueprint>(Item->TiledActor);
+		return BP && SpawnedActor->GetClass() == BP->GeneratedClass;
 	}
-	SpawnedTiledActors.Empty();
-	for (auto& elem : TiledObjectSpawner)
+	const AStaticMeshActor* Mirrored = Cast<AStaticMeshActor>(SpawnedActor);
+	return Mirrored && Mirrored->GetStaticMeshComponent()->GetStaticMesh() == Item->TiledMesh;
+}
+
+void ATiledLevel::ClearAllInstances()
+{
+	ClearTiledActors();
+	ClearLegacySpawner();
+	for (auto& elem : TiledObjectPartitions)
 	{
 		if (elem.Value)
 		{
@@ -638,47 +868,149 @@ void ATiledLevel::ResetAllInstanceFromData()
 			{
 				AllIndices.Add(i);
 			}
+			const FBox DirtyArea = GetInstancesBounds(elem.Value, AllIndices);
 			elem.Value->RemoveInstances(AllIndices);
+			MarkNavigationDirty(elem.Value, DirtyArea);
+			INC_DWORD_STAT_BY(STAT_TiledLevel_InstancesRemoved, AllIndices.Num());
 		}
 	}
+	InstanceLookups.Empty();
+}
+
+void ATiledLevel::ResetAllInstanceFromData()
+{
+	ClearAllInstances();
 
 	// TiledObjectSpawner.Empty();
-	
-	for (FTilePlacement& Placement : GametimeData.BlockPlacements)
+
+	// hidden floors are instanced as well, their partitions are just invisible
+	HiddenFloors = TSet<int32>(GametimeData.HiddenFloors);
+	PopulatePlacements(GametimeData.BlockPlacements);
+	PopulatePlacements(GametimeData.FloorPlacements);
+	PopulatePlacements(GametimeData.PillarPlacements);
+	PopulatePlacements(GametimeData.WallPlacements);
+	PopulatePlacements(GametimeData.EdgePlacements);
+	PopulatePlacements(GametimeData.PointPlacements);
+
+	for (AActor* Actor : SpawnedTiledActors)
 	{
-		if (GametimeData.HiddenFloors.Contains(Placement.GridPosition.Z)) continue;
-	    PopulateSinglePlacement(Placement);
+		Actor->AttachToActor(this, FAttachmentTransformRules::KeepRelativeTransform);
 	}
-	for (FTilePlacement& Placement : GametimeData.FloorPlacements)
+	SetHiddenFloors(HiddenFloors);
+}
+
+FTiledPopulateStats ATiledLevel::ResetAllInstanceFromSnapshot(const FTiledLevelSnapshot& Snapshot)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_PopulatePlacements);
+	ClearAllInstances();
+
+	HiddenFloors.Empty();
+	for (int32 Floor : Snapshot.GetHiddenFloors())
+		HiddenFloors.Add(Floor);
+	// one record at a time into a temp placement, there is never a decoded copy of the whole data
+	TMap<FTiledInstancePartition, FTiledInstanceBatch> Batches;
+	int32 NumActors = 0;
+	for (EPlacedType PlacedType : {EPlacedType::Block, EPlacedType::Floor, EPlacedType::Pillar, EPlacedType::Wall, EPlacedType::Edge, EPlacedType::Point})
 	{
-		if (GametimeData.HiddenFloors.Contains(Placement.GridPosition.Z)) continue;
-		PopulateSinglePlacement(Placement);
+		const EPlacedShapeType Shape = FTiledLevelUtility::PlacedTypeToShape(PlacedType);
+		for (const FTiledSnapshotPlacement& Record : Snapshot.GetPlacements(PlacedType))
+		{
+			if (Shape == Shape3D)
+				AddToPopulateBatch(Snapshot.MakeTilePlacement(Record), Batches, NumActors);
+			else if (Shape == Shape2D)
+				AddToPopulateBatch(Snapshot.MakeEdgePlacement(Record), Batches, NumActors);
+			else
+				AddToPopulateBatch(Snapshot.MakePointPlacement(Record), Batches, NumActors);
+		}
 	}
-	for (FPointPlacement& Placement : GametimeData.PillarPlacements)
+	FTiledPopulateStats Stats = SubmitInstanceBatches(Batches);
+	Stats.NumActors = NumActors;
+
+	for (AActor* Actor : SpawnedTiledActors)
 	{
-		if (GametimeData.HiddenFloors.Contains(Placement.GridPosition.Z)) continue;
-		PopulateSinglePlacement(Placement);
+		Actor->AttachToActor(this, FAttachmentTransformRules::KeepRelativeTransform);
 	}
-	for (FEdgePlacement& Placement : GametimeData.WallPlacements)
+	SetHiddenFloors(HiddenFloors);
+	return Stats;
+}
+
+template <typename T>
+static void DestroyChunkActors(ATiledLevel* Level, const TArray<T>& Placements)
+{
+	for (const T& P : Placements)
 	{
-		if (GametimeData.HiddenFloors.Contains(Placement.GetEdgePosition().Z)) continue;
-		PopulateSinglePlacement(Placement);
+		if (P.GetItem() && (P.GetItem()->SourceType == ETLSourceType::Actor || P.IsMirrored))
+			Level->DestroyTiledActorByPlacement(P);
 	}
-	for (FEdgePlacement& Placement : GametimeData.EdgePlacements)
+}
+
+void ATiledLevel::UnloadInstanceChunk(const FIntPoint& Chunk, const FTiledLevelGameData& ChunkData)
+{
+	TArray<FTiledInstancePartition> ChunkPartitions;
+	for (auto& elem : TiledObjectPartitions)
 	{
-		if (GametimeData.HiddenFloors.Contains(Placement.GetEdgePosition().Z)) continue;
-		PopulateSinglePlacement(Placement);
+		if (elem.Key.Chunk == Chunk)
+			ChunkPartitions.Add(elem.Key);
 	}
-	for (FPointPlacement& Placement : GametimeData.PointPlacements)
+	for (const FTiledInstancePartition& Partition : ChunkPartitions)
+		DestroyPartition(Partition);
+	DestroyChunkActors(this, ChunkData.BlockPlacements);
+	DestroyChunkActors(this, ChunkData.FloorPlacements);
+	DestroyChunkActors(this, ChunkData.WallPlacements);
+	DestroyChunkActors(this, ChunkData.EdgePlacements);
+	DestroyChunkActors(this, ChunkData.PillarPlacements);
+	DestroyChunkActors(this, ChunkData.PointPlacements);
+	UpdatePartitionStats();
+}
+
+void ATiledLevel::SetHiddenFloors(const TSet<int32>& NewHiddenFloors)
+{
+	HiddenFloors = NewHiddenFloors;
+	for (auto& elem : TiledObjectPartitions)
 	{
-		if (GametimeData.HiddenFloors.Contains(Placement.GridPosition.Z)) continue;
-		PopulateSinglePlacement(Placement);
+		if (elem.Value)
+			ApplyFloorVisibility(elem.Value, IsFloorHidden(elem.Key.Floor));
+	}
+	for (AActor* SpawnedActor : SpawnedTiledActors)
+	{
+		if (const FTiledActorHandle* Handle = FindTiledActorHandle(SpawnedActor))
+			ApplyFloorVisibility(SpawnedActor, *Handle);
 	}
+}
 
-	for (AActor* Actor : SpawnedTiledActors)
+int32 ATiledLevel::GetInstanceChunkSize() const
+{
+	return ActiveAsset? ActiveAsset->InstanceChunkSize : InstanceChunkSize;
+}
+
+void ATiledLevel::UpdateFloorVisibility()
+{
+	if (!ActiveAsset) return;
+	TSet<int32> NewHiddenFloors;
+	for (const FTiledFloor& F : ActiveAsset->TiledFloors)
 	{
-		Actor->AttachToActor(this, FAttachmentTransformRules::KeepRelativeTransform);
+		if (!F.ShouldRenderInEditor)
+			NewHiddenFloors.Add(F.FloorPosition);
 	}
+	SetHiddenFloors(NewHiddenFloors);
+}
+
+void ATiledLevel::ApplyFloorVisibility(UHierarchicalInstancedStaticMeshComponent* HISM, bool bHidden) const
+{
+	HISM->SetVisibility(!bHidden);
+	HISM->SetCollisionEnabled(bHidden? ECollisionEnabled::NoCollision : ECollisionEnabled::QueryAndPhysics);
+}
+
+void ATiledLevel::ApplyFloorVisibility(AActor* SpawnedActor, const FTiledActorHandle& Handle) const
+{
+	// restriction helper is shared by positions on different floors, leave it alone
+	if (!SpawnedActor || SpawnedActor->IsA(ATiledLevelRestrictionHelper::StaticClass())) return;
+	const bool bHidden = IsFloorHidden(Handle.Position.Z);
+	SpawnedActor->SetActorHiddenInGame(bHidden);
+	SpawnedActor->SetActorEnableCollision(!bHidden);
+#if WITH_EDITOR
+	SpawnedActor->SetIsTemporarilyHiddenInEditor(bHidden);
+#endif
 }
 
 void ATiledLevel::MakeEditable()
@@ -701,9 +1033,11 @@ void ATiledLevel::Break()
 	// TODO: rotation in pitch and roll will affect the break result...   the X/Y scale is swapped
 	// This issue still exists in auto sized items.... after I hard code a solution...
 	
-	for ( auto It = TiledObjectSpawner.CreateIterator(); It; ++It)
+	for ( auto It = TiledObjectPartitions.CreateIterator(); It; ++It)
 	{
-		UStaticMesh* MeshPtr = It.Key();
+		// hidden floors are not broken out, same as before they were instanced
+		if (IsFloorHidden(It.Key().Floor) || !It.Value()) continue;
+		UStaticMesh* MeshPtr = It.Key().Mesh;
 		UHierarchicalInstancedStaticMeshComponent* HISM = It.Value();
 		int N = HISM->GetInstanceCount();
 		for (int i = 0; i < N; i++)
@@ -732,6 +1066,7 @@ void ATiledLevel::Break()
 
 	for (AActor* SpawnedActor : SpawnedTiledActors)
 	{
+		if (SpawnedActor->IsHidden()) continue;
 		const int NTags = SpawnedActor->Tags.Num();
 		FVector TilePosition;
 		TilePosition.InitFromString(SpawnedActor->Tags[NTags-3].ToString());
@@ -811,12 +1146,13 @@ TArray<UTiledLevelItem*> ATiledLevel::GetEraserActiveItems() const
      return Out;
 }
 
-void ATiledLevel::CreateNewHISM(UStaticMesh* MeshPtr, const TArray<class UMaterialInterface*>& OverrideMaterials)
+UHierarchicalInstancedStaticMeshComponent* ATiledLevel::CreateNewHISM(const FTiledInstancePartition& Partition, const TArray<class UMaterialInterface*>& OverrideMaterials)
 {
-	if (!TiledObjectSpawner.Find(MeshPtr))
+	UHierarchicalInstancedStaticMeshComponent* HISM = TiledObjectPartitions.FindRef(Partition);
+	if (!HISM)
 	{
 		UHierarchicalInstancedStaticMeshComponent* NewHISM = NewObject<UHierarchicalInstancedStaticMeshComponent>(this, NAME_None, RF_Transactional);
-		NewHISM->SetStaticMesh(MeshPtr);
+		NewHISM->SetStaticMesh(Partition.Mesh);
 		NewHISM->AttachToComponent(Root, FAttachmentTransformRules::KeepRelativeTransform);
 		NewHISM->SetMobility(EComponentMobility::Movable);
 		NewHISM->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
@@ -824,7 +1160,11 @@ void ATiledLevel::CreateNewHISM(UStaticMesh* MeshPtr, const TArray<class UMateri
 		// 6 custom data for pos and extent (floor), pos, length, height, is horizontal (edge)		
 		NewHISM->NumCustomDataFloats = 6;
 		NewHISM->RegisterComponentWithWorld(GetWorld());
-		TiledObjectSpawner.Add(MeshPtr, NewHISM);
+		if (IsFloorHidden(Partition.Floor))
+			ApplyFloorVisibility(NewHISM, true);
+		TiledObjectPartitions.Add(Partition, NewHISM);
+		HISMPartitions.Add(NewHISM, Partition);
+		HISM = NewHISM;
 		// TODO: road to replication
 		// if (!NewHISM->IsSupportedForNetworking())
 		// {
@@ -840,9 +1180,229 @@ void ATiledLevel::CreateNewHISM(UStaticMesh* MeshPtr, const TArray<class UMateri
 	for (UMaterialInterface* M : OverrideMaterials)
 	{
 		if (M)
-			TiledObjectSpawner[MeshPtr]->SetMaterial(i, M);
+			HISM->SetMaterial(i, M);
 		i++;
 	}
+	return HISM;
+}
+
+void ATiledLevel::DestroyPartition(const FTiledInstancePartition& Partition)
+{
+	if (UHierarchicalInstancedStaticMeshComponent* HISM = TiledObjectPartitions.FindRef(Partition))
+	{
+		HISMPartitions.Remove(HISM);
+		HISM->DestroyComponent();
+	}
+	TiledObjectPartitions.Remove(Partition);
+	InstanceLookups.Remove(Partition);
+}
+
+const FTiledInstancePartition* ATiledLevel::FindPartition(const UHierarchicalInstancedStaticMeshComponent* HISM)
+{
+	if (!HISM) return nullptr;
+	const FTiledInstancePartition* Partition = HISMPartitions.Find(HISM);
+	if (Partition && TiledObjectPartitions.FindRef(*Partition) == HISM)
+		return Partition;
+	HISMPartitions.Reset();
+	for (auto& elem : TiledObjectPartitions)
+	{
+		if (elem.Value)
+			HISMPartitions.Add(elem.Value, elem.Key);
+	}
+	return HISMPartitions.Find(HISM);
+}
+
+void ATiledLevel::UpdatePartitionStats() const
+{
+#if STATS
+	if (!FThreadStats::IsCollectingData() || !GetWorld()) return;
+	int32 NumPartitions = 0;
+	int32 NumInstances = 0;
+	int32 MaxInstances = 0;
+	for (TActorIterator<ATiledLevel> It(GetWorld()); It; ++It)
+	{
+		for (auto& elem : It->TiledObjectPartitions)
+		{
+			const int32 N = elem.Value? elem.Value->GetInstanceCount() : 0;
+			if (N == 0) continue;
+			NumPartitions++;
+			NumInstances += N;
+			MaxInstances = FMath::Max(MaxInstances, N);
+		}
+	}
+	SET_DWORD_STAT(STAT_TiledLevel_InstancePartitions, NumPartitions);
+	SET_DWORD_STAT(STAT_TiledLevel_PartitionedInstances, NumInstances);
+	SET_DWORD_STAT(STAT_TiledLevel_AvgPartitionInstances, NumPartitions > 0? NumInstances / NumPartitions : 0);
+	SET_DWORD_STAT(STAT_TiledLevel_MaxPartitionInstances, MaxInstances);
+#endif
+}
+
+void ATiledLevel::ClearLegacySpawner()
+{
+	// levels saved before floor partitions still hold one HISM per mesh, rebuilt into partitions on reset
+	for (auto& elem : TiledObjectSpawner)
+	{
+		if (elem.Value)
+			elem.Value->DestroyComponent();
+	}
+	TiledObjectSpawner.Empty();
+}
+
+FTiledInstanceLookup& ATiledLevel::GetInstanceLookup(const FTiledInstancePartition& Partition)
+{
+	FTiledInstanceLookup* Lookup = InstanceLookups.Find(Partition);
+	if (!Lookup || Lookup->IndexToKey.Num() != TiledObjectPartitions[Partition]->GetInstanceCount())
+		return RebuildInstanceLookup(Partition);
+	return *Lookup;
+}
+
+FTiledInstanceLookup& ATiledLevel::RebuildInstanceLookup(const FTiledInstancePartition& Partition)
+{
+	FTiledInstanceLookup& Lookup = InstanceLookups.FindOrAdd(Partition);
+	Lookup.KeyToIndex.Reset();
+	Lookup.IndexToKey.Reset();
+	const TArray<float>& CustomData = TiledObjectPartitions[Partition]->PerInstanceSMCustomData;
+	const int32 N = FMath::Min(TiledObjectPartitions[Partition]->GetInstanceCount(), CustomData.Num() / 6);
+	Lookup.IndexToKey.Reserve(N);
+	for (int32 i = 0; i < N; i++)
+	{
+		Lookup.IndexToKey.Emplace(&CustomData[i * 6]);
+		Lookup.KeyToIndex.Add(Lookup.IndexToKey.Last(), i);
+	}
+	return Lookup;
+}
+
+void ATiledLevel::AddToInstanceLookup(const FTiledInstancePartition& Partition, int32 InstanceIndex, TArrayView<const float> CustomData)
+{
+	// not built yet, will be built from custom data when it's needed
+	FTiledInstanceLookup* Lookup = InstanceLookups.Find(Partition);
+	if (!Lookup) return;
+	if (Lookup->IndexToKey.Num() != InstanceIndex || CustomData.Num() != 6)
+	{
+		InstanceLookups.Remove(Partition);
+		return;
+	}
+	Lookup->IndexToKey.Emplace(CustomData.GetData());
+	Lookup->KeyToIndex.Add(Lookup->IndexToKey.Last(), InstanceIndex);
+}
+
+void ATiledLevel::AddInstanceBatch(const FTiledInstancePartition& Partition, UHierarchicalInstancedStaticMeshComponent* HISM, const FTiledInstanceBatch& Batch)
+{
+	const int32 N = Batch.Transforms.Num();
+	if (N == 0 || Batch.CustomData.Num() != N * 6) return;
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_AddInstanceBatch);
+	INC_DWORD_STAT_BY(STAT_TiledLevel_InstancesAdded, N);
+	const int32 FirstIndex = HISM->GetInstanceCount();
+	HISM->AddInstances(Batch.Transforms, false);
+	for (int32 i = 0; i < N; i++)
+	{
+		const TArrayView<const float> InstanceData = MakeArrayView(&Batch.CustomData[i * 6], 6);
+		HISM->SetCustomData(FirstIndex + i, InstanceData, false);
+		AddToInstanceLookup(Partition, FirstIndex + i, InstanceData);
+	}
+	HISM->MarkRenderStateDirty();
+	MarkNavigationDirty(HISM, GetInstancesBounds(HISM, Batch.Transforms));
+}
+
+static TAutoConsoleVariable<bool> CVarLogNavigationDirty(
+	TEXT("TiledLevel.LogNavigationDirty"),
+	false,
+	TEXT("Log the navigation dirty area reported by each tiled level instance edit."));
+
+FBox ATiledLevel::GetInstancesBounds(const UHierarchicalInstancedStaticMeshComponent* HISM, TArrayView<const FTransform> LocalTransforms) const
+{
+	FBox Bounds(ForceInit);
+	if (!HISM->GetStaticMesh()) return Bounds;
+	const FBox MeshBox = HISM->GetStaticMesh()->GetBounds().GetBox();
+	const FTransform& ComponentTransform = HISM->GetComponentTransform();
+	for (const FTransform& T : LocalTransforms)
+		Bounds += MeshBox.TransformBy(T * ComponentTransform);
+	return Bounds;
+}
+
+FBox ATiledLevel::GetInstancesBounds(const UHierarchicalInstancedStaticMeshComponent* HISM, const TArray<int32>& InstanceIndices) const
+{
+	FBox Bounds(ForceInit);
+	if (!HISM->GetStaticMesh()) return Bounds;
+	const FBox MeshBox = HISM->GetStaticMesh()->GetBounds().GetBox();
+	for (int32 Index : InstanceIndices)
+	{
+		FTransform T;
+		if (HISM->GetInstanceTransform(Index, T, true))
+			Bounds += MeshBox.TransformBy(T);
+	}
+	return Bounds;
+}
+
+void ATiledLevel::MarkNavigationDirty(UHierarchicalInstancedStaticMeshComponent* HISM, const FBox& DirtyArea)
+{
+	if (!DirtyArea.IsValid || !HISM->IsRegistered() || !HISM->IsNavigationRelevant()) return;
+	UWorld* World = GetWorld();
+	if (!World || !World->GetNavigationSystem()) return;
+	// the octree element of this HISM gets its new bounds (an added instance may be outside the old ones),
+	// and only the instances area is rebuilt
+	HISM->UpdateBounds();
+	FNavigationSystem::OnComponentBoundsChanged(*HISM, HISM->Bounds.GetBox(), DirtyArea);
+	if (CVarLogNavigationDirty.GetValueOnGameThread())
+	{
+		DEV_LOGF("%s: navigation dirty area %s (size %s) in %s", *GetName(), *DirtyArea.ToString(),
+			*DirtyArea.GetSize().ToString(), *HISM->GetName())
+	}
+}
+
+static TAutoConsoleVariable<bool> CVarLogPopulateStats(
+	TEXT("TiledLevel.LogPopulateStats"),
+	false,
+	TEXT("Log instance count and avoided render state updates of each batched populate (fill, paste, template)."));
+
+FTiledPopulateStats ATiledLevel::SubmitInstanceBatches(const TMap<FTiledInstancePartition, FTiledInstanceBatch>& Batches)
+{
+	FTiledPopulateStats Stats;
+	for (auto& elem : Batches)
+	{
+		static const TArray<UMaterialInterface*> NoMaterials;
+		const FTiledInstanceBatch& Batch = elem.Value;
+		UHierarchicalInstancedStaticMeshComponent* HISM = CreateNewHISM(elem.Key, Batch.OverrideMaterials? *Batch.OverrideMaterials : NoMaterials);
+		AddInstanceBatch(elem.Key, HISM, Batch);
+		Stats.NumInstances += Batch.Transforms.Num();
+		Stats.NumHISMs++;
+		// one by one: AddInstance marks render state dirty for every instance
+		Stats.AvoidedRenderStateUpdates += FMath::Max(0, Batch.Transforms.Num() - 1);
+	}
+	if (CVarLogPopulateStats.GetValueOnGameThread())
+	{
+		DEV_LOGF("%s: batched %d instances into %d HISMs, %d render state updates avoided",
+			*GetName(), Stats.NumInstances, Stats.NumHISMs, Stats.AvoidedRenderStateUpdates)
+	}
+	UpdatePartitionStats();
+	return Stats;
+}
+
+void ATiledLevel::RemoveFromInstanceLookup(const FTiledInstancePartition& Partition, const TArray<int32>& InstancesToRemove)
+{
+	FTiledInstanceLookup* Lookup = InstanceLookups.Find(Partition);
+	if (!Lookup) return;
+
+	// same as what HISM does: from high index to low, the last instance is moved to the removed slot
+	TArray<int32> SortedIndices = InstancesToRemove;
+	SortedIndices.Sort(TGreater<int32>());
+	for (int32 Index : SortedIndices)
+	{
+		if (!Lookup->IndexToKey.IsValidIndex(Index))
+		{
+			InstanceLookups.Remove(Partition);
+			return;
+		}
+		const int32 LastIndex = Lookup->IndexToKey.Num() - 1;
+		Lookup->KeyToIndex.RemoveSingle(Lookup->IndexToKey[Index], Index);
+		if (Index != LastIndex)
+		{
+			const FTiledInstanceKey MovedKey = Lookup->IndexToKey[LastIndex];
+			Lookup->KeyToIndex.RemoveSingle(MovedKey, LastIndex);
+			Lookup->KeyToIndex.Add(MovedKey, Index);
+		}
+		Lookup->IndexToKey.RemoveAtSwap(Index, 1, false);
+	}
 }
 
 AActor* ATiledLevel::SpawnActorPlacement(const FItemPlacement& ItemPlacement)
@@ -860,6 +1420,7 @@ AActor* ATiledLevel::SpawnActorPlacement(const FItemPlacement& ItemPlacement)
 				{
 					FTilePlacement* TP = (FTilePlacement*)&ItemPlacement;
 					Arh->AddTargetedPositions(TP->GridPosition);
+					MarkRestrictionIndexDirty();
 					return nullptr;
 				}
 			}
@@ -872,6 +1433,7 @@ AActor* ATiledLevel::SpawnActorPlacement(const FItemPlacement& ItemPlacement)
 		NewArh->SourceItemID = RestrictionItem->ItemID;
 		NewArh->UpdatePreviewVisual();
 		NewArh->AddTargetedPositions(TP->GridPosition);
+		MarkRestrictionIndexDirty();
 	}
 	else
 	{
@@ -910,4 +1472,297 @@ AActor* ATiledLevel::SpawnMirroredPlacement(const FItemPlacement& ItemPlacement)
 
 
 
-#undef LOCTEXT_NAMESPACE
\ No newline at end of file
+#undef LOCTEXT_NAMESPACE
+
+// Gametime replication
+
+// bits sent per connection by the placement fast array, split between builds and erases by the ops each delta carries
+struct FTiledReplicationStats
+{
+	int64 NumBuilds = 0;
+	int64 NumErases = 0;
+	int64 BuildBits = 0;
+	int64 EraseBits = 0;
+	int64 NumDeltas = 0;
+	int64 TotalBits = 0;
+};
+static FTiledReplicationStats ReplicationStats;
+
+static TAutoConsoleVariable<bool> CVarLogReplication(
+	TEXT("TiledLevel.LogReplication"),
+	false,
+	TEXT("Log the size of each gametime placement delta sent to a connection."));
+
+static void PrintReplicationStats(const TArray<FString>& Args)
+{
+	const FTiledReplicationStats& S = ReplicationStats;
+	DEV_LOGF("Gametime replication: %lld deltas, %.1f KB total; %lld builds sent, %.1f bytes each; %lld erases sent, %.1f bytes each",
+		S.NumDeltas, S.TotalBits / 8192.0, S.NumBuilds, S.NumBuilds > 0? S.BuildBits / 8.0 / S.NumBuilds : 0.0,
+		S.NumErases, S.NumErases > 0? S.EraseBits / 8.0 / S.NumErases : 0.0)
+	if (Args.Num() > 0 && Args[0] == TEXT("reset"))
+		ReplicationStats = FTiledReplicationStats();
+}
+
+static FAutoConsoleCommand ReplicationStatsCommand(
+	TEXT("TiledLevel.ReplicationStats"),
+	TEXT("Log bandwidth of gametime placement replication per build and erase (counted per connection). Usage: TiledLevel.ReplicationStats [reset]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&PrintReplicationStats));
+
+void FTiledReplicatedPlacement::PreReplicatedRemove(const FTiledReplicatedPlacements& InArraySerializer)
+{
+	if (InArraySerializer.OwnerLevel)
+		InArraySerializer.OwnerLevel->RemoveReplicatedPlacement(Placement);
+}
+
+void FTiledReplicatedPlacement::PostReplicatedAdd(const FTiledReplicatedPlacements& InArraySerializer)
+{
+	if (InArraySerializer.OwnerLevel)
+		InArraySerializer.OwnerLevel->QueueReplicatedPlacement(Placement);
+}
+
+void FTiledReplicatedPlacements::AddItem(const FTiledNetPlacement& Placement)
+{
+	FTiledReplicatedPlacement& NewItem = Items.AddDefaulted_GetRef();
+	NewItem.Placement = Placement;
+	// gives the item its replication id
+	MarkItemDirty(NewItem);
+	ItemIndices.Add(NewItem.ReplicationID, Items.Num() - 1);
+	HandleIds.Add(Placement.GetHandle(), NewItem.ReplicationID);
+}
+
+void FTiledReplicatedPlacements::Add(const FTiledNetPlacement& Placement)
+{
+	AddItem(Placement);
+	NumBuilds++;
+}
+
+bool FTiledReplicatedPlacements::Remove(const FTiledActorHandle& Handle, const FTransform& Transform)
+{
+	TArray<int32, TInlineAllocator<4>> Ids;
+	HandleIds.MultiFind(Handle, Ids);
+	if (Ids.Num() == 0) return false;
+	int32 RemovedId = Ids[0];
+	for (int32 Id : Ids)
+	{
+		const int32* Found = ItemIndices.Find(Id);
+		if (Found && Items.IsValidIndex(*Found) && Items[*Found].Placement.TileObjectTransform.Equals(Transform))
+		{
+			RemovedId = Id;
+			break;
+		}
+	}
+	HandleIds.RemoveSingle(Handle, RemovedId);
+	int32 Index;
+	if (!ItemIndices.RemoveAndCopyValue(RemovedId, Index) || !Items.IsValidIndex(Index)) return false;
+	Items.RemoveAtSwap(Index);
+	if (Items.IsValidIndex(Index))
+		ItemIndices.Add(Items[Index].ReplicationID, Index);
+	MarkArrayDirty();
+	NumErases++;
+	return true;
+}
+
+void FTiledReplicatedPlacements::Reset(const FTiledLevelGameData& Data)
+{
+	Items.Empty(Data.BlockPlacements.Num() + Data.FloorPlacements.Num() + Data.WallPlacements.Num() +
+		Data.EdgePlacements.Num() + Data.PillarPlacements.Num() + Data.PointPlacements.Num());
+	ItemIndices.Empty(Items.Max());
+	HandleIds.Empty(Items.Max());
+	auto AddItems = [this](const auto& Placements, EPlacedType PlacedType)
+	{
+		for (const auto& P : Placements)
+			AddItem(FTiledNetPlacement(P, PlacedType));
+	};
+	AddItems(Data.BlockPlacements, EPlacedType::Block);
+	AddItems(Data.FloorPlacements, EPlacedType::Floor);
+	AddItems(Data.WallPlacements, EPlacedType::Wall);
+	AddItems(Data.EdgePlacements, EPlacedType::Edge);
+	AddItems(Data.PillarPlacements, EPlacedType::Pillar);
+	AddItems(Data.PointPlacements, EPlacedType::Point);
+	MarkArrayDirty();
+}
+
+void FTiledReplicatedPlacements::Reset(const FTiledLevelSnapshot& Snapshot)
+{
+	Items.Empty(Snapshot.GetNumOfAllPlacements());
+	ItemIndices.Empty(Items.Max());
+	HandleIds.Empty(Items.Max());
+	for (EPlacedType PlacedType : {EPlacedType::Block, EPlacedType::Floor})
+		for (const FTiledSnapshotPlacement& Record : Snapshot.GetPlacements(PlacedType))
+			AddItem(FTiledNetPlacement(Snapshot.MakeTilePlacement(Record), PlacedType));
+	for (EPlacedType PlacedType : {EPlacedType::Wall, EPlacedType::Edge})
+		for (const FTiledSnapshotPlacement& Record : Snapshot.GetPlacements(PlacedType))
+			AddItem(FTiledNetPlacement(Snapshot.MakeEdgePlacement(Record), PlacedType));
+	for (EPlacedType PlacedType : {EPlacedType::Pillar, EPlacedType::Point})
+		for (const FTiledSnapshotPlacement& Record : Snapshot.GetPlacements(PlacedType))
+			AddItem(FTiledNetPlacement(Snapshot.MakePointPlacement(Record), PlacedType));
+	MarkArrayDirty();
+}
+
+void FTiledReplicatedPlacements::PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters)
+{
+	if (OwnerLevel)
+		OwnerLevel->FlushReplicatedPlacements();
+}
+
+bool FTiledReplicatedPlacements::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 StartBits = DeltaParms.Writer? DeltaParms.Writer->GetNumBits() : 0;
+	const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FTiledReplicatedPlacement, FTiledReplicatedPlacements>(Items, DeltaParms, *this);
+	if (DeltaParms.Writer && DeltaParms.Map)
+	{
+		const int64 Bits = DeltaParms.Writer->GetNumBits() - StartBits;
+		FIntPoint& Sent = SentOps.FindOrAdd(DeltaParms.Map);
+		const int32 NewBuilds = NumBuilds - Sent.X;
+		const int32 NewErases = NumErases - Sent.Y;
+		Sent = FIntPoint(NumBuilds, NumErases);
+		if (Bits > 0)
+		{
+			ReplicationStats.NumDeltas++;
+			ReplicationStats.TotalBits += Bits;
+			if (NewBuilds + NewErases > 0)
+			{
+				const int64 BuildBits = Bits * NewBuilds / (NewBuilds + NewErases);
+				ReplicationStats.NumBuilds += NewBuilds;
+				ReplicationStats.NumErases += NewErases;
+				ReplicationStats.BuildBits += BuildBits;
+				ReplicationStats.EraseBits += Bits - BuildBits;
+			}
+			if (CVarLogReplication.GetValueOnGameThread())
+			{
+				DEV_LOGF("%s: sent %lld bytes for %d builds, %d erases (%d placements in level)",
+					OwnerLevel? *OwnerLevel->GetName() : TEXT("?"), (Bits + 7) / 8, NewBuilds, NewErases, Items.Num())
+			}
+		}
+	}
+	return bResult;
+}
+
+const FTiledRestrictionIndex& ATiledLevel::GetRestrictionIndex()
+{
+	if (bRestrictionIndexDirty)
+	{
+		RestrictionIndex.Build(SpawnedTiledActors);
+		bRestrictionIndexDirty = false;
+	}
+	return RestrictionIndex;
+}
+
+void ATiledLevel::ReplicatePlacementAdded(const FTiledNetPlacement& Placement)
+{
+	if (!IsReplicatingPlacements()) return;
+	ReplicatedPlacements.Add(Placement);
+}
+
+void ATiledLevel::ReplicatePlacementRemoved(const FTiledActorHandle& Handle, const FTransform& Transform)
+{
+	if (!IsReplicatingPlacements()) return;
+	ReplicatedPlacements.Remove(Handle, Transform);
+}
+
+void ATiledLevel::ResetReplicatedPlacements(const FTiledLevelGameData& Data)
+{
+	if (!IsReplicatingPlacements()) return;
+	ReplicatedPlacements.Reset(Data);
+}
+
+void ATiledLevel::ResetReplicatedPlacements(const FTiledLevelSnapshot& Snapshot)
+{
+	if (!IsReplicatingPlacements()) return;
+	ReplicatedPlacements.Reset(Snapshot);
+}
+
+void ATiledLevel::QueueReplicatedPlacement(const FTiledNetPlacement& Placement)
+{
+	if (HasAuthority()) return;
+	PendingReplicatedPlacements.Add(Placement);
+}
+
+template <typename T>
+void ATiledLevel::RemoveReplicatedInstance(const T& Placement)
+{
+	UTiledLevelItem* Item = Placement.GetItem();
+	if (!Item) return;
+	if (Item->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
+	{
+		DestroyTiledActorByPlacement(Placement);
+		return;
+	}
+	TMap<FTiledInstancePartition, TArray<int32>> FoundIndices;
+	FindInstanceIndexByPlacement(FoundIndices, Item->TiledMesh, FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement));
+	RemoveInstances(FoundIndices);
+}
+
+void ATiledLevel::RemoveReplicatedPlacement(const FTiledNetPlacement& Placement)
+{
+	if (HasAuthority()) return;
+	// added and removed before the receive ends, it was never populated
+	// only this one, a stacked placement with the same handle may still be pending
+	const FTiledActorHandle Handle = Placement.GetHandle();
+	const int32 PendingIndex = PendingReplicatedPlacements.IndexOfByPredicate([&](const FTiledNetPlacement& P)
+	{
+		return P.GetHandle() == Handle && P.TileObjectTransform.Equals(Placement.TileObjectTransform);
+	});
+	if (PendingIndex != INDEX_NONE)
+	{
+		PendingReplicatedPlacements.RemoveAt(PendingIndex);
+		return;
+	}
+	// by transform, removing by placement would take the stacked ones with it
+	GametimeData.RemovePlacement(Placement.TileObjectTransform, Placement.ItemID);
+	switch (FTiledLevelUtility::PlacedTypeToShape(Placement.PlacedType))
+	{
+		case Shape3D:
+			RemoveReplicatedInstance(Placement.MakeTilePlacement());
+			break;
+		case Shape2D:
+			RemoveReplicatedInstance(Placement.MakeEdgePlacement());
+			break;
+		case Shape1D:
+			RemoveReplicatedInstance(Placement.MakePointPlacement());
+			break;
+	}
+}
+
+void ATiledLevel::FlushReplicatedPlacements()
+{
+	if (PendingReplicatedPlacements.Num() == 0) return;
+	// a client joining late gets the whole level in one receive, so it's batched like any other populate
+	TMap<FTiledInstancePartition, FTiledInstanceBatch> Batches;
+	int32 NumActors = 0;
+	const int32 NumSpawnedBefore = SpawnedTiledActors.Num();
+	for (const FTiledNetPlacement& Placement : PendingReplicatedPlacements)
+	{
+		switch (FTiledLevelUtility::PlacedTypeToShape(Placement.PlacedType))
+		{
+			case Shape3D:
+			{
+				const FTilePlacement Tile = Placement.MakeTilePlacement();
+				GametimeData.AddPlacement(Tile, Placement.PlacedType);
+				AddToPopulateBatch(Tile, Batches, NumActors);
+				break;
+			}
+			case Shape2D:
+			{
+				const FEdgePlacement Edge = Placement.MakeEdgePlacement();
+				GametimeData.AddPlacement(Edge, Placement.PlacedType);
+				AddToPopulateBatch(Edge, Batches, NumActors);
+				break;
+			}
+			case Shape1D:
+			{
+				const FPointPlacement Point = Placement.MakePointPlacement();
+				GametimeData.AddPlacement(Point, Placement.PlacedType);
+				AddToPopulateBatch(Point, Batches, NumActors);
+				break;
+			}
+		}
+	}
+	PendingReplicatedPlacements.Empty();
+	SubmitInstanceBatches(Batches);
+	for (int32 i = NumSpawnedBefore; i < SpawnedTiledActors.Num(); i++)
+	{
+		if (SpawnedTiledActors[i])
+			SpawnedTiledActors[i]->AttachToActor(this, FAttachmentTransformRules::KeepRelativeTransform);
+	}
+}
@@ -3,6 +3,7 @@
 #include "TiledLevelAsset.h"
 #include "TiledLevel.h"
 #include "TiledLevelEditorLog.h"
+#include "TiledLevelStats.h"
 #include "TiledLevelItem.h"
 #include "TiledLevelUtility.h"
 #include "Components/StaticMeshComponent.h"
@@ -70,8 +71,18 @@ void UTiledLevelAsset::PostEditChangeProperty(FPropertyChangedEvent& PropertyCha
 		MoveHelperFloorGrids.ExecuteIfBound(ActiveFloor->FloorPosition);
 	}
 	VersionNumber += 1;
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UTiledLevelAsset, InstanceChunkSize) && HostLevel)
+	{
+		HostLevel->ResetAllInstance();
+	}
 	UObject::PostEditChangeProperty(PropertyChangedEvent);
 }
+
+void UTiledLevelAsset::PostEditUndo()
+{
+	MarkOccupancyIndexDirty();
+	UObject::PostEditUndo();
+}
 #endif
 
 int UTiledLevelAsset::AddNewFloor(int32 InsertPosition)
@@ -104,6 +115,7 @@ int UTiledLevelAsset::AddNewFloor(int32 InsertPosition)
 		}
 	}
 	TiledFloors.Add(FTiledFloor(ActualInsertPosition));
+	MarkOccupancyIndexDirty();
 	OnTiledLevelAreaChanged.ExecuteIfBound(TileSizeX, TileSizeY, TileSizeZ, X_Num, Y_Num, TiledFloors.Num(), FMath::Max(TiledFloors).FloorPosition);
 	return ActualInsertPosition;
 }
@@ -149,6 +161,7 @@ void UTiledLevelAsset::DuplicatedFloor(int SourcePosition)
 	TargetFloor->WallPlacements = WP;
 	TargetFloor->EdgePlacements = BmP;
 	TargetFloor->PointPlacements = PP;
+	MarkOccupancyIndexDirty();
 }
 
 void UTiledLevelAsset::MoveAllFloors(bool Up)
@@ -160,6 +173,7 @@ void UTiledLevelAsset::MoveAllFloors(bool Up)
 		else
 			F.UpdatePosition(F.FloorPosition - 1, TileSizeZ);
 	}
+	MarkOccupancyIndexDirty();
 	OnTiledLevelAreaChanged.ExecuteIfBound(TileSizeX, TileSizeY, TileSizeZ, X_Num, Y_Num, TiledFloors.Num(), FMath::Max(TiledFloors).FloorPosition);
 }
 
@@ -180,6 +194,7 @@ void UTiledLevelAsset::RemoveFloor(int32 DeleteIndex)
 			if (F.FloorPosition < DeleteIndex)
 				F.UpdatePosition(F.FloorPosition + 1, TileSizeZ);
 	}
+	MarkOccupancyIndexDirty();
 	OnTiledLevelAreaChanged.ExecuteIfBound(TileSizeX, TileSizeY, TileSizeZ, X_Num, Y_Num, TiledFloors.Num(), FMath::Max(TiledFloors).FloorPosition);
 }
 
@@ -193,6 +208,7 @@ void UTiledLevelAsset::EmptyFloor(int FloorPosition)
 		F->EdgePlacements.Empty();
 		F->PillarPlacements.Empty();
 	}
+	MarkOccupancyIndexDirty();
 	VersionNumber += 100;
 }
 
@@ -206,6 +222,7 @@ void UTiledLevelAsset::EmptyAllFloors()
 		F.EdgePlacements.Empty();
 		F.PillarPlacements.Empty();
 	}
+	MarkOccupancyIndexDirty();
 	VersionNumber += 100;
 }
 
@@ -232,6 +249,9 @@ void UTiledLevelAsset::RemovePlacements(const TArray<FTilePlacement>& TilesToDel
 			return TilesToDelete.Contains(P);
 		});
 	}
+	PlacementRevision++;
+	for (const FTilePlacement& P : TilesToDelete)
+		OccupancyIndex.RemovePlacement(P);
 }
 
 void UTiledLevelAsset::RemovePlacements(const TArray<FEdgePlacement>& WallsToDelete)
@@ -247,6 +267,9 @@ void UTiledLevelAsset::RemovePlacements(const TArray<FEdgePlacement>& WallsToDel
 			return WallsToDelete.Contains(P);
 		});
 	}
+	PlacementRevision++;
+	for (const FEdgePlacement& P : WallsToDelete)
+		OccupancyIndex.RemovePlacement(P);
 }
 
 void UTiledLevelAsset::RemovePlacements(const TArray<FPointPlacement>& PointsToDelete)
@@ -262,6 +285,9 @@ void UTiledLevelAsset::RemovePlacements(const TArray<FPointPlacement>& PointsToD
 			return PointsToDelete.Contains(P);
 		});
 	}
+	PlacementRevision++;
+	for (const FPointPlacement& P : PointsToDelete)
+		OccupancyIndex.RemovePlacement(P);
 }
 
 void UTiledLevelAsset::ClearItem(const FGuid& ItemID)
@@ -297,6 +323,7 @@ void UTiledLevelAsset::ClearItem(const FGuid& ItemID)
 			return P.ItemID == ItemID;
 		});
 	}
+	MarkOccupancyIndexDirty();
 	VersionNumber += 1;
 }
 
@@ -326,6 +353,7 @@ void UTiledLevelAsset::ClearItemInActiveFloor(const FGuid& ItemID)
 	{
 		return P.ItemID == ItemID;
 	});
+	MarkOccupancyIndexDirty();
 	VersionNumber += 1;
 }
 
@@ -340,6 +368,7 @@ void UTiledLevelAsset::ClearInvalidPlacements()
 				InvalidIndices.AddUnique(P.ItemID);
 		}
 	}
+	// ClearItem marks the occupancy index dirty, nothing to rebuild when everything is valid
 	for (FGuid& TestID : InvalidIndices)
 	{
 		ClearItem(TestID);
@@ -379,8 +408,10 @@ void UTiledLevelAsset::AddNewTilePlacement(FTilePlacement NewTile)
         case EPlacedType::Floor:
             TargetFloor->FloorPlacements.Add(NewTile);
             break;
-        default: ;
+        default: return;
     }
+    PlacementRevision++;
+    OccupancyIndex.AddPlacement(NewTile, Item->PlacedType);
 }
 
 void UTiledLevelAsset::AddNewEdgePlacement(FEdgePlacement NewEdge)
@@ -394,8 +425,11 @@ void UTiledLevelAsset::AddNewEdgePlacement(FEdgePlacement NewEdge)
             break;
         case EPlacedType::Edge:
             TargetFloor->EdgePlacements.Add(NewEdge);
-        default: ;
+            break;
+        default: return;
     }
+    PlacementRevision++;
+    OccupancyIndex.AddPlacement(NewEdge, Item->PlacedType);
 }
 
 void UTiledLevelAsset::AddNewPointPlacement(FPointPlacement NewPoint)
@@ -410,8 +444,10 @@ void UTiledLevelAsset::AddNewPointPlacement(FPointPlacement NewPoint)
         case EPlacedType::Point:
             TargetFloor->PointPlacements.Add(NewPoint);
             break;
-        default: ;
+        default: return;
     }
+    PlacementRevision++;
+    OccupancyIndex.AddPlacement(NewPoint, Item->PlacedType);
 }
 
 TArray<FTilePlacement> UTiledLevelAsset::GetAllBlockPlacements() const
@@ -509,7 +545,9 @@ TSet<UTiledLevelItem*> UTiledLevelAsset::GetUsedItems() const
 	{
 		for (FItemPlacement& P : F.GetItemPlacements())
 		{
-		    UsedItemsSet.Add(P.GetItem());
+			// item removed from its item set, nothing to use
+			if (UTiledLevelItem* Item = P.GetItem())
+				UsedItemsSet.Add(Item);
 		}
 	}
 	return UsedItemsSet;
@@ -530,7 +568,7 @@ TSet<UStaticMesh*> UTiledLevelAsset::GetUsedStaticMeshSet() const
 		{
 			MeshesSet.Add(UsedItem->TiledMesh);
 		}
-		else if (UsedItem->TiledActor)
+		else if (UsedItem->TiledActor && HostLevel)
 		{
 			for (AActor* SpawnedActor : HostLevel->SpawnedTiledActors)
 			{
@@ -633,6 +671,31 @@ void UTiledLevelAsset::EmptyEdgeRegionData(const TArray<FTiledLevelEdge>& EdgeRe
 	RemovePlacements(WallToDelete);
 }
 
+const FTiledLevelOccupancyIndex& UTiledLevelAsset::GetOccupancyIndex()
+{
+	if (!bOccupancyIndexDirty)
+		return OccupancyIndex;
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_OccupancyIndexBuild);
+	OccupancyIndex.Empty();
+	for (const FTiledFloor& F : TiledFloors)
+	{
+		for (const FTilePlacement& P : F.BlockPlacements)
+			OccupancyIndex.AddPlacement(P, EPlacedType::Block);
+		for (const FTilePlacement& P : F.FloorPlacements)
+			OccupancyIndex.AddPlacement(P, EPlacedType::Floor);
+		for (const FEdgePlacement& P : F.WallPlacements)
+			OccupancyIndex.AddPlacement(P, EPlacedType::Wall);
+		for (const FEdgePlacement& P : F.EdgePlacements)
+			OccupancyIndex.AddPlacement(P, EPlacedType::Edge);
+		for (const FPointPlacement& P : F.PillarPlacements)
+			OccupancyIndex.AddPlacement(P, EPlacedType::Pillar);
+		for (const FPointPlacement& P : F.PointPlacements)
+			OccupancyIndex.AddPlacement(P, EPlacedType::Point);
+	}
+	bOccupancyIndexDirty = false;
+	return OccupancyIndex;
+}
+
 void UTiledLevelAsset::GetAssetRegistryTags(TArray<FAssetRegistryTag>& AssetRegistryTags) const
 {
 	const FString TileSizeStr = FString::Printf(TEXT("%dx%dx%d"), FMath::RoundToInt(TileSizeX), FMath::RoundToInt(TileSizeY), FMath::RoundToInt(TileSizeZ));
@@ -9,7 +9,8 @@
 #include "ProceduralMeshComponent.h"
 #include "Components/ArrowComponent.h"
 #include "Components/StaticMeshComponent.h"
-#include "KismetProceduralMeshLibrary.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
 #include "TiledLevel.h"
 #include "Kismet/GameplayStatics.h"
 #include "UObject/ConstructorHelpers.h"
@@ -27,10 +28,16 @@ ATiledLevelEditorHelper::ATiledLevelEditorHelper(const FObjectInitializer& Objec
 	FloorGrids->CastShadow = false;
 	FloorGrids->SetupAttachment(Root);
 
-	FillPreviewGrids = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("FillPreviewGrids"));
+	FillPreviewGrids = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("FillPreviewGrids"));
 	FillPreviewGrids->CastShadow = false;
+	FillPreviewGrids->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	FillPreviewGrids->SetupAttachment(Root);
 
+	FillPreviewEdges = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("FillPreviewEdges"));
+	FillPreviewEdges->CastShadow = false;
+	FillPreviewEdges->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	FillPreviewEdges->SetupAttachment(Root);
+
 	CustomGizmo = CreateDefaultSubobject<UTiledLevelGrid>(TEXT("CustomGizmo"));
 	CustomGizmo->SetBoxColor(FColor::Yellow);
 	CustomGizmo->SetBoxExtent(FVector(3));
@@ -62,11 +69,17 @@ ATiledLevelEditorHelper::ATiledLevelEditorHelper(const FObjectInitializer& Objec
 	ConstructorHelpers::FObjectFinder<UMaterialInterface> Asset_M_FillPreview(TEXT("/TiledLevel/Materials/M_FillPreview"));
 	ConstructorHelpers::FObjectFinder<UMaterialInterface> Asset_M_PreviewCanBuild(TEXT("/TiledLevel/Materials/MI_Preview_Normal"));
 	ConstructorHelpers::FObjectFinder<UMaterialInterface> Asset_M_PreviewCanNotBuild(TEXT("/TiledLevel/Materials/MI_Preview_Eraser"));
+	ConstructorHelpers::FObjectFinder<UStaticMesh> Asset_SM_Cube(TEXT("/Engine/BasicShapes/Cube"));
 	M_FloorGrids = Asset_M_FloorGrids.Object;
 	M_HelperFloor = Asset_M_HelperFloor.Object;
 	M_FillPreview = Asset_M_FillPreview.Object;
 	CanBuildPreviewMaterial = Asset_M_PreviewCanBuild.Object;
 	CanNotBuildPreviewMaterial =Asset_M_PreviewCanNotBuild.Object;
+
+	FillPreviewGrids->SetStaticMesh(Asset_SM_Cube.Object);
+	FillPreviewGrids->SetMaterial(0, M_FillPreview);
+	FillPreviewEdges->SetStaticMesh(Asset_SM_Cube.Object);
+	FillPreviewEdges->SetMaterial(0, M_FillPreview);
 }
 
 void ATiledLevelEditorHelper::BeginPlay()
@@ -204,7 +217,7 @@ void ATiledLevelEditorHelper::ResetBrush()
 	Center->SetVisibility(false, true);
 	CustomGizmo->SetVisibility(false, true);
 	Brush->SetRelativeScale3D(FVector(1));
-	FillPreviewGrids->ClearAllMeshSections();
+	ClearFillPreview();
 	
 	// // Reset rotation
 	BrushRotationIndex = 0;
@@ -495,99 +508,121 @@ void ATiledLevelEditorHelper::SetHelperGridsVisibility(bool IsVisible)
 	AreaHint->SetVisibility(IsVisible, true);
 }
 
-void ATiledLevelEditorHelper::UpdateFillPreviewGrids(TArray<FIntPoint> InFillBoard,int InFillFloorPosition, int InFillHeight)
+// basic shape cube is 100 units wide
+static FTransform MakeFillPreviewBox(const FVector& BoxCenter, const FVector& BoxSize)
 {
-	if (InFillBoard == CacheFillTiles) return;
-	CacheFillTiles = InFillBoard;
-	FillPreviewGrids->ClearAllMeshSections();
-	
-	TArray<FVector> PreviewVertices;
-	TArray<int32> PreviewTriangles;
-	TArray<FVector> PreviewNormals;
-	TArray<FVector2D> PreviewUVs;
-	TArray<FProcMeshTangent> PreviewTangents;
-	
-	TArray<FVector> BoxVertices;
-	TArray<int32> BoxTriangles;
-	TArray<FVector> BoxNormals;
-	TArray<FVector2D> BoxUVs;
-	TArray<FProcMeshTangent> BoxTangents;
-	
-	UKismetProceduralMeshLibrary::GenerateBoxMesh(TileSize * FVector(0.5, 0.5, 0.5*InFillHeight), BoxVertices, BoxTriangles, BoxNormals, BoxUVs, BoxTangents);
-
-	int N_Box = 0;
-	FVector Offset = FVector(0.5, 0.5, InFillHeight * 0.5) * TileSize;
-	
-	for (auto Tile : InFillBoard)
-	{
-		for (FVector v : BoxVertices)
-			PreviewVertices.Add(v + FVector(Tile.X, Tile.Y, InFillFloorPosition) * TileSize + Offset); 
-		for (int32 t : BoxTriangles)
-			PreviewTriangles.Add(t + N_Box * BoxVertices.Num());
-		PreviewNormals.Append(BoxNormals);
-		PreviewUVs.Append(BoxUVs);
-		PreviewTangents.Append(BoxTangents);
-		N_Box++;
-	}
-	
-	FillPreviewGrids->CreateMeshSection(0, PreviewVertices, PreviewTriangles, PreviewNormals, PreviewUVs, TArray<FColor>{}, PreviewTangents, false);
-	FillPreviewGrids->SetMaterial(0, M_FillPreview);
+	return FTransform(FQuat::Identity, BoxCenter, BoxSize / 100.0);
 }
 
-void ATiledLevelEditorHelper::UpdateFillPreviewEdges(TArray<FTiledLevelEdge> InEdgePoints, int InFillHeight)
+template <typename T>
+int32 ATiledLevelEditorHelper::SyncFillPreviewInstances(UInstancedStaticMeshComponent* Target, const TArray<T>& NewItems, TTiledFillPreviewPool<T>& Pool, TFunctionRef<FTransform(const T&)> MakeTransform)
 {
-	if (InEdgePoints == CacheFillEdges) return;
-	CacheFillEdges = InEdgePoints;
-	FillPreviewGrids->ClearAllMeshSections();
-
-	TArray<FVector> PreviewVertices;
-	TArray<int32> PreviewTriangles;
-	TArray<FVector> PreviewNormals;
-	TArray<FVector2D> PreviewUVs;
-	TArray<FProcMeshTangent> PreviewTangents;
-	
-	TArray<FVector> HBoxVertices;
-	TArray<FVector> VBoxVertices;
-	TArray<int32> BoxTriangles;
-	TArray<FVector> BoxNormals;
-	TArray<FVector2D> BoxUVs;
-	TArray<FProcMeshTangent> BoxTangents;
-	
-	UKismetProceduralMeshLibrary::GenerateBoxMesh(TileSize * FVector(0.5, 0.05, 0.5 * InFillHeight), HBoxVertices, BoxTriangles, BoxNormals, BoxUVs, BoxTangents);
-	UKismetProceduralMeshLibrary::GenerateBoxMesh(TileSize * FVector(0.05, 0.5, 0.5 * InFillHeight), VBoxVertices, BoxTriangles, BoxNormals, BoxUVs, BoxTangents);
-	
-	int N_Box = 0;
-	FVector HOffset = FVector(0.5, 0.025, 0.5 * InFillHeight) * TileSize;
-	FVector VOffset = FVector(0.025, 0.5, 0.5 * InFillHeight) * TileSize;
-	
-	for (const auto Edge : InEdgePoints)
+	const int32 NumSlots = Pool.Items.Num();
+	TBitArray<> Kept(false, NumSlots);
+	int32 NumTouched = 0;
+	TArray<FTransform> Added;
+	// new items go to hidden instances first, slots freed by this update are only reused by the next one
+	for (const T& Item : NewItems)
 	{
-		if (Edge.EdgeType == EEdgeType::Horizontal)
+		if (const int32* Slot = Pool.Slots.Find(Item))
 		{
-			for (FVector v : HBoxVertices)
-			{
-				PreviewVertices.Add((v + FVector(Edge.X, Edge.Y, Edge.Z) * TileSize) + HOffset);
-			}
+			if (*Slot < NumSlots)
+				Kept[*Slot] = true;
+			continue;
+		}
+		NumTouched++;
+		if (Pool.FreeSlots.Num() > 0)
+		{
+			const int32 Slot = Pool.FreeSlots.Pop(false);
+			Target->UpdateInstanceTransform(Slot, MakeTransform(Item), false, false, true);
+			Pool.Items[Slot] = Item;
+			Pool.Visible[Slot] = true;
+			Kept[Slot] = true;
+			Pool.Slots.Add(Item, Slot);
 		}
 		else
 		{
-			for (FVector v : VBoxVertices)
-			{
-				PreviewVertices.Add((v + FVector(Edge.X, Edge.Y, Edge.Z) * TileSize) + VOffset);
-			}
+			Added.Add(MakeTransform(Item));
+			Pool.Slots.Add(Item, Pool.Items.Add(Item));
+			Pool.Visible.Add(true);
 		}
-		
-		for (int32 t : BoxTriangles)
-			PreviewTriangles.Add(t + N_Box * HBoxVertices.Num());
-		PreviewNormals.Append(BoxNormals);
-		PreviewUVs.Append(BoxUVs);
-		PreviewTangents.Append(BoxTangents);
-		N_Box++;
+	}
+	if (Added.Num() > 0)
+		Target->AddInstances(Added, false);
+
+	// hide the ones no longer in the region, other instances keep their index
+	const FTransform Hidden(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+	for (int32 Slot = 0; Slot < NumSlots; Slot++)
+	{
+		if (!Pool.Visible[Slot] || Kept[Slot]) continue;
+		Target->UpdateInstanceTransform(Slot, Hidden, false, false, true);
+		Pool.Slots.Remove(Pool.Items[Slot]);
+		Pool.Visible[Slot] = false;
+		Pool.FreeSlots.Add(Slot);
+		NumTouched++;
+	}
+
+	// only the touched instances are sent to the render thread, the proxy is not recreated
+	if (NumTouched > 0)
+		Target->MarkRenderInstancesDirty();
+	return NumTouched;
+}
+
+void ATiledLevelEditorHelper::UpdateFillPreviewGrids(TArray<FIntPoint> InFillBoard,int InFillFloorPosition, int InFillHeight)
+{
+	if (FillEdgePool.Items.Num() > 0)
+	{
+		FillPreviewEdges->ClearInstances();
+		FillEdgePool.Reset();
+	}
+	// every box moves or resizes, start over
+	if (InFillFloorPosition != CacheFillFloorPosition || InFillHeight != CacheFillHeight)
+	{
+		FillPreviewGrids->ClearInstances();
+		FillTilePool.Reset();
+		CacheFillFloorPosition = InFillFloorPosition;
+		CacheFillHeight = InFillHeight;
 	}
 	
-	FillPreviewGrids->CreateMeshSection(0, PreviewVertices, PreviewTriangles, PreviewNormals, PreviewUVs, TArray<FColor>{}, PreviewTangents, false);
-	FillPreviewGrids->SetMaterial(0, M_FillPreview);
-	
+	const FVector BoxSize = FVector(1, 1, InFillHeight) * TileSize;
+	const FVector Offset = FVector(0.5, 0.5, InFillHeight * 0.5) * TileSize;
+	SyncFillPreviewInstances<FIntPoint>(FillPreviewGrids, InFillBoard, FillTilePool, [&](const FIntPoint& Tile)
+	{
+		return MakeFillPreviewBox(FVector(Tile.X, Tile.Y, InFillFloorPosition) * TileSize + Offset, BoxSize);
+	});
+}
+
+void ATiledLevelEditorHelper::UpdateFillPreviewEdges(TArray<FTiledLevelEdge> InEdgePoints, int InFillHeight)
+{
+	if (FillTilePool.Items.Num() > 0)
+	{
+		FillPreviewGrids->ClearInstances();
+		FillTilePool.Reset();
+	}
+	if (InFillHeight != CacheFillHeight)
+	{
+		FillPreviewEdges->ClearInstances();
+		FillEdgePool.Reset();
+		CacheFillHeight = InFillHeight;
+	}
+
+	const FVector HBoxSize = FVector(1, 0.1, InFillHeight) * TileSize;
+	const FVector VBoxSize = FVector(0.1, 1, InFillHeight) * TileSize;
+	const FVector HOffset = FVector(0.5, 0.025, 0.5 * InFillHeight) * TileSize;
+	const FVector VOffset = FVector(0.025, 0.5, 0.5 * InFillHeight) * TileSize;
+	SyncFillPreviewInstances<FTiledLevelEdge>(FillPreviewEdges, InEdgePoints, FillEdgePool, [&](const FTiledLevelEdge& Edge)
+	{
+		const bool IsHorizontal = Edge.EdgeType == EEdgeType::Horizontal;
+		return MakeFillPreviewBox(FVector(Edge.X, Edge.Y, Edge.Z) * TileSize + (IsHorizontal? HOffset : VOffset), IsHorizontal? HBoxSize : VBoxSize);
+	});
+}
+
+void ATiledLevelEditorHelper::ClearFillPreview()
+{
+	FillPreviewGrids->ClearInstances();
+	FillPreviewEdges->ClearInstances();
+	FillTilePool.Reset();
+	FillEdgePool.Reset();
 }
 
 void ATiledLevelEditorHelper::SetupPreviewBrushInGame(UTiledLevelItem* Item)
@@ -5,14 +5,23 @@
 #include "TiledLevelEditorHelper.h"
 #include "TiledLevelEditorLog.h"
 #include "TiledLevelRestrictionHelper.h"
+#include "TiledLevelSettings.h"
+#include "TiledLevelSnapshot.h"
+#include "TiledLevelStats.h"
 #include "TiledLevelUtility.h"
 #include "DrawDebugHelpers.h"
 #include "TiledLevelItem.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "Async/Async.h"
 #include "Engine/Engine.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "TimerManager.h"
 
 bool UTiledLevelGametimeSystem::ShouldCreateSubsystem(UObject* Outer) const
 {
@@ -27,6 +36,7 @@ void UTiledLevelGametimeSystem::Initialize(FSubsystemCollectionBase& Collection)
 
 void UTiledLevelGametimeSystem::Deinitialize()
 {
+	ResetStreaming();
 	Super::Deinitialize();
 }
 
@@ -54,6 +64,9 @@ void UTiledLevelGametimeSystem::InitializeGametimeSystemFromData(const UObject*
 
 	DeactivateEraserMode();
 	DeactivatePreviewItem();
+	ResetStreaming();
+	GametimeSnapshot.Reset();
+	SnapshotChunks.Empty();
 	GametimeMode = bUnbound? EGametimeMode::Infinite : EGametimeMode::BoundToExistingLevels;
 	SourceItemSet = StartupItemSet;
 	if (GametimeLevel) GametimeLevel->Destroy();
@@ -72,7 +85,9 @@ void UTiledLevelGametimeSystem::InitializeGametimeSystemFromData(const UObject*
 	SpawnParams.bNoFail = true; // this stuck me so long... force it spawn... no matter the collision...
 	GametimeLevel = InWorld->SpawnActor<ATiledLevel>(ATiledLevel::StaticClass(), FVector(0, 0, 0), FRotator(0), SpawnParams);
 	// GametimeLevel->SetSystem(this);
+	GametimeLevel->SetInstanceChunkSize(GetGametimeInstanceChunkSize());
 	GametimeLevel->GametimeData = GametimeData;
+	GametimeLevel->ResetReplicatedPlacements(GametimeData);
 	// GametimeLevel->ResetAllInstance(GametimeData);
 	
 	Helper = InWorld->SpawnActor<ATiledLevelEditorHelper>(ATiledLevelEditorHelper::StaticClass(), FVector(0), FRotator(0), SpawnParams);
@@ -87,6 +102,7 @@ void UTiledLevelGametimeSystem::InitializeGametimeSystemFromData(const UObject*
 	}
 	Helper->SetActorTransform(GametimeLevel->GetActorTransform());
 	Helper->AttachToActor(GametimeLevel, FAttachmentTransformRules::KeepWorldTransform);
+	InitStreaming();
 }
 
 void UTiledLevelGametimeSystem::InitializeGametimeSystem(const UObject* WorldContextObject, UTiledItemSet* StartupItemSet, const TArray<ATiledLevel*>& ExistingTiledLevels, bool bUnbound)
@@ -112,6 +128,7 @@ void UTiledLevelGametimeSystem::InitializeGametimeSystem(const UObject* WorldCon
 	}
 	
 	SourceItemSet = StartupItemSet;
+	ResetStreaming();
 	if (GametimeLevel) GametimeLevel->Destroy();
 
 	// mark other tiled levels as static...
@@ -177,8 +194,11 @@ void UTiledLevelGametimeSystem::InitializeGametimeSystem(const UObject* WorldCon
 	}
 	
 	GametimeLevel = InWorld->SpawnActor<ATiledLevel>(FVector(0, 0, 0), FRotator(0), SpawnParams);
+	GametimeLevel->SetInstanceChunkSize(GetGametimeInstanceChunkSize());
 	GametimeLevel->GametimeData = GametimeData;
 	GametimeLevel->ResetAllInstanceFromData();
+	GametimeLevel->ResetReplicatedPlacements(GametimeData);
+	InitStreaming();
 
 	// TODO: leave for next update for replication...
 	/*if (UKismetSystemLibrary::IsServer(InWorld))
@@ -201,6 +221,51 @@ void UTiledLevelGametimeSystem::InitializeGametimeSystem(const UObject* WorldCon
 
 }
 
+bool UTiledLevelGametimeSystem::InitializeGametimeSystemFromFile(const UObject* WorldContextObject, UTiledItemSet* StartupItemSet,
+	FString SourceFile, bool bUnbound)
+{
+	TArray<uint8> Bytes;
+	FTiledLevelGameData LoadedData;
+	FVector LoadedTileSize;
+	if (!FFileHelper::LoadFileToArray(Bytes, *SourceFile) || !LoadedData.LoadFromBinary(Bytes, LoadedTileSize))
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to load gametime data from %s"), *SourceFile);
+		return false;
+	}
+	if (LoadedTileSize != TileSize)
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Tile size of %s (%s) is not the same as gametime system (%s)"), *SourceFile,
+			*LoadedTileSize.ToString(), *TileSize.ToString());
+		return false;
+	}
+	InitializeGametimeSystemFromData(WorldContextObject, StartupItemSet, LoadedData, {}, bUnbound);
+	return GametimeMode != Uninitialized;
+}
+
+bool UTiledLevelGametimeSystem::InitializeGametimeSystemFromSnapshot(const UObject* WorldContextObject, UTiledItemSet* StartupItemSet,
+	FString SourceFile, bool bUnbound)
+{
+	TUniquePtr<FTiledLevelSnapshot> Snapshot = MakeUnique<FTiledLevelSnapshot>();
+	if (!Snapshot->Open(SourceFile)) return false;
+	if (Snapshot->GetTileSize() != TileSize)
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Tile size of %s (%s) is not the same as gametime system (%s)"), *SourceFile,
+			*Snapshot->GetTileSize().ToString(), *TileSize.ToString());
+		return false;
+	}
+	InitializeGametimeSystemFromData(WorldContextObject, StartupItemSet, Snapshot->MakeEmptyGameData(), {}, bUnbound);
+	if (GametimeMode == Uninitialized) return false;
+	GametimeLevel->ResetAllInstanceFromSnapshot(*Snapshot);
+	GametimeLevel->ResetReplicatedPlacements(*Snapshot);
+	// no decoded copy of the whole snapshot, chunks are decoded into GametimeData when building, erasing or streaming touches them
+	Snapshot->BuildChunkIndex(StreamingChunkSize);
+	Snapshot->GetChunks(SnapshotChunks);
+	if (SnapshotChunks.Num() > 0)
+		GametimeSnapshot = MoveTemp(Snapshot);
+	InitStreaming();
+	return true;
+}
+
 bool UTiledLevelGametimeSystem::ChangeItemSet(UTiledItemSet* NewItemSet)
 {
 	if (NewItemSet->GetTileSize() != TileSize) return false;
@@ -411,26 +476,20 @@ void UTiledLevelGametimeSystem:: BuildItem()
 
 	switch (ShapeType) {
 		case Shape3D:
-			if (ActiveItem->PlacedType == EPlacedType::Block)
-				GametimeData.BlockPlacements.Add(NewTile);
-			else
-				GametimeData.FloorPlacements.Add(NewTile);
+			GametimeData.AddPlacement(NewTile, ActiveItem->PlacedType);
 			GametimeLevel->PopulateSinglePlacement(NewTile);
+			GametimeLevel->ReplicatePlacementAdded(FTiledNetPlacement(NewTile, ActiveItem->PlacedType));
 			break;
 		case Shape2D:
-			if (ActiveItem->PlacedType == EPlacedType::Edge)
-				GametimeData.EdgePlacements.Add(NewEdge);
-			else
-				GametimeData.WallPlacements.Add(NewEdge);
+			GametimeData.AddPlacement(NewEdge, ActiveItem->PlacedType);
 			GametimeLevel->PopulateSinglePlacement(NewEdge);
+			GametimeLevel->ReplicatePlacementAdded(FTiledNetPlacement(NewEdge, ActiveItem->PlacedType));
 			break;
 		case Shape1D:
 			// TargetLevel->GetAsset()->AddNewPointPlacement(NewPoint);
-			if (ActiveItem->PlacedType == EPlacedType::Point)
-				GametimeData.PointPlacements.Add(NewPoint);
-			else
-				GametimeData.PillarPlacements.Add(NewPoint);
+			GametimeData.AddPlacement(NewPoint, ActiveItem->PlacedType);
 			GametimeLevel->PopulateSinglePlacement(NewPoint);
+			GametimeLevel->ReplicatePlacementAdded(FTiledNetPlacement(NewPoint, ActiveItem->PlacedType));
 			break;
 	}
 	OnItemBuilt.Broadcast(ActiveItem, GetBuildLocation());
@@ -498,24 +557,26 @@ bool UTiledLevelGametimeSystem::RemoveItem_FromHit(const FHitResult& HitResult)
 		BuildPosition = GetBuildLocation(ShapeType, TilePosition, TileExtent);
 		// remove data 
 		HISM->GetInstanceTransform(HitResult.Item, PlacedTransform);
+		EnsureChunksLoaded(FIntVector(TilePosition), FIntVector(TilePosition));
 		GametimeData.RemovePlacement(PlacedTransform, HitItem->ItemID);
-		// remove that instance
-		HISM->RemoveInstance(HitResult.Item);
+		FTiledActorHandle RemovedHandle;
+		RemovedHandle.Position = FIntVector(TilePosition);
+		RemovedHandle.ItemID = HitItem->ItemID;
+		if (ShapeType == Shape3D)
+			RemovedHandle.ExtraInfo = FIntVector(TileExtent);
+		else if (ShapeType == Shape2D)
+			RemovedHandle.ExtraInfo.Z = static_cast<int32>(TileExtent.Z == -1? EEdgeType::Horizontal : EEdgeType::Vertical);
+		GametimeLevel->ReplicatePlacementRemoved(RemovedHandle, PlacedTransform);
+		// remove that instance, through the level so the lookup and navigation stay in sync
+		GametimeLevel->RemoveInstance(HISM, HitResult.Item);
 		OnItemRemoved.Broadcast(HitItem, BuildPosition);
 		return true;
 	}
 	if (HitResult.GetActor()->IsAttachedTo(GametimeLevel))
 	{
-		FGuid HitItemID;
-		FGuid::Parse(HitResult.GetActor()->Tags.Last().ToString(), HitItemID);
-		for (UTiledLevelItem* Item : SourceItemSet->GetItemSet())
-		{
-			 if (Item->ItemID == HitItemID)
-			 {
-				  HitItem = Item;
-				  break;
-			 }
-		}
+		const FTiledActorHandle* HitHandle = GametimeLevel->FindTiledActorHandle(HitResult.GetActor());
+		if (!HitHandle) return false;
+		HitItem = SourceItemSet->GetItem(HitHandle->ItemID);
 		if (!HitItem) return false;
 		if (!CanRemoveItem(HitItem) || IsRemoveRestricted(HitItem, HitResult.ImpactPoint))
 		{
@@ -523,9 +584,14 @@ bool UTiledLevelGametimeSystem::RemoveItem_FromHit(const FHitResult& HitResult)
 			return false;
 		}
 		ShapeType = FTiledLevelUtility::PlacedTypeToShape(HitItem->PlacedType);
-		int NumTags = HitResult.GetActor()->Tags.Num();
-		TilePosition.InitFromString(HitResult.GetActor()->Tags[NumTags - 3].ToString());
-		TileExtent.InitFromString(HitResult.GetActor()->Tags[NumTags - 2].ToString());
+		// same values as what used to be written in the tags
+		TilePosition = FVector(HitHandle->Position);
+		if (ShapeType == Shape3D)
+			TileExtent = FVector(HitHandle->ExtraInfo);
+		else if (ShapeType == Shape2D)
+			TileExtent = FVector(HitItem->Extent.X, HitItem->Extent.Z, HitHandle->ExtraInfo.Z == static_cast<int32>(EEdgeType::Horizontal)? -1 : 0);
+		else
+			TileExtent = HitItem->Extent;
 		BuildPosition = GetBuildLocation(ShapeType, TilePosition, TileExtent);
 		if (!CanRemoveItem(HitItem))
 		{
@@ -534,8 +600,14 @@ bool UTiledLevelGametimeSystem::RemoveItem_FromHit(const FHitResult& HitResult)
 		}
 		// remove data
 		PlacedTransform = HitResult.GetActor()->GetActorTransform().GetRelativeTransform(GametimeLevel->GetTransform());
+		EnsureChunksLoaded(HitHandle->Position, HitHandle->Position);
 		GametimeData.RemovePlacement(PlacedTransform, HitItem->ItemID);
+		GametimeLevel->ReplicatePlacementRemoved(*HitHandle, PlacedTransform);
 		// remove that instance
+		GametimeLevel->UnregisterTiledActor(HitResult.GetActor());
+		GametimeLevel->SpawnedTiledActors.Remove(HitResult.GetActor());
+		if (HitResult.GetActor()->IsA<ATiledLevelRestrictionHelper>())
+			GametimeLevel->MarkRestrictionIndexDirty();
 		HitResult.GetActor()->Destroy();
 		OnItemRemoved.Broadcast(HitItem, BuildPosition);
 		return true;
@@ -675,45 +747,29 @@ void UTiledLevelGametimeSystem::RotateEraser(bool bIsClockwise)
 void UTiledLevelGametimeSystem::EraseItem()
 {
 	if (!IsEraserMode) return;
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	TArray<FTilePlacement> TilesToDelete;
 	TArray<FEdgePlacement> EdgesToDelete;
 	TArray<FPointPlacement> PointsToDelete;
 
 	EPlacedShapeType EraserShape = FTiledLevelUtility::PlacedTypeToShape(EraserType);
+	const FIntVector EraserPosition = EraserShape == EPlacedShapeType::Shape2D && EraserType != EPlacedType::Any? CurrentEdge.GetEdgePosition() : CurrentTilePosition;
+	EnsureChunksLoaded(EraserPosition - EraserExtent, EraserPosition + EraserExtent);
 	if (EraserShape == EPlacedShapeType::Shape3D || EraserType == EPlacedType::Any)
 	{
-		TArray<FTilePlacement> TargetTilePlacements;
-		FTilePlacement TestPlacement;
-		TestPlacement.GridPosition = CurrentTilePosition;
-		TestPlacement.Extent = EraserExtent;
-		if (EraserType == EPlacedType::Any)
-		{
-			TargetTilePlacements.Append(GametimeData.BlockPlacements);
-			TargetTilePlacements.Append(GametimeData.FloorPlacements);
-		}
-		else if (EraserType == EPlacedType::Block)
-			TargetTilePlacements.Append(GametimeData.BlockPlacements);
-		else
-			TargetTilePlacements.Append(GametimeData.FloorPlacements);
+		const EPlacedType TargetType = EraserType == EPlacedType::Any || EraserType == EPlacedType::Block? EraserType : EPlacedType::Floor;
+		TArray<FTilePlacement> TargetTilePlacements = GametimeData.GetOccupancyIndex().FindOverlappingTiles(CurrentTilePosition, EraserExtent, TargetType);
 		for (FTilePlacement& Placement : TargetTilePlacements)
 		{
-			
-			if (FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Placement))
+			TilesToDelete.Add(Placement);
+			if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			{
-				TilesToDelete.Add(Placement);
-				if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
-				{
-					GametimeLevel->DestroyTiledActorByPlacement(Placement);
-				}
-				else
-				{
-					 UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-					 if (!TargetInstanceData.Contains(TiledMesh))				
-						  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
-					 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-					 FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],GametimeLevel->TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
-				}
+				GametimeLevel->DestroyTiledActorByPlacement(Placement);
+			}
+			else
+			{
+				 TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
+				 GametimeLevel->FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			}
 		}
 	}
@@ -722,40 +778,20 @@ void UTiledLevelGametimeSystem::EraseItem()
 	{
 		 TArray<FEdgePlacement> TargetEdgePlacements;
 		 if (EraserType == EPlacedType::Any)
-		 {
-			  TargetEdgePlacements.Append(GametimeData.WallPlacements);
-			  TargetEdgePlacements.Append(GametimeData.EdgePlacements);
-		 }
-		 else if (EraserType == EPlacedType::Wall)
-			  TargetEdgePlacements.Append(GametimeData.WallPlacements);
+			  TargetEdgePlacements = GametimeData.GetOccupancyIndex().FindEdgesInsideTile(CurrentTilePosition, EraserExtent);
 		 else
-			  TargetEdgePlacements.Append(GametimeData.EdgePlacements);
+			  TargetEdgePlacements = GametimeData.GetOccupancyIndex().FindOverlappingEdges(CurrentEdge, EraserExtent, EraserType == EPlacedType::Wall? EPlacedType::Wall : EPlacedType::Edge);
 		 for (FEdgePlacement& Placement : TargetEdgePlacements)
 		 {
-		 	  bool Con;
-		 	  if (EraserType == EPlacedType::Any)
-		 	  {
-			 	  Con = FTiledLevelUtility::IsEdgeInsideTile(Placement.Edge, FIntVector(Placement.GetItem()->Extent), CurrentTilePosition, EraserExtent);
-		 	  }
-		      else
-		      {
-		      	  Con = FTiledLevelUtility::IsEdgeOverlapping(CurrentEdge, FVector(EraserExtent), Placement.Edge, Placement.GetItem()->Extent);
-		      }
-			  if (Con)
+			  EdgesToDelete.Add(Placement);
+			  if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			  {
-				  EdgesToDelete.Add(Placement);
-				  if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
-				  {
-					   GametimeLevel->DestroyTiledActorByPlacement(Placement);
-				  }
-				  else
-				  {
-						UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-						if (!TargetInstanceData.Contains(TiledMesh))				
-							  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
-						TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-						FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],GametimeLevel->TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
-				  }
+				   GametimeLevel->DestroyTiledActorByPlacement(Placement);
+			  }
+			  else
+			  {
+					TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
+					GametimeLevel->FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			  }
 		 }
 	}
@@ -763,46 +799,33 @@ void UTiledLevelGametimeSystem::EraseItem()
 	if (EraserShape == EPlacedShapeType::Shape1D || EraserType == EPlacedType::Any)
 	{
 		 TArray<FPointPlacement> TargetPointPlacements;
-		 FPointPlacement TestPlacement;
-		 TestPlacement.GridPosition = CurrentTilePosition;
 		 if (EraserType == EPlacedType::Any)
-		 {
-			  TargetPointPlacements.Append(GametimeData.PillarPlacements);
-			  TargetPointPlacements.Append(GametimeData.PointPlacements);
-		 }
-		 else if (EraserType == EPlacedType::Pillar)
-			  TargetPointPlacements.Append(GametimeData.PillarPlacements);
+			  TargetPointPlacements = GametimeData.GetOccupancyIndex().FindPointsInsideTile(CurrentTilePosition, EraserExtent);
 		 else
-			  TargetPointPlacements.Append(GametimeData.PointPlacements);
+			  TargetPointPlacements = GametimeData.GetOccupancyIndex().FindOverlappingPoints(CurrentTilePosition, EraserExtent.Z, EraserType == EPlacedType::Pillar? EPlacedType::Pillar : EPlacedType::Point);
 		 for (FPointPlacement& Placement : TargetPointPlacements)
 		 {
-		 	  bool Con;
-		 	  if (EraserType == EPlacedType::Any)
-		 	  	  Con = FTiledLevelUtility::IsPointInsideTile(Placement.GridPosition, Placement.GetItem()->Extent.Z, CurrentTilePosition, EraserExtent);
-		 	  else
-			      Con = FTiledLevelUtility::IsPointPlacementOverlapping(TestPlacement, EraserExtent.Z, Placement, Placement.GetItem()->Extent.Z);
-		 	
-		 	  if (Con)
+			  PointsToDelete.Add(Placement);
+			  if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
 			  {
-				  PointsToDelete.Add(Placement);
-				  if (Placement.GetItem()->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
-				  {
-					   GametimeLevel->DestroyTiledActorByPlacement(Placement);
-				  }
-				  else
-				  {
-						UStaticMesh* TiledMesh = Placement.GetItem()->TiledMesh;
-						if (!TargetInstanceData.Contains(TiledMesh))				
-							  TargetInstanceData.Add(TiledMesh, TArray<int32>{});
-						TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-						FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[TiledMesh],GametimeLevel->TiledObjectSpawner[TiledMesh]->PerInstanceSMCustomData, TargetInfo);
-				  }
+				   GametimeLevel->DestroyTiledActorByPlacement(Placement);
+			  }
+			  else
+			  {
+					TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
+					GametimeLevel->FindInstanceIndexByPlacement(TargetInstanceData, Placement.GetItem()->TiledMesh, TargetInfo);
 			  }
 		 }
 	}
 	GametimeData.RemovePlacements(TilesToDelete);
 	GametimeData.RemovePlacements(EdgesToDelete);
 	GametimeData.RemovePlacements(PointsToDelete);
+	for (const FTilePlacement& P : TilesToDelete)
+		GametimeLevel->ReplicatePlacementRemoved(FTiledActorHandle(P), P.TileObjectTransform);
+	for (const FEdgePlacement& P : EdgesToDelete)
+		GametimeLevel->ReplicatePlacementRemoved(FTiledActorHandle(P), P.TileObjectTransform);
+	for (const FPointPlacement& P : PointsToDelete)
+		GametimeLevel->ReplicatePlacementRemoved(FTiledActorHandle(P), P.TileObjectTransform);
 	GametimeLevel->RemoveInstances(TargetInstanceData);
 }
 
@@ -817,12 +840,7 @@ UTiledLevelItem* UTiledLevelGametimeSystem::QueryItemByUID(FName ItemID)
 	FGuid UID;
 	FGuid::Parse(ItemID.ToString(), UID);
 	if (SourceItemSet)
-	{
-		return *SourceItemSet->GetItemSet().FindByPredicate([=](UTiledLevelItem* Item)
-		{
-			return Item->ItemID == UID;
-		});
-	}
+		return SourceItemSet->GetItem(UID);
 	return nullptr;
 }
 
@@ -831,6 +849,7 @@ void UTiledLevelGametimeSystem::FocusFloor(int FloorPosition)
 	GametimeData.SetFocusFloor(FloorPosition);
 	GametimeLevel->GametimeData = GametimeData;
 	// GametimeLevel->ResetAllInstance(GametimeData);
+	GametimeLevel->SetHiddenFloors(TSet<int32>(GametimeData.HiddenFloors));
 }
 
 void UTiledLevelGametimeSystem::UnfocusFloor()
@@ -838,6 +857,7 @@ void UTiledLevelGametimeSystem::UnfocusFloor()
 	GametimeData.HiddenFloors.Empty();
 	GametimeLevel->GametimeData = GametimeData;
 	// GametimeLevel->ResetAllInstance(GametimeData);
+	GametimeLevel->SetHiddenFloors(TSet<int32>(GametimeData.HiddenFloors));
 }
 
 bool UTiledLevelGametimeSystem::HasAnyFocusedFloor()
@@ -847,10 +867,27 @@ bool UTiledLevelGametimeSystem::HasAnyFocusedFloor()
 
 bool UTiledLevelGametimeSystem::SaveAsTiledLevelAsset(FString TargetFile)
 {
-	return false;
+	if (GametimeMode == Uninitialized) return false;
+	TArray<uint8> Bytes;
+	if (HasDataOutsideMemory())
+		GatherAllGametimeData().SaveToBinary(TileSize, Bytes);
+	else
+		GametimeData.SaveToBinary(TileSize, Bytes);
+	if (!FFileHelper::SaveArrayToFile(Bytes, *TargetFile))
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to save gametime data to %s"), *TargetFile);
+		return false;
+	}
+	return true;
 }
 
 
+bool UTiledLevelGametimeSystem::SaveAsSnapshot(FString TargetFile)
+{
+	if (GametimeMode == Uninitialized) return false;
+	return FTiledLevelSnapshot::Write(HasDataOutsideMemory()? GatherAllGametimeData() : GametimeData, TileSize, TargetFile);
+}
+
 FIntVector UTiledLevelGametimeSystem::GetTilePosition(FVector WorldLocation, bool& Found)
 {
 	FIntVector FoundPosition = FIntVector(-9999);
@@ -1096,54 +1133,40 @@ void UTiledLevelGametimeSystem::MoveEdgePreviewItem(FTiledLevelEdge NewEdge, boo
 bool UTiledLevelGametimeSystem::HasEnoughSpaceToBuild()
 {
 	if (!IsPreviewItemActivated()) return false;
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_RestrictionCheck);
 	
-	TArray<ATiledLevelRestrictionHelper*> Restrictions;
-	for (AActor* A : GametimeLevel->SpawnedTiledActors)
-	{
-		if (ATiledLevelRestrictionHelper* Arh = Cast<ATiledLevelRestrictionHelper>(A))
-		{
-			Restrictions.Add(Arh);
-		}
-	}
 	TArray<FIntVector> PointsToCheck;
 	if (ActiveItem->PlacedType == EPlacedType::Edge ||ActiveItem->PlacedType == EPlacedType::Wall)
 		PointsToCheck = FTiledLevelUtility::GetOccupiedPositions(ActiveItem, CurrentEdge);
 	else
 		PointsToCheck = FTiledLevelUtility::GetOccupiedPositions(ActiveItem, CurrentTilePosition, ShouldRotatePreviewBrush);
+	if (PointsToCheck.Num() > 0)
+	{
+		// overlap checks need the placements there, the build position can be far from any streaming source
+		FIntVector MinPosition = PointsToCheck[0];
+		FIntVector MaxPosition = PointsToCheck[0];
+		for (const FIntVector& P : PointsToCheck)
+		{
+			MinPosition = FIntVector(FMath::Min(MinPosition.X, P.X), FMath::Min(MinPosition.Y, P.Y), 0);
+			MaxPosition = FIntVector(FMath::Max(MaxPosition.X, P.X), FMath::Max(MaxPosition.Y, P.Y), 0);
+		}
+		EnsureChunksLoaded(MinPosition, MaxPosition);
+	}
 	
+	const FTiledRestrictionIndex& Restrictions = GametimeLevel->GetRestrictionIndex();
 	if (bLockBuild)
 	{
-		bool bPassBlockBuild = false;
 		// check if it is explicitly allowed building here 
-		for (ATiledLevelRestrictionHelper* Arh : Restrictions)
-		{
-			if (Arh->GetSourceItem()->RestrictionType == ERestrictionType::AllowBuilding || Arh->GetSourceItem()->RestrictionType == ERestrictionType::AllowBuildingAndRemoving)
-			{
-				if (Arh->GetSourceItem()->bTargetAllItems || Arh->GetSourceItem()->TargetItems.Contains(ActiveItem->ItemID))
-				{
-					if (Arh->IsInsideTargetedTilePositions(PointsToCheck))
-					{
-						bPassBlockBuild = true;
-						break;
-					}
-				}
-			}
-		}
-		if (!bPassBlockBuild)
+		if (!Restrictions.IsCovered(PointsToCheck, ERestrictionType::AllowBuilding, &ActiveItem->ItemID) &&
+			!Restrictions.IsCovered(PointsToCheck, ERestrictionType::AllowBuildingAndRemoving, &ActiveItem->ItemID))
 			return false;
 	}
 	else
 	{
 		// check if it is explicitly freeze building here
-		for (ATiledLevelRestrictionHelper* Arh : Restrictions)
-		{
-			if (Arh->GetSourceItem()->RestrictionType == ERestrictionType::DisallowBuilding || Arh->GetSourceItem()->RestrictionType == ERestrictionType::DisallowBuildingAndRemoving)
-			{
-				if (Arh->GetSourceItem()->bTargetAllItems || Arh->GetSourceItem()->TargetItems.Contains(ActiveItem->ItemID))
-					if (Arh->IsInsideTargetedTilePositions(PointsToCheck))
-						return false;
-			}
-		}
+		if (Restrictions.IsCovered(PointsToCheck, ERestrictionType::DisallowBuilding, &ActiveItem->ItemID) ||
+			Restrictions.IsCovered(PointsToCheck, ERestrictionType::DisallowBuildingAndRemoving, &ActiveItem->ItemID))
+			return false;
 	}
 	
 	EPlacedShapeType ActiveShape = FTiledLevelUtility::PlacedTypeToShape(ActiveItem->PlacedType);
@@ -1151,25 +1174,15 @@ bool UTiledLevelGametimeSystem::HasEnoughSpaceToBuild()
 	{
 	case Shape3D:
 		{
-			FTilePlacement TestPlacement;
-			TestPlacement.GridPosition = CurrentTilePosition;
 			const FIntVector ItemExtent = FIntVector(ActiveItem->Extent);
-			TestPlacement.Extent = ShouldRotatePreviewBrush? FIntVector(ItemExtent.Y, ItemExtent.X, ItemExtent.Z) : ItemExtent;
-			TArray<FTilePlacement> OverlappingPlacements;
+			const FIntVector TestExtent = ShouldRotatePreviewBrush? FIntVector(ItemExtent.Y, ItemExtent.X, ItemExtent.Z) : ItemExtent;
+			TArray<FTilePlacement> OverlappingPlacements = GametimeData.GetOccupancyIndex().FindOverlappingTiles(CurrentTilePosition, TestExtent, ActiveItem->PlacedType);
 			if (ActiveItem->PlacedType == EPlacedType::Block)
 			{
-				OverlappingPlacements = GametimeData.BlockPlacements.FilterByPredicate([=](const FTilePlacement& Block)
-				{
-					 // exclude special helpers from including as overlapped...
-					 if (Cast<UTiledLevelRestrictionItem>(Block.GetItem())) return false;
-					 return FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Block);
-				});
-			}
-			else
-			{
-				OverlappingPlacements = GametimeData.FloorPlacements.FilterByPredicate([=](const FTilePlacement& Floor)
+				// exclude special helpers from including as overlapped...
+				OverlappingPlacements.RemoveAll([](const FTilePlacement& Block)
 				{
-					 return FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Floor);
+					 return Cast<UTiledLevelRestrictionItem>(Block.GetItem()) != nullptr;
 				});
 			}
 			if (OverlappingPlacements.Num() == 0)
@@ -1185,25 +1198,7 @@ bool UTiledLevelGametimeSystem::HasEnoughSpaceToBuild()
 		}
 	case Shape2D:
 		{
-			FEdgePlacement TestPlacement;
-			TestPlacement.Edge = CurrentEdge;
-			TestPlacement.ItemSet = SourceItemSet;
-			TestPlacement.ItemID = ActiveItem->ItemID;
-			TArray<FEdgePlacement> OverlappingPlacements;
-			if (ActiveItem->PlacedType == EPlacedType::Wall)
-			{
-				OverlappingPlacements = GametimeData.WallPlacements.FilterByPredicate([=](const FEdgePlacement& Wall)
-				{
-						 return FTiledLevelUtility::IsEdgePlacementOverlapping(TestPlacement, Wall);
-				});
-			}
-			else
-			{
-				OverlappingPlacements = GametimeData.EdgePlacements.FilterByPredicate([=](const FEdgePlacement& Edge)
-				{
-						 return FTiledLevelUtility::IsEdgePlacementOverlapping(TestPlacement, Edge);
-				});
-			}
+			TArray<FEdgePlacement> OverlappingPlacements = GametimeData.GetOccupancyIndex().FindOverlappingEdges(CurrentEdge, FIntVector(ActiveItem->Extent), ActiveItem->PlacedType);
 			if (OverlappingPlacements.Num() == 0)
 				return true;
 			if (ActiveItem->StructureType == ETLStructureType::Structure)
@@ -1217,23 +1212,7 @@ bool UTiledLevelGametimeSystem::HasEnoughSpaceToBuild()
 		}
 	case Shape1D:
 		{
-			FPointPlacement TestPlacement;
-			TestPlacement.GridPosition = CurrentTilePosition;
-			TArray<FPointPlacement> OverlappingPlacements;
-			if (ActiveItem->PlacedType == EPlacedType::Pillar)
-			{
-			   OverlappingPlacements = GametimeData.PillarPlacements.FilterByPredicate([=](const FPointPlacement& Pillar)
-			   {
-			   		return FTiledLevelUtility::IsPointPlacementOverlapping(TestPlacement, ActiveItem->Extent.Z, Pillar, Pillar.GetItem()->Extent.Z );
-			   });
-			}
-			else
-			{
-			   OverlappingPlacements = GametimeData.PointPlacements.FilterByPredicate([=](const FPointPlacement& Point)
-			   {
-			   		return FTiledLevelUtility::IsPointPlacementOverlapping(TestPlacement, ActiveItem->Extent.Z, Point, Point.GetItem()->Extent.Z);
-			   });
-			}
+			TArray<FPointPlacement> OverlappingPlacements = GametimeData.GetOccupancyIndex().FindOverlappingPoints(CurrentTilePosition, ActiveItem->Extent.Z, ActiveItem->PlacedType);
 			if (OverlappingPlacements.Num() == 0)
 				return true;
 			if (ActiveItem->StructureType == ETLStructureType::Structure)
@@ -1252,49 +1231,22 @@ bool UTiledLevelGametimeSystem::HasEnoughSpaceToBuild()
 
 bool UTiledLevelGametimeSystem::IsRemoveRestricted(UTiledLevelItem* TestItem, FVector HitPosition)
 {
-	TArray<ATiledLevelRestrictionHelper*> Restrictions;
- 	for (AActor* A : GametimeLevel->SpawnedTiledActors)
- 	{
- 		if (ATiledLevelRestrictionHelper* Arh = Cast<ATiledLevelRestrictionHelper>(A))
- 		{
- 			Restrictions.Add(Arh);
- 		}
- 	}
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_RestrictionCheck);
 	const int X_mod = HitPosition.X < 0? -1 : 0;
 	const int Y_mod = HitPosition.Y < 0? -1 : 0;
 	const int Z_mod = HitPosition.Z < 0? -1 : 0;
 	const FIntVector PointToCheck = FIntVector(HitPosition / TileSize) + FIntVector(X_mod, Y_mod, Z_mod);
- 	TArray<FIntVector> PointsToCheck = { PointToCheck };
+	const TArrayView<const FIntVector> PointsToCheck(&PointToCheck, 1);
+	const FTiledRestrictionIndex& Restrictions = GametimeLevel->GetRestrictionIndex();
  	if (bLockRemove)
  	{
  		// check if it is explicitly allowed removing here 
- 		for (ATiledLevelRestrictionHelper* Arh : Restrictions)
- 		{
- 			if (Arh->GetSourceItem()->RestrictionType == ERestrictionType::AllowRemoving || Arh->GetSourceItem()->RestrictionType == ERestrictionType::AllowBuildingAndRemoving)
- 			{
- 				if (Arh->GetSourceItem()->bTargetAllItems || Arh->GetSourceItem()->TargetItems.Contains(TestItem->ItemID))
- 				{
-					 if (Arh->IsInsideTargetedTilePositions(PointsToCheck))
-					 {
-						   return false;
-					 }
- 				}
- 			}
- 		}
- 		return true;
+		return !Restrictions.IsCovered(PointsToCheck, ERestrictionType::AllowRemoving, &TestItem->ItemID) &&
+			!Restrictions.IsCovered(PointsToCheck, ERestrictionType::AllowBuildingAndRemoving, &TestItem->ItemID);
  	}
- 	// check if it is explicitly freeze removing here
- 	for (ATiledLevelRestrictionHelper* Arh : Restrictions)
- 	{
- 		if (Arh->GetSourceItem()->RestrictionType == ERestrictionType::DisallowRemoving || Arh->GetSourceItem()->RestrictionType == ERestrictionType::DisallowBuildingAndRemoving)
- 		{
- 			if (Arh->IsInsideTargetedTilePositions(PointsToCheck))
- 			{
- 				return true;
- 			}
- 		}
- 	}
-	return false;
+ 	// check if it is explicitly freeze removing here, for any item
+	return Restrictions.IsCovered(PointsToCheck, ERestrictionType::DisallowRemoving) ||
+		Restrictions.IsCovered(PointsToCheck, ERestrictionType::DisallowBuildingAndRemoving);
 }
 
 FVector UTiledLevelGametimeSystem::GetBuildLocation()
@@ -1340,3 +1292,393 @@ UWorld* UTiledLevelGametimeSystem::GetWorld() const
 	return Helper->GetWorld();
 }
 
+void UTiledLevelGametimeSystem::AddStreamingSource(AActor* Source)
+{
+	if (Source)
+		StreamingSources.AddUnique(Source);
+}
+
+void UTiledLevelGametimeSystem::RemoveStreamingSource(AActor* Source)
+{
+	StreamingSources.Remove(Source);
+}
+
+int32 UTiledLevelGametimeSystem::GetGametimeInstanceChunkSize() const
+{
+	// a streaming chunk owns the HISMs of its instances, so unloading it is just dropping them
+	return IsStreamingChunks()? StreamingChunkSize : GetDefault<UTiledLevelSettings>()->GametimeInstanceChunkSize;
+}
+
+/*
+ * A chunk file read or write. The file and the codec run on a worker, the result is applied on the game thread.
+ * There is at most one per chunk, so writes of the same file never overlap.
+ */
+struct FTiledChunkStreamingTask
+{
+	enum class EType : uint8 { Load, Save, Delete };
+	EType Type = EType::Load;
+	FIntPoint Chunk;
+	FString File;
+	FVector TileSize;
+	// the chunk to save (the worker only reads it), or the loaded chunk
+	FTiledLevelGameData Data;
+	// item sets the worker can resolve, a chunk using any other set keeps its bytes to be decoded on the game thread
+	TMap<FString, UTiledItemSet*> KnownItemSets;
+	TArray<uint8> Bytes;
+	bool bSucceeded = false;
+	TFuture<void> Future;
+
+	void Run()
+	{
+		switch (Type)
+		{
+		case EType::Load:
+		{
+			FVector ChunkTileSize;
+			bSucceeded = FFileHelper::LoadFileToArray(Bytes, *File) && Data.LoadFromBinary(Bytes, ChunkTileSize, &KnownItemSets);
+			if (bSucceeded)
+				Bytes.Empty();
+			break;
+		}
+		case EType::Save:
+			Data.SaveToBinary(TileSize, Bytes);
+			bSucceeded = FFileHelper::SaveArrayToFile(Bytes, *File);
+			Bytes.Empty();
+			break;
+		case EType::Delete:
+			bSucceeded = IFileManager::Get().Delete(*File);
+			break;
+		}
+	}
+};
+
+void UTiledLevelGametimeSystem::InitStreaming()
+{
+	if (!IsStreamingChunks() || !GametimeLevel) return;
+	if (StreamingDirectory.IsEmpty())
+		StreamingDirectory = FPaths::ProjectSavedDir() / TEXT("TiledLevelStreaming") / FGuid::NewGuid().ToString();
+	LoadedChunks.Empty();
+	GametimeData.GetChunks(StreamingChunkSize, LoadedChunks);
+	// their instances are populated already
+	LoadedChunks.Append(SnapshotChunks);
+	GametimeLevel->GetWorld()->GetTimerManager().SetTimer(StreamingTimer, this, &UTiledLevelGametimeSystem::UpdateStreaming, StreamingUpdateInterval, true);
+	UpdateStreaming();
+}
+
+void UTiledLevelGametimeSystem::ResetStreaming()
+{
+	if (UWorld* World = GetWorld())
+		World->GetTimerManager().ClearTimer(StreamingTimer);
+	// let running reads and writes finish before their files go away, the results are dropped
+	for (const TPair<FIntPoint, TSharedRef<FTiledChunkStreamingTask>>& Pair : ChunkTasks)
+		Pair.Value->Future.Wait();
+	ChunkTasks.Empty();
+	if (!StreamingDirectory.IsEmpty())
+		IFileManager::Get().DeleteDirectory(*StreamingDirectory, false, true);
+	StreamingDirectory.Empty();
+	LoadedChunks.Empty();
+	ChunksOnDisk.Empty();
+	StreamingItemSets.Empty();
+}
+
+void UTiledLevelGametimeSystem::UpdateStreaming()
+{
+	if (!IsStreamingChunks() || !GametimeLevel) return;
+
+	// source locations in tiled level space
+	TArray<FVector> Sources;
+	StreamingSources.RemoveAll([](const TWeakObjectPtr<AActor>& Source) { return !Source.IsValid(); });
+	for (const TWeakObjectPtr<AActor>& Source : StreamingSources)
+		Sources.Add(GametimeLevel->GetActorTransform().InverseTransformPosition(Source->GetActorLocation()));
+	for (FConstPlayerControllerIterator It = GametimeLevel->GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (It->IsValid() && (*It)->GetPawn())
+			Sources.Add(GametimeLevel->GetActorTransform().InverseTransformPosition((*It)->GetPawn()->GetActorLocation()));
+	}
+	// nobody around (ex: pawn not spawned yet), don't drop the whole world
+	if (Sources.Num() == 0) return;
+
+	const FVector2D ChunkExtent = FVector2D(TileSize.X, TileSize.Y) * StreamingChunkSize;
+	auto GetChunkBox = [&ChunkExtent](const FIntPoint& Chunk)
+	{
+		const FVector2D Min = FVector2D(Chunk.X * ChunkExtent.X, Chunk.Y * ChunkExtent.Y);
+		return FBox2D(Min, Min + ChunkExtent);
+	};
+
+	for (const FVector& Source : Sources)
+	{
+		const FIntPoint MinChunk(FMath::FloorToInt((Source.X - StreamingLoadRadius) / ChunkExtent.X), FMath::FloorToInt((Source.Y - StreamingLoadRadius) / ChunkExtent.Y));
+		const FIntPoint MaxChunk(FMath::FloorToInt((Source.X + StreamingLoadRadius) / ChunkExtent.X), FMath::FloorToInt((Source.Y + StreamingLoadRadius) / ChunkExtent.Y));
+		for (int32 Y = MinChunk.Y; Y <= MaxChunk.Y; Y++)
+		{
+			for (int32 X = MinChunk.X; X <= MaxChunk.X; X++)
+			{
+				if (GetChunkBox(FIntPoint(X, Y)).ComputeSquaredDistanceToPoint(FVector2D(Source)) <= FMath::Square(StreamingLoadRadius))
+					LoadChunk(FIntPoint(X, Y));
+			}
+		}
+	}
+
+	TArray<FIntPoint> ChunksToUnload;
+	for (const FIntPoint& Chunk : LoadedChunks)
+	{
+		const FBox2D ChunkBox = GetChunkBox(Chunk);
+		const bool bIsNear = Sources.ContainsByPredicate([&](const FVector& Source)
+		{
+			return ChunkBox.ComputeSquaredDistanceToPoint(FVector2D(Source)) <= FMath::Square(StreamingUnloadRadius);
+		});
+		if (!bIsNear)
+			ChunksToUnload.Add(Chunk);
+	}
+	for (const FIntPoint& Chunk : ChunksToUnload)
+		UnloadChunk(Chunk);
+}
+
+template <typename T>
+static void ReplicateChunkPlacements(ATiledLevel* Level, const TArray<T>& Placements, EPlacedType PlacedType, bool bAdded)
+{
+	for (const T& P : Placements)
+	{
+		if (bAdded)
+			Level->ReplicatePlacementAdded(FTiledNetPlacement(P, PlacedType));
+		else
+			Level->ReplicatePlacementRemoved(FTiledActorHandle(P), P.TileObjectTransform);
+	}
+}
+
+static void ReplicateChunk(ATiledLevel* Level, const FTiledLevelGameData& ChunkData, bool bAdded)
+{
+	ReplicateChunkPlacements(Level, ChunkData.BlockPlacements, EPlacedType::Block, bAdded);
+	ReplicateChunkPlacements(Level, ChunkData.FloorPlacements, EPlacedType::Floor, bAdded);
+	ReplicateChunkPlacements(Level, ChunkData.WallPlacements, EPlacedType::Wall, bAdded);
+	ReplicateChunkPlacements(Level, ChunkData.EdgePlacements, EPlacedType::Edge, bAdded);
+	ReplicateChunkPlacements(Level, ChunkData.PillarPlacements, EPlacedType::Pillar, bAdded);
+	ReplicateChunkPlacements(Level, ChunkData.PointPlacements, EPlacedType::Point, bAdded);
+}
+
+void UTiledLevelGametimeSystem::LoadChunk(const FIntPoint& Chunk)
+{
+	if (LoadedChunks.Contains(Chunk)) return;
+	if (const TSharedRef<FTiledChunkStreamingTask>* Pending = ChunkTasks.Find(Chunk))
+	{
+		const FTiledChunkStreamingTask& Task = Pending->Get();
+		// a load in flight is applied when it is done
+		if (Task.Type == FTiledChunkStreamingTask::EType::Load) return;
+		// still being saved or deleted, take it back from memory
+		LoadedChunks.Add(Chunk);
+		if (Task.Type == FTiledChunkStreamingTask::EType::Save)
+			AddChunkData(Task.Data);
+		return;
+	}
+	if (!ChunksOnDisk.Contains(Chunk))
+	{
+		LoadedChunks.Add(Chunk);
+		return;
+	}
+
+	TSharedRef<FTiledChunkStreamingTask> Task = MakeShared<FTiledChunkStreamingTask>();
+	Task->Type = FTiledChunkStreamingTask::EType::Load;
+	Task->Chunk = Chunk;
+	Task->File = GetChunkFile(Chunk);
+	for (UTiledItemSet* ItemSet : StreamingItemSets)
+		Task->KnownItemSets.Add(GetPathNameSafe(ItemSet), ItemSet);
+	StartChunkTask(Task);
+}
+
+void UTiledLevelGametimeSystem::UnloadChunk(const FIntPoint& Chunk)
+{
+	// its last save is still running, try again next update
+	if (ChunkTasks.Contains(Chunk)) return;
+	DecodeSnapshotChunk(Chunk);
+	FTiledLevelGameData ChunkData = GametimeData.TakeChunk(Chunk, StreamingChunkSize);
+	LoadedChunks.Remove(Chunk);
+	GametimeLevel->UnloadInstanceChunk(Chunk, ChunkData);
+	ReplicateChunk(GametimeLevel, ChunkData, false);
+
+	TSharedRef<FTiledChunkStreamingTask> Task = MakeShared<FTiledChunkStreamingTask>();
+	Task->Chunk = Chunk;
+	Task->File = GetChunkFile(Chunk);
+	Task->TileSize = TileSize;
+	if (ChunkData.Num() == 0)
+	{
+		// everything in it was removed since it was loaded
+		if (ChunksOnDisk.Remove(Chunk) == 0) return;
+		Task->Type = FTiledChunkStreamingTask::EType::Delete;
+	}
+	else
+	{
+		// keep its item sets alive while the worker encodes them, and known when it is loaded back
+		TSet<UTiledItemSet*> ItemSets;
+		ChunkData.GetItemSets(ItemSets);
+		for (UTiledItemSet* ItemSet : ItemSets)
+			StreamingItemSets.AddUnique(ItemSet);
+		Task->Type = FTiledChunkStreamingTask::EType::Save;
+		Task->Data = MoveTemp(ChunkData);
+	}
+	StartChunkTask(Task);
+}
+
+void UTiledLevelGametimeSystem::AddChunkData(const FTiledLevelGameData& ChunkData)
+{
+	GametimeData.AppendChunk(ChunkData);
+	GametimeLevel->PopulatePlacements(ChunkData.BlockPlacements);
+	GametimeLevel->PopulatePlacements(ChunkData.FloorPlacements);
+	GametimeLevel->PopulatePlacements(ChunkData.WallPlacements);
+	GametimeLevel->PopulatePlacements(ChunkData.EdgePlacements);
+	GametimeLevel->PopulatePlacements(ChunkData.PillarPlacements);
+	GametimeLevel->PopulatePlacements(ChunkData.PointPlacements);
+	ReplicateChunk(GametimeLevel, ChunkData, true);
+}
+
+void UTiledLevelGametimeSystem::StartChunkTask(const TSharedRef<FTiledChunkStreamingTask>& Task)
+{
+	ChunkTasks.Add(Task->Chunk, Task);
+	TWeakObjectPtr<UTiledLevelGametimeSystem> WeakSystem(this);
+	Task->Future = Async(EAsyncExecution::ThreadPool, [Task, WeakSystem]()
+	{
+		Task->Run();
+		AsyncTask(ENamedThreads::GameThread, [Task, WeakSystem]()
+		{
+			if (UTiledLevelGametimeSystem* System = WeakSystem.Get())
+				System->FinishChunkTask(Task);
+		});
+	});
+}
+
+void UTiledLevelGametimeSystem::FinishChunkTask(const TSharedRef<FTiledChunkStreamingTask>& Task)
+{
+	// already finished by WaitForChunkTask, or dropped by ResetStreaming
+	const TSharedRef<FTiledChunkStreamingTask>* Current = ChunkTasks.Find(Task->Chunk);
+	if (!Current || *Current != Task) return;
+	ChunkTasks.Remove(Task->Chunk);
+
+	const FIntPoint Chunk = Task->Chunk;
+	switch (Task->Type)
+	{
+	case FTiledChunkStreamingTask::EType::Load:
+		if (!Task->bSucceeded && Task->Bytes.Num() > 0)
+		{
+			// it uses an item set the worker could not resolve, loading objects has to happen here
+			FVector ChunkTileSize;
+			Task->bSucceeded = Task->Data.LoadFromBinary(Task->Bytes, ChunkTileSize);
+			TSet<UTiledItemSet*> ItemSets;
+			Task->Data.GetItemSets(ItemSets);
+			for (UTiledItemSet* ItemSet : ItemSets)
+				StreamingItemSets.AddUnique(ItemSet);
+		}
+		LoadedChunks.Add(Chunk);
+		if (Task->bSucceeded)
+		{
+			AddChunkData(Task->Data);
+		}
+		else
+		{
+			UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to load streaming chunk %s from %s"), *Chunk.ToString(), *Task->File);
+			ChunksOnDisk.Remove(Chunk);
+		}
+		break;
+	case FTiledChunkStreamingTask::EType::Save:
+		if (Task->bSucceeded)
+		{
+			ChunksOnDisk.Add(Chunk);
+		}
+		else
+		{
+			// bring it back rather than losing it, unless it is loaded again already
+			UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to save streaming chunk %s to %s"), *Chunk.ToString(), *Task->File);
+			if (!LoadedChunks.Contains(Chunk))
+			{
+				LoadedChunks.Add(Chunk);
+				AddChunkData(Task->Data);
+			}
+		}
+		break;
+	case FTiledChunkStreamingTask::EType::Delete:
+		if (!Task->bSucceeded)
+			UE_LOG(LogTiledLevelDev, Warning, TEXT("Failed to delete empty streaming chunk file %s"), *Task->File);
+		break;
+	}
+	// the completion queued for the game thread may still hold the task for a while
+	Task->Data = FTiledLevelGameData();
+	Task->Bytes.Empty();
+}
+
+void UTiledLevelGametimeSystem::WaitForChunkTask(const FIntPoint& Chunk)
+{
+	const TSharedRef<FTiledChunkStreamingTask>* Pending = ChunkTasks.Find(Chunk);
+	if (!Pending) return;
+	const TSharedRef<FTiledChunkStreamingTask> Task = *Pending;
+	Task->Future.Wait();
+	FinishChunkTask(Task);
+}
+
+void UTiledLevelGametimeSystem::FlushStreaming()
+{
+	TArray<FIntPoint> PendingChunks;
+	ChunkTasks.GetKeys(PendingChunks);
+	for (const FIntPoint& Chunk : PendingChunks)
+		WaitForChunkTask(Chunk);
+}
+
+void UTiledLevelGametimeSystem::EnsureChunksLoaded(const FIntVector& MinPosition, const FIntVector& MaxPosition)
+{
+	if (!IsStreamingChunks() && SnapshotChunks.Num() == 0) return;
+	// placements are filed under the chunk of their position only, but a footprint can cross into the next chunk
+	// (tiles and pillars reach +X/+Y, edges reach -1 on their side), so load the ring around the range as well.
+	// one ring is enough as long as no item is wider than a chunk
+	const FIntPoint MinChunk = FTiledLevelGameData::GetChunk(MinPosition, StreamingChunkSize) - FIntPoint(1, 1);
+	const FIntPoint MaxChunk = FTiledLevelGameData::GetChunk(MaxPosition, StreamingChunkSize) + FIntPoint(1, 1);
+	for (int32 Y = MinChunk.Y; Y <= MaxChunk.Y; Y++)
+	{
+		for (int32 X = MinChunk.X; X <= MaxChunk.X; X++)
+		{
+			DecodeSnapshotChunk(FIntPoint(X, Y));
+			if (!IsStreamingChunks()) continue;
+			LoadChunk(FIntPoint(X, Y));
+			// needed right now, don't wait for the game thread to pick it up
+			if (!LoadedChunks.Contains(FIntPoint(X, Y)))
+				WaitForChunkTask(FIntPoint(X, Y));
+		}
+	}
+}
+
+void UTiledLevelGametimeSystem::DecodeSnapshotChunk(const FIntPoint& Chunk)
+{
+	if (!GametimeSnapshot || SnapshotChunks.Remove(Chunk) == 0) return;
+	GametimeData.AppendChunk(GametimeSnapshot->DecodeChunk(Chunk));
+	// everything is decoded, the file is not needed anymore
+	if (SnapshotChunks.Num() == 0)
+		GametimeSnapshot.Reset();
+}
+
+FString UTiledLevelGametimeSystem::GetChunkFile(const FIntPoint& Chunk) const
+{
+	return StreamingDirectory / FString::Printf(TEXT("Chunk_%d_%d.tlgd"), Chunk.X, Chunk.Y);
+}
+
+FTiledLevelGameData UTiledLevelGametimeSystem::GatherAllGametimeData() const
+{
+	FTiledLevelGameData AllData = GametimeData;
+	for (const FIntPoint& Chunk : SnapshotChunks)
+		AllData.AppendChunk(GametimeSnapshot->DecodeChunk(Chunk));
+	for (const TPair<FIntPoint, TSharedRef<FTiledChunkStreamingTask>>& Pair : ChunkTasks)
+	{
+		// its file is still being written
+		if (Pair.Value->Type == FTiledChunkStreamingTask::EType::Save && !LoadedChunks.Contains(Pair.Key))
+			AllData += Pair.Value->Data;
+	}
+	for (const FIntPoint& Chunk : ChunksOnDisk)
+	{
+		if (LoadedChunks.Contains(Chunk)) continue;
+		const TSharedRef<FTiledChunkStreamingTask>* Pending = ChunkTasks.Find(Chunk);
+		if (Pending && (*Pending)->Type == FTiledChunkStreamingTask::EType::Save) continue;
+		TArray<uint8> Bytes;
+		FTiledLevelGameData ChunkData;
+		FVector ChunkTileSize;
+		if (FFileHelper::LoadFileToArray(Bytes, *GetChunkFile(Chunk)) && ChunkData.LoadFromBinary(Bytes, ChunkTileSize))
+			AllData += ChunkData;
+		else
+			UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to read streaming chunk %s, it is missing from the saved data"), *Chunk.ToString());
+	}
+	return AllData;
+}
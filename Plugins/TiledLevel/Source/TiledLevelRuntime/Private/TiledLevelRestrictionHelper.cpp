@@ -5,7 +5,9 @@
 #include "ProceduralMeshComponent.h"
 #include "TiledItemSet.h"
 #include "TiledLevelItem.h"
+#include "TiledLevelStats.h"
 #include "Materials/MaterialInstanceDynamic.h"
+#include "UObject/ConstructorHelpers.h"
 
 
 // Sets default values
@@ -17,6 +19,19 @@ ATiledLevelRestrictionHelper::ATiledLevelRestrictionHelper()
 	SetRootComponent(Root);
 	AreaHint = CreateDefaultSubobject<UProceduralMeshComponent>(TEXT("AreaHint"));
 	AreaHint->SetupAttachment(Root);
+
+	// resolve the outline material once instead of on every visual update
+	ConstructorHelpers::FObjectFinder<UMaterialInterface> Asset_M_UVOutline(TEXT("/TiledLevel/Materials/M_UVOutline"));
+	M_AreaHintBase = Asset_M_UVOutline.Object;
+}
+
+void ATiledLevelRestrictionHelper::ApplyAreaHintMaterial()
+{
+	if (!M_AreaHint)
+		M_AreaHint = UMaterialInstanceDynamic::Create(M_AreaHintBase, this);
+	M_AreaHint->SetVectorParameterValue("BorderColor", GetSourceItem()->BorderColor);
+	M_AreaHint->SetScalarParameterValue("BorderWidth", GetSourceItem()->BorderWidth);
+	AreaHint->SetMaterial(0, M_AreaHint);
 }
 
 
@@ -33,11 +48,7 @@ void ATiledLevelRestrictionHelper::UpdatePreviewVisual()
 	TArray<FColor> VertexColors; 
 	AreaHint->CreateMeshSection(0, Vertices, Triangles, Normals, UVs, VertexColors, Tangents, false);
 	// Set material to the color user specified...
-	UMaterialInterface* M_Base = LoadObject<UMaterialInterface>(NULL, TEXT("/TiledLevel/Materials/M_UVOutline"), NULL, 0, NULL);
-	M_AreaHint = UMaterialInstanceDynamic::Create(M_Base, this);
-	M_AreaHint->SetVectorParameterValue("BorderColor", GetSourceItem()->BorderColor);
-	M_AreaHint->SetScalarParameterValue("BorderWidth", GetSourceItem()->BorderWidth);
-	AreaHint->SetMaterial(0, M_AreaHint);
+	ApplyAreaHintMaterial();
 	AreaHint->SetHiddenInGame(GetSourceItem()->bHiddenInGame);
 }
 
@@ -88,147 +99,202 @@ void ATiledLevelRestrictionHelper::UpdateVisual()
 	SetActorTransform(GetAttachParentActor()->GetActorTransform()); // make sure transform is the same as parent tiled level actor
 	AreaHint->ClearAllMeshSections();
 	
-	struct FCubeFace
+	TArray<FVector> Vertices;
+	TArray<int32> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UVs;
+	TArray<FProcMeshTangent> Tangents;
+	TArray<FColor> VertexColors;
+	BuildAreaHintMesh(TargetedTilePositions, SourceItemSet->GetTileSize(), Vertices, Triangles, Normals, UVs);
+	// TODO: options to add padding? 
+	AreaHint->CreateMeshSection(0, Vertices, Triangles, Normals, UVs, VertexColors, Tangents, false);
+	ApplyAreaHintMaterial();
+}
+
+/*
+ * Greedy meshing: exposed cube faces are found with set lookups, grouped per plane, then each plane is
+ * covered by as few rectangles as possible (grow along U, then along V while the whole row is still there).
+ * Every rectangle is sliced 3x3 with half tile borders, UV goes 0 -> 0.5 -> 0.5 -> 1, so the outline
+ * material draws the same border width as a single tile face does, no matter how large the rectangle is.
+ * Border slices only get the 0 / 1 side where the region really ends, sides touching another rectangle stay at 0.5
+ * (sides half open are cut where that changes), so the outline is the region outline and not the rectangles.
+ */
+void ATiledLevelRestrictionHelper::BuildAreaHintMesh(const TArray<FIntVector>& Positions, const FVector& TileSize,
+	TArray<FVector>& OutVertices, TArray<int32>& OutTriangles, TArray<FVector>& OutNormals, TArray<FVector2D>& OutUVs)
+{
+	const TSet<FIntVector> Cells(Positions);
+	// face axis -> the two in plane axes
+	const int32 UAxes[3] = {1, 0, 0};
+	const int32 VAxes[3] = {2, 2, 1};
+
+	for (int32 Axis = 0; Axis < 3; Axis++)
 	{
-		FIntVector P0, P1, P2, P3;
-		FVector2D UV0, UV1, UV2, UV3;
-		FVector FaceNormal;
-		
-		FCubeFace(const FIntVector& InP0, const FIntVector& InP1, const FIntVector& InP2, const FIntVector& InP3, FVector InFaceNormal )
-			: P0(InP0), P1(InP1), P2(InP2), P3(InP3), FaceNormal(InFaceNormal)
-		{}
-
-		void SetUV(FVector2D InUV0, FVector2D InUV1, FVector2D InUV2, FVector2D InUV3)
-		{
-			UV0 = InUV0;
-			UV1 = InUV1;
-			UV2 = InUV2;
-			UV3 = InUV3;
-		}
-		
-		bool operator==(const FCubeFace Other) const
+		const int32 UAxis = UAxes[Axis];
+		const int32 VAxis = VAxes[Axis];
+		for (int32 Sign = -1; Sign <= 1; Sign += 2)
 		{
-			TArray<FIntVector> Ps = {P0, P1, P2, P3};
-			return Ps.Contains(Other.P0) && Ps.Contains(Other.P1) && Ps.Contains(Other.P2) && Ps.Contains(Other.P3);
+			FIntVector Step(0);
+			Step[Axis] = Sign;
+			// plane coordinate -> exposed faces on it, in (U, V)
+			TMap<int32, TSet<FIntPoint>> Planes;
+			for (const FIntVector& Cell : Cells)
+			{
+				if (Cells.Contains(Cell + Step)) continue;
+				Planes.FindOrAdd(Cell[Axis] + (Sign > 0 ? 1 : 0)).Add(FIntPoint(Cell[UAxis], Cell[VAxis]));
+			}
+
+			FVector Normal(0);
+			Normal[Axis] = Sign;
+			FVector UDir(0), VDir(0);
+			UDir[UAxis] = TileSize[UAxis];
+			VDir[VAxis] = TileSize[VAxis];
+			// front faces wind clockwise seen from the outside
+			const bool bFlip = FVector::DotProduct(FVector::CrossProduct(UDir, VDir), Normal) > 0;
+
+			for (TPair<int32, TSet<FIntPoint>>& Plane : Planes)
+			{
+				// all faces of the plane, the working set below loses the ones already covered
+				const TSet<FIntPoint> PlaneFaces = Plane.Value;
+				TArray<FIntPoint> Starts = Plane.Value.Array();
+				Starts.Sort([](const FIntPoint& A, const FIntPoint& B) { return A.Y == B.Y ? A.X < B.X : A.Y < B.Y; });
+				TSet<FIntPoint>& Faces = Plane.Value;
+				FVector Origin(0);
+				Origin[Axis] = Plane.Key * TileSize[Axis];
+
+				for (const FIntPoint& Start : Starts)
+				{
+					if (!Faces.Contains(Start)) continue;
+					int32 Width = 1;
+					while (Faces.Contains(Start + FIntPoint(Width, 0)))
+						Width++;
+					int32 Height = 1;
+					for (bool bRowFull = true; bRowFull; )
+					{
+						for (int32 U = 0; U < Width && bRowFull; U++)
+							bRowFull = Faces.Contains(Start + FIntPoint(U, Height));
+						if (bRowFull)
+							Height++;
+					}
+					for (int32 V = 0; V < Height; V++)
+						for (int32 U = 0; U < Width; U++)
+							Faces.Remove(Start + FIntPoint(U, V));
+
+					// region continues past the side, per tile along it
+					auto IsOpen = [&PlaneFaces, &Start](int32 U, int32 V) { return PlaneFaces.Contains(Start + FIntPoint(U, V)); };
+					// 3x3 slices, or 2 slices on a side only one tile long, plus cuts where a side turns from open to closed
+					auto MakeCuts = [](int32 Length, TFunctionRef<bool(int32)> IsSideChanged)
+					{
+						TArray<float, TInlineAllocator<8>> Cuts = {0.f, 0.5f};
+						for (int32 i = 1; i < Length; i++)
+						{
+							if (IsSideChanged(i))
+								Cuts.Add((float)i);
+						}
+						if (Length > 1)
+							Cuts.Add(Length - 0.5f);
+						Cuts.Add((float)Length);
+						return Cuts;
+					};
+					const TArray<float, TInlineAllocator<8>> UCuts = MakeCuts(Width, [&](int32 U)
+					{
+						return IsOpen(U, -1) != IsOpen(U - 1, -1) || IsOpen(U, Height) != IsOpen(U - 1, Height);
+					});
+					const TArray<float, TInlineAllocator<8>> VCuts = MakeCuts(Height, [&](int32 V)
+					{
+						return IsOpen(-1, V) != IsOpen(-1, V - 1) || IsOpen(Width, V) != IsOpen(Width, V - 1);
+					});
+					// texture range of a slice along one axis, an open side goes on into the next rectangle so it gets no border
+					auto GetTex = [](float From, float To, int32 Length, bool bStartOpen, bool bEndOpen)
+					{
+						if (To <= 0.5f)
+							return FVector2D(bStartOpen? 0.5f : 0.f, 0.5f);
+						if (From >= Length - 0.5f)
+							return FVector2D(0.5f, bEndOpen? 0.5f : 1.f);
+						return FVector2D(0.5f, 0.5f);
+					};
+
+					const FVector Corner = Origin + UDir * Start.X + VDir * Start.Y;
+					for (int32 j = 0; j < VCuts.Num() - 1; j++)
+					{
+						const int32 Row = FMath::Min((int32)VCuts[j], Height - 1);
+						for (int32 i = 0; i < UCuts.Num() - 1; i++)
+						{
+							const int32 Column = FMath::Min((int32)UCuts[i], Width - 1);
+							const FVector2D UTex = GetTex(UCuts[i], UCuts[i + 1], Width, IsOpen(-1, Row), IsOpen(Width, Row));
+							const FVector2D VTex = GetTex(VCuts[j], VCuts[j + 1], Height, IsOpen(Column, -1), IsOpen(Column, Height));
+							// own vertices per slice, the same corner can have different UVs in the slices around it
+							const int32 I00 = OutVertices.Num();
+							for (int32 dV = 0; dV < 2; dV++)
+							{
+								for (int32 dU = 0; dU < 2; dU++)
+								{
+									OutVertices.Add(Corner + UDir * UCuts[i + dU] + VDir * VCuts[j + dV]);
+									OutNormals.Add(Normal);
+									OutUVs.Add(FVector2D(UTex[dU], VTex[dV]));
+								}
+							}
+							const int32 I10 = I00 + 1;
+							const int32 I01 = I00 + 2;
+							const int32 I11 = I00 + 3;
+							if (bFlip)
+								OutTriangles.Append({I00, I01, I10, I10, I01, I11});
+							else
+								OutTriangles.Append({I00, I10, I01, I01, I10, I11});
+						}
+					}
+				}
+			}
 		}
-	};
-
-	TArray<FCubeFace> CubeFaces;
-	const FIntVector Xp1 = {1, 0, 0};
-	const FIntVector Yp1 = {0, 1, 0};
-	const FIntVector Zp1 = {0, 0, 1};
-	const FIntVector XYp1 = {1, 1, 0};
-	const FIntVector YZp1 = {0, 1, 1};
-	const FIntVector XZp1 = {1, 0, 1};
-	const FIntVector XYZp1 = {1, 1, 1};
-	for (FIntVector Position : TargetedTilePositions)
+	}
+}
+
+void FTiledRestrictionIndex::Build(const TArray<AActor*>& SpawnedActors)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_RestrictionIndexBuild);
+	Rules.Empty();
+	Cells.Empty();
+	for (AActor* A : SpawnedActors)
 	{
-		// The six faces
-		//front
-		FCubeFace FrontFace(Position, Position+Yp1,Position+Zp1, Position+YZp1, {1.f, 0.f, 0.f});
-		FrontFace.SetUV({0.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {1.f, 1.f});
-		if (CubeFaces.Contains(FrontFace))
+		ATiledLevelRestrictionHelper* Arh = Cast<ATiledLevelRestrictionHelper>(A);
+		if (!Arh) continue;
+		const UTiledLevelRestrictionItem* Item = Arh->GetSourceItem();
+		if (!Item) continue;
+		const int32 RuleIndex = Rules.Num();
+		FRule& Rule = Rules.AddDefaulted_GetRef();
+		Rule.bTargetAllItems = Item->bTargetAllItems;
+		Rule.TargetItems = TSet<FGuid>(Item->TargetItems);
+		for (const FIntVector& P : Arh->TargetedTilePositions)
 		{
-			CubeFaces.Remove(FrontFace);
-		}
-		else
-		{
-			CubeFaces.Add(FrontFace);
-		}
-		
-		//back
-		FCubeFace BackFace(Position+Xp1, Position+XYp1,Position+XZp1, Position+XYZp1, {-1.f, 0.f, 0.f});
-		BackFace.SetUV({0.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {1.f, 1.f});
-		if (CubeFaces.Contains(BackFace))
-		{
-			CubeFaces.Remove(BackFace);
-		}
-		else
-		{
-			CubeFaces.Add(BackFace);
-		}
-		//right
-		FCubeFace RightFace(Position+Yp1, Position+XYp1,Position+YZp1, Position+XYZp1, {0.f, 1.f, 0.f});
-		RightFace.SetUV({0.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {1.f, 1.f});
-		if (CubeFaces.Contains(RightFace))
-		{
-			CubeFaces.Remove(RightFace);
-		}
-		else
-		{
-			CubeFaces.Add(RightFace);
-		}
-		//left
-		FCubeFace LeftFace(Position, Position+Xp1,Position+Zp1, Position+XZp1, {0.f, -1.f, 0.f});
-		LeftFace.SetUV({0.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {1.f, 1.f});
-		if (CubeFaces.Contains(LeftFace))
-		{
-			CubeFaces.Remove(LeftFace);
-		}
-		else
-		{
-			CubeFaces.Add(LeftFace);
-		}
-		//top
-		FCubeFace TopFace(Position+Zp1, Position+XZp1,Position+YZp1, Position+XYZp1, {0.f, 0.f, 1.f});
-		TopFace.SetUV({0.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {1.f, 1.f});
-		if (CubeFaces.Contains(TopFace))
-		{
-			CubeFaces.Remove(TopFace);
-		}
-		else
-		{
-			CubeFaces.Add(TopFace);
-		}
-		//bottom
-		FCubeFace BottomFace(Position, Position+Xp1,Position+Yp1, Position+XYp1, {0.f, 0.f, -1.f});
-		BottomFace.SetUV({0.f, 0.f}, {1.f, 0.f}, {0.f, 1.f}, {1.f, 1.f});
-		if (CubeFaces.Contains(BottomFace))
-		{
-			CubeFaces.Remove(BottomFace);
-		}
-		else
-		{
-			CubeFaces.Add(BottomFace);
+			TArray<int32, TInlineAllocator<1>>& CellRules = Cells.FindOrAdd(TPair<int32, ERestrictionType>(P.Z, Item->RestrictionType)).FindOrAdd(FIntPoint(P.X, P.Y));
+			CellRules.AddUnique(RuleIndex);
 		}
 	}
-	// now, there is no duplicate face, let create triangles and normals...
-	TArray<FVector> Vertices;
-	TArray<int32> Triangles;
-	TArray<FVector> Normals;
-	TArray<FVector2D> UVs;
-	TArray<FProcMeshTangent> Tangents;
-	TArray<FColor> VertexColors;
-	const FVector TileSize = SourceItemSet->GetTileSize();
-	int FaceCount = 0;
-	for (FCubeFace Face : CubeFaces)
+}
+
+bool FTiledRestrictionIndex::IsCovered(TArrayView<const FIntVector> Positions, ERestrictionType RestrictionType, const FGuid* TargetItemID) const
+{
+	INC_DWORD_STAT_BY(STAT_TiledLevel_RestrictionChecks, Positions.Num());
+	if (Cells.Num() == 0) return false;
+	for (const FIntVector& P : Positions)
 	{
-		Vertices.Add(FVector(Face.P0)*TileSize);
-		Vertices.Add(FVector(Face.P1)*TileSize);
-		Vertices.Add(FVector(Face.P2)*TileSize);
-		Vertices.Add(FVector(Face.P3)*TileSize);
-		Triangles.Add(FaceCount * 4 + 0);
-		Triangles.Add(FaceCount * 4 + 1);
-		Triangles.Add(FaceCount * 4 + 2);
-		Triangles.Add(FaceCount * 4 + 2);
-		Triangles.Add(FaceCount * 4 + 1);
-		Triangles.Add(FaceCount * 4 + 3);
-		Normals.Add(Face.FaceNormal);
-		Normals.Add(Face.FaceNormal);
-		Normals.Add(Face.FaceNormal);
-		Normals.Add(Face.FaceNormal);
-		UVs.Add(Face.UV0);
-		UVs.Add(Face.UV1);
-		UVs.Add(Face.UV2);
-		UVs.Add(Face.UV3);
-		FaceCount++;
+		const TMap<FIntPoint, TArray<int32, TInlineAllocator<1>>>* FloorCells = Cells.Find(TPair<int32, ERestrictionType>(P.Z, RestrictionType));
+		if (!FloorCells) continue;
+		const TArray<int32, TInlineAllocator<1>>* CellRules = FloorCells->Find(FIntPoint(P.X, P.Y));
+		if (!CellRules) continue;
+		for (int32 RuleIndex : *CellRules)
+		{
+			const FRule& Rule = Rules[RuleIndex];
+			if (!TargetItemID || Rule.bTargetAllItems || Rule.TargetItems.Contains(*TargetItemID))
+				return true;
+		}
 	}
-      
-	// TODO: options to add padding? 
-	AreaHint->CreateMeshSection(0, Vertices, Triangles, Normals, UVs, VertexColors, Tangents, false);
-	UMaterialInterface* M_Base = LoadObject<UMaterialInterface>(NULL, TEXT("/TiledLevel/Materials/M_UVOutline"), NULL, 0, NULL);
-	M_AreaHint = UMaterialInstanceDynamic::Create(M_Base, this);
-	M_AreaHint->SetVectorParameterValue("BorderColor", GetSourceItem()->BorderColor);
-	M_AreaHint->SetScalarParameterValue("BorderWidth", GetSourceItem()->BorderWidth);
-	AreaHint->SetMaterial(0, M_AreaHint);
+	return false;
+}
+
+int32 FTiledRestrictionIndex::GetNumCells() const
+{
+	int32 Num = 0;
+	for (const auto& FloorCells : Cells)
+		Num += FloorCells.Value.Num();
+	return Num;
 }
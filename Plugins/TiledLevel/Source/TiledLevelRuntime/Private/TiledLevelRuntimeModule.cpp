@@ -3,10 +3,45 @@
 #include "TiledLevelRuntimeModule.h"
 #include "Modules/ModuleManager.h"
 #include "TiledLevelEditorLog.h"
+#include "TiledLevelStats.h"
 
 
 DEFINE_LOG_CATEGORY(LogTiledLevelDev);
 
+DEFINE_STAT(STAT_TiledLevel_ResetAllInstance);
+DEFINE_STAT(STAT_TiledLevel_ApplyResetTargets);
+DEFINE_STAT(STAT_TiledLevel_PopulatePlacements);
+DEFINE_STAT(STAT_TiledLevel_PopulateSinglePlacement);
+DEFINE_STAT(STAT_TiledLevel_AddInstanceBatch);
+DEFINE_STAT(STAT_TiledLevel_RemoveInstances);
+DEFINE_STAT(STAT_TiledLevel_PlacementsPopulated);
+DEFINE_STAT(STAT_TiledLevel_InstancesAdded);
+DEFINE_STAT(STAT_TiledLevel_InstancesRemoved);
+DEFINE_STAT(STAT_TiledLevel_InstancePartitions);
+DEFINE_STAT(STAT_TiledLevel_PartitionedInstances);
+DEFINE_STAT(STAT_TiledLevel_AvgPartitionInstances);
+DEFINE_STAT(STAT_TiledLevel_MaxPartitionInstances);
+DEFINE_STAT(STAT_TiledLevel_OccupancyIndexBuild);
+DEFINE_STAT(STAT_TiledLevel_OverlapQuery);
+DEFINE_STAT(STAT_TiledLevel_OverlapQueries);
+DEFINE_STAT(STAT_TiledLevel_OverlapCandidates);
+DEFINE_STAT(STAT_TiledLevel_OverlappingPlacements);
+DEFINE_STAT(STAT_TiledLevel_FloodFill);
+DEFINE_STAT(STAT_TiledLevel_FloodFilledTiles);
+DEFINE_STAT(STAT_TiledLevel_RestrictionCheck);
+DEFINE_STAT(STAT_TiledLevel_RestrictionIndexBuild);
+DEFINE_STAT(STAT_TiledLevel_RestrictionChecks);
+DEFINE_STAT(STAT_TiledLevel_MergeTemplates);
+DEFINE_STAT(STAT_TiledLevel_MergeGather);
+DEFINE_STAT(STAT_TiledLevel_MergeFill);
+DEFINE_STAT(STAT_TiledLevel_MergeMeshDescription);
+DEFINE_STAT(STAT_TiledLevel_MergedInstances);
+DEFINE_STAT(STAT_TiledLevel_MergedTriangles);
+DEFINE_STAT(STAT_TiledLevel_ThumbnailRender);
+DEFINE_STAT(STAT_TiledLevel_ThumbnailsRendered);
+DEFINE_STAT(STAT_TiledLevel_ThumbnailPlacements);
+DEFINE_STAT(STAT_TiledLevel_ThumbnailCacheHits);
+
 void FTiledLevelRunTimeModule::StartupModule()
 {
 }
@@ -149,13 +149,14 @@ void ATiledLevelSelectHelper::PopulateCopied(bool bForTemplate)
         AllCopied.Append(SelectedEdges);
         AllCopied.Append(SelectedPoints);
     }
+	// hint instances are grouped by mesh and added at once
+	TMap<UStaticMesh*, TArray<FTransform>> HintTransforms;
 	for (FItemPlacement& P : AllCopied)
 	{
 		UTiledLevelItem* Item = P.GetItem();
 		if (Item->SourceType == ETLSourceType::Mesh)
 		{
-			CreateHISM(Item->TiledMesh);
-			HintMeshSpawner[Item->TiledMesh]->AddInstance(P.TileObjectTransform);
+			HintTransforms.FindOrAdd(Item->TiledMesh).Add(P.TileObjectTransform);
 		}
 		else
 		{
@@ -168,6 +169,11 @@ void ATiledLevelSelectHelper::PopulateCopied(bool bForTemplate)
 			HintActors.Add(NewActor);
 		}
 	}
+	for (auto& elem : HintTransforms)
+	{
+		CreateHISM(elem.Key);
+		HintMeshSpawner[elem.Key]->AddInstances(elem.Value, false);
+	}
 }
 
 void ATiledLevelSelectHelper::Move(FIntVector NewPosition, FVector InTileSize, FTransform AnchorTransform)
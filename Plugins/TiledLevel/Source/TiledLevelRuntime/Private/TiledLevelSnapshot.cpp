@@ -0,0 +1,464 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#include "TiledLevelSnapshot.h"
+#include "TiledItemSet.h"
+#include "TiledLevelEditorLog.h"
+#include "TiledLevelUtility.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+
+static constexpr uint32 SnapshotMagic = 0x53534C54; // "TLSS"
+static constexpr uint32 SnapshotVersion = 1;
+
+enum ESnapshotSection
+{
+	Section_ItemSetPaths,
+	Section_Items,
+	Section_HiddenFloors,
+	Section_Boundaries,
+	Section_Placements, // one for each placed type
+	Section_Num = Section_Placements + 6
+};
+
+struct FSnapshotSection
+{
+	uint64 Offset;
+	uint64 Num;
+};
+
+struct FSnapshotHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	double TileSize[3];
+	FSnapshotSection Sections[Section_Num];
+};
+
+static const TArray<FTilePlacement>* GetTileArray(const FTiledLevelGameData& Data, int32 Type)
+{
+	return Type == 0? &Data.BlockPlacements : Type == 1? &Data.FloorPlacements : nullptr;
+}
+
+static const TArray<FEdgePlacement>* GetEdgeArray(const FTiledLevelGameData& Data, int32 Type)
+{
+	return Type == 2? &Data.WallPlacements : Type == 3? &Data.EdgePlacements : nullptr;
+}
+
+static const TArray<FPointPlacement>* GetPointArray(const FTiledLevelGameData& Data, int32 Type)
+{
+	return Type == 4? &Data.PillarPlacements : Type == 5? &Data.PointPlacements : nullptr;
+}
+
+static uint64 AlignSnapshotOffset(uint64 Offset)
+{
+	return Align(Offset, 8);
+}
+
+static void FillSnapshotRecord(FTiledSnapshotPlacement& Record, const FItemPlacement& P, const TMap<FGuid, int32>& ItemIndices,
+	const TMap<UTiledItemSet*, int32>& ItemSetIndices)
+{
+	FMemory::Memzero(Record);
+	const FQuat Rotation = P.TileObjectTransform.GetRotation();
+	const FVector Translation = P.TileObjectTransform.GetTranslation();
+	const FVector Scale = P.TileObjectTransform.GetScale3D();
+	Record.Rotation[0] = Rotation.X;
+	Record.Rotation[1] = Rotation.Y;
+	Record.Rotation[2] = Rotation.Z;
+	Record.Rotation[3] = Rotation.W;
+	for (int32 i = 0; i < 3; i++)
+	{
+		Record.Translation[i] = Translation[i];
+		Record.Scale[i] = Scale[i];
+	}
+	Record.ItemIndex = ItemIndices[P.ItemID];
+	Record.ItemSetIndex = ItemSetIndices[P.ItemSet];
+	Record.IsMirrored = P.IsMirrored? 1 : 0;
+}
+
+static FTransform MakeSnapshotTransform(const FTiledSnapshotPlacement& Record)
+{
+	return FTransform(
+		FQuat(Record.Rotation[0], Record.Rotation[1], Record.Rotation[2], Record.Rotation[3]),
+		FVector(Record.Translation[0], Record.Translation[1], Record.Translation[2]),
+		FVector(Record.Scale[0], Record.Scale[1], Record.Scale[2]));
+}
+
+bool FTiledLevelSnapshot::Write(const FTiledLevelGameData& Data, const FVector& InTileSize, const FString& TargetFile)
+{
+	TMap<FGuid, int32> ItemIndices;
+	TArray<FGuid> ItemTable;
+	TMap<UTiledItemSet*, int32> ItemSetIndices;
+	TArray<UTiledItemSet*> ItemSetTable;
+	auto AddToTables = [&](const FItemPlacement& P)
+	{
+		if (!ItemIndices.Contains(P.ItemID))
+			ItemIndices.Add(P.ItemID, ItemTable.Add(P.ItemID));
+		if (!ItemSetIndices.Contains(P.ItemSet))
+			ItemSetIndices.Add(P.ItemSet, ItemSetTable.Add(P.ItemSet));
+	};
+	for (int32 Type = 0; Type < 6; Type++)
+	{
+		if (const TArray<FTilePlacement>* Tiles = GetTileArray(Data, Type))
+			for (const FTilePlacement& P : *Tiles) AddToTables(P);
+		if (const TArray<FEdgePlacement>* Edges = GetEdgeArray(Data, Type))
+			for (const FEdgePlacement& P : *Edges) AddToTables(P);
+		if (const TArray<FPointPlacement>* Points = GetPointArray(Data, Type))
+			for (const FPointPlacement& P : *Points) AddToTables(P);
+	}
+	TArray<ANSICHAR> ItemSetPaths;
+	for (UTiledItemSet* ItemSet : ItemSetTable)
+	{
+		FTCHARToUTF8 Path(*GetPathNameSafe(ItemSet));
+		ItemSetPaths.Append(Path.Get(), Path.Length());
+		ItemSetPaths.Add('\0');
+	}
+
+	// layout is known up front, so sections are streamed to the file without building the whole file in memory
+	FSnapshotHeader Header;
+	FMemory::Memzero(Header);
+	Header.Magic = SnapshotMagic;
+	Header.Version = SnapshotVersion;
+	for (int32 i = 0; i < 3; i++)
+		Header.TileSize[i] = InTileSize[i];
+	Header.Sections[Section_ItemSetPaths].Num = ItemSetPaths.Num();
+	Header.Sections[Section_Items].Num = ItemTable.Num();
+	Header.Sections[Section_HiddenFloors].Num = Data.HiddenFloors.Num();
+	Header.Sections[Section_Boundaries].Num = Data.Boundaries.Num();
+	Header.Sections[Section_Placements + 0].Num = Data.BlockPlacements.Num();
+	Header.Sections[Section_Placements + 1].Num = Data.FloorPlacements.Num();
+	Header.Sections[Section_Placements + 2].Num = Data.WallPlacements.Num();
+	Header.Sections[Section_Placements + 3].Num = Data.EdgePlacements.Num();
+	Header.Sections[Section_Placements + 4].Num = Data.PillarPlacements.Num();
+	Header.Sections[Section_Placements + 5].Num = Data.PointPlacements.Num();
+	const uint64 ElementSizes[Section_Num] = {sizeof(ANSICHAR), sizeof(FGuid), sizeof(int32), sizeof(FTiledSnapshotBox),
+		sizeof(FTiledSnapshotPlacement), sizeof(FTiledSnapshotPlacement), sizeof(FTiledSnapshotPlacement),
+		sizeof(FTiledSnapshotPlacement), sizeof(FTiledSnapshotPlacement), sizeof(FTiledSnapshotPlacement)};
+	uint64 Offset = sizeof(FSnapshotHeader);
+	for (int32 i = 0; i < Section_Num; i++)
+	{
+		Offset = AlignSnapshotOffset(Offset);
+		Header.Sections[i].Offset = Offset;
+		Offset += Header.Sections[i].Num * ElementSizes[i];
+	}
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TargetFile));
+	if (!Writer)
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to write snapshot %s"), *TargetFile);
+		return false;
+	}
+	auto SeekToSection = [&Writer, &Header](int32 Section)
+	{
+		static const uint8 Zeros[8] = {};
+		const int64 Padding = Header.Sections[Section].Offset - Writer->Tell();
+		check(Padding >= 0 && Padding < 8);
+		Writer->Serialize(const_cast<uint8*>(Zeros), Padding);
+	};
+	Writer->Serialize(&Header, sizeof(FSnapshotHeader));
+	SeekToSection(Section_ItemSetPaths);
+	Writer->Serialize(ItemSetPaths.GetData(), ItemSetPaths.Num());
+	SeekToSection(Section_Items);
+	Writer->Serialize(ItemTable.GetData(), ItemTable.Num() * sizeof(FGuid));
+	SeekToSection(Section_HiddenFloors);
+	TArray<int32> HiddenFloorValues(Data.HiddenFloors);
+	Writer->Serialize(HiddenFloorValues.GetData(), HiddenFloorValues.Num() * sizeof(int32));
+	SeekToSection(Section_Boundaries);
+	for (const FBox& Box : Data.Boundaries)
+	{
+		FTiledSnapshotBox Record = {{Box.Min.X, Box.Min.Y, Box.Min.Z}, {Box.Max.X, Box.Max.Y, Box.Max.Z}, Box.IsValid};
+		Writer->Serialize(&Record, sizeof(FTiledSnapshotBox));
+	}
+	for (int32 Type = 0; Type < 6; Type++)
+	{
+		SeekToSection(Section_Placements + Type);
+		FTiledSnapshotPlacement Record;
+		if (const TArray<FTilePlacement>* Tiles = GetTileArray(Data, Type))
+		{
+			for (const FTilePlacement& P : *Tiles)
+			{
+				FillSnapshotRecord(Record, P, ItemIndices, ItemSetIndices);
+				for (int32 i = 0; i < 3; i++)
+				{
+					Record.Position[i] = P.GridPosition[i];
+					Record.Extent[i] = P.Extent[i];
+				}
+				Writer->Serialize(&Record, sizeof(Record));
+			}
+		}
+		if (const TArray<FEdgePlacement>* Edges = GetEdgeArray(Data, Type))
+		{
+			for (const FEdgePlacement& P : *Edges)
+			{
+				FillSnapshotRecord(Record, P, ItemIndices, ItemSetIndices);
+				Record.Position[0] = P.Edge.X;
+				Record.Position[1] = P.Edge.Y;
+				Record.Position[2] = P.Edge.Z;
+				Record.Extent[0] = static_cast<int32>(P.Edge.EdgeType);
+				Writer->Serialize(&Record, sizeof(Record));
+			}
+		}
+		if (const TArray<FPointPlacement>* Points = GetPointArray(Data, Type))
+		{
+			for (const FPointPlacement& P : *Points)
+			{
+				FillSnapshotRecord(Record, P, ItemIndices, ItemSetIndices);
+				for (int32 i = 0; i < 3; i++)
+					Record.Position[i] = P.GridPosition[i];
+				Writer->Serialize(&Record, sizeof(Record));
+			}
+		}
+	}
+	return Writer->Close();
+}
+
+FTiledLevelSnapshot::~FTiledLevelSnapshot()
+{
+	Close();
+}
+
+bool FTiledLevelSnapshot::Open(const FString& SourceFile)
+{
+	Close();
+	MappedHandle = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*SourceFile);
+	if (MappedHandle)
+		MappedRegion = MappedHandle->MapRegion(0, MappedHandle->GetFileSize());
+	if (MappedRegion)
+	{
+		Bytes = MappedRegion->GetMappedPtr();
+		NumBytes = MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedBytes, *SourceFile))
+	{
+		Bytes = LoadedBytes.GetData();
+		NumBytes = LoadedBytes.Num();
+	}
+	if (!Bytes || !Parse())
+	{
+		UE_LOG(LogTiledLevelDev, Error, TEXT("Failed to open snapshot %s"), *SourceFile);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FTiledLevelSnapshot::Close()
+{
+	delete MappedRegion;
+	MappedRegion = nullptr;
+	delete MappedHandle;
+	MappedHandle = nullptr;
+	LoadedBytes.Empty();
+	Bytes = nullptr;
+	NumBytes = 0;
+	Items = {};
+	ItemSets.Empty();
+	HiddenFloors = {};
+	Boundaries = {};
+	for (TArrayView<const FTiledSnapshotPlacement>& View : Placements)
+		View = {};
+	ChunkSize = 0;
+	ChunkIndex.Empty();
+}
+
+bool FTiledLevelSnapshot::Parse()
+{
+	// the layout is written as is, a big endian platform would just fail the magic check
+	if (NumBytes < static_cast<int64>(sizeof(FSnapshotHeader))) return false;
+	const FSnapshotHeader& Header = *reinterpret_cast<const FSnapshotHeader*>(Bytes);
+	if (Header.Magic != SnapshotMagic || Header.Version != SnapshotVersion) return false;
+
+	auto GetSection = [this, &Header](int32 Section, uint64 ElementSize, const uint8*& OutData, int32& OutNum)
+	{
+		const FSnapshotSection& S = Header.Sections[Section];
+		if (S.Offset % 8 != 0 || S.Offset > static_cast<uint64>(NumBytes)) return false;
+		if (S.Num > (NumBytes - S.Offset) / ElementSize || S.Num > MAX_int32) return false;
+		OutData = Bytes + S.Offset;
+		OutNum = static_cast<int32>(S.Num);
+		return true;
+	};
+	const uint8* Data;
+	int32 Num;
+	if (!GetSection(Section_ItemSetPaths, sizeof(ANSICHAR), Data, Num)) return false;
+	const ANSICHAR* Paths = reinterpret_cast<const ANSICHAR*>(Data);
+	if (Num > 0 && Paths[Num - 1] != '\0') return false;
+	for (int32 Start = 0; Start < Num;)
+	{
+		const int32 Length = FCStringAnsi::Strlen(Paths + Start);
+		const FString Path = FString(FUTF8ToTCHAR(Paths + Start, Length));
+		ItemSets.Add(Path.IsEmpty()? nullptr : LoadObject<UTiledItemSet>(nullptr, *Path));
+		Start += Length + 1;
+	}
+
+	if (!GetSection(Section_Items, sizeof(FGuid), Data, Num)) return false;
+	Items = MakeArrayView(reinterpret_cast<const FGuid*>(Data), Num);
+	if (!GetSection(Section_HiddenFloors, sizeof(int32), Data, Num)) return false;
+	HiddenFloors = MakeArrayView(reinterpret_cast<const int32*>(Data), Num);
+	if (!GetSection(Section_Boundaries, sizeof(FTiledSnapshotBox), Data, Num)) return false;
+	Boundaries = MakeArrayView(reinterpret_cast<const FTiledSnapshotBox*>(Data), Num);
+	for (int32 Type = 0; Type < 6; Type++)
+	{
+		if (!GetSection(Section_Placements + Type, sizeof(FTiledSnapshotPlacement), Data, Num)) return false;
+		Placements[Type] = MakeArrayView(reinterpret_cast<const FTiledSnapshotPlacement*>(Data), Num);
+		const bool IsEdge = Type == 2 || Type == 3;
+		for (const FTiledSnapshotPlacement& Record : Placements[Type])
+		{
+			if (!Items.IsValidIndex(Record.ItemIndex) || !ItemSets.IsValidIndex(Record.ItemSetIndex)) return false;
+			if (IsEdge && Record.Extent[0] != static_cast<int32>(EEdgeType::Horizontal) && Record.Extent[0] != static_cast<int32>(EEdgeType::Vertical))
+				return false;
+		}
+	}
+	TileSize = FVector(Header.TileSize[0], Header.TileSize[1], Header.TileSize[2]);
+	return true;
+}
+
+TArrayView<const FTiledSnapshotPlacement> FTiledLevelSnapshot::GetPlacements(EPlacedType PlacedType) const
+{
+	const int32 Type = static_cast<int32>(PlacedType);
+	return Type < 6? Placements[Type] : TArrayView<const FTiledSnapshotPlacement>();
+}
+
+int32 FTiledLevelSnapshot::GetNumOfAllPlacements() const
+{
+	int32 Num = 0;
+	for (const TArrayView<const FTiledSnapshotPlacement>& View : Placements)
+		Num += View.Num();
+	return Num;
+}
+
+FTilePlacement FTiledLevelSnapshot::MakeTilePlacement(const FTiledSnapshotPlacement& Record) const
+{
+	FTilePlacement P;
+	P.ItemSet = ItemSets[Record.ItemSetIndex];
+	P.ItemID = Items[Record.ItemIndex];
+	P.TileObjectTransform = MakeSnapshotTransform(Record);
+	P.IsMirrored = Record.IsMirrored != 0;
+	P.GridPosition = FIntVector(Record.Position[0], Record.Position[1], Record.Position[2]);
+	P.Extent = FIntVector(Record.Extent[0], Record.Extent[1], Record.Extent[2]);
+	return P;
+}
+
+FEdgePlacement FTiledLevelSnapshot::MakeEdgePlacement(const FTiledSnapshotPlacement& Record) const
+{
+	FEdgePlacement P;
+	P.ItemSet = ItemSets[Record.ItemSetIndex];
+	P.ItemID = Items[Record.ItemIndex];
+	P.TileObjectTransform = MakeSnapshotTransform(Record);
+	P.IsMirrored = Record.IsMirrored != 0;
+	P.Edge = FTiledLevelEdge(Record.Position[0], Record.Position[1], Record.Position[2], static_cast<EEdgeType>(Record.Extent[0]));
+	return P;
+}
+
+FPointPlacement FTiledLevelSnapshot::MakePointPlacement(const FTiledSnapshotPlacement& Record) const
+{
+	FPointPlacement P;
+	P.ItemSet = ItemSets[Record.ItemSetIndex];
+	P.ItemID = Items[Record.ItemIndex];
+	P.TileObjectTransform = MakeSnapshotTransform(Record);
+	P.IsMirrored = Record.IsMirrored != 0;
+	P.GridPosition = FIntVector(Record.Position[0], Record.Position[1], Record.Position[2]);
+	return P;
+}
+
+FTiledLevelGameData FTiledLevelSnapshot::MakeEmptyGameData() const
+{
+	FTiledLevelGameData Data;
+	Data.HiddenFloors = TArray<int>(HiddenFloors.GetData(), HiddenFloors.Num());
+	for (const FTiledSnapshotBox& Box : Boundaries)
+	{
+		FBox& NewBox = Data.Boundaries.Add_GetRef(FBox(FVector(Box.Min[0], Box.Min[1], Box.Min[2]), FVector(Box.Max[0], Box.Max[1], Box.Max[2])));
+		NewBox.IsValid = Box.IsValid != 0;
+	}
+	return Data;
+}
+
+FTiledLevelGameData FTiledLevelSnapshot::ToGameData() const
+{
+	FTiledLevelGameData Data = MakeEmptyGameData();
+	auto AddTiles = [this](TArray<FTilePlacement>& Target, EPlacedType PlacedType)
+	{
+		Target.Reserve(GetPlacements(PlacedType).Num());
+		for (const FTiledSnapshotPlacement& Record : GetPlacements(PlacedType))
+			Target.Add(MakeTilePlacement(Record));
+	};
+	auto AddEdges = [this](TArray<FEdgePlacement>& Target, EPlacedType PlacedType)
+	{
+		Target.Reserve(GetPlacements(PlacedType).Num());
+		for (const FTiledSnapshotPlacement& Record : GetPlacements(PlacedType))
+			Target.Add(MakeEdgePlacement(Record));
+	};
+	auto AddPoints = [this](TArray<FPointPlacement>& Target, EPlacedType PlacedType)
+	{
+		Target.Reserve(GetPlacements(PlacedType).Num());
+		for (const FTiledSnapshotPlacement& Record : GetPlacements(PlacedType))
+			Target.Add(MakePointPlacement(Record));
+	};
+	AddTiles(Data.BlockPlacements, EPlacedType::Block);
+	AddTiles(Data.FloorPlacements, EPlacedType::Floor);
+	AddEdges(Data.WallPlacements, EPlacedType::Wall);
+	AddEdges(Data.EdgePlacements, EPlacedType::Edge);
+	AddPoints(Data.PillarPlacements, EPlacedType::Pillar);
+	AddPoints(Data.PointPlacements, EPlacedType::Point);
+	Data.MarkOccupancyIndexDirty();
+	return Data;
+}
+
+void FTiledLevelSnapshot::BuildChunkIndex(int32 InChunkSize)
+{
+	ChunkSize = FMath::Max(1, InChunkSize);
+	ChunkIndex.Empty();
+	for (int32 Type = 0; Type < 6; Type++)
+	{
+		const EPlacedType PlacedType = static_cast<EPlacedType>(Type);
+		const TArrayView<const FTiledSnapshotPlacement> Records = GetPlacements(PlacedType);
+		for (int32 i = 0; i < Records.Num(); i++)
+		{
+			// edges are chunked by edge position, everything else by grid position, both are what the record stores
+			const FIntVector Position(Records[i].Position[0], Records[i].Position[1], Records[i].Position[2]);
+			ChunkIndex.FindOrAdd(FTiledLevelGameData::GetChunk(Position, ChunkSize)).Records[Type].Add(i);
+		}
+	}
+}
+
+void FTiledLevelSnapshot::GetChunks(TSet<FIntPoint>& OutChunks) const
+{
+	for (const TPair<FIntPoint, FChunkRecords>& Pair : ChunkIndex)
+		OutChunks.Add(Pair.Key);
+}
+
+FTiledLevelGameData FTiledLevelSnapshot::DecodeChunk(const FIntPoint& Chunk) const
+{
+	FTiledLevelGameData Data;
+	const FChunkRecords* Found = ChunkIndex.Find(Chunk);
+	if (!Found) return Data;
+	auto GetRecords = [this, Found](EPlacedType PlacedType, TFunctionRef<void(const FTiledSnapshotPlacement&)> AddRecord)
+	{
+		const TArrayView<const FTiledSnapshotPlacement> Records = GetPlacements(PlacedType);
+		for (int32 Index : Found->Records[static_cast<int32>(PlacedType)])
+			AddRecord(Records[Index]);
+	};
+	auto AddTiles = [&](TArray<FTilePlacement>& Target, EPlacedType PlacedType)
+	{
+		Target.Reserve(Found->Records[static_cast<int32>(PlacedType)].Num());
+		GetRecords(PlacedType, [&](const FTiledSnapshotPlacement& Record) { Target.Add(MakeTilePlacement(Record)); });
+	};
+	auto AddEdges = [&](TArray<FEdgePlacement>& Target, EPlacedType PlacedType)
+	{
+		Target.Reserve(Found->Records[static_cast<int32>(PlacedType)].Num());
+		GetRecords(PlacedType, [&](const FTiledSnapshotPlacement& Record) { Target.Add(MakeEdgePlacement(Record)); });
+	};
+	auto AddPoints = [&](TArray<FPointPlacement>& Target, EPlacedType PlacedType)
+	{
+		Target.Reserve(Found->Records[static_cast<int32>(PlacedType)].Num());
+		GetRecords(PlacedType, [&](const FTiledSnapshotPlacement& Record) { Target.Add(MakePointPlacement(Record)); });
+	};
+	AddTiles(Data.BlockPlacements, EPlacedType::Block);
+	AddTiles(Data.FloorPlacements, EPlacedType::Floor);
+	AddEdges(Data.WallPlacements, EPlacedType::Wall);
+	AddEdges(Data.EdgePlacements, EPlacedType::Edge);
+	AddPoints(Data.PillarPlacements, EPlacedType::Pillar);
+	AddPoints(Data.PointPlacements, EPlacedType::Point);
+	Data.MarkOccupancyIndexDirty();
+	return Data;
+}
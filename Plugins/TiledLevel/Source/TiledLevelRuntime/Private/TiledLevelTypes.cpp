@@ -2,6 +2,12 @@
 
 #include "TiledLevelTypes.h"
 #include "TiledItemSet.h"
+#include "TiledLevelItem.h"
+#include "TiledLevelUtility.h"
+#include "TiledLevelStats.h"
+#include "Algo/StableSort.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 
 UTiledLevelItem* FItemPlacement::GetItem() const
 {
@@ -21,82 +27,318 @@ if (FoundID != INDEX_NONE) \
 	return true; \
 }*/
 
-void FTiledLevelGameData::Empty()
+void FTiledLevelOccupancyIndex::Empty()
 {
-	BlockPlacements.Empty();
-	FloorPlacements.Empty();
-	WallPlacements.Empty();
-	EdgePlacements.Empty();
-	PillarPlacements.Empty();
-	PointPlacements.Empty();
+	Tiles.Empty();
+	Edges.Empty();
+	Points.Empty();
+	TileCells.Empty();
+	EdgeCells.Empty();
+	PointCells.Empty();
 }
 
-bool FTiledLevelGameData::RemovePlacement(FTransform CompareTransform, FGuid ItemID)
+void FTiledLevelOccupancyIndex::AddPlacement(const FTilePlacement& P, EPlacedType PlacedType)
+{
+	const int32 EntryIndex = Tiles.Add(FTileEntry{P, PlacedType});
+	for (const FIntVector& Cell : GetTileCells(P.GridPosition, P.Extent))
+		TileCells.Add(Cell, EntryIndex);
+}
+
+void FTiledLevelOccupancyIndex::AddPlacement(const FEdgePlacement& P, EPlacedType PlacedType)
+{
+	// invalid item placements are still indexed, so that index size always matches the placement arrays
+	const UTiledLevelItem* Item = P.GetItem();
+	const FIntVector Extent = Item? FIntVector(Item->Extent) : FIntVector(1);
+	const int32 EntryIndex = Edges.Add(FEdgeEntry{P, PlacedType, Extent});
+	for (const FTiledLevelEdge& Cell : GetEdgeCells(P.Edge, Extent))
+		EdgeCells.Add(Cell, EntryIndex);
+}
+
+void FTiledLevelOccupancyIndex::AddPlacement(const FPointPlacement& P, EPlacedType PlacedType)
+{
+	const UTiledLevelItem* Item = P.GetItem();
+	const int ZExtent = Item? FMath::RoundToInt(Item->Extent.Z) : 1;
+	const int32 EntryIndex = Points.Add(FPointEntry{P, PlacedType, ZExtent});
+	for (const FIntVector& Cell : GetPointCells(P.GridPosition, ZExtent))
+		PointCells.Add(Cell, EntryIndex);
+}
+
+void FTiledLevelOccupancyIndex::RemovePlacement(const FTilePlacement& P, bool bExactTransform)
 {
-	int FoundID = BlockPlacements.IndexOfByPredicate([=](FItemPlacement P)
+	TArray<int32> Found;
+	TileCells.MultiFind(P.GridPosition, Found);
+	for (const int32 EntryIndex : Found)
 	{
-		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
-	});
-	if (FoundID != INDEX_NONE)
+		if (!(Tiles[EntryIndex].Placement == P)) continue;
+		if (bExactTransform && !Tiles[EntryIndex].Placement.TileObjectTransform.Equals(P.TileObjectTransform)) continue;
+		const FTileEntry& Entry = Tiles[EntryIndex];
+		for (const FIntVector& Cell : GetTileCells(Entry.Placement.GridPosition, Entry.Placement.Extent))
+			TileCells.RemoveSingle(Cell, EntryIndex);
+		Tiles.RemoveAt(EntryIndex);
+		if (bExactTransform) break;
+	}
+}
+
+void FTiledLevelOccupancyIndex::RemovePlacement(const FEdgePlacement& P, bool bExactTransform)
+{
+	TArray<int32> Found;
+	EdgeCells.MultiFind(P.Edge, Found);
+	for (const int32 EntryIndex : Found)
 	{
-		BlockPlacements.RemoveAt(FoundID);
-		return true;
+		if (!(Edges[EntryIndex].Placement == P)) continue;
+		if (bExactTransform && !Edges[EntryIndex].Placement.TileObjectTransform.Equals(P.TileObjectTransform)) continue;
+		const FEdgeEntry& Entry = Edges[EntryIndex];
+		for (const FTiledLevelEdge& Cell : GetEdgeCells(Entry.Placement.Edge, Entry.Extent))
+			EdgeCells.RemoveSingle(Cell, EntryIndex);
+		Edges.RemoveAt(EntryIndex);
+		if (bExactTransform) break;
 	}
-	
-	FoundID = FloorPlacements.IndexOfByPredicate([=](FItemPlacement P)
+}
+
+void FTiledLevelOccupancyIndex::RemovePlacement(const FPointPlacement& P, bool bExactTransform)
+{
+	TArray<int32> Found;
+	PointCells.MultiFind(P.GridPosition, Found);
+	for (const int32 EntryIndex : Found)
 	{
-		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
-	});
-	if (FoundID != INDEX_NONE)
+		if (!(Points[EntryIndex].Placement == P)) continue;
+		if (bExactTransform && !Points[EntryIndex].Placement.TileObjectTransform.Equals(P.TileObjectTransform)) continue;
+		const FPointEntry& Entry = Points[EntryIndex];
+		for (const FIntVector& Cell : GetPointCells(Entry.Placement.GridPosition, Entry.ZExtent))
+			PointCells.RemoveSingle(Cell, EntryIndex);
+		Points.RemoveAt(EntryIndex);
+		if (bExactTransform) break;
+	}
+}
+
+/*
+ * Collect candidate entries from cells, sorted by entry index to keep results in a stable order.
+ * Two placements overlap only if they share at least one cell, the exact test is done by caller.
+ */
+template <typename KeyType>
+static TArray<int32> CollectCandidates(const TMultiMap<KeyType, int32>& CellMap, const TArray<KeyType>& Cells)
+{
+	TSet<int32> CandidateSet;
+	for (const KeyType& Cell : Cells)
 	{
-		FloorPlacements.RemoveAt(FoundID);
-		return true;
+		for (auto It = CellMap.CreateConstKeyIterator(Cell); It; ++It)
+			CandidateSet.Add(It.Value());
 	}
-	
-	FoundID = WallPlacements.IndexOfByPredicate([=](FItemPlacement P)
+	TArray<int32> Candidates = CandidateSet.Array();
+	Candidates.Sort();
+	INC_DWORD_STAT(STAT_TiledLevel_OverlapQueries);
+	INC_DWORD_STAT_BY(STAT_TiledLevel_OverlapCandidates, Candidates.Num());
+	return Candidates;
+}
+
+static bool IsMatchedPlacedType(EPlacedType EntryType, EPlacedType QueryType)
+{
+	return QueryType == EPlacedType::Any || EntryType == QueryType;
+}
+
+TArray<FTilePlacement> FTiledLevelOccupancyIndex::FindOverlappingTiles(const FIntVector& Position,
+	const FIntVector& Extent, EPlacedType PlacedType) const
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_OverlapQuery);
+	FTilePlacement TestPlacement;
+	TestPlacement.GridPosition = Position;
+	TestPlacement.Extent = Extent;
+	TArray<FTilePlacement> Out;
+	for (const int32 EntryIndex : CollectCandidates(TileCells, GetTileCells(Position, Extent)))
 	{
-		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
-	});
-	if (FoundID != INDEX_NONE)
+		const FTileEntry& Entry = Tiles[EntryIndex];
+		if (IsMatchedPlacedType(Entry.PlacedType, PlacedType) && FTiledLevelUtility::IsTilePlacementOverlapping(TestPlacement, Entry.Placement))
+			Out.Add(Entry.Placement);
+	}
+	INC_DWORD_STAT_BY(STAT_TiledLevel_OverlappingPlacements, Out.Num());
+	return Out;
+}
+
+TArray<FEdgePlacement> FTiledLevelOccupancyIndex::FindOverlappingEdges(const FTiledLevelEdge& Edge,
+	const FIntVector& Extent, EPlacedType PlacedType) const
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_OverlapQuery);
+	TArray<FEdgePlacement> Out;
+	for (const int32 EntryIndex : CollectCandidates(EdgeCells, GetEdgeCells(Edge, Extent)))
 	{
-		WallPlacements.RemoveAt(FoundID);
-		return true;
+		const FEdgeEntry& Entry = Edges[EntryIndex];
+		if (IsMatchedPlacedType(Entry.PlacedType, PlacedType) && FTiledLevelUtility::IsEdgeOverlapping(Edge, FVector(Extent), Entry.Placement.Edge, FVector(Entry.Extent)))
+			Out.Add(Entry.Placement);
 	}
-	
-	FoundID = EdgePlacements.IndexOfByPredicate([=](FItemPlacement P)
+	INC_DWORD_STAT_BY(STAT_TiledLevel_OverlappingPlacements, Out.Num());
+	return Out;
+}
+
+TArray<FPointPlacement> FTiledLevelOccupancyIndex::FindOverlappingPoints(const FIntVector& Position, int ZExtent,
+	EPlacedType PlacedType) const
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_OverlapQuery);
+	TArray<FPointPlacement> Out;
+	for (const int32 EntryIndex : CollectCandidates(PointCells, GetPointCells(Position, ZExtent)))
 	{
-		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
-	});
-	if (FoundID != INDEX_NONE)
+		const FPointEntry& Entry = Points[EntryIndex];
+		if (IsMatchedPlacedType(Entry.PlacedType, PlacedType) && FTiledLevelUtility::IsPointOverlapping(Position, ZExtent, Entry.Placement.GridPosition, Entry.ZExtent))
+			Out.Add(Entry.Placement);
+	}
+	INC_DWORD_STAT_BY(STAT_TiledLevel_OverlappingPlacements, Out.Num());
+	return Out;
+}
+
+TArray<FEdgePlacement> FTiledLevelOccupancyIndex::FindEdgesInsideTile(const FIntVector& TilePosition,
+	const FIntVector& TileExtent, EPlacedType PlacedType) const
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_OverlapQuery);
+	// all vertical and horizontal unit edges on and inside the tile boundary
+	TArray<FTiledLevelEdge> Cells;
+	for (int x = 0; x <= TileExtent.X; x++)
+		Cells.Append(GetEdgeCells(FTiledLevelEdge(TilePosition + FIntVector(x, 0, 0), EEdgeType::Vertical), FIntVector(TileExtent.Y, 0, TileExtent.Z)));
+	for (int y = 0; y <= TileExtent.Y; y++)
+		Cells.Append(GetEdgeCells(FTiledLevelEdge(TilePosition + FIntVector(0, y, 0), EEdgeType::Horizontal), FIntVector(TileExtent.X, 0, TileExtent.Z)));
+
+	TArray<FEdgePlacement> Out;
+	for (const int32 EntryIndex : CollectCandidates(EdgeCells, Cells))
+	{
+		const FEdgeEntry& Entry = Edges[EntryIndex];
+		if (IsMatchedPlacedType(Entry.PlacedType, PlacedType) && FTiledLevelUtility::IsEdgeInsideTile(Entry.Placement.Edge, Entry.Extent, TilePosition, TileExtent))
+			Out.Add(Entry.Placement);
+	}
+	INC_DWORD_STAT_BY(STAT_TiledLevel_OverlappingPlacements, Out.Num());
+	return Out;
+}
+
+TArray<FPointPlacement> FTiledLevelOccupancyIndex::FindPointsInsideTile(const FIntVector& TilePosition,
+	const FIntVector& TileExtent, EPlacedType PlacedType) const
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_OverlapQuery);
+	TArray<FIntVector> Cells;
+	for (int x = 0; x <= TileExtent.X; x++)
 	{
-		EdgePlacements.RemoveAt(FoundID);
-		return true;
+		for (int y = 0; y <= TileExtent.Y; y++)
+		{
+			Cells.Append(GetPointCells(TilePosition + FIntVector(x, y, 0), TileExtent.Z));
+		}
 	}
 	
-	FoundID = PillarPlacements.IndexOfByPredicate([=](FItemPlacement P)
+	TArray<FPointPlacement> Out;
+	for (const int32 EntryIndex : CollectCandidates(PointCells, Cells))
 	{
-		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
-	});
-	if (FoundID != INDEX_NONE)
+		const FPointEntry& Entry = Points[EntryIndex];
+		if (IsMatchedPlacedType(Entry.PlacedType, PlacedType) && FTiledLevelUtility::IsPointInsideTile(Entry.Placement.GridPosition, Entry.ZExtent, TilePosition, TileExtent))
+			Out.Add(Entry.Placement);
+	}
+	INC_DWORD_STAT_BY(STAT_TiledLevel_OverlappingPlacements, Out.Num());
+	return Out;
+}
+
+TArray<FIntVector> FTiledLevelOccupancyIndex::GetTileCells(const FIntVector& Position, const FIntVector& Extent)
+{
+	TArray<FIntVector> Cells;
+	for (int x = 0; x < FMath::Max(Extent.X, 1); x++)
 	{
-		PillarPlacements.RemoveAt(FoundID);
-		return true;
+		for (int y = 0; y < FMath::Max(Extent.Y, 1); y++)
+		{
+			for (int z = 0; z < FMath::Max(Extent.Z, 1); z++)
+			{
+				Cells.Add(Position + FIntVector(x, y, z));
+			}
+		}
 	}
-	
-	FoundID = PointPlacements.IndexOfByPredicate([=](FItemPlacement P)
+	return Cells;
+}
+
+TArray<FTiledLevelEdge> FTiledLevelOccupancyIndex::GetEdgeCells(const FTiledLevelEdge& Edge, const FIntVector& Extent)
+{
+	// same as FEdgePlacement::GetOccupiedEdges
+	TArray<FTiledLevelEdge> Cells;
+	for (int x = 0; x < FMath::Max(Extent.X, 1); x++)
 	{
-		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
-	});
-	if (FoundID != INDEX_NONE)
+		for (int z = 0; z < FMath::Max(Extent.Z, 1); z++)
+		{
+			if (Edge.EdgeType == EEdgeType::Horizontal)
+				Cells.Add(FTiledLevelEdge(Edge.X + x, Edge.Y, Edge.Z + z, Edge.EdgeType));
+			else
+				Cells.Add(FTiledLevelEdge(Edge.X, Edge.Y + x, Edge.Z + z, Edge.EdgeType));
+		}
+	}
+	return Cells;
+}
+
+TArray<FIntVector> FTiledLevelOccupancyIndex::GetPointCells(const FIntVector& Position, int ZExtent)
+{
+	// both ends included, point overlapping is "one contains the other", which always share an integer height
+	TArray<FIntVector> Cells;
+	for (int z = 0; z <= FMath::Max(ZExtent, 0); z++)
+		Cells.Add(Position + FIntVector(0, 0, z));
+	return Cells;
+}
+
+void FTiledLevelGameData::Empty()
+{
+	BlockPlacements.Empty();
+	FloorPlacements.Empty();
+	WallPlacements.Empty();
+	EdgePlacements.Empty();
+	PillarPlacements.Empty();
+	PointPlacements.Empty();
+	MarkOccupancyIndexDirty();
+}
+
+// RemoveAtSwap, and point the chunk index at the placement moved into the hole (null index: not built)
+template <typename T>
+static void RemoveIndexedPlacement(TArray<T>& Placements, int32 Index, int32 ArrayId, TMap<FIntPoint, FTiledChunkPlacements>* ChunkIndex, int32 ChunkSize)
+{
+	const int32 Last = Placements.Num() - 1;
+	if (ChunkIndex)
 	{
-		PointPlacements.RemoveAt(FoundID);
-		return true;
+		if (FTiledChunkPlacements* Found = ChunkIndex->Find(FTiledLevelGameData::GetChunk(FTiledActorHandle(Placements[Index]).Position, ChunkSize)))
+			Found->Indices[ArrayId].RemoveSingleSwap(Index, false);
+		if (Index != Last)
+		{
+			if (FTiledChunkPlacements* Moved = ChunkIndex->Find(FTiledLevelGameData::GetChunk(FTiledActorHandle(Placements[Last]).Position, ChunkSize)))
+			{
+				const int32 Slot = Moved->Indices[ArrayId].Find(Last);
+				if (Slot != INDEX_NONE)
+					Moved->Indices[ArrayId][Slot] = Index;
+			}
+		}
 	}
-	return false;
+	Placements.RemoveAtSwap(Index, 1, false);
+}
+
+// remove the placement just found from the indices as well, a gametime erase shouldn't cost a full index rebuild
+template <typename T>
+static bool RemoveMatchedPlacement(TArray<T>& Placements, int32 ArrayId, const FTransform& CompareTransform, const FGuid& ItemID,
+	FTiledLevelOccupancyIndex& OccupancyIndex, bool bIndexDirty, TMap<FIntPoint, FTiledChunkPlacements>* ChunkIndex, int32 ChunkSize)
+{
+	const int FoundID = Placements.IndexOfByPredicate([&](const T& P)
+	{
+		return P.ItemID == ItemID && P.TileObjectTransform.Equals(CompareTransform);
+	});
+	if (FoundID == INDEX_NONE) return false;
+	if (!bIndexDirty)
+		OccupancyIndex.RemovePlacement(Placements[FoundID], true);
+	RemoveIndexedPlacement(Placements, FoundID, ArrayId, ChunkIndex, ChunkSize);
+	return true;
+}
+
+bool FTiledLevelGameData::RemovePlacement(FTransform CompareTransform, FGuid ItemID)
+{
+	const bool bChunkIndexValid = IsChunkIndexValid();
+	TMap<FIntPoint, FTiledChunkPlacements>* Chunks = bChunkIndexValid? &ChunkIndex : nullptr;
+	const bool bRemoved = RemoveMatchedPlacement(BlockPlacements, 0, CompareTransform, ItemID, OccupancyIndex, bOccupancyIndexDirty, Chunks, ChunkIndexSize)
+		|| RemoveMatchedPlacement(FloorPlacements, 1, CompareTransform, ItemID, OccupancyIndex, bOccupancyIndexDirty, Chunks, ChunkIndexSize)
+		|| RemoveMatchedPlacement(WallPlacements, 2, CompareTransform, ItemID, OccupancyIndex, bOccupancyIndexDirty, Chunks, ChunkIndexSize)
+		|| RemoveMatchedPlacement(EdgePlacements, 3, CompareTransform, ItemID, OccupancyIndex, bOccupancyIndexDirty, Chunks, ChunkIndexSize)
+		|| RemoveMatchedPlacement(PillarPlacements, 4, CompareTransform, ItemID, OccupancyIndex, bOccupancyIndexDirty, Chunks, ChunkIndexSize)
+		|| RemoveMatchedPlacement(PointPlacements, 5, CompareTransform, ItemID, OccupancyIndex, bOccupancyIndexDirty, Chunks, ChunkIndexSize);
+	if (bRemoved && bChunkIndexValid)
+		ChunkIndexNum--;
+	return bRemoved;
 }
 
 void FTiledLevelGameData::RemovePlacements(const TArray<FTilePlacement>& ToDelete)
 {
+	ChunkIndexSize = 0;
 	BlockPlacements.RemoveAll([=](const FTilePlacement& P)
 	{
 		return ToDelete.Contains(P);
@@ -105,10 +347,16 @@ void FTiledLevelGameData::RemovePlacements(const TArray<FTilePlacement>& ToDelet
 	{
 		return ToDelete.Contains(P);
 	});
+	if (!bOccupancyIndexDirty)
+	{
+		for (const FTilePlacement& P : ToDelete)
+			OccupancyIndex.RemovePlacement(P);
+	}
 }
 
 void FTiledLevelGameData::RemovePlacements(const TArray<FEdgePlacement>& ToDelete)
 {
+	ChunkIndexSize = 0;
 	WallPlacements.RemoveAll([=](const FEdgePlacement& P)
 	{
 		return ToDelete.Contains(P);
@@ -117,10 +365,16 @@ void FTiledLevelGameData::RemovePlacements(const TArray<FEdgePlacement>& ToDelet
 	{
 		return ToDelete.Contains(P);
 	});
+	if (!bOccupancyIndexDirty)
+	{
+		for (const FEdgePlacement& P : ToDelete)
+			OccupancyIndex.RemovePlacement(P);
+	}
 }
 
 void FTiledLevelGameData::RemovePlacements(const TArray<FPointPlacement>& ToDelete)
 {
+	ChunkIndexSize = 0;
 	PillarPlacements.RemoveAll([=](const FPointPlacement& P)
 	{
 		return ToDelete.Contains(P);
@@ -129,6 +383,11 @@ void FTiledLevelGameData::RemovePlacements(const TArray<FPointPlacement>& ToDele
 	{
 		return ToDelete.Contains(P);
 	});
+	if (!bOccupancyIndexDirty)
+	{
+		for (const FPointPlacement& P : ToDelete)
+			OccupancyIndex.RemovePlacement(P);
+	}
 }
 
 
@@ -160,3 +419,613 @@ void FTiledLevelGameData::SetFocusFloor(int FloorPosition)
 		HiddenFloors.Remove(FMath::Min(HiddenFloors));
 	}
 }
+
+template <typename T>
+void FTiledLevelGameData::AddToChunkIndex(const TArray<T>& Placements, int32 ArrayId)
+{
+	// checked before the add
+	if (ChunkIndexSize <= 0 || ChunkIndexNum != GetNumOfAllPlacements() - 1) return;
+	ChunkIndex.FindOrAdd(GetChunk(FTiledActorHandle(Placements.Last()).Position, ChunkIndexSize)).Indices[ArrayId].Add(Placements.Num() - 1);
+	ChunkIndexNum++;
+}
+
+void FTiledLevelGameData::AddPlacement(const FTilePlacement& P, EPlacedType PlacedType)
+{
+	if (PlacedType == EPlacedType::Block)
+	{
+		BlockPlacements.Add(P);
+		AddToChunkIndex(BlockPlacements, 0);
+	}
+	else
+	{
+		FloorPlacements.Add(P);
+		AddToChunkIndex(FloorPlacements, 1);
+	}
+	if (!bOccupancyIndexDirty)
+		OccupancyIndex.AddPlacement(P, PlacedType);
+}
+
+void FTiledLevelGameData::AddPlacement(const FEdgePlacement& P, EPlacedType PlacedType)
+{
+	if (PlacedType == EPlacedType::Wall)
+	{
+		WallPlacements.Add(P);
+		AddToChunkIndex(WallPlacements, 2);
+	}
+	else
+	{
+		EdgePlacements.Add(P);
+		AddToChunkIndex(EdgePlacements, 3);
+	}
+	if (!bOccupancyIndexDirty)
+		OccupancyIndex.AddPlacement(P, PlacedType);
+}
+
+void FTiledLevelGameData::AddPlacement(const FPointPlacement& P, EPlacedType PlacedType)
+{
+	if (PlacedType == EPlacedType::Pillar)
+	{
+		PillarPlacements.Add(P);
+		AddToChunkIndex(PillarPlacements, 4);
+	}
+	else
+	{
+		PointPlacements.Add(P);
+		AddToChunkIndex(PointPlacements, 5);
+	}
+	if (!bOccupancyIndexDirty)
+		OccupancyIndex.AddPlacement(P, PlacedType);
+}
+
+void FTiledLevelGameData::BuildChunkIndex(int32 ChunkSize)
+{
+	ChunkIndex.Reset();
+	auto AddArray = [this, ChunkSize](const auto& Placements, int32 ArrayId)
+	{
+		for (int32 i = 0; i < Placements.Num(); i++)
+			ChunkIndex.FindOrAdd(GetChunk(FTiledActorHandle(Placements[i]).Position, ChunkSize)).Indices[ArrayId].Add(i);
+	};
+	AddArray(BlockPlacements, 0);
+	AddArray(FloorPlacements, 1);
+	AddArray(WallPlacements, 2);
+	AddArray(EdgePlacements, 3);
+	AddArray(PillarPlacements, 4);
+	AddArray(PointPlacements, 5);
+	ChunkIndexSize = ChunkSize;
+	ChunkIndexNum = GetNumOfAllPlacements();
+}
+
+template <typename T>
+static void MoveChunkPlacements(TArray<T>& From, TArray<T>& To, TArray<int32>& Indices, int32 ArrayId, TMap<FIntPoint, FTiledChunkPlacements>& ChunkIndex, int32 ChunkSize)
+{
+	// from the back, so the placement swapped into a hole is never one of the chunk's own
+	Indices.Sort(TGreater<int32>());
+	To.Reserve(Indices.Num());
+	for (const int32 Index : Indices)
+	{
+		To.Add(From[Index]);
+		RemoveIndexedPlacement(From, Index, ArrayId, &ChunkIndex, ChunkSize);
+	}
+}
+
+FTiledLevelGameData FTiledLevelGameData::TakeChunk(const FIntPoint& Chunk, int32 ChunkSize)
+{
+	FTiledLevelGameData ChunkData;
+	if (ChunkIndexSize != ChunkSize || !IsChunkIndexValid())
+		BuildChunkIndex(ChunkSize);
+	FTiledChunkPlacements Taken;
+	if (!ChunkIndex.RemoveAndCopyValue(Chunk, Taken))
+		return ChunkData;
+	MoveChunkPlacements(BlockPlacements, ChunkData.BlockPlacements, Taken.Indices[0], 0, ChunkIndex, ChunkSize);
+	MoveChunkPlacements(FloorPlacements, ChunkData.FloorPlacements, Taken.Indices[1], 1, ChunkIndex, ChunkSize);
+	MoveChunkPlacements(WallPlacements, ChunkData.WallPlacements, Taken.Indices[2], 2, ChunkIndex, ChunkSize);
+	MoveChunkPlacements(EdgePlacements, ChunkData.EdgePlacements, Taken.Indices[3], 3, ChunkIndex, ChunkSize);
+	MoveChunkPlacements(PillarPlacements, ChunkData.PillarPlacements, Taken.Indices[4], 4, ChunkIndex, ChunkSize);
+	MoveChunkPlacements(PointPlacements, ChunkData.PointPlacements, Taken.Indices[5], 5, ChunkIndex, ChunkSize);
+	ChunkIndexNum -= ChunkData.Num();
+	if (!bOccupancyIndexDirty)
+	{
+		for (const FTilePlacement& P : ChunkData.BlockPlacements)
+			OccupancyIndex.RemovePlacement(P);
+		for (const FTilePlacement& P : ChunkData.FloorPlacements)
+			OccupancyIndex.RemovePlacement(P);
+		for (const FEdgePlacement& P : ChunkData.WallPlacements)
+			OccupancyIndex.RemovePlacement(P);
+		for (const FEdgePlacement& P : ChunkData.EdgePlacements)
+			OccupancyIndex.RemovePlacement(P);
+		for (const FPointPlacement& P : ChunkData.PillarPlacements)
+			OccupancyIndex.RemovePlacement(P);
+		for (const FPointPlacement& P : ChunkData.PointPlacements)
+			OccupancyIndex.RemovePlacement(P);
+	}
+	return ChunkData;
+}
+
+void FTiledLevelGameData::AppendChunk(const FTiledLevelGameData& ChunkData)
+{
+	for (const FTilePlacement& P : ChunkData.BlockPlacements)
+		AddPlacement(P, EPlacedType::Block);
+	for (const FTilePlacement& P : ChunkData.FloorPlacements)
+		AddPlacement(P, EPlacedType::Floor);
+	for (const FEdgePlacement& P : ChunkData.WallPlacements)
+		AddPlacement(P, EPlacedType::Wall);
+	for (const FEdgePlacement& P : ChunkData.EdgePlacements)
+		AddPlacement(P, EPlacedType::Edge);
+	for (const FPointPlacement& P : ChunkData.PillarPlacements)
+		AddPlacement(P, EPlacedType::Pillar);
+	for (const FPointPlacement& P : ChunkData.PointPlacements)
+		AddPlacement(P, EPlacedType::Point);
+}
+
+void FTiledLevelGameData::GetChunks(int32 ChunkSize, TSet<FIntPoint>& OutChunks) const
+{
+	for (const FTilePlacement& P : BlockPlacements)
+		OutChunks.Add(GetChunk(P.GridPosition, ChunkSize));
+	for (const FTilePlacement& P : FloorPlacements)
+		OutChunks.Add(GetChunk(P.GridPosition, ChunkSize));
+	for (const FEdgePlacement& P : WallPlacements)
+		OutChunks.Add(GetChunk(FTiledActorHandle(P).Position, ChunkSize));
+	for (const FEdgePlacement& P : EdgePlacements)
+		OutChunks.Add(GetChunk(FTiledActorHandle(P).Position, ChunkSize));
+	for (const FPointPlacement& P : PillarPlacements)
+		OutChunks.Add(GetChunk(P.GridPosition, ChunkSize));
+	for (const FPointPlacement& P : PointPlacements)
+		OutChunks.Add(GetChunk(P.GridPosition, ChunkSize));
+}
+
+void FTiledLevelGameData::GetItemSets(TSet<UTiledItemSet*>& OutItemSets) const
+{
+	for (const FTilePlacement& P : BlockPlacements) OutItemSets.Add(P.ItemSet);
+	for (const FTilePlacement& P : FloorPlacements) OutItemSets.Add(P.ItemSet);
+	for (const FEdgePlacement& P : WallPlacements) OutItemSets.Add(P.ItemSet);
+	for (const FEdgePlacement& P : EdgePlacements) OutItemSets.Add(P.ItemSet);
+	for (const FPointPlacement& P : PillarPlacements) OutItemSets.Add(P.ItemSet);
+	for (const FPointPlacement& P : PointPlacements) OutItemSets.Add(P.ItemSet);
+	OutItemSets.Remove(nullptr);
+}
+
+const FTiledLevelOccupancyIndex& FTiledLevelGameData::GetOccupancyIndex() const
+{
+	// count check catches arrays modified directly (ex: copied or replicated data)
+	if (!bOccupancyIndexDirty && OccupancyIndex.Num() == GetNumOfAllPlacements())
+		return OccupancyIndex;
+	OccupancyIndex.Empty();
+	for (const FTilePlacement& P : BlockPlacements)
+		OccupancyIndex.AddPlacement(P, EPlacedType::Block);
+	for (const FTilePlacement& P : FloorPlacements)
+		OccupancyIndex.AddPlacement(P, EPlacedType::Floor);
+	for (const FEdgePlacement& P : WallPlacements)
+		OccupancyIndex.AddPlacement(P, EPlacedType::Wall);
+	for (const FEdgePlacement& P : EdgePlacements)
+		OccupancyIndex.AddPlacement(P, EPlacedType::Edge);
+	for (const FPointPlacement& P : PillarPlacements)
+		OccupancyIndex.AddPlacement(P, EPlacedType::Pillar);
+	for (const FPointPlacement& P : PointPlacements)
+		OccupancyIndex.AddPlacement(P, EPlacedType::Point);
+	bOccupancyIndexDirty = false;
+	return OccupancyIndex;
+}
+
+/*
+ * Game data binary format (version 1), ints are zigzag + 7 bits per byte packed:
+ *   magic, version, tile size, hidden floors, boundaries
+ *   item set path table, item guid table
+ *   6 placement arrays: count, then each placement sorted by floor, row and column:
+ *     item index, item set index, grid position as delta from the previous placement, tile extent, flags, transform
+ * Transforms are lossless: translation is a float offset from the grid origin if that round-trips exactly,
+ * rotation is a quarter turn index if it's exactly one, otherwise full float or double values are stored.
+ */
+static constexpr uint32 GameDataMagic = 0x44474C54; // "TLGD"
+static constexpr uint32 GameDataVersion = 1;
+
+struct FGameDataTables
+{
+	TArray<FGuid> Items;
+	TMap<FGuid, int32> ItemIndices;
+	TArray<UTiledItemSet*> ItemSets;
+	TMap<UTiledItemSet*, int32> ItemSetIndices;
+
+	void Add(const FItemPlacement& P)
+	{
+		if (!ItemIndices.Contains(P.ItemID))
+			ItemIndices.Add(P.ItemID, Items.Add(P.ItemID));
+		if (!ItemSetIndices.Contains(P.ItemSet))
+			ItemSetIndices.Add(P.ItemSet, ItemSets.Add(P.ItemSet));
+	}
+};
+
+static void SerializePackedInt(FArchive& Ar, int32& Value)
+{
+	uint32 Packed = (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	Ar.SerializeIntPacked(Packed);
+	if (Ar.IsLoading())
+		Value = static_cast<int32>(Packed >> 1) ^ -static_cast<int32>(Packed & 1);
+}
+
+static void SerializePackedIntVector(FArchive& Ar, FIntVector& Value)
+{
+	SerializePackedInt(Ar, Value.X);
+	SerializePackedInt(Ar, Value.Y);
+	SerializePackedInt(Ar, Value.Z);
+}
+
+static bool IsFloatExact(double Value)
+{
+	return static_cast<double>(static_cast<float>(Value)) == Value;
+}
+
+static bool IsSameBits(const FVector& A, const FVector& B)
+{
+	return FMemory::Memcmp(&A, &B, sizeof(FVector)) == 0;
+}
+
+// 0: not stored (value is known), 1: float, 2: double
+static void SerializeDoubles(FArchive& Ar, double* Values, int32 Num, uint8 Mode)
+{
+	for (int32 i = 0; i < Num; i++)
+	{
+		if (Mode == 1)
+		{
+			float F = static_cast<float>(Values[i]);
+			Ar << F;
+			Values[i] = F;
+		}
+		else if (Mode == 2)
+		{
+			Ar << Values[i];
+		}
+	}
+}
+
+static const FQuat& GetQuarterTurn(int32 Index)
+{
+	static const FQuat QuarterTurns[4] = {
+		FRotator(0, 0, 0).Quaternion(), FRotator(0, 90, 0).Quaternion(), FRotator(0, 180, 0).Quaternion(), FRotator(0, 270, 0).Quaternion()};
+	return QuarterTurns[Index];
+}
+
+// flags: bits 0-1 translation mode (0: grid origin, 1: float offset, 2: double), bits 2-4 rotation (0-3: quarter turn, 4: float, 5: double),
+// bits 5-6 scale mode (0: one, 1: float, 2: double)
+static void SerializePlacementTransform(FArchive& Ar, FTransform& Transform, const FVector& GridOrigin)
+{
+	FVector Translation = Transform.GetTranslation();
+	FQuat Rotation = Transform.GetRotation();
+	FVector Scale = Transform.GetScale3D();
+	FVector Offset = Translation - GridOrigin;
+	uint8 Flags = 0;
+	if (Ar.IsSaving())
+	{
+		uint8 TranslationMode = 2;
+		if (IsSameBits(Translation, GridOrigin))
+			TranslationMode = 0;
+		else if (IsFloatExact(Offset.X) && IsFloatExact(Offset.Y) && IsFloatExact(Offset.Z) && IsSameBits(GridOrigin + Offset, Translation))
+			TranslationMode = 1;
+		uint8 RotationMode = IsFloatExact(Rotation.X) && IsFloatExact(Rotation.Y) && IsFloatExact(Rotation.Z) && IsFloatExact(Rotation.W)? 4 : 5;
+		for (uint8 i = 0; i < 4; i++)
+		{
+			if (FMemory::Memcmp(&Rotation, &GetQuarterTurn(i), sizeof(FQuat)) == 0)
+			{
+				RotationMode = i;
+				break;
+			}
+		}
+		uint8 ScaleMode = 2;
+		if (IsSameBits(Scale, FVector::OneVector))
+			ScaleMode = 0;
+		else if (IsFloatExact(Scale.X) && IsFloatExact(Scale.Y) && IsFloatExact(Scale.Z))
+			ScaleMode = 1;
+		Flags = TranslationMode | RotationMode << 2 | ScaleMode << 5;
+	}
+	Ar << Flags;
+
+	const uint8 TranslationMode = Flags & 3;
+	if (TranslationMode == 2)
+		SerializeDoubles(Ar, &Translation.X, 3, 2);
+	else
+		SerializeDoubles(Ar, &Offset.X, 3, TranslationMode);
+	const uint8 RotationMode = Flags >> 2 & 7;
+	if (RotationMode >= 4)
+		SerializeDoubles(Ar, &Rotation.X, 4, RotationMode - 3);
+	const uint8 ScaleMode = Flags >> 5 & 3;
+	SerializeDoubles(Ar, &Scale.X, 3, ScaleMode);
+	if (TranslationMode > 2 || RotationMode > 5 || ScaleMode > 2)
+		Ar.SetError();
+
+	if (Ar.IsLoading() && !Ar.IsError())
+	{
+		if (TranslationMode == 0)
+			Translation = GridOrigin;
+		else if (TranslationMode == 1)
+			Translation = GridOrigin + Offset;
+		if (RotationMode < 4)
+			Rotation = GetQuarterTurn(RotationMode);
+		if (ScaleMode == 0)
+			Scale = FVector::OneVector;
+		Transform = FTransform(Rotation, Translation, Scale);
+	}
+}
+
+static void SerializePlacementItem(FArchive& Ar, FItemPlacement& P, FGameDataTables& Tables)
+{
+	int32 ItemIndex = Ar.IsSaving()? Tables.ItemIndices[P.ItemID] : 0;
+	int32 ItemSetIndex = Ar.IsSaving()? Tables.ItemSetIndices[P.ItemSet] : 0;
+	SerializePackedInt(Ar, ItemIndex);
+	SerializePackedInt(Ar, ItemSetIndex);
+	if (Ar.IsLoading())
+	{
+		if (!Tables.Items.IsValidIndex(ItemIndex) || !Tables.ItemSets.IsValidIndex(ItemSetIndex))
+		{
+			Ar.SetError();
+			return;
+		}
+		P.ItemID = Tables.Items[ItemIndex];
+		P.ItemSet = Tables.ItemSets[ItemSetIndex];
+	}
+}
+
+static FIntVector GetPlacementPosition(const FTilePlacement& P) { return P.GridPosition; }
+static FIntVector GetPlacementPosition(const FEdgePlacement& P) { return P.Edge.GetEdgePosition(); }
+static FIntVector GetPlacementPosition(const FPointPlacement& P) { return P.GridPosition; }
+
+static void SerializePlacement(FArchive& Ar, FTilePlacement& P, FIntVector& LastPosition, const FVector& TileSize, FGameDataTables& Tables)
+{
+	SerializePlacementItem(Ar, P, Tables);
+	FIntVector Delta = P.GridPosition - LastPosition;
+	SerializePackedIntVector(Ar, Delta);
+	P.GridPosition = LastPosition = LastPosition + Delta;
+	SerializePackedIntVector(Ar, P.Extent);
+	uint8 Flags = P.IsMirrored? 1 : 0;
+	Ar << Flags;
+	P.IsMirrored = (Flags & 1) != 0;
+	SerializePlacementTransform(Ar, P.TileObjectTransform, FVector(P.GridPosition) * TileSize);
+}
+
+static void SerializePlacement(FArchive& Ar, FEdgePlacement& P, FIntVector& LastPosition, const FVector& TileSize, FGameDataTables& Tables)
+{
+	SerializePlacementItem(Ar, P, Tables);
+	FIntVector Delta = P.Edge.GetEdgePosition() - LastPosition;
+	SerializePackedIntVector(Ar, Delta);
+	LastPosition = LastPosition + Delta;
+	uint8 Flags = (P.IsMirrored? 1 : 0) | (P.Edge.EdgeType == EEdgeType::Vertical? 2 : 0);
+	Ar << Flags;
+	P.IsMirrored = (Flags & 1) != 0;
+	P.Edge = FTiledLevelEdge(LastPosition, (Flags & 2)? EEdgeType::Vertical : EEdgeType::Horizontal);
+	SerializePlacementTransform(Ar, P.TileObjectTransform, FVector(LastPosition) * TileSize);
+}
+
+static void SerializePlacement(FArchive& Ar, FPointPlacement& P, FIntVector& LastPosition, const FVector& TileSize, FGameDataTables& Tables)
+{
+	SerializePlacementItem(Ar, P, Tables);
+	FIntVector Delta = P.GridPosition - LastPosition;
+	SerializePackedIntVector(Ar, Delta);
+	P.GridPosition = LastPosition = LastPosition + Delta;
+	uint8 Flags = P.IsMirrored? 1 : 0;
+	Ar << Flags;
+	P.IsMirrored = (Flags & 1) != 0;
+	SerializePlacementTransform(Ar, P.TileObjectTransform, FVector(P.GridPosition) * TileSize);
+}
+
+template <typename T>
+static void SerializePlacementArray(FArchive& Ar, TArray<T>& Placements, const FVector& TileSize, FGameDataTables& Tables)
+{
+	int32 Num = Placements.Num();
+	SerializePackedInt(Ar, Num);
+	// each placement takes more than 1 byte, so a bigger count is corrupted data
+	if (Ar.IsLoading() && (Num < 0 || Num > Ar.TotalSize() - Ar.Tell()))
+	{
+		Ar.SetError();
+		return;
+	}
+	
+	TArray<int32> Order;
+	Order.Reserve(Num);
+	for (int32 i = 0; i < Num; i++)
+		Order.Add(i);
+	if (Ar.IsSaving())
+	{
+		// floor by floor, row by row, so position deltas are small
+		Algo::StableSortBy(Order, [&Placements](int32 i)
+		{
+			const FIntVector P = GetPlacementPosition(Placements[i]);
+			return TTuple<int32, int32, int32>(P.Z, P.Y, P.X);
+		});
+	}
+	else
+	{
+		Placements.SetNum(Num);
+	}
+
+	FIntVector LastPosition(0);
+	for (int32 i : Order)
+	{
+		SerializePlacement(Ar, Placements[i], LastPosition, TileSize, Tables);
+		if (Ar.IsError()) return;
+	}
+}
+
+static void SerializeGameData(FArchive& Ar, FTiledLevelGameData& Data, FVector& TileSize, const TMap<FString, UTiledItemSet*>* KnownItemSets = nullptr)
+{
+	uint32 Magic = GameDataMagic;
+	uint32 Version = GameDataVersion;
+	Ar << Magic;
+	Ar << Version;
+	if (Magic != GameDataMagic || Version > GameDataVersion)
+	{
+		Ar.SetError();
+		return;
+	}
+	Ar << TileSize.X << TileSize.Y << TileSize.Z;
+
+	int32 NumHiddenFloors = Data.HiddenFloors.Num();
+	SerializePackedInt(Ar, NumHiddenFloors);
+	if (Ar.IsLoading())
+	{
+		if (NumHiddenFloors < 0 || NumHiddenFloors > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		Data.HiddenFloors.SetNum(NumHiddenFloors);
+	}
+	for (int& Floor : Data.HiddenFloors)
+		SerializePackedInt(Ar, Floor);
+
+	int32 NumBoundaries = Data.Boundaries.Num();
+	SerializePackedInt(Ar, NumBoundaries);
+	if (Ar.IsLoading())
+	{
+		if (NumBoundaries < 0 || NumBoundaries > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return;
+		}
+		Data.Boundaries.SetNum(NumBoundaries);
+	}
+	for (FBox& Box : Data.Boundaries)
+	{
+		Ar << Box.Min.X << Box.Min.Y << Box.Min.Z << Box.Max.X << Box.Max.Y << Box.Max.Z;
+		Ar << Box.IsValid;
+	}
+
+	FGameDataTables Tables;
+	if (Ar.IsSaving())
+	{
+		for (const FTilePlacement& P : Data.BlockPlacements) Tables.Add(P);
+		for (const FTilePlacement& P : Data.FloorPlacements) Tables.Add(P);
+		for (const FEdgePlacement& P : Data.WallPlacements) Tables.Add(P);
+		for (const FEdgePlacement& P : Data.EdgePlacements) Tables.Add(P);
+		for (const FPointPlacement& P : Data.PillarPlacements) Tables.Add(P);
+		for (const FPointPlacement& P : Data.PointPlacements) Tables.Add(P);
+	}
+	TArray<FString> ItemSetPaths;
+	for (UTiledItemSet* ItemSet : Tables.ItemSets)
+		ItemSetPaths.Add(GetPathNameSafe(ItemSet));
+	Ar << ItemSetPaths;
+	Ar << Tables.Items;
+	if (Ar.IsError()) return;
+	if (Ar.IsLoading())
+	{
+		for (const FString& Path : ItemSetPaths)
+		{
+			if (Path.IsEmpty() || !KnownItemSets)
+			{
+				Tables.ItemSets.Add(Path.IsEmpty()? nullptr : LoadObject<UTiledItemSet>(nullptr, *Path));
+				continue;
+			}
+			UTiledItemSet* const* ItemSet = KnownItemSets->Find(Path);
+			if (!ItemSet)
+			{
+				Ar.SetError();
+				return;
+			}
+			Tables.ItemSets.Add(*ItemSet);
+		}
+	}
+
+	SerializePlacementArray(Ar, Data.BlockPlacements, TileSize, Tables);
+	SerializePlacementArray(Ar, Data.FloorPlacements, TileSize, Tables);
+	SerializePlacementArray(Ar, Data.WallPlacements, TileSize, Tables);
+	SerializePlacementArray(Ar, Data.EdgePlacements, TileSize, Tables);
+	SerializePlacementArray(Ar, Data.PillarPlacements, TileSize, Tables);
+	SerializePlacementArray(Ar, Data.PointPlacements, TileSize, Tables);
+}
+
+void FTiledLevelGameData::SaveToBinary(const FVector& TileSize, TArray<uint8>& OutBytes) const
+{
+	FMemoryWriter Writer(OutBytes);
+	FVector SavedTileSize = TileSize;
+	// saving doesn't modify data, the archive functions just work both ways
+	SerializeGameData(Writer, const_cast<FTiledLevelGameData&>(*this), SavedTileSize);
+}
+
+bool FTiledLevelGameData::LoadFromBinary(const TArray<uint8>& InBytes, FVector& OutTileSize, const TMap<FString, UTiledItemSet*>* KnownItemSets)
+{
+	FTiledLevelGameData Loaded;
+	FMemoryReader Reader(InBytes);
+	SerializeGameData(Reader, Loaded, OutTileSize, KnownItemSets);
+	if (Reader.IsError() || !Reader.AtEnd())
+		return false;
+	*this = Loaded;
+	MarkOccupancyIndexDirty();
+	return true;
+}
+
+FTiledNetPlacement::FTiledNetPlacement(const FTilePlacement& P, EPlacedType InPlacedType)
+	: ItemSet(P.ItemSet), ItemID(P.ItemID), PlacedType(InPlacedType), Position(P.GridPosition), ExtraInfo(P.Extent),
+	  IsMirrored(P.IsMirrored), TileObjectTransform(P.TileObjectTransform)
+{}
+
+FTiledNetPlacement::FTiledNetPlacement(const FEdgePlacement& P, EPlacedType InPlacedType)
+	: ItemSet(P.ItemSet), ItemID(P.ItemID), PlacedType(InPlacedType), Position(P.Edge.GetEdgePosition()),
+	  ExtraInfo(0, 0, static_cast<int32>(P.Edge.EdgeType)), IsMirrored(P.IsMirrored), TileObjectTransform(P.TileObjectTransform)
+{}
+
+FTiledNetPlacement::FTiledNetPlacement(const FPointPlacement& P, EPlacedType InPlacedType)
+	: ItemSet(P.ItemSet), ItemID(P.ItemID), PlacedType(InPlacedType), Position(P.GridPosition),
+	  IsMirrored(P.IsMirrored), TileObjectTransform(P.TileObjectTransform)
+{}
+
+FTilePlacement FTiledNetPlacement::MakeTilePlacement() const
+{
+	FTilePlacement P;
+	P.ItemSet = ItemSet;
+	P.ItemID = ItemID;
+	P.IsMirrored = IsMirrored;
+	P.TileObjectTransform = TileObjectTransform;
+	P.GridPosition = Position;
+	P.Extent = ExtraInfo;
+	return P;
+}
+
+FEdgePlacement FTiledNetPlacement::MakeEdgePlacement() const
+{
+	FEdgePlacement P;
+	P.ItemSet = ItemSet;
+	P.ItemID = ItemID;
+	P.IsMirrored = IsMirrored;
+	P.TileObjectTransform = TileObjectTransform;
+	P.Edge = FTiledLevelEdge(Position, ExtraInfo.Z == static_cast<int32>(EEdgeType::Vertical)? EEdgeType::Vertical : EEdgeType::Horizontal);
+	return P;
+}
+
+FPointPlacement FTiledNetPlacement::MakePointPlacement() const
+{
+	FPointPlacement P;
+	P.ItemSet = ItemSet;
+	P.ItemID = ItemID;
+	P.IsMirrored = IsMirrored;
+	P.TileObjectTransform = TileObjectTransform;
+	P.GridPosition = Position;
+	return P;
+}
+
+FTiledActorHandle FTiledNetPlacement::GetHandle() const
+{
+	FTiledActorHandle Handle;
+	Handle.Position = Position;
+	Handle.ExtraInfo = ExtraInfo;
+	Handle.ItemID = ItemID;
+	return Handle;
+}
+
+bool FTiledNetPlacement::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// item set goes through the package map, the guid is sent whole since the set may not be resolved yet on the client
+	UObject* ItemSetObject = ItemSet;
+	Ar << ItemSetObject;
+	if (Ar.IsLoading())
+		ItemSet = Cast<UTiledItemSet>(ItemSetObject);
+	Ar << ItemID;
+	uint8 Flags = static_cast<uint8>(PlacedType) | (IsMirrored? 8 : 0);
+	Ar << Flags;
+	PlacedType = static_cast<EPlacedType>(Flags & 7);
+	IsMirrored = (Flags & 8) != 0;
+	if (PlacedType >= EPlacedType::Any)
+		Ar.SetError();
+	SerializePackedIntVector(Ar, Position);
+	SerializePackedIntVector(Ar, ExtraInfo);
+	// no tile size without the item set, so no grid origin either, common translations are still exact floats
+	SerializePlacementTransform(Ar, TileObjectTransform, FVector::ZeroVector);
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
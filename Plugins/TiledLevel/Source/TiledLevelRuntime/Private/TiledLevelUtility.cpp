@@ -12,10 +12,16 @@
 #include "TiledLevelEditorLog.h"
 #include "TiledLevelGrid.h"
 #include "TiledLevelItem.h"
+#include "TiledLevelStats.h"
+#include "TiledItemSet.h"
 #include "Components/HierarchicalInstancedStaticMeshComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "Engine/StaticMesh.h"
 #include "TimerManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Async/ParallelFor.h"
+#include "Misc/SecureHash.h"
+#include "UObject/GCObject.h"
 
 bool FTiledLevelUtility::IsTilePlacementOverlapping(const FTilePlacement& Tile1, const FTilePlacement& Tile2)
 {
@@ -625,65 +631,82 @@ FString FTiledLevelUtility::GetFloorNameFromPosition(int FloorPositionIndex)
 	return FString::Printf(TEXT("%dF"), FloorPositionIndex + 1);
 }
 
-void FTiledLevelUtility::FloodFill(TArray<TArray<int>>& InBoard, const FIntPoint& InBoardSize, int X, int Y,
-	TArray<FIntPoint>& FilledTarget)
+/*
+ * Scanline fill: fill the whole span of a seed row, then push one seed per open run in the rows above and below.
+ * Uses an explicit stack, so a 1024x1024 board (or a 1-tile wide spiral) won't blow the call stack like the old recursive one.
+ * CanMove(X, Y, DX, DY) tells whether the step from (X, Y) to its neighbour is allowed, it must be symmetric.
+ */
+template <typename FCanMove>
+static void ScanlineFill(FTiledFillBoard& Board, bool bTargetValue, int X, int Y, TArray<FIntPoint>& OutFilled, FCanMove CanMove)
 {
-	// copy from https://www.educative.io/edpresso/flood-fill-algorithm-in-cpp
-	// works like a charm!!
-	if (X < 0 || X >= InBoardSize.X || Y < 0 || Y >= InBoardSize.Y)
-		return;
-	// 0 will be empty place, 1 will be occupied region
-	if (InBoard[X][Y] == 1)
+	if (!Board.IsInside(X, Y) || Board.Get(X, Y) != bTargetValue)
 		return;
-	InBoard[X][Y] = 1;
-	FilledTarget.Add(FIntPoint(X, Y));
-	
-	FloodFill(InBoard, InBoardSize, X+1, Y, FilledTarget);
-	FloodFill(InBoard, InBoardSize, X-1, Y, FilledTarget);
-	FloodFill(InBoard, InBoardSize, X, Y+1, FilledTarget);
-	FloodFill(InBoard, InBoardSize, X, Y-1, FilledTarget);
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_FloodFill);
+	const FIntPoint Size = Board.GetSize();
+	TArray<FIntPoint> Seeds;
+	Seeds.Add(FIntPoint(X, Y));
+	while (Seeds.Num() > 0)
+	{
+		const FIntPoint Seed = Seeds.Pop(false);
+		if (Board.Get(Seed.X, Seed.Y) != bTargetValue)
+			continue;
+		const int SY = Seed.Y;
+		int L = Seed.X;
+		int R = Seed.X;
+		while (L > 0 && Board.Get(L - 1, SY) == bTargetValue && CanMove(L, SY, -1, 0))
+			L--;
+		while (R < Size.X - 1 && Board.Get(R + 1, SY) == bTargetValue && CanMove(R, SY, 1, 0))
+			R++;
+		for (int i = L; i <= R; i++)
+		{
+			Board.Set(i, SY, !bTargetValue);
+			OutFilled.Add(FIntPoint(i, SY));
+		}
+		INC_DWORD_STAT_BY(STAT_TiledLevel_FloodFilledTiles, R - L + 1);
+		for (const int DY : {-1, 1})
+		{
+			const int NY = SY + DY;
+			if (NY < 0 || NY >= Size.Y)
+				continue;
+			bool IsInRun = false;
+			for (int i = L; i <= R; i++)
+			{
+				const bool IsOpen = Board.Get(i, NY) == bTargetValue && CanMove(i, SY, 0, DY);
+				// a run in the next row is also cut by anything blocking inside that row
+				if (IsOpen && (!IsInRun || !CanMove(i - 1, NY, 1, 0)))
+					Seeds.Add(FIntPoint(i, NY));
+				IsInRun = IsOpen;
+			}
+		}
+	}
 }
 
-void FTiledLevelUtility::FloodFillByEdges(const TArray<FTiledLevelEdge>& BlockingEdges, TArray<TArray<int>>& InBoard, const FIntPoint& InBoardSize, int X,
+void FTiledLevelUtility::FloodFill(FTiledFillBoard& InBoard, int X, int Y, TArray<FIntPoint>& FilledTarget)
+{
+	// false will be empty place, true will be occupied region
+	ScanlineFill(InBoard, false, X, Y, FilledTarget, [](int, int, int, int) { return true; });
+}
+
+void FTiledLevelUtility::FloodFillByEdges(const TSet<FTiledLevelEdge>& BlockingEdges, FTiledFillBoard& InBoard, int X,
 	int Y, TArray<FIntPoint>& FilledTarget)
 {
-	if (X < 0 || X >= InBoardSize.X || Y < 0 || Y >= InBoardSize.Y)
-		return;
-	if (InBoard[X][Y] == 1)
-		return;
-	InBoard[X][Y] = 1;
-	FilledTarget.Add(FIntPoint(X, Y));
-
-	// test right
-	if (!BlockingEdges.Contains(FTiledLevelEdge(X + 1, Y, 1, EEdgeType::Vertical)))
-		FloodFillByEdges(BlockingEdges, InBoard, InBoardSize, X + 1, Y, FilledTarget);
-	// test left
-	if (!BlockingEdges.Contains(FTiledLevelEdge(X, Y, 1, EEdgeType::Vertical)))
-		FloodFillByEdges(BlockingEdges, InBoard, InBoardSize, X - 1, Y, FilledTarget);
-	//test up
-	if (!BlockingEdges.Contains(FTiledLevelEdge(X, Y, 1, EEdgeType::Horizontal)))
-		FloodFillByEdges(BlockingEdges, InBoard, InBoardSize, X, Y - 1, FilledTarget);
-	// test down
-	if (!BlockingEdges.Contains(FTiledLevelEdge(X, Y + 1, 1, EEdgeType::Horizontal)))
-		FloodFillByEdges(BlockingEdges, InBoard, InBoardSize, X, Y + 1, FilledTarget);
+	ScanlineFill(InBoard, false, X, Y, FilledTarget, [&BlockingEdges](int TX, int TY, int DX, int DY)
+	{
+		if (DX == 1) // right
+			return !BlockingEdges.Contains(FTiledLevelEdge(TX + 1, TY, 1, EEdgeType::Vertical));
+		if (DX == -1) // left
+			return !BlockingEdges.Contains(FTiledLevelEdge(TX, TY, 1, EEdgeType::Vertical));
+		if (DY == -1) // up
+			return !BlockingEdges.Contains(FTiledLevelEdge(TX, TY, 1, EEdgeType::Horizontal));
+		// down
+		return !BlockingEdges.Contains(FTiledLevelEdge(TX, TY + 1, 1, EEdgeType::Horizontal));
+	});
 }
 
-void FTiledLevelUtility::GetConsecutiveTiles(TArray<TArray<int>>& InBoard, FIntPoint InBoardSize, int X, int Y,
-                                             TArray<FIntPoint>& OutTiles)
+void FTiledLevelUtility::GetConsecutiveTiles(FTiledFillBoard& InBoard, int X, int Y, TArray<FIntPoint>& OutTiles)
 {
-	if (X < 0 || X >= InBoardSize.X || Y < 0 || Y >= InBoardSize.Y)
-		return;
-	// 0 will be empty place, 1 will be occupied region
-	if (InBoard[X][Y] == 0)
-		return;
-	InBoard[X][Y] = 0;
-	OutTiles.Add(FIntPoint(X, Y));
-	
-	GetConsecutiveTiles(InBoard, InBoardSize, X+1, Y,OutTiles);
-	GetConsecutiveTiles(InBoard, InBoardSize, X-1, Y,OutTiles);
-	GetConsecutiveTiles(InBoard, InBoardSize, X, Y+1,OutTiles);
-	GetConsecutiveTiles(InBoard, InBoardSize, X, Y-1,OutTiles);
-	
+	// true will be occupied region, collect the connected occupied tiles
+	ScanlineFill(InBoard, true, X, Y, OutTiles, [](int, int, int, int) { return true; });
 }
 
 TArray<float> FTiledLevelUtility::GetWeightedCoefficient(TArray<float>& RawCoefficientArray)
@@ -1004,8 +1027,18 @@ bool FTiledLevelUtility::CheckOverlappedTiledLevels(ATiledLevel* FirstLevel, ATi
 	return B1.Intersect(B2);
 }
 
-FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshComponent* ProcMeshComp)
+// polygon group name of a section material, sections without one get the default material
+static FName GetMaterialSlotName(const UMaterialInterface* Material)
 {
+	return Material? Material->GetFName() : UMaterial::GetDefaultMaterial(MD_Surface)->GetFName();
+}
+
+// sections and their material slots could come from a proc mesh component or straight from the merge
+// no UObject is touched in here, so it can run on any thread
+static FMeshDescription BuildMeshDescriptionFromSections(TArrayView<const FProcMeshSection* const> Sections,
+	TArrayView<const FName> SectionSlotNames, const TAtomic<bool>* CancelFlag = nullptr)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_MergeMeshDescription);
 	FMeshDescription MeshDescription;
 	FStaticMeshAttributes AttributeGetter(MeshDescription);
 	AttributeGetter.Register();
@@ -1019,28 +1052,21 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 	TVertexInstanceAttributesRef<FVector2f> UVs = AttributeGetter.GetVertexInstanceUVs();
 	
 	// Materials to apply to new mesh
-	const int32 NumSections = ProcMeshComp->GetNumSections();
+	const int32 NumSections = Sections.Num();
 	int32 VertexCount = 0;
 	int32 VertexInstanceCount = 0;
 	int32 PolygonCount = 0;
 	
-	TMap<UMaterialInterface*, FPolygonGroupID> UniqueMaterials;
+	TMap<FName, FPolygonGroupID> UniqueMaterials;
 	UniqueMaterials.Reserve(NumSections);
 	for (int32 SectionIdx = 0; SectionIdx < NumSections; SectionIdx++)
 	{
-		FProcMeshSection *ProcSection =
-			ProcMeshComp->GetProcMeshSection(SectionIdx);
-		UMaterialInterface *Material = ProcMeshComp->GetMaterial(SectionIdx);
-		if (Material == nullptr)
-		{
-			Material = UMaterial::GetDefaultMaterial(MD_Surface);
-		}
-	
-		if (!UniqueMaterials.Contains(Material))
+		const FName SlotName = SectionSlotNames[SectionIdx];
+		if (!UniqueMaterials.Contains(SlotName))
 		{
 			FPolygonGroupID NewPolygonGroup = MeshDescription.CreatePolygonGroup();
-			UniqueMaterials.Add(Material, NewPolygonGroup);
-			PolygonGroupNames[NewPolygonGroup] = Material->GetFName();
+			UniqueMaterials.Add(SlotName, NewPolygonGroup);
+			PolygonGroupNames[NewPolygonGroup] = SlotName;
 		}
 	}
 	TArray<FPolygonGroupID> PolygonGroupForSection;
@@ -1049,8 +1075,7 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 	// Calculate the totals for each ProcMesh element type
 	for (int32 SectionIdx = 0; SectionIdx < NumSections; SectionIdx++)
 	{
-		FProcMeshSection *ProcSection =
-			ProcMeshComp->GetProcMeshSection(SectionIdx);
+		const FProcMeshSection* ProcSection = Sections[SectionIdx];
 		VertexCount += ProcSection->ProcVertexBuffer.Num();
 		VertexInstanceCount += ProcSection->ProcIndexBuffer.Num();
 		PolygonCount += ProcSection->ProcIndexBuffer.Num() / 3;
@@ -1064,15 +1089,7 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 	// Create the Polygon Groups
 	for (int32 SectionIdx = 0; SectionIdx < NumSections; SectionIdx++)
 	{
-		FProcMeshSection *ProcSection =
-			ProcMeshComp->GetProcMeshSection(SectionIdx);
-		UMaterialInterface *Material = ProcMeshComp->GetMaterial(SectionIdx);
-		if (Material == nullptr)
-		{
-			Material = UMaterial::GetDefaultMaterial(MD_Surface);
-		}
-	
-		FPolygonGroupID *PolygonGroupID = UniqueMaterials.Find(Material);
+		FPolygonGroupID *PolygonGroupID = UniqueMaterials.Find(SectionSlotNames[SectionIdx]);
 		check(PolygonGroupID != nullptr);
 		PolygonGroupForSection.Add(*PolygonGroupID);
 	}
@@ -1081,8 +1098,8 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 	// Add Vertex and VertexInstance and polygon for each section
 	for (int32 SectionIdx = 0; SectionIdx < NumSections; SectionIdx++)
 	{
-		FProcMeshSection *ProcSection =
-			ProcMeshComp->GetProcMeshSection(SectionIdx);
+		const FProcMeshSection* ProcSection = Sections[SectionIdx];
+		if (CancelFlag && *CancelFlag) return FMeshDescription();
 		FPolygonGroupID PolygonGroupID = PolygonGroupForSection[SectionIdx];
 		// Create the vertex
 		int32 NumVertex = ProcSection->ProcVertexBuffer.Num();
@@ -1090,7 +1107,7 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 		VertexIndexToVertexID.Reserve(NumVertex);
 		for (int32 VertexIndex = 0; VertexIndex < NumVertex; ++VertexIndex)
 		{
-			FProcMeshVertex &Vert = ProcSection->ProcVertexBuffer[VertexIndex];
+			const FProcMeshVertex& Vert = ProcSection->ProcVertexBuffer[VertexIndex];
 			const FVertexID VertexID = MeshDescription.CreateVertex();
 			VertexPositions[VertexID] = FVector3f(Vert.Position);
 			VertexIndexToVertexID.Add(VertexIndex, VertexID);
@@ -1108,7 +1125,7 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 				MeshDescription.CreateVertexInstance(VertexID);
 			IndiceIndexToVertexInstanceID.Add(IndiceIndex, VertexInstanceID);
 	
-			FProcMeshVertex &ProcVertex = ProcSection->ProcVertexBuffer[VertexIndex];
+			const FProcMeshVertex& ProcVertex = ProcSection->ProcVertexBuffer[VertexIndex];
 	
 			Tangents[VertexInstanceID] = FVector3f(ProcVertex.Tangent.TangentX);
 			Normals[VertexInstanceID] = FVector3f(ProcVertex.Normal);
@@ -1146,32 +1163,51 @@ FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshCompone
 	return MeshDescription;
 }
 
-UProceduralMeshComponent* FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(UTiledLevelAsset* TargetAsset,
-	int TargetLOD, UObject* Outer, EObjectFlags Flags)
+FMeshDescription FTiledLevelUtility::BuildMeshDescription(UProceduralMeshComponent* ProcMeshComp)
 {
-	struct FCollisionVertex
+	TArray<const FProcMeshSection*> Sections;
+	TArray<FName> SectionSlotNames;
+	for (int32 SectionIdx = 0; SectionIdx < ProcMeshComp->GetNumSections(); SectionIdx++)
 	{
-		TArray<FVector> CollisionVertex;
-	};
-	
-	struct FPerSectionData
-	{
-		UStaticMesh* MeshPtr;
-		int LOD;
-		int SectionID;
-		UMaterialInterface* SectionMaterial;
-		TArray<FVector> Vertex;
-		TArray<int> Triangles;
-		TArray<FVector> Normals;
-		TArray<FVector2D> UV;
-		TArray<FProcMeshTangent> Tangents;
-		TArray<FColor> VertexColor;
-		TArray<FCollisionVertex> CollisionData;
-	};
+		Sections.Add(ProcMeshComp->GetProcMeshSection(SectionIdx));
+		SectionSlotNames.Add(GetMaterialSlotName(ProcMeshComp->GetMaterial(SectionIdx)));
+	}
+	return BuildMeshDescriptionFromSections(Sections, SectionSlotNames);
+}
 
-	if (!Outer)
-		Outer = TargetAsset;
-	UProceduralMeshComponent* ProcMeshComp = NewObject<UProceduralMeshComponent>(Outer, NAME_None, Flags);
+// Merge into proc mesh
+struct FTiledMergeCollision
+{
+	TArray<FVector> CollisionVertex;
+};
+
+struct FTiledMergeSection
+{
+	UStaticMesh* MeshPtr;
+	int LOD;
+	int SectionID;
+	UMaterialInterface* SectionMaterial;
+	// resolved on game thread for the builds running off it, path is empty without material
+	FString SectionMaterialPath;
+	FName SectionMaterialSlot;
+	TArray<FVector> Vertex;
+	TArray<int> Triangles;
+	TArray<FVector> Normals;
+	TArray<FVector2D> UV;
+	TArray<FProcMeshTangent> Tangents;
+	TArray<FColor> VertexColor;
+	TArray<FTiledMergeCollision> CollisionData;
+};
+
+static TAutoConsoleVariable<bool> CVarParallelMeshMerge(
+	TEXT("TiledLevel.ParallelMeshMerge"),
+	true,
+	TEXT("Transform vertices of each placement in parallel when merging a tiled level asset into a mesh."));
+
+// construct template data (source mesh sections) and the empty sections to fill, both in the same order
+static void BuildMergeTemplates(UTiledLevelAsset* TargetAsset, int TargetLOD, TArray<FTiledMergeSection>& SectionTemplateData, TArray<FTiledMergeSection>& ProcData)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_MergeTemplates);
 	TMap<UStaticMesh*, int> MeshLODMap;
 	for (UStaticMesh* SMPtr : TargetAsset->GetUsedStaticMeshSet())
 	{
@@ -1180,24 +1216,23 @@ UProceduralMeshComponent* FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(U
 			MeshLODMap.Add(SMPtr, SMPtr->GetNumLODs()-1) : MeshLODMap.Add(SMPtr, TargetLOD);
 	}
 	
-	// construct template data ... and
-	// init proc data
-	TArray<FPerSectionData> SectionTemplateData;
-	TArray<FPerSectionData> ProcData;
 	for (auto MeshLOD : MeshLODMap)
 	{
 		for (int SectionID = 0; SectionID < MeshLOD.Key->GetNumSections(MeshLOD.Value); SectionID++)
 		{
-			FPerSectionData NewSectionData;
+			UMaterialInterface* SectionMaterial = MeshLOD.Key->GetMaterial(SectionID);
+			FTiledMergeSection NewSectionData;
 			NewSectionData.MeshPtr = MeshLOD.Key;
 			NewSectionData.LOD = MeshLOD.Value;
 			NewSectionData.SectionID = SectionID;
-			NewSectionData.SectionMaterial = MeshLOD.Key->GetMaterial(SectionID);
-			FPerSectionData InitSectionData;
+			NewSectionData.SectionMaterial = SectionMaterial;
+			FTiledMergeSection InitSectionData;
 			InitSectionData.MeshPtr = MeshLOD.Key;
 			InitSectionData.LOD = MeshLOD.Value;
 			InitSectionData.SectionID = SectionID;
-			InitSectionData.SectionMaterial = MeshLOD.Key->GetMaterial(SectionID);
+			InitSectionData.SectionMaterial = SectionMaterial;
+			InitSectionData.SectionMaterialPath = SectionMaterial? SectionMaterial->GetPathName() : FString();
+			InitSectionData.SectionMaterialSlot = GetMaterialSlotName(SectionMaterial);
 			UKismetProceduralMeshLibrary::GetSectionFromStaticMesh(MeshLOD.Key, MeshLOD.Value, SectionID, NewSectionData.Vertex,
 				NewSectionData.Triangles, NewSectionData.Normals, NewSectionData.UV, NewSectionData.Tangents);
 			if (MeshLOD.Key->GetBodySetup() != nullptr)
@@ -1205,7 +1240,7 @@ UProceduralMeshComponent* FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(U
 				const int32 NumConvex = MeshLOD.Key->GetBodySetup()->AggGeom.ConvexElems.Num();
 				for (int ConvexIndex = 0; ConvexIndex < NumConvex; ConvexIndex++)
 				{
-					FCollisionVertex CV;
+					FTiledMergeCollision CV;
 					CV.CollisionVertex = MeshLOD.Key->GetBodySetup()->AggGeom.ConvexElems[ConvexIndex].VertexData;
 					NewSectionData.CollisionData.Add(CV);
 				}
@@ -1217,32 +1252,32 @@ UProceduralMeshComponent* FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(U
 				// The num of vertex is actually 3 times more than original for smoothing purpose EX: 40 VS 12
 				TMap<FVector3f, FColor> VertexColorMap;
 				MeshLOD.Key->GetVertexColorData(VertexColorMap);
+				NewSectionData.VertexColor.Reserve(NewSectionData.Vertex.Num());
 				for (FVector& v : NewSectionData.Vertex)
 				{
-					if (VertexColorMap.Contains(FVector3f(v)))
-						 NewSectionData.VertexColor.Add(VertexColorMap[FVector3f(v)]);
-					else
-						NewSectionData.VertexColor.Add(FColor::White);
+					const FColor* Found = VertexColorMap.Find(FVector3f(v));
+					NewSectionData.VertexColor.Add(Found? *Found : FColor::White);
 				}
 			} else
 			{
-				TArray<FColor> Whites;
-				Whites.Init(FColor::White, NewSectionData.Vertex.Num());
-				NewSectionData.VertexColor.Append(Whites);
+				NewSectionData.VertexColor.Init(FColor::White, NewSectionData.Vertex.Num());
 			}
 			SectionTemplateData.Add(NewSectionData);	
 			ProcData.Add(InitSectionData);
 		}
 	}
+}
 
-	// fill proc data
-	TArray<UStaticMesh*> TargetMeshes;
-	TArray<FTransform> TransformMods;
-	for (FTiledFloor F : TargetAsset->TiledFloors)
+// every mesh item placement and static mesh of spawned tiled actors
+static void GatherMergeInstances(UTiledLevelAsset* TargetAsset, TArray<UStaticMesh*>& TargetMeshes, TArray<FTransform>& TransformMods)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_MergeGather);
+	for (const FTiledFloor& F : TargetAsset->TiledFloors)
 	{
-		for (FItemPlacement P : F.GetItemPlacements())
+		for (const FItemPlacement& P : F.GetItemPlacements())
 		{
-			UStaticMesh* ItemMesh = P.GetItem()->TiledMesh;
+			const UTiledLevelItem* Item = P.GetItem();
+			UStaticMesh* ItemMesh = Item? Item->TiledMesh : nullptr;
 			if (ItemMesh)
 			{
 				TargetMeshes.Add(ItemMesh);
@@ -1250,91 +1285,416 @@ UProceduralMeshComponent* FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(U
 			}
 		}
 	}
-	FTransform CachedHostLevelTransform = TargetAsset->HostLevel->GetTransform();
-	TargetAsset->HostLevel->SetActorTransform(FTransform());
-	for (AActor* SpawnedActor : TargetAsset->HostLevel->SpawnedTiledActors)
+	// not placed in any level (ex: merged by the commandlet), so no spawned actors either
+	if (TargetAsset->HostLevel)
 	{
-		for (UActorComponent* AC : SpawnedActor->GetComponents())
+		FTransform CachedHostLevelTransform = TargetAsset->HostLevel->GetTransform();
+		TargetAsset->HostLevel->SetActorTransform(FTransform());
+		for (AActor* SpawnedActor : TargetAsset->HostLevel->SpawnedTiledActors)
 		{
-			if (UStaticMeshComponent* SMC = Cast<UStaticMeshComponent>(AC))
+			if (!SpawnedActor) continue;
+			for (UActorComponent* AC : SpawnedActor->GetComponents())
 			{
-				if (SMC->GetStaticMesh())
+				if (UStaticMeshComponent* SMC = Cast<UStaticMeshComponent>(AC))
 				{
-					TargetMeshes.Add(SMC->GetStaticMesh());
-					TransformMods.Add(SMC->GetComponentTransform());
+					if (SMC->GetStaticMesh())
+					{
+						TargetMeshes.Add(SMC->GetStaticMesh());
+						TransformMods.Add(SMC->GetComponentTransform());
+					}
 				}
 			}
 		}
+		TargetAsset->HostLevel->SetActorTransform(CachedHostLevelTransform);
 	}
-	TargetAsset->HostLevel->SetActorTransform(CachedHostLevelTransform);
-	
+	INC_DWORD_STAT_BY(STAT_TiledLevel_MergedInstances, TargetMeshes.Num());
+}
+
+// the original one by one append, kept as the reference for the parallel path
+static void FillMergeSectionsSerial(const TArray<UStaticMesh*>& TargetMeshes, const TArray<FTransform>& TransformMods,
+	const TArray<FTiledMergeSection>& SectionTemplateData, TArray<FTiledMergeSection>& ProcData)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_MergeFill);
+	// the sections of each mesh, in LOD and section order, same as looping the mesh's LODs and sections
+	// (only the sections are read, the meshes are never touched off the game thread)
+	TMap<UStaticMesh*, TArray<int32>> MeshSections;
+	for (int32 s = 0; s < ProcData.Num(); s++)
+		MeshSections.FindOrAdd(ProcData[s].MeshPtr).Add(s);
+
 	for (int i = 0; i < TargetMeshes.Num(); i++)
 	{
-		for (int LOD = 0; LOD < TargetMeshes[i]->GetNumLODs(); LOD++)
+		const TArray<int32>* Sections = MeshSections.Find(TargetMeshes[i]);
+		if (!Sections) continue;
+		for (const int32 s : *Sections)
 		{
-			for (int SectionID = 0 ; SectionID < TargetMeshes[i]->GetNumSections(LOD); SectionID++)
+			FTiledMergeSection* DataToFill = &ProcData[s];
+			const FTiledMergeSection* TemplateToCopy = &SectionTemplateData[s];
+			// vertex
+			int NumOfExistingVertex = DataToFill->Vertex.Num();
+			for (FVector v : TemplateToCopy->Vertex)
 			{
-				FPerSectionData* DataToFill = ProcData.FindByPredicate([=](const FPerSectionData& Data)
-				{
-					return Data.SectionID == SectionID && Data.MeshPtr==TargetMeshes[i] && Data.LOD == LOD;
-				});
-				FPerSectionData* TemplateToCopy = SectionTemplateData.FindByPredicate([=](const FPerSectionData& Data)
-				{
-					return Data.SectionID == SectionID && Data.MeshPtr==TargetMeshes[i] && Data.LOD == LOD;
-				});
+				DataToFill->Vertex.Add(TransformMods[i].TransformPosition(v));
+			}
+			
+			// triangle
+			for (int t : TemplateToCopy->Triangles)
+			{
+				DataToFill->Triangles.Add(t + NumOfExistingVertex);
+			}
+			
+			// normal
+			for (FVector n : TemplateToCopy->Normals)
+				DataToFill->Normals.Add(TransformMods[i].GetRotation().RotateVector(n));
+			 
+			// uv
+			DataToFill->UV.Append(TemplateToCopy->UV);
+			
+			// tangent
+			DataToFill->Tangents.Append(TemplateToCopy->Tangents);
+			
+			// vertex color
+			DataToFill->VertexColor.Append(TemplateToCopy->VertexColor);
 
-				if (!DataToFill) continue;
-				// vertex
-				int NumOfExistingVertex = DataToFill->Vertex.Num();
-				for (FVector v : TemplateToCopy->Vertex)
-				{
-					DataToFill->Vertex.Add(TransformMods[i].TransformPosition(v));
-				}
-				
-				// triangle
-				for (int t : TemplateToCopy->Triangles)
-				{
-					DataToFill->Triangles.Add(t + NumOfExistingVertex);
-				}
-				
-				// normal
-				for (FVector n : TemplateToCopy->Normals)
-					DataToFill->Normals.Add(TransformMods[i].GetRotation().RotateVector(n));
-				 
-				// uv
-				DataToFill->UV.Append(TemplateToCopy->UV);
-				
-				// tangent
-				DataToFill->Tangents.Append(TemplateToCopy->Tangents);
-				
-				// vertex color
-				DataToFill->VertexColor.Append(TemplateToCopy->VertexColor);
-
-				// Collision data
-				int NumOfCollisions = TemplateToCopy->CollisionData.Num();
-				for (int CollisionIndex = 0; CollisionIndex < NumOfCollisions; CollisionIndex++ )
+			// Collision data
+			int NumOfCollisions = TemplateToCopy->CollisionData.Num();
+			for (int CollisionIndex = 0; CollisionIndex < NumOfCollisions; CollisionIndex++ )
+			{
+				FTiledMergeCollision CV;
+				for (FVector v : TemplateToCopy->CollisionData[CollisionIndex].CollisionVertex)
 				{
-					FCollisionVertex CV;
-					for (FVector v : TemplateToCopy->CollisionData[CollisionIndex].CollisionVertex)
-					{
-						CV.CollisionVertex.Add(TransformMods[i].TransformPosition(v));
-					}
-					 DataToFill->CollisionData.Add(CV);
+					CV.CollisionVertex.Add(TransformMods[i].TransformPosition(v));
 				}
+				 DataToFill->CollisionData.Add(CV);
 			}
 		}
 	}
+}
+
+// Same output as the serial one. Every placement of a mesh adds the same amount of data to each of that mesh's sections,
+// so the k-th placement of a mesh writes to a known range of the pre-sized buffers, and placements can be done in parallel.
+static void FillMergeSectionsParallel(const TArray<UStaticMesh*>& TargetMeshes, const TArray<FTransform>& TransformMods,
+	const TArray<FTiledMergeSection>& SectionTemplateData, TArray<FTiledMergeSection>& ProcData)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_MergeFill);
+	// sections of a mesh are next to each other
+	TMap<UStaticMesh*, TPair<int32, int32>> MeshSections; // first section index, num of sections
+	for (int32 s = 0; s < ProcData.Num(); s++)
+	{
+		TPair<int32, int32>& Range = MeshSections.FindOrAdd(ProcData[s].MeshPtr, TPair<int32, int32>(s, 0));
+		Range.Value++;
+	}
+
+	TArray<int32> MeshSlot; // k-th placement of its mesh, INDEX_NONE for meshes without sections to fill
+	MeshSlot.Init(INDEX_NONE, TargetMeshes.Num());
+	TMap<UStaticMesh*, int32> MeshCounts;
+	for (int32 i = 0; i < TargetMeshes.Num(); i++)
+	{
+		if (!MeshSections.Contains(TargetMeshes[i])) continue;
+		MeshSlot[i] = MeshCounts.FindOrAdd(TargetMeshes[i])++;
+	}
+
+	for (int32 s = 0; s < ProcData.Num(); s++)
+	{
+		const FTiledMergeSection& Template = SectionTemplateData[s];
+		FTiledMergeSection& Data = ProcData[s];
+		const int32 Count = MeshCounts.FindRef(Data.MeshPtr);
+		Data.Vertex.SetNumUninitialized(Count * Template.Vertex.Num());
+		Data.Triangles.SetNumUninitialized(Count * Template.Triangles.Num());
+		Data.Normals.SetNumUninitialized(Count * Template.Normals.Num());
+		Data.UV.SetNumUninitialized(Count * Template.UV.Num());
+		Data.Tangents.SetNumUninitialized(Count * Template.Tangents.Num());
+		Data.VertexColor.SetNumUninitialized(Count * Template.VertexColor.Num());
+		Data.CollisionData.SetNum(Count * Template.CollisionData.Num());
+	}
+
+	ParallelFor(TargetMeshes.Num(), [&](int32 i)
+	{
+		const int32 k = MeshSlot[i];
+		if (k == INDEX_NONE) return;
+		const FTransform& Transform = TransformMods[i];
+		const FQuat Rotation = Transform.GetRotation();
+		const TPair<int32, int32>& Range = MeshSections[TargetMeshes[i]];
+		for (int32 s = Range.Key; s < Range.Key + Range.Value; s++)
+		{
+			const FTiledMergeSection& Template = SectionTemplateData[s];
+			FTiledMergeSection& Data = ProcData[s];
+
+			const int32 NumVertex = Template.Vertex.Num();
+			const int32 VertexStart = k * NumVertex;
+			for (int32 v = 0; v < NumVertex; v++)
+				Data.Vertex[VertexStart + v] = Transform.TransformPosition(Template.Vertex[v]);
+
+			const int32 NumTriangles = Template.Triangles.Num();
+			for (int32 t = 0; t < NumTriangles; t++)
+				Data.Triangles[k * NumTriangles + t] = Template.Triangles[t] + VertexStart;
+
+			const int32 NumNormals = Template.Normals.Num();
+			for (int32 n = 0; n < NumNormals; n++)
+				Data.Normals[k * NumNormals + n] = Rotation.RotateVector(Template.Normals[n]);
+
+			FMemory::Memcpy(Data.UV.GetData() + k * Template.UV.Num(), Template.UV.GetData(), Template.UV.Num() * sizeof(FVector2D));
+			FMemory::Memcpy(Data.Tangents.GetData() + k * Template.Tangents.Num(), Template.Tangents.GetData(), Template.Tangents.Num() * sizeof(FProcMeshTangent));
+			FMemory::Memcpy(Data.VertexColor.GetData() + k * Template.VertexColor.Num(), Template.VertexColor.GetData(), Template.VertexColor.Num() * sizeof(FColor));
+
+			const int32 NumOfCollisions = Template.CollisionData.Num();
+			for (int32 c = 0; c < NumOfCollisions; c++)
+			{
+				const TArray<FVector>& Source = Template.CollisionData[c].CollisionVertex;
+				TArray<FVector>& Target = Data.CollisionData[k * NumOfCollisions + c].CollisionVertex;
+				Target.SetNumUninitialized(Source.Num());
+				for (int32 v = 0; v < Source.Num(); v++)
+					Target[v] = Transform.TransformPosition(Source[v]);
+			}
+		}
+	});
+}
+
+UProceduralMeshComponent* FTiledLevelUtility::ConvertTiledLevelAssetToProcMesh(UTiledLevelAsset* TargetAsset,
+	int TargetLOD, UObject* Outer, EObjectFlags Flags)
+{
+	if (!Outer)
+		Outer = TargetAsset;
+	UProceduralMeshComponent* ProcMeshComp = NewObject<UProceduralMeshComponent>(Outer, NAME_None, Flags);
+	
+	TArray<FTiledMergeSection> SectionTemplateData;
+	TArray<FTiledMergeSection> ProcData;
+	BuildMergeTemplates(TargetAsset, TargetLOD, SectionTemplateData, ProcData);
+
+	// fill proc data
+	TArray<UStaticMesh*> TargetMeshes;
+	TArray<FTransform> TransformMods;
+	GatherMergeInstances(TargetAsset, TargetMeshes, TransformMods);
+	if (CVarParallelMeshMerge.GetValueOnAnyThread())
+		FillMergeSectionsParallel(TargetMeshes, TransformMods, SectionTemplateData, ProcData);
+	else
+		FillMergeSectionsSerial(TargetMeshes, TransformMods, SectionTemplateData, ProcData);
 
 	int s = 0;
-	for (FPerSectionData  Data: ProcData)
+	for (const FTiledMergeSection& Data: ProcData)
 	{
 		ProcMeshComp->CreateMeshSection(s, Data.Vertex, Data.Triangles, Data.Normals, Data.UV, Data.VertexColor, Data.Tangents, false);
+		INC_DWORD_STAT_BY(STAT_TiledLevel_MergedTriangles, Data.Triangles.Num() / 3);
 		ProcMeshComp->SetMaterial(s, Data.SectionMaterial);
 		// Collision
-		for (FCollisionVertex CV: Data.CollisionData)
+		for (const FTiledMergeCollision& CV: Data.CollisionData)
 			ProcMeshComp->AddCollisionConvexMesh(CV.CollisionVertex);
 		s++;
 	}
 	return ProcMeshComp;
 }
 
+// meshes and materials stay referenced while the build runs on another thread, only pointers are compared there
+struct FTiledMergeSource : public FGCObject
+{
+	TArray<FTiledMergeSection> SectionTemplateData;
+	TArray<FTiledMergeSection> ProcData;
+	TArray<UStaticMesh*> TargetMeshes;
+	TArray<FTransform> TransformMods;
+
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override
+	{
+		Collector.AddReferencedObjects(TargetMeshes);
+		for (FTiledMergeSection& Section : SectionTemplateData)
+		{
+			Collector.AddReferencedObject(Section.MeshPtr);
+			Collector.AddReferencedObject(Section.SectionMaterial);
+		}
+		for (FTiledMergeSection& Section : ProcData)
+		{
+			Collector.AddReferencedObject(Section.MeshPtr);
+			Collector.AddReferencedObject(Section.SectionMaterial);
+		}
+	}
+
+	virtual FString GetReferencerName() const override
+	{
+		return TEXT("FTiledMergeSource");
+	}
+};
+
+TSharedRef<FTiledMergeSource> FTiledLevelUtility::PrepareMergeSource(UTiledLevelAsset* TargetAsset, int TargetLOD)
+{
+	check(IsInGameThread());
+	TSharedRef<FTiledMergeSource> Source = MakeShared<FTiledMergeSource>();
+	BuildMergeTemplates(TargetAsset, TargetLOD, Source->SectionTemplateData, Source->ProcData);
+	GatherMergeInstances(TargetAsset, Source->TargetMeshes, Source->TransformMods);
+	return Source;
+}
+
+// same as UProceduralMeshComponent::CreateMeshSection does with its input arrays
+static void ConvertMergeSectionToProcSection(const FTiledMergeSection& Data, FProcMeshSection& OutSection)
+{
+	const int32 NumVerts = Data.Vertex.Num();
+	OutSection.ProcVertexBuffer.SetNumUninitialized(NumVerts);
+	for (int32 VertIdx = 0; VertIdx < NumVerts; VertIdx++)
+	{
+		FProcMeshVertex& Vertex = OutSection.ProcVertexBuffer[VertIdx];
+		Vertex.Position = Data.Vertex[VertIdx];
+		Vertex.Normal = Data.Normals.Num() == NumVerts? Data.Normals[VertIdx] : FVector(0.f, 0.f, 1.f);
+		Vertex.UV0 = Data.UV.Num() == NumVerts? Data.UV[VertIdx] : FVector2D(0.f, 0.f);
+		Vertex.UV1 = FVector2D(0.f, 0.f);
+		Vertex.UV2 = FVector2D(0.f, 0.f);
+		Vertex.UV3 = FVector2D(0.f, 0.f);
+		Vertex.Color = Data.VertexColor.Num() == NumVerts? Data.VertexColor[VertIdx] : FColor(255, 255, 255);
+		Vertex.Tangent = Data.Tangents.Num() == NumVerts? Data.Tangents[VertIdx] : FProcMeshTangent();
+		OutSection.SectionLocalBox += Vertex.Position;
+	}
+	const int32 MaxIndex = NumVerts - 1;
+	const int32 NumTriIndices = (Data.Triangles.Num() / 3) * 3;
+	OutSection.ProcIndexBuffer.SetNumUninitialized(NumTriIndices);
+	for (int32 i = 0; i < NumTriIndices; i++)
+		OutSection.ProcIndexBuffer[i] = FMath::Min(Data.Triangles[i], MaxIndex);
+}
+
+FMeshDescription FTiledLevelUtility::BuildMergedMeshDescription(const FTiledMergeSource& Source, TArray<TArray<FVector>>& OutConvexVertices,
+	TArray<FString>& OutSectionMaterialPaths, const TAtomic<bool>* CancelFlag)
+{
+	TArray<FTiledMergeSection> ProcData = Source.ProcData;
+	if (CVarParallelMeshMerge.GetValueOnAnyThread())
+		FillMergeSectionsParallel(Source.TargetMeshes, Source.TransformMods, Source.SectionTemplateData, ProcData);
+	else
+		FillMergeSectionsSerial(Source.TargetMeshes, Source.TransformMods, Source.SectionTemplateData, ProcData);
+	if (CancelFlag && *CancelFlag) return FMeshDescription();
+
+	TArray<FProcMeshSection> ProcSections;
+	ProcSections.SetNum(ProcData.Num());
+	TArray<const FProcMeshSection*> Sections;
+	TArray<FName> SectionSlotNames;
+	for (int32 s = 0; s < ProcData.Num(); s++)
+	{
+		ConvertMergeSectionToProcSection(ProcData[s], ProcSections[s]);
+		INC_DWORD_STAT_BY(STAT_TiledLevel_MergedTriangles, ProcData[s].Triangles.Num() / 3);
+		Sections.Add(&ProcSections[s]);
+		SectionSlotNames.Add(ProcData[s].SectionMaterialSlot);
+		OutSectionMaterialPaths.Add(ProcData[s].SectionMaterialPath);
+		for (FTiledMergeCollision& CV : ProcData[s].CollisionData)
+			OutConvexVertices.Add(MoveTemp(CV.CollisionVertex));
+		// no longer needed, keep the peak memory down for big levels
+		ProcData[s] = FTiledMergeSection();
+	}
+	return BuildMeshDescriptionFromSections(Sections, SectionSlotNames, CancelFlag);
+}
+
+FString FTiledLevelUtility::GetMergeContentHash(UTiledLevelAsset* TargetAsset)
+{
+	FSHA1 Hash;
+	auto UpdateString = [&Hash](const FString& String)
+	{
+		Hash.UpdateWithString(*String, String.Len());
+	};
+	auto UpdateVector = [&Hash](const FVector& V)
+	{
+		Hash.Update(reinterpret_cast<const uint8*>(&V), sizeof(FVector));
+	};
+
+	UpdateVector(TargetAsset->GetTileSize());
+	UpdateString(GetPathNameSafe(TargetAsset->GetItemSetAsset()));
+
+	// source meshes: a reimported or edited mesh gets a new lighting guid, its collision a new body setup guid
+	TArray<UStaticMesh*> UsedMeshes = TargetAsset->GetUsedStaticMeshSet().Array();
+	UsedMeshes.Sort([](const UStaticMesh& A, const UStaticMesh& B) { return A.GetPathName() < B.GetPathName(); });
+	for (UStaticMesh* Mesh : UsedMeshes)
+	{
+		UpdateString(Mesh->GetPathName());
+		const FGuid LightingGuid = Mesh->GetLightingGuid();
+		Hash.Update(reinterpret_cast<const uint8*>(&LightingGuid), sizeof(FGuid));
+		const int32 NumLODs = Mesh->GetNumLODs();
+		Hash.Update(reinterpret_cast<const uint8*>(&NumLODs), sizeof(int32));
+		for (const FStaticMaterial& Material : Mesh->GetStaticMaterials())
+			UpdateString(GetPathNameSafe(Material.MaterialInterface));
+		// collision is merged too (convex elements): edited collision gets a new body setup guid, trace flag changes don't
+		if (const UBodySetup* BodySetup = Mesh->GetBodySetup())
+		{
+			Hash.Update(reinterpret_cast<const uint8*>(&BodySetup->BodySetupGuid), sizeof(FGuid));
+			const uint8 TraceFlag = static_cast<uint8>(BodySetup->CollisionTraceFlag.GetValue());
+			Hash.Update(&TraceFlag, sizeof(uint8));
+			const int32 NumConvex = BodySetup->AggGeom.ConvexElems.Num();
+			Hash.Update(reinterpret_cast<const uint8*>(&NumConvex), sizeof(int32));
+		}
+	}
+
+	TArray<UStaticMesh*> TargetMeshes;
+	TArray<FTransform> TransformMods;
+	GatherMergeInstances(TargetAsset, TargetMeshes, TransformMods);
+	for (int32 i = 0; i < TargetMeshes.Num(); i++)
+	{
+		UpdateString(TargetMeshes[i]->GetPathName());
+		UpdateVector(TransformMods[i].GetTranslation());
+		const FQuat Rotation = TransformMods[i].GetRotation();
+		Hash.Update(reinterpret_cast<const uint8*>(&Rotation), sizeof(FQuat));
+		UpdateVector(TransformMods[i].GetScale3D());
+	}
+	
+	Hash.Final();
+	FSHAHash Result;
+	Hash.GetHash(Result.Hash);
+	return Result.ToString();
+}
+
+FTiledLevelGameData FTiledLevelUtility::MakeBenchmarkGameData(int32 NumPlacements, const FVector& TileSize, UTiledItemSet* ItemSet)
+{
+	FRandomStream Random(1234);
+	TArray<FGuid> ItemPool;
+	if (ItemSet)
+	{
+		for (const UTiledLevelItem* Item : ItemSet->GetItemSet())
+			if (Item) ItemPool.Add(Item->ItemID);
+	}
+	if (ItemPool.Num() == 0)
+	{
+		for (int32 i = 0; i < 40; i++)
+			ItemPool.Add(FGuid::NewGuid());
+	}
+
+	FTiledLevelGameData Data;
+	const int32 Side = FMath::CeilToInt(FMath::Sqrt(NumPlacements / 4.0));
+	int32 Count = 0;
+	for (int32 Z = 0; Count < NumPlacements; Z++)
+	{
+		for (int32 Y = 0; Y < Side && Count < NumPlacements; Y++)
+		{
+			for (int32 X = 0; X < Side && Count < NumPlacements; X++)
+			{
+				const FIntVector Position(X, Y, Z);
+				const FQuat Rotation = FRotator(0, 90 * Random.RandRange(0, 3), 0).Quaternion();
+				const FVector Origin = FVector(Position) * TileSize;
+				const int32 Kind = Count % 10;
+				if (Kind < 6)
+				{
+					FTilePlacement P;
+					P.ItemSet = ItemSet;
+					P.ItemID = ItemPool[Random.RandRange(0, ItemPool.Num() - 1)];
+					P.GridPosition = Position;
+					P.Extent = FIntVector(1, 1, Kind < 3? 1 : 0);
+					P.IsMirrored = Random.FRand() < 0.1f;
+					P.TileObjectTransform = FTransform(Rotation, Origin + FVector(50, 50, 0), P.IsMirrored? FVector(-1, 1, 1) : FVector::OneVector);
+					(Kind < 3? Data.BlockPlacements : Data.FloorPlacements).Add(P);
+				}
+				else if (Kind < 9)
+				{
+					FEdgePlacement P;
+					P.ItemSet = ItemSet;
+					P.ItemID = ItemPool[Random.RandRange(0, ItemPool.Num() - 1)];
+					P.Edge = FTiledLevelEdge(Position, Random.FRand() < 0.5f? EEdgeType::Horizontal : EEdgeType::Vertical);
+					// some arbitrary transforms, so savers can't assume everything is on the grid
+					P.TileObjectTransform = FTransform(Random.FRand() < 0.05f? FQuat(FRotator(0, Random.FRandRange(0, 360), 0)) : Rotation,
+						Origin + FVector(Random.FRandRange(0, 100), 0, 0));
+					(Kind < 8? Data.WallPlacements : Data.EdgePlacements).Add(P);
+				}
+				else
+				{
+					FPointPlacement P;
+					P.ItemSet = ItemSet;
+					P.ItemID = ItemPool[Random.RandRange(0, ItemPool.Num() - 1)];
+					P.GridPosition = Position;
+					P.TileObjectTransform = FTransform(Rotation, Origin);
+					(Random.FRand() < 0.5f? Data.PillarPlacements : Data.PointPlacements).Add(P);
+				}
+				Count++;
+			}
+		}
+	}
+	Data.HiddenFloors = {1, 3};
+	Data.Boundaries.Add(FBox(FVector(0), FVector(static_cast<double>(Side)) * TileSize));
+	return Data;
+}
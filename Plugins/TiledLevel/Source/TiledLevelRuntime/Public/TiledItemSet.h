@@ -101,6 +101,8 @@ public:
 
 
 	virtual void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const override;
+	virtual void PostLoad() override;
+	virtual void PostDuplicate(bool bDuplicateForPIE) override;
 	
 #if WITH_EDITOR
 	UFUNCTION(CallInEditor, Category="CustomData")
@@ -113,5 +115,13 @@ private:
 	UPROPERTY()
 	TArray<UTiledLevelItem*> ItemSet;
 
+	// ItemID -> Item for GetItem, items are kept alive by ItemSet above
+	mutable TMap<FGuid, UTiledLevelItem*> ItemMap;
+	// ItemSet.Num() when ItemMap was built, ItemSet restored by transaction will trigger rebuild 
+	mutable int32 ItemMapSourceNum = INDEX_NONE;
+	
+	void RegisterNewItem(UTiledLevelItem* NewItem);
+	void RebuildItemMap() const;
+	
 	EPivotPosition GetDefaultPivotPosition(EPlacedType TargetPlacedType);
 };
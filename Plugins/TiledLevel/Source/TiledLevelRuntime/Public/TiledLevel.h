@@ -4,7 +4,10 @@
 #include "CoreMinimal.h"
 #include "TiledLevelAsset.h"
 #include "TiledLevelUtility.h"
+#include "TiledLevelRestrictionHelper.h"
+#include "TiledLevelStats.h"
 #include "GameFramework/Actor.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "TiledLevel.generated.h"
 
 DECLARE_DELEGATE(FPreSaveTiledLevelActor)
@@ -13,6 +16,177 @@ class UHierarchicalInstancedStaticMeshComponent;
 struct FTilePlacement;
 struct FTiledLevelGameData;
 
+// the 6 HISM custom data floats (pos + extent) of an instance, works as the placement identity inside a HISM
+struct FTiledInstanceKey
+{
+	float Data[6];
+
+	FTiledInstanceKey() = default;
+	explicit FTiledInstanceKey(const float* InData) { FMemory::Memcpy(Data, InData, sizeof(Data)); }
+
+	bool operator==(const FTiledInstanceKey& Other) const
+	{
+		return FMemory::Memcmp(Data, Other.Data, sizeof(Data)) == 0;
+	}
+
+	bool operator!=(const FTiledInstanceKey& Other) const { return !(*this == Other); }
+
+	friend uint32 GetTypeHash(const FTiledInstanceKey& Key)
+	{
+		return FCrc::MemCrc32(Key.Data, sizeof(Key.Data));
+	}
+};
+
+/*
+ * Placement <-> instance index for a single HISM. HISM removes instances by swap-and-pop (sorted from high to low),
+ * so the lookup mirrors that instead of searching the whole custom data again.
+ * Not saved, it's rebuilt from PerInstanceSMCustomData whenever it's missing or out of sync.
+ */
+struct FTiledInstanceLookup
+{
+	TMultiMap<FTiledInstanceKey, int32> KeyToIndex;
+	TArray<FTiledInstanceKey> IndexToKey;
+};
+
+// instances waiting to be added to one HISM at once, 6 custom data floats per transform
+struct FTiledInstanceBatch
+{
+	TArray<FTransform> Transforms;
+	TArray<float> CustomData;
+	const TArray<UMaterialInterface*>* OverrideMaterials = nullptr;
+};
+
+// what a batched populate did, each HISM gets one AddInstances and one render state update instead of one per instance
+struct FTiledPopulateStats
+{
+	int32 NumInstances = 0;
+	int32 NumActors = 0;
+	int32 NumHISMs = 0;
+	int32 AvoidedRenderStateUpdates = 0;
+};
+
+// Instances are split into one HISM per mesh per floor, so a floor can be hidden by just flipping its HISMs
+// With a chunk size, each floor is further split into square chunks, an edit only rebuilds the cluster tree of its chunk
+USTRUCT()
+struct FTiledInstancePartition
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UStaticMesh* Mesh = nullptr;
+
+	UPROPERTY()
+	int32 Floor = 0;
+
+	// chunk coordinate in tiles / chunk size, always (0, 0) when chunking is off
+	UPROPERTY()
+	FIntPoint Chunk = FIntPoint(0, 0);
+
+	FTiledInstancePartition() {}
+
+	FTiledInstancePartition(UStaticMesh* InMesh, int32 InFloor)
+		: Mesh(InMesh), Floor(InFloor)
+	{}
+
+	// from HISM custom data, the first 3 floats are always the grid position
+	FTiledInstancePartition(UStaticMesh* InMesh, const float* CustomData, int32 ChunkSize = 0)
+		: Mesh(InMesh), Floor(FMath::RoundToInt(CustomData[2]))
+	{
+		if (ChunkSize > 0)
+			Chunk = FIntPoint(FMath::FloorToInt(CustomData[0] / ChunkSize), FMath::FloorToInt(CustomData[1] / ChunkSize));
+	}
+
+	bool operator== (const FTiledInstancePartition& Other) const
+	{
+		return Mesh == Other.Mesh && Floor == Other.Floor && Chunk == Other.Chunk;
+	}
+
+	friend uint32 GetTypeHash(const FTiledInstancePartition& Partition)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Partition.Mesh), GetTypeHash(Partition.Floor)), GetTypeHash(Partition.Chunk));
+	}
+};
+
+// Gametime placements replicated as fast array deltas, HISMs don't replicate so clients rebuild instances from these
+USTRUCT()
+struct FTiledReplicatedPlacement : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FTiledNetPlacement Placement;
+
+	void PreReplicatedRemove(const struct FTiledReplicatedPlacements& InArraySerializer);
+	void PostReplicatedAdd(const struct FTiledReplicatedPlacements& InArraySerializer);
+};
+
+USTRUCT()
+struct FTiledReplicatedPlacements : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FTiledReplicatedPlacement> Items;
+
+	// set by the owning level, not replicated
+	class ATiledLevel* OwnerLevel = nullptr;
+
+	// server side, each call only dirties what it touches
+	void Add(const FTiledNetPlacement& Placement);
+	// stacked placements share the handle, the transform tells which one of them goes
+	bool Remove(const FTiledActorHandle& Handle, const FTransform& Transform);
+	void Reset(const FTiledLevelGameData& Data);
+	void Reset(const class FTiledLevelSnapshot& Snapshot);
+
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters);
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+private:
+	void AddItem(const FTiledNetPlacement& Placement);
+
+	// replication id (unique per placement, stacked ones too) -> index in items, so erasing doesn't scan the whole level
+	TMap<int32, int32> ItemIndices;
+	// handle -> replication ids of the placements with it
+	TMultiMap<FTiledActorHandle, int32> HandleIds;
+	// build / erase counts, and how many of them each connection has been sent, for bandwidth stats
+	int32 NumBuilds = 0;
+	int32 NumErases = 0;
+	TMap<TWeakObjectPtr<UPackageMap>, FIntPoint> SentOps;
+};
+
+template<>
+struct TStructOpsTypeTraits<FTiledReplicatedPlacements> : public TStructOpsTypeTraitsBase2<FTiledReplicatedPlacements>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+USTRUCT()
+struct FTiledRegisteredActor
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	AActor* Actor = nullptr;
+
+	// placement transform, relative to the level
+	UPROPERTY()
+	FTransform Transform;
+};
+
+// All actors spawned for one handle. Stacked placements share the handle, the transform tells which one is which
+// (a TMultiMap would do, but it can't be a UPROPERTY and the registry is saved with the level)
+USTRUCT()
+struct FTiledRegisteredActors
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FTiledRegisteredActor> Entries;
+};
+
 // TODO: can users inherit this actor? 
 
 UCLASS(BlueprintType, NotBlueprintable)
@@ -25,13 +199,14 @@ public:
 	// Sets default values for this actor's properties
 	ATiledLevel();
 
-	// TODO: leave all replication features to next update...
-	// void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
 	virtual void OnConstruction(const FTransform& Transform) override;
 
 	virtual void BeginPlay() override;
 
+	virtual void PostLoad() override;
+
 #if WITH_EDITOR
 	// TODO: leave all replication features to next update...
 	// virtual void PostDuplicate(bool bDuplicateForPIE) override;
@@ -42,6 +217,8 @@ public:
 	
 	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
 
+	virtual void PostEditUndo() override;
+
 #endif	
 	virtual void Destroyed() override;
 	
@@ -51,21 +228,39 @@ public:
 	// TODO: HISM, ISM do not replicate... they just don't replicate... need other way around to implement it...
 	// TODO: with this setup, there is no way to handle same SMptr in different ItemSet!?
 	UPROPERTY()
+	TMap<FTiledInstancePartition, UHierarchicalInstancedStaticMeshComponent*> TiledObjectPartitions;
+
+	// Deprecated: one HISM per mesh for all floors, only kept to clean up levels saved before floor partitions
+	UPROPERTY()
 	TMap<UStaticMesh* , UHierarchicalInstancedStaticMeshComponent*> TiledObjectSpawner;
 
 	UPROPERTY()
 	TArray<AActor*> SpawnedTiledActors;
 
+	// spawned actor lookup by placement, don't go through actor tags
+	// the transform picks among stacked placements, a handle with a single actor returns it regardless
+	AActor* FindTiledActor(const FTiledActorHandle& Handle, const FTransform& Transform);
+	const FTiledActorHandle* FindTiledActorHandle(const AActor* SpawnedActor);
+	void RegisterTiledActor(const FTiledActorHandle& Handle, const FTransform& Transform, AActor* SpawnedActor);
+	void UnregisterTiledActor(const AActor* SpawnedActor);
+
 	void SetActiveAsset(UTiledLevelAsset* NewAsset) { ActiveAsset = NewAsset; }
 	UTiledLevelAsset* GetAsset() const { return ActiveAsset; }
 	void RemoveAsset();
 	template <typename T>
 	void PopulateSinglePlacement(const T& Placement);
+	// same as PopulateSinglePlacement for each, but mesh instances are grouped by partition and added in one go
+	template <typename T>
+	FTiledPopulateStats PopulatePlacements(const TArray<T>& Placements);
 	// Never use clear instance
 	void ClearItemInstances(const UStaticMesh* MeshPtr);
 	template <typename T>
 	void RemovePlacements(const TArray<T>& PlacementsToDelete);
-	void RemoveInstances(const TMap<UStaticMesh*, TArray<int32>>& TargetInstancesData);
+	void RemoveInstances(const TMap<FTiledInstancePartition, TArray<int32>>& TargetInstancesData);
+	// single instance of one of the partition HISMs, ex: from a hit result
+	void RemoveInstance(UHierarchicalInstancedStaticMeshComponent* HISM, int32 InstanceIndex);
+	// from placement data to get instance index, same as the utility one but use the instance lookup instead of scanning all custom data
+	void FindInstanceIndexByPlacement(TMap<FTiledInstancePartition, TArray<int32>>& FoundIndices, UStaticMesh* MeshPtr, const TArray<float>& SearchData);
 	void DestroyTiledActorByPlacement(const FTilePlacement& Placement);
 	void DestroyTiledActorByPlacement(const FEdgePlacement& Placement);
 	void DestroyTiledActorByPlacement(const FPointPlacement& Placement);
@@ -80,6 +275,41 @@ public:
 
 	void ResetAllInstance(bool IgnoreVersion = false);
 	void ResetAllInstanceFromData();
+	// same as above, but read placements in place from a snapshot, GametimeData is left untouched
+	FTiledPopulateStats ResetAllInstanceFromSnapshot(const class FTiledLevelSnapshot& Snapshot);
+	// chunk streaming: mesh instances of a chunk go away with its partitions, actors are destroyed from the chunk placements
+	// requires an instance chunk size, otherwise every partition is chunk (0, 0)
+	void UnloadInstanceChunk(const FIntPoint& Chunk, const FTiledLevelGameData& ChunkData);
+
+	// Server: mirror gametime placement changes to clients as deltas, does nothing in standalone
+	void ReplicatePlacementAdded(const FTiledNetPlacement& Placement);
+	void ReplicatePlacementRemoved(const FTiledActorHandle& Handle, const FTransform& Transform);
+	void ResetReplicatedPlacements(const FTiledLevelGameData& Data);
+	// straight from the snapshot records, without decoding the whole snapshot first
+	void ResetReplicatedPlacements(const class FTiledLevelSnapshot& Snapshot);
+	// Client: apply replicated deltas to GametimeData and instances, adds are batched until the whole receive is done
+	void QueueReplicatedPlacement(const FTiledNetPlacement& Placement);
+	void RemoveReplicatedPlacement(const FTiledNetPlacement& Placement);
+	void FlushReplicatedPlacements();
+
+	// restriction areas of the spawned restriction helpers, only rebuilt after helpers are added, changed or removed
+	const FTiledRestrictionIndex& GetRestrictionIndex();
+	void MarkRestrictionIndexDirty() { bRestrictionIndexDirty = true; }
+
+	// Hidden floors keep their instances, only the visibility and collision of their HISMs and actors are changed
+	void SetHiddenFloors(const TSet<int32>& NewHiddenFloors);
+	// sync hidden floors with floor visibility in the active asset
+	void UpdateFloorVisibility();
+	bool IsFloorHidden(int32 FloorPosition) const { return HiddenFloors.Contains(FloorPosition); }
+
+	// tiles per chunk side for instance partitions, 0 means one partition per mesh per floor
+	int32 GetInstanceChunkSize() const;
+	// only used when there is no active asset (gametime), the asset setting wins otherwise
+	void SetInstanceChunkSize(int32 NewChunkSize) { InstanceChunkSize = NewChunkSize; }
+	FTiledInstancePartition MakeInstancePartition(UStaticMesh* MeshPtr, const TArray<float>& InstanceData) const
+	{
+		return FTiledInstancePartition(MeshPtr, InstanceData.GetData(), GetInstanceChunkSize());
+	}
 	// UFUNCTION(Server, Reliable)
 	// void SetGametimeData(const FTiledLevelGameData& NewGametimeData) { GametimeData = NewGametimeData; }
 	
@@ -118,7 +348,67 @@ private:
 	UTiledLevelAsset* ActiveAsset = nullptr;
 	
 	TArray<UTiledLevelItem*> GetEraserActiveItems() const;
-	void CreateNewHISM(UStaticMesh* MeshPtr, const TArray<class UMaterialInterface*>& OverrideMaterials);
+	UHierarchicalInstancedStaticMeshComponent* CreateNewHISM(const FTiledInstancePartition& Partition, const TArray<class UMaterialInterface*>& OverrideMaterials);
+	void DestroyPartition(const FTiledInstancePartition& Partition);
+	// reverse of TiledObjectPartitions, resynced when a HISM is not found (undo and load restore the partitions directly)
+	TMap<const UHierarchicalInstancedStaticMeshComponent*, FTiledInstancePartition> HISMPartitions;
+	const FTiledInstancePartition* FindPartition(const UHierarchicalInstancedStaticMeshComponent* HISM);
+	// partition stats of the whole world, only while stats are collected
+	void UpdatePartitionStats() const;
+	void ClearLegacySpawner();
+
+	UPROPERTY()
+	TSet<int32> HiddenFloors;
+
+	UPROPERTY()
+	int32 InstanceChunkSize = 0;
+	void ApplyFloorVisibility(UHierarchicalInstancedStaticMeshComponent* HISM, bool bHidden) const;
+	void ApplyFloorVisibility(AActor* SpawnedActor, const FTiledActorHandle& Handle) const;
+
+	// per partition instance lookups, only valid while synced with TiledObjectPartitions
+	TMap<FTiledInstancePartition, FTiledInstanceLookup> InstanceLookups;
+	FTiledInstanceLookup& GetInstanceLookup(const FTiledInstancePartition& Partition);
+	FTiledInstanceLookup& RebuildInstanceLookup(const FTiledInstancePartition& Partition);
+	void AddToInstanceLookup(const FTiledInstancePartition& Partition, int32 InstanceIndex, TArrayView<const float> CustomData);
+	void AddInstanceBatch(const FTiledInstancePartition& Partition, UHierarchicalInstancedStaticMeshComponent* HISM, const FTiledInstanceBatch& Batch);
+	FTiledPopulateStats SubmitInstanceBatches(const TMap<FTiledInstancePartition, FTiledInstanceBatch>& Batches);
+	// mesh instances go to their batch, actors and mirrored ones are spawned right away
+	template <typename T>
+	void AddToPopulateBatch(const T& Placement, TMap<FTiledInstancePartition, FTiledInstanceBatch>& Batches, int32& NumActors);
+	void RemoveFromInstanceLookup(const FTiledInstancePartition& Partition, const TArray<int32>& InstancesToRemove);
+
+	// Instance edits report only the area of the touched instances to the navigation system,
+	// so the navmesh rebuilds the changed tiles instead of the whole HISM (or not at all)
+	FBox GetInstancesBounds(const UHierarchicalInstancedStaticMeshComponent* HISM, TArrayView<const FTransform> LocalTransforms) const;
+	FBox GetInstancesBounds(const UHierarchicalInstancedStaticMeshComponent* HISM, const TArray<int32>& InstanceIndices) const;
+	void MarkNavigationDirty(UHierarchicalInstancedStaticMeshComponent* HISM, const FBox& DirtyArea);
+
+	// placement handle -> spawned actors, saved with the level so it survives load and duplication
+	UPROPERTY()
+	TMap<FTiledActorHandle, FTiledRegisteredActors> TiledActorRegistry;
+	// reverse of the registry, rebuilt whenever it's out of sync
+	TMap<const AActor*, FTiledActorHandle> TiledActorHandles;
+	bool bTiledActorHandlesDirty = true;
+	// levels saved before the registry existed only have tags...
+	bool bNeedsActorRegistryMigration = false;
+	void MigrateTiledActorRegistry();
+	void DestroyTiledActorByHandle(const FTiledActorHandle& Handle, const FTransform& Transform);
+	void ClearTiledActors();
+
+	FTiledRestrictionIndex RestrictionIndex;
+	bool bRestrictionIndexDirty = true;
+
+	UPROPERTY(Replicated)
+	FTiledReplicatedPlacements ReplicatedPlacements;
+	TArray<FTiledNetPlacement> PendingReplicatedPlacements;
+	bool IsReplicatingPlacements() const { return GetNetMode() == NM_DedicatedServer || GetNetMode() == NM_ListenServer; }
+	template <typename T>
+	void RemoveReplicatedInstance(const T& Placement);
+
+	// incremental ResetAllInstance, only apply the difference between current instances and the asset
+	void ApplyResetTargets(const struct FTiledResetTargets& Targets);
+	bool IsTiledActorUpToDate(const AActor* SpawnedActor, const FItemPlacement& Placement) const;
+	void ClearAllInstances();
 	AActor* SpawnActorPlacement(const FItemPlacement& ItemPlacement);
 	AActor* SpawnMirroredPlacement(const FItemPlacement& ItemPlacement);
 #if WITH_EDITOR
@@ -133,12 +423,15 @@ private:
 // template implementations...
 
 /*
- * For actor item: use tags to store position, extent, and guid. WARNING: this may block users to use the last 3 tags...
+ * For actor item: register the actor by placement handle. Tags (position, extent, and guid) are still written for
+ * old levels and other users of them. WARNING: this may block users to use the last 3 tags...
  * For mesh item: Use custom data to store position and extent information
  */
 template <typename T>
 void ATiledLevel::PopulateSinglePlacement(const T& Placement)
 {
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_PopulateSinglePlacement);
+	INC_DWORD_STAT(STAT_TiledLevel_PlacementsPopulated);
 	if (Placement.GetItem()->SourceType == ETLSourceType::Actor)
 	{
 		if (!IsValid(Placement.GetItem()->TiledActor)) return;
@@ -146,6 +439,8 @@ void ATiledLevel::PopulateSinglePlacement(const T& Placement)
 		{
 			FTiledLevelUtility::SetSpawnedActorTag(Placement, NewActor);
 			SpawnedTiledActors.Add(NewActor);
+			RegisterTiledActor(FTiledActorHandle(Placement), Placement.TileObjectTransform, NewActor);
+			ApplyFloorVisibility(NewActor, FTiledActorHandle(Placement));
 		}
 	}
 	else if (Placement.IsMirrored)
@@ -153,21 +448,63 @@ void ATiledLevel::PopulateSinglePlacement(const T& Placement)
 		AActor* NewMirrored = SpawnMirroredPlacement(Placement);
 		FTiledLevelUtility::SetSpawnedActorTag(Placement, NewMirrored);
 		SpawnedTiledActors.Add(NewMirrored);
+		RegisterTiledActor(FTiledActorHandle(Placement), Placement.TileObjectTransform, NewMirrored);
+		ApplyFloorVisibility(NewMirrored, FTiledActorHandle(Placement));
 	} else
 	{
 		if (!Placement.GetItem()->TiledMesh) return;
 		
-		CreateNewHISM(Placement.GetItem()->TiledMesh, Placement.GetItem()->OverrideMaterials);
-		const int InstanceIndex = TiledObjectSpawner[Placement.GetItem()->TiledMesh]->AddInstance(Placement.TileObjectTransform);
 		const TArray<float> InstanceData = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
-		TiledObjectSpawner[Placement.GetItem()->TiledMesh]->SetCustomData(InstanceIndex, InstanceData);
+		const FTiledInstancePartition Partition = MakeInstancePartition(Placement.GetItem()->TiledMesh, InstanceData);
+		UHierarchicalInstancedStaticMeshComponent* HISM = CreateNewHISM(Partition, Placement.GetItem()->OverrideMaterials);
+		const int InstanceIndex = HISM->AddInstance(Placement.TileObjectTransform);
+		HISM->SetCustomData(InstanceIndex, InstanceData);
+		AddToInstanceLookup(Partition, InstanceIndex, InstanceData);
+		MarkNavigationDirty(HISM, GetInstancesBounds(HISM, MakeArrayView(&Placement.TileObjectTransform, 1)));
+		INC_DWORD_STAT(STAT_TiledLevel_InstancesAdded);
+		UpdatePartitionStats();
+	}
+}
+
+template <typename T>
+FTiledPopulateStats ATiledLevel::PopulatePlacements(const TArray<T>& Placements)
+{
+	TILEDLEVEL_SCOPE_CYCLE_COUNTER(STAT_TiledLevel_PopulatePlacements);
+	TMap<FTiledInstancePartition, FTiledInstanceBatch> Batches;
+	int32 NumActors = 0;
+	for (const T& Placement : Placements)
+	{
+		AddToPopulateBatch(Placement, Batches, NumActors);
+	}
+	FTiledPopulateStats Stats = SubmitInstanceBatches(Batches);
+	Stats.NumActors = NumActors;
+	return Stats;
+}
+
+template <typename T>
+void ATiledLevel::AddToPopulateBatch(const T& Placement, TMap<FTiledInstancePartition, FTiledInstanceBatch>& Batches, int32& NumActors)
+{
+	UTiledLevelItem* Item = Placement.GetItem();
+	if (!Item) return;
+	if (Item->SourceType == ETLSourceType::Actor || Placement.IsMirrored)
+	{
+		PopulateSinglePlacement(Placement);
+		NumActors++;
+		return;
 	}
+	if (!Item->TiledMesh) return;
+	const TArray<float> InstanceData = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(Placement);
+	FTiledInstanceBatch& Batch = Batches.FindOrAdd(MakeInstancePartition(Item->TiledMesh, InstanceData));
+	Batch.Transforms.Add(Placement.TileObjectTransform);
+	Batch.CustomData.Append(InstanceData);
+	Batch.OverrideMaterials = &Item->OverrideMaterials;
+	INC_DWORD_STAT(STAT_TiledLevel_PlacementsPopulated);
 }
 
 template <typename T>
 void ATiledLevel::RemovePlacements(const TArray<T>& PlacementsToDelete)
 {
-	TMap<UStaticMesh*, TArray<int32>> TargetInstanceData;
+	TMap<FTiledInstancePartition, TArray<int32>> TargetInstanceData;
 	for (auto P : PlacementsToDelete)
 	{
 		if (P.GetItem()->SourceType == ETLSourceType::Actor || P.IsMirrored)
@@ -176,10 +513,8 @@ void ATiledLevel::RemovePlacements(const TArray<T>& PlacementsToDelete)
 		}
 		else
 		{
-			if (!TargetInstanceData.Contains(P.GetItem()->TiledMesh))
-				TargetInstanceData.Add(P.GetItem()->TiledMesh, TArray<int32>{});
 			TArray<float> TargetInfo = FTiledLevelUtility::ConvertPlacementToHISM_CustomData(P);
-			FTiledLevelUtility::FindInstanceIndexByPlacement(TargetInstanceData[P.GetItem()->TiledMesh],TiledObjectSpawner[P.GetItem()->TiledMesh]->PerInstanceSMCustomData, TargetInfo);
+			FindInstanceIndexByPlacement(TargetInstanceData, P.GetItem()->TiledMesh, TargetInfo);
 		}
 	}
 	ActiveAsset->RemovePlacements(PlacementsToDelete);
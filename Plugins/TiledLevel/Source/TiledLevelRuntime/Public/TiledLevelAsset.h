@@ -166,6 +166,13 @@ public:
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category="Setup", DisplayName = "Numer of Y Tiles", meta=(UIMin=1, ClampMin=1, ClampMax=1024))
 	int32 Y_Num = 10;
+
+	/*
+	 * Split instances into square chunks of this many tiles, each chunk gets its own HISM per mesh per floor.
+	 * Editing a tile only rebuilds its chunk, and far away chunks are culled as a whole. 0 disables chunking.
+	 */
+	UPROPERTY(EditAnywhere, Category="Setup", AdvancedDisplay, meta=(UIMin=0, ClampMin=0, ClampMax=1024))
+	int32 InstanceChunkSize = 0;
     
 	UPROPERTY(VisibleAnywhere, Instanced, AdvancedDisplay, Category=Thumbnail)
 	class UThumbnailInfo* ThumbnailInfo;
@@ -198,6 +205,7 @@ public:
 
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual void PostEditUndo() override;
 #endif
 	
 	/* Modify above|below ground floor will only affect above|below floors
@@ -240,6 +248,16 @@ public:
 	void SetActiveItemSet(UTiledItemSet* NewItemSet);
 	void EmptyRegionData(const TArray<FIntVector>& Points);
 	void EmptyEdgeRegionData(const TArray<FTiledLevelEdge>& EdgeRegions);
+
+	/*
+	 * Cell keyed lookup of all placements for overlap queries.
+	 * AddNew*Placement and RemovePlacements keep it updated, bulk changes (undo, clear item or floor, floor reordering)
+	 * mark it dirty and it is rebuilt on next query. A loaded asset starts dirty.
+	 */
+	const FTiledLevelOccupancyIndex& GetOccupancyIndex();
+	void MarkOccupancyIndexDirty() { bOccupancyIndexDirty = true; PlacementRevision++; }
+	// bumped on every placement change the occupancy index knows about, for caches built from placements
+	uint32 GetPlacementRevision() const { return PlacementRevision; }
 	
 	void SetTileSize(const FVector& NewSize)
 	{
@@ -266,4 +284,8 @@ private:
 	
 	UPROPERTY(VisibleDefaultsOnly, Category="Setup", AdvancedDisplay)
 	bool CanEditTileSize = false;
+
+	FTiledLevelOccupancyIndex OccupancyIndex;
+	bool bOccupancyIndexDirty = true;
+	uint32 PlacementRevision = 0;
 };
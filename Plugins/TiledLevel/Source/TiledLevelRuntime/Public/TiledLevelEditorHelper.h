@@ -9,6 +9,28 @@
 class UTiledLevelItem;
 class UTiledLevelAsset;
 
+/*
+ * Fill preview instances of one component. Instances that leave the region are hidden (zero scale) and kept for reuse
+ * instead of removed, so a hover only updates the instances of the tiles that changed.
+ */
+template <typename T>
+struct TTiledFillPreviewPool
+{
+	// item shown by each instance, only meaningful while the instance is visible
+	TArray<T> Items;
+	TBitArray<> Visible;
+	TMap<T, int32> Slots;
+	TArray<int32> FreeSlots;
+
+	void Reset()
+	{
+		Items.Reset();
+		Visible.Reset();
+		Slots.Reset();
+		FreeSlots.Reset();
+	}
+};
+
 UCLASS(NotPlaceable, NotBlueprintable)
 class TILEDLEVELRUNTIME_API ATiledLevelEditorHelper : public AActor
 {
@@ -30,8 +52,12 @@ public:
 	UPROPERTY()
 	class UProceduralMeshComponent* FloorGrids;
 
+	// fill preview boxes are instances of a unit cube, only changed tiles/edges are updated on hover
+	UPROPERTY()
+	class UInstancedStaticMeshComponent* FillPreviewGrids;
+
 	UPROPERTY()
-	class UProceduralMeshComponent* FillPreviewGrids;
+	class UInstancedStaticMeshComponent* FillPreviewEdges;
 	
 	UPROPERTY()
 	class UTiledLevelGrid* CustomGizmo;
@@ -67,6 +93,7 @@ public:
 
 	void UpdateFillPreviewGrids(TArray<FIntPoint> InFillBoard, int InFillFloorPosition = 0, int InFillHeight = 1);
 	void UpdateFillPreviewEdges(TArray<FTiledLevelEdge> InEdgePoints, int InFillHeight = 1);
+	void ClearFillPreview();
 	
 	uint8 BrushRotationIndex;
 
@@ -114,8 +141,14 @@ private:
 	FVector CachedCenterScale{1, 1, 1};
 	FVector CachedBrushLocation;
 	bool IsBrushValid;
-	TArray<FIntPoint> CacheFillTiles;
-	TArray<FTiledLevelEdge> CacheFillEdges;
+	TTiledFillPreviewPool<FIntPoint> FillTilePool;
+	TTiledFillPreviewPool<FTiledLevelEdge> FillEdgePool;
+	int CacheFillFloorPosition = 0;
+	int CacheFillHeight = 0;
+
+	// returns number of instances touched
+	template<typename T>
+	int32 SyncFillPreviewInstances(UInstancedStaticMeshComponent* Target, const TArray<T>& NewItems, TTiledFillPreviewPool<T>& Pool, TFunctionRef<FTransform(const T&)> MakeTransform);
 	
 	// If not, use original material for valid, and hidden actors for not valid 
 	bool ShouldUsePreviewMaterial = true;
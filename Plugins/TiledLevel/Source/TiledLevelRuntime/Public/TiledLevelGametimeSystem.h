@@ -3,12 +3,15 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "TiledLevelTypes.h"
+#include "TiledLevelSnapshot.h"
+#include "Engine/EngineTypes.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "TiledLevelGametimeSystem.generated.h"
 
 class ATiledLevel;
 class UTiledLevelItem;
 class UMaterialInterface;
+struct FTiledChunkStreamingTask;
 
 enum EGametimeMode
 {
@@ -62,6 +65,15 @@ public:
 	void InitializeGametimeSystemFromData(const UObject* WorldContextObject, UTiledItemSet* StartupItemSet,
 		const FTiledLevelGameData& InData, TArray<class ATiledLevel*> TiledLevelsInsideData, bool bUnbound = false);
 
+	// Initialize through a file written by SaveAsTiledLevelAsset, fail if the file is invalid or its tile size is not the same
+	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Init", meta = (WorldContext = "WorldContextObject"))
+	bool InitializeGametimeSystemFromFile(const UObject* WorldContextObject, UTiledItemSet* StartupItemSet, FString SourceFile, bool bUnbound = false);
+
+	// Same as above for a file written by SaveAsSnapshot, the file is memory mapped and instances are populated straight from it
+	// bigger file than SaveAsTiledLevelAsset, but much faster to load for huge data
+	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Init", meta = (WorldContext = "WorldContextObject"))
+	bool InitializeGametimeSystemFromSnapshot(const UObject* WorldContextObject, UTiledItemSet* StartupItemSet, FString SourceFile, bool bUnbound = false);
+
 	// fail to change if the tile size is not the same
 	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Init" )
 	bool ChangeItemSet(UTiledItemSet* NewItemSet);
@@ -198,8 +210,12 @@ public:
 
 	///////////////////////// V2.2
 	// save as asset, and the player can use it later... for which it is still in a dynamic manner
+	// written in the compact binary format of FTiledLevelGameData, load it back with InitializeGametimeSystemFromFile
 	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Conversion")
 	bool SaveAsTiledLevelAsset(FString TargetFile);
+
+	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Conversion")
+	bool SaveAsSnapshot(FString TargetFile);
 	
 	////////////////////////
 	
@@ -235,7 +251,7 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Preview", meta=(EditCondition="ShouldUsePreviewMaterial"))
 	UMaterialInterface* PreviewMaterial_CanNotBuildHere;
 
-	// Where gametime data stored
+	// Where gametime data stored, after initializing from a snapshot it only has the chunks built or erased around so far
 	UPROPERTY(BlueprintReadWrite, Category="TiledLevelGametimeSystem | Data")
 	FTiledLevelGameData GametimeData;
 
@@ -247,6 +263,53 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Restriction")
 	bool bLockRemove = false;
 
+	/*
+	 * Chunk streaming for unbound (infinite) mode.
+	 * Placements are split into square chunks, each chunk has its own HISMs (instance chunk size is set to the same size).
+	 * Chunks far from every streaming source are saved to disk and dropped, then loaded back when any source comes close.
+	 */
+	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Streaming")
+	bool bStreamChunks = false;
+
+	// tiles per chunk side, keep it at least as wide as the widest item (overlap checks load one ring of neighbour chunks)
+	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Streaming", meta=(EditCondition="bStreamChunks", ClampMin=1, ClampMax=1024))
+	int32 StreamingChunkSize = 32;
+
+	// chunks within this distance (cm) of any streaming source are loaded
+	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Streaming", meta=(EditCondition="bStreamChunks", ClampMin=0))
+	float StreamingLoadRadius = 10000.f;
+
+	// chunks farther than this from all streaming sources are unloaded, keep it larger than load radius so chunks on the edge don't flip every update
+	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Streaming", meta=(EditCondition="bStreamChunks", ClampMin=0))
+	float StreamingUnloadRadius = 15000.f;
+
+	// seconds between streaming updates
+	UPROPERTY(EditDefaultsOnly, Category="TiledLevelGametimeSystem | Streaming", meta=(EditCondition="bStreamChunks", ClampMin=0.05))
+	float StreamingUpdateInterval = 0.5f;
+
+	// player pawns are always streaming sources, add any other actor that should keep chunks around it loaded
+	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Streaming")
+	void AddStreamingSource(AActor* Source);
+
+	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Streaming")
+	void RemoveStreamingSource(AActor* Source);
+
+	// runs on a timer, call it to stream right away (ex: after teleporting)
+	UFUNCTION(BlueprintCallable, Category="TiledLevelGametimeSystem | Streaming")
+	void UpdateStreaming();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="TiledLevelGametimeSystem | Streaming")
+	int32 GetNumLoadedChunks() const { return LoadedChunks.Num(); }
+
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category="TiledLevelGametimeSystem | Streaming")
+	int32 GetNumChunksOnDisk() const { return ChunksOnDisk.Num(); }
+
+	// chunk files are read and written on workers, this blocks until every one in flight is done and applied
+	void FlushStreaming();
+	int32 GetNumPendingChunks() const { return ChunkTasks.Num(); }
+
+	bool IsStreamingChunks() const { return bStreamChunks && GametimeMode == Infinite; }
+
 
 private:
 	FIntVector GetTilePosition(FVector WorldLocation, bool& Found);
@@ -264,6 +327,25 @@ private:
 	bool IsRemoveRestricted(UTiledLevelItem* TestItem, FVector HitPosition);
 	FVector GetBuildLocation(); // return grid bottom center...
 	FVector GetBuildLocation(EPlacedShapeType Shape, FVector InTilePosition, FVector InTileExtent);
+
+	// streaming
+	int32 GetGametimeInstanceChunkSize() const;
+	void InitStreaming();
+	void ResetStreaming();
+	void LoadChunk(const FIntPoint& Chunk);
+	void UnloadChunk(const FIntPoint& Chunk);
+	void AddChunkData(const FTiledLevelGameData& ChunkData);
+	void StartChunkTask(const TSharedRef<FTiledChunkStreamingTask>& Task);
+	void FinishChunkTask(const TSharedRef<FTiledChunkStreamingTask>& Task);
+	void WaitForChunkTask(const FIntPoint& Chunk);
+	// load (and decode from the snapshot) every chunk touched by the tile range, before overlap checks or erasing there
+	void EnsureChunksLoaded(const FIntVector& MinPosition, const FIntVector& MaxPosition);
+	// snapshot chunks already have instances, only their data is added to GametimeData
+	void DecodeSnapshotChunk(const FIntPoint& Chunk);
+	FString GetChunkFile(const FIntPoint& Chunk) const;
+	bool HasDataOutsideMemory() const { return ChunksOnDisk.Num() > 0 || SnapshotChunks.Num() > 0; }
+	// loaded data plus everything on disk or still in the snapshot, for saving
+	FTiledLevelGameData GatherAllGametimeData() const;
 	
 	UPROPERTY()
 	class UTiledItemSet* SourceItemSet = nullptr;
@@ -286,6 +368,21 @@ private:
 	bool IsEraserMode = false;
 	FIntVector EraserExtent;
 
+	UPROPERTY()
+	TArray<TWeakObjectPtr<AActor>> StreamingSources;
+	TSet<FIntPoint> LoadedChunks;
+	TSet<FIntPoint> ChunksOnDisk;
+	// at most one file read or write per chunk
+	TMap<FIntPoint, TSharedRef<FTiledChunkStreamingTask>> ChunkTasks;
+	// item sets of chunks streamed out, kept alive for the workers encoding them and to resolve them on load
+	UPROPERTY()
+	TArray<class UTiledItemSet*> StreamingItemSets;
+	FString StreamingDirectory;
+	FTimerHandle StreamingTimer;
+	// kept open after InitializeGametimeSystemFromSnapshot, until every chunk of it is decoded
+	TUniquePtr<FTiledLevelSnapshot> GametimeSnapshot;
+	TSet<FIntPoint> SnapshotChunks;
+
 	// struct FTimerHandle ClientInitTimer;
 	// UFUNCTION()
 	// void InitClient();
@@ -4,8 +4,33 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "TiledLevelTypes.h"
 #include "TiledLevelRestrictionHelper.generated.h"
 
+/*
+ * Restriction areas of a tiled level by cell, compiled from its restriction helpers.
+ * One cell map per floor and restriction type, so a cell check is a single hash lookup instead of
+ * collecting every helper and searching its position array.
+ */
+struct TILEDLEVELRUNTIME_API FTiledRestrictionIndex
+{
+	void Build(const TArray<AActor*>& SpawnedActors);
+	// true if any position is covered by a restriction of this type, only restrictions targeting the item count if item id is given
+	bool IsCovered(TArrayView<const FIntVector> Positions, ERestrictionType RestrictionType, const FGuid* TargetItemID = nullptr) const;
+	int32 GetNumCells() const;
+
+private:
+	struct FRule
+	{
+		bool bTargetAllItems = true;
+		TSet<FGuid> TargetItems;
+	};
+	// one per restriction item
+	TArray<FRule> Rules;
+	// (floor, restriction type) -> cell -> rules covering it
+	TMap<TPair<int32, ERestrictionType>, TMap<FIntPoint, TArray<int32, TInlineAllocator<1>>>> Cells;
+};
+
 UCLASS(NotPlaceable, NotBlueprintable)
 class TILEDLEVELRUNTIME_API ATiledLevelRestrictionHelper : public AActor
 {
@@ -32,6 +57,10 @@ public:
 	void AddTargetedPositions(FIntVector NewPoint);
 	void RemoveTargetedPositions(FIntVector PointToRemove);
 
+	// merged area mesh of the targeted positions, in tiled level space
+	static void BuildAreaHintMesh(const TArray<FIntVector>& Positions, const FVector& TileSize,
+		TArray<FVector>& OutVertices, TArray<int32>& OutTriangles, TArray<FVector>& OutNormals, TArray<FVector2D>& OutUVs);
+
 protected:
 	UPROPERTY()
 	class USceneComponent* Root;
@@ -44,6 +73,10 @@ protected:
 private:
 	
 	void UpdateVisual();
+	void ApplyAreaHintMaterial();
+
+	UPROPERTY()
+	class UMaterialInterface* M_AreaHintBase;
 
 	UPROPERTY()
 	class UMaterialInstanceDynamic* M_AreaHint; 
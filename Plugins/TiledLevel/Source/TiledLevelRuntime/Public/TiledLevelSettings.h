@@ -15,9 +15,13 @@ public:
 	/*
 	 * Whether you want to convert all tiled level on current map to static mesh when begin play ?
 	 * This is a temporal solution to fix navigation volume not update in case you want to quick test AI behaviour
+	 * Not required for navigation anymore, tiled level edits now report their dirty area to the navigation system
 	 */
 	UPROPERTY(EditAnywhere, Config, Category="Gameplay")
 	bool bAutomaticStaticConversion = false;
+	// Instance chunk size of the tiled level built by gametime system, same as the one in tiled level asset. 0 disables chunking
+	UPROPERTY(EditAnywhere, Config, Category="Gameplay", meta=(UIMin=0, ClampMin=0, ClampMax=1024))
+	int32 GametimeInstanceChunkSize = 0;
 	UPROPERTY(EditAnywhere, Config, Category="Appearance")
 	FLinearColor SpecialItemColor = FLinearColor(0.1,0.1,0.1, 1);
 	UPROPERTY(EditAnywhere, Config, Category="Appearance")
@@ -0,0 +1,104 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TiledLevelTypes.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class UTiledItemSet;
+
+/*
+ * Fixed layout snapshot of FTiledLevelGameData, made to be memory mapped and read in place.
+ * Unlike SaveToBinary (small, but must be decoded into arrays), every placement is a fixed size record,
+ * so a huge save can populate instances straight from the file without a decoded copy of it.
+ * Layout (little endian, every section 8 byte aligned):
+ *   header, item set paths (null separated UTF-8), item guids, hidden floors, boundaries, 6 placement record arrays
+ */
+struct FTiledSnapshotPlacement
+{
+	double Rotation[4];
+	double Translation[3];
+	double Scale[3];
+	int32 ItemIndex;
+	int32 ItemSetIndex;
+	// grid position, or edge position
+	int32 Position[3];
+	// tile extent, edges store edge type in X
+	int32 Extent[3];
+	uint8 IsMirrored;
+	uint8 Padding[7];
+};
+static_assert(sizeof(FTiledSnapshotPlacement) == 120, "snapshot record layout changed, bump the snapshot version");
+
+struct FTiledSnapshotBox
+{
+	double Min[3];
+	double Max[3];
+	uint64 IsValid;
+};
+
+class TILEDLEVELRUNTIME_API FTiledLevelSnapshot
+{
+public:
+	FTiledLevelSnapshot() = default;
+	~FTiledLevelSnapshot();
+	FTiledLevelSnapshot(const FTiledLevelSnapshot&) = delete;
+	FTiledLevelSnapshot& operator=(const FTiledLevelSnapshot&) = delete;
+
+	static bool Write(const FTiledLevelGameData& Data, const FVector& InTileSize, const FString& TargetFile);
+
+	// map the file (or read it whole where mapping is not supported), validate it and resolve item sets
+	bool Open(const FString& SourceFile);
+	void Close();
+	bool IsOpen() const { return Bytes != nullptr; }
+	bool IsMapped() const { return MappedRegion != nullptr; }
+
+	FVector GetTileSize() const { return TileSize; }
+	TArrayView<const FGuid> GetItems() const { return Items; }
+	const TArray<UTiledItemSet*>& GetItemSets() const { return ItemSets; }
+	TArrayView<const int32> GetHiddenFloors() const { return HiddenFloors; }
+	TArrayView<const FTiledSnapshotBox> GetBoundaries() const { return Boundaries; }
+	TArrayView<const FTiledSnapshotPlacement> GetPlacements(EPlacedType PlacedType) const;
+	int32 GetNumOfAllPlacements() const;
+
+	// one record to a placement, only the record is touched, nothing else is allocated
+	FTilePlacement MakeTilePlacement(const FTiledSnapshotPlacement& Record) const;
+	FEdgePlacement MakeEdgePlacement(const FTiledSnapshotPlacement& Record) const;
+	FPointPlacement MakePointPlacement(const FTiledSnapshotPlacement& Record) const;
+	// decoded copy, when the data has to be edited
+	FTiledLevelGameData ToGameData() const;
+	// hidden floors and boundaries only, placements are left to ToGameData or DecodeChunk
+	FTiledLevelGameData MakeEmptyGameData() const;
+
+	// group record indices by chunk (same chunks as FTiledLevelGameData::GetChunks), so the data can be decoded a chunk at a time
+	void BuildChunkIndex(int32 InChunkSize);
+	void GetChunks(TSet<FIntPoint>& OutChunks) const;
+	// placements of one chunk, needs BuildChunkIndex first
+	FTiledLevelGameData DecodeChunk(const FIntPoint& Chunk) const;
+
+private:
+	bool Parse();
+
+	struct FChunkRecords
+	{
+		TArray<int32> Records[6];
+	};
+	int32 ChunkSize = 0;
+	TMap<FIntPoint, FChunkRecords> ChunkIndex;
+
+	IMappedFileHandle* MappedHandle = nullptr;
+	IMappedFileRegion* MappedRegion = nullptr;
+	// used when the platform can't map files
+	TArray<uint8> LoadedBytes;
+	const uint8* Bytes = nullptr;
+	int64 NumBytes = 0;
+
+	FVector TileSize = FVector(0);
+	TArrayView<const FGuid> Items;
+	TArray<UTiledItemSet*> ItemSets;
+	TArrayView<const int32> HiddenFloors;
+	TArrayView<const FTiledSnapshotBox> Boundaries;
+	TArrayView<const FTiledSnapshotPlacement> Placements[6];
+};
@@ -0,0 +1,63 @@
+﻿// Copyright 2022 PufStudio. All Rights Reserved.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// "stat TiledLevel" in game or editor, the scopes also show up by name in Insights traces
+
+DECLARE_STATS_GROUP(TEXT("TiledLevel"), STATGROUP_TiledLevel, STATCAT_Advanced);
+
+// instance population
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Reset All Instance"), STAT_TiledLevel_ResetAllInstance, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Reset Targets"), STAT_TiledLevel_ApplyResetTargets, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Populate Placements"), STAT_TiledLevel_PopulatePlacements, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Populate Single Placement"), STAT_TiledLevel_PopulateSinglePlacement, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Add Instance Batch"), STAT_TiledLevel_AddInstanceBatch, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Remove Instances"), STAT_TiledLevel_RemoveInstances, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Placements Populated"), STAT_TiledLevel_PlacementsPopulated, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Instances Added"), STAT_TiledLevel_InstancesAdded, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Instances Removed"), STAT_TiledLevel_InstancesRemoved, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+// mesh / floor / chunk partitions of all tiled levels in the world, kept until the next instance edit
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Instance Partitions"), STAT_TiledLevel_InstancePartitions, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Partitioned Instances"), STAT_TiledLevel_PartitionedInstances, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Avg Instances Per Partition"), STAT_TiledLevel_AvgPartitionInstances, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Max Instances Per Partition"), STAT_TiledLevel_MaxPartitionInstances, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+
+// overlap checks
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Occupancy Index Build"), STAT_TiledLevel_OccupancyIndexBuild, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Overlap Query"), STAT_TiledLevel_OverlapQuery, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlap Queries"), STAT_TiledLevel_OverlapQueries, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlap Candidates"), STAT_TiledLevel_OverlapCandidates, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Overlapping Placements"), STAT_TiledLevel_OverlappingPlacements, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+
+// fill tools
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Flood Fill"), STAT_TiledLevel_FloodFill, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Flood Filled Tiles"), STAT_TiledLevel_FloodFilledTiles, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+
+// restrictions
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restriction Check"), STAT_TiledLevel_RestrictionCheck, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Restriction Index Build"), STAT_TiledLevel_RestrictionIndexBuild, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Restriction Checks"), STAT_TiledLevel_RestrictionChecks, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+
+// merge
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Templates"), STAT_TiledLevel_MergeTemplates, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Gather Instances"), STAT_TiledLevel_MergeGather, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Fill Sections"), STAT_TiledLevel_MergeFill, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Mesh Description"), STAT_TiledLevel_MergeMeshDescription, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Merged Instances"), STAT_TiledLevel_MergedInstances, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Merged Triangles"), STAT_TiledLevel_MergedTriangles, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+
+// thumbnails (editor)
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Thumbnail Render"), STAT_TiledLevel_ThumbnailRender, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Thumbnails Rendered"), STAT_TiledLevel_ThumbnailsRendered, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Thumbnail Placements"), STAT_TiledLevel_ThumbnailPlacements, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Thumbnail Cache Hits"), STAT_TiledLevel_ThumbnailCacheHits, STATGROUP_TiledLevel, TILEDLEVELRUNTIME_API);
+
+// cycle counter when stats are compiled in (which traces the scope as well), only the trace scope otherwise (test builds)
+#if STATS
+#define TILEDLEVEL_SCOPE_CYCLE_COUNTER(Stat) SCOPE_CYCLE_COUNTER(Stat)
+#else
+#define TILEDLEVEL_SCOPE_CYCLE_COUNTER(Stat) TRACE_CPUPROFILER_EVENT_SCOPE(Stat)
+#endif
@@ -237,6 +237,11 @@ struct FTiledLevelEdge
 			 return X < OtherEdge.X;
 		return Y < OtherEdge.Y;
 	}
+
+	friend uint32 GetTypeHash(const FTiledLevelEdge& Edge)
+	{
+		return HashCombine(GetTypeHash(Edge.GetEdgePosition()), GetTypeHash(static_cast<uint8>(Edge.EdgeType)));
+	}
 };
 
 // includes both wall and Edge, have "vertical" and "horizontal"
@@ -364,8 +369,169 @@ struct FPointPlacement : public FItemPlacement
 	}
 };
 
+// Identify the actor spawned for a placement (actor item or mirrored mesh), same rule as placement operator==
+USTRUCT()
+struct FTiledActorHandle
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FIntVector Position = FIntVector::ZeroValue;
+
+	// tile: extent, edge: (0, 0, edge type), point: unused
+	UPROPERTY()
+	FIntVector ExtraInfo = FIntVector::ZeroValue;
+
+	UPROPERTY()
+	FGuid ItemID;
+
+	FTiledActorHandle() {}
+
+	explicit FTiledActorHandle(const FTilePlacement& P)
+		: Position(P.GridPosition), ExtraInfo(P.Extent), ItemID(P.ItemID)
+	{}
+
+	explicit FTiledActorHandle(const FEdgePlacement& P)
+		: Position(P.Edge.X, P.Edge.Y, P.Edge.Z), ExtraInfo(0, 0, static_cast<int32>(P.Edge.EdgeType)), ItemID(P.ItemID)
+	{}
+
+	explicit FTiledActorHandle(const FPointPlacement& P)
+		: Position(P.GridPosition), ItemID(P.ItemID)
+	{}
+
+	bool operator== (const FTiledActorHandle& Other) const
+	{
+		return Position == Other.Position && ExtraInfo == Other.ExtraInfo && ItemID == Other.ItemID;
+	}
+
+	friend uint32 GetTypeHash(const FTiledActorHandle& Handle)
+	{
+		return HashCombine(HashCombine(GetTypeHash(Handle.Position), GetTypeHash(Handle.ExtraInfo)), GetTypeHash(Handle.ItemID));
+	}
+};
+
+// One gametime placement on the wire, packed like the binary save format (packed ints, compact transforms)
+USTRUCT()
+struct FTiledNetPlacement
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class UTiledItemSet* ItemSet = nullptr;
+
+	UPROPERTY()
+	FGuid ItemID;
+
+	UPROPERTY()
+	EPlacedType PlacedType = EPlacedType::Block;
+
+	// grid position or edge position
+	UPROPERTY()
+	FIntVector Position = FIntVector::ZeroValue;
+
+	// same as FTiledActorHandle
+	UPROPERTY()
+	FIntVector ExtraInfo = FIntVector::ZeroValue;
+
+	UPROPERTY()
+	bool IsMirrored = false;
+
+	UPROPERTY()
+	FTransform TileObjectTransform;
+
+	FTiledNetPlacement() {}
+	FTiledNetPlacement(const FTilePlacement& P, EPlacedType InPlacedType);
+	FTiledNetPlacement(const FEdgePlacement& P, EPlacedType InPlacedType);
+	FTiledNetPlacement(const FPointPlacement& P, EPlacedType InPlacedType);
+
+	FTilePlacement MakeTilePlacement() const;
+	FEdgePlacement MakeEdgePlacement() const;
+	FPointPlacement MakePointPlacement() const;
+	FTiledActorHandle GetHandle() const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FTiledNetPlacement> : public TStructOpsTypeTraitsBase2<FTiledNetPlacement>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+
+
+
+/*
+ * Cell keyed lookup for placements, so overlap queries only visit the cells covered by the query
+ * instead of every placement in the level.
+ * Tiles are keyed by each occupied tile, edges by each unit edge, points by each (x, y, z) along its height.
+ * Candidates are still tested with the FTiledLevelUtility overlap functions, results are the same as brute force.
+ */
+class TILEDLEVELRUNTIME_API FTiledLevelOccupancyIndex
+{
+public:
+	void Empty();
+	int Num() const { return Tiles.Num() + Edges.Num() + Points.Num(); }
+
+	void AddPlacement(const FTilePlacement& P, EPlacedType PlacedType);
+	void AddPlacement(const FEdgePlacement& P, EPlacedType PlacedType);
+	void AddPlacement(const FPointPlacement& P, EPlacedType PlacedType);
+	// remove all entries equal to P (same as TArray::RemoveAll used by the placement arrays)
+	// bExactTransform: only the first one also at P's transform, for removing a single placement from stacked ones
+	void RemovePlacement(const FTilePlacement& P, bool bExactTransform = false);
+	void RemovePlacement(const FEdgePlacement& P, bool bExactTransform = false);
+	void RemovePlacement(const FPointPlacement& P, bool bExactTransform = false);
+
+	// PlacedType == Any: include both types of the same shape (ex: block and floor)
+	TArray<FTilePlacement> FindOverlappingTiles(const FIntVector& Position, const FIntVector& Extent, EPlacedType PlacedType = EPlacedType::Any) const;
+	TArray<FEdgePlacement> FindOverlappingEdges(const FTiledLevelEdge& Edge, const FIntVector& Extent, EPlacedType PlacedType = EPlacedType::Any) const;
+	TArray<FPointPlacement> FindOverlappingPoints(const FIntVector& Position, int ZExtent, EPlacedType PlacedType = EPlacedType::Any) const;
+	// for eraser "Any", match FTiledLevelUtility::IsEdgeInsideTile / IsPointInsideTile
+	TArray<FEdgePlacement> FindEdgesInsideTile(const FIntVector& TilePosition, const FIntVector& TileExtent, EPlacedType PlacedType = EPlacedType::Any) const;
+	TArray<FPointPlacement> FindPointsInsideTile(const FIntVector& TilePosition, const FIntVector& TileExtent, EPlacedType PlacedType = EPlacedType::Any) const;
+
+private:
+	struct FTileEntry
+	{
+		FTilePlacement Placement;
+		EPlacedType PlacedType;
+	};
+
+	// extent is cached from item when added, so queries don't need to look up items
+	struct FEdgeEntry
+	{
+		FEdgePlacement Placement;
+		EPlacedType PlacedType;
+		FIntVector Extent;
+	};
 
+	struct FPointEntry
+	{
+		FPointPlacement Placement;
+		EPlacedType PlacedType;
+		int ZExtent;
+	};
+
+	static TArray<FIntVector> GetTileCells(const FIntVector& Position, const FIntVector& Extent);
+	static TArray<FTiledLevelEdge> GetEdgeCells(const FTiledLevelEdge& Edge, const FIntVector& Extent);
+	static TArray<FIntVector> GetPointCells(const FIntVector& Position, int ZExtent);
 
+	TSparseArray<FTileEntry> Tiles;
+	TSparseArray<FEdgeEntry> Edges;
+	TSparseArray<FPointEntry> Points;
+	TMultiMap<FIntVector, int32> TileCells;
+	TMultiMap<FTiledLevelEdge, int32> EdgeCells;
+	TMultiMap<FIntVector, int32> PointCells;
+};
+
+// indices of a chunk's placements in each placement array of FTiledLevelGameData (block, floor, wall, edge, pillar, point)
+struct FTiledChunkPlacements
+{
+	TArray<int32> Indices[6];
+};
 
 /*
  * Just copy all placement data from Tiled Level Asset to this game data... let it handle all the rest...
@@ -416,9 +582,61 @@ struct FTiledLevelGameData
 		PillarPlacements.Append(Other.PillarPlacements);
 		PointPlacements.Append(Other.PointPlacements);
 		Boundaries.Append(Other.Boundaries);
+		MarkOccupancyIndexDirty();
 	}
 
 	void SetFocusFloor(int FloorPosition);
+
+	// Add placement to its array and keep occupancy index updated
+	void AddPlacement(const FTilePlacement& P, EPlacedType PlacedType);
+	void AddPlacement(const FEdgePlacement& P, EPlacedType PlacedType);
+	void AddPlacement(const FPointPlacement& P, EPlacedType PlacedType);
+
+	// Compact versioned binary format for saving game-time data (ex: player built bases), placements are saved sorted by position
+	void SaveToBinary(const FVector& TileSize, TArray<uint8>& OutBytes) const;
+	// fail on corrupted or newer version data, and leave this data untouched
+	// with KnownItemSets, item sets are only looked up there instead of loaded (safe off the game thread), any other set fails the load
+	bool LoadFromBinary(const TArray<uint8>& InBytes, FVector& OutTileSize, const TMap<FString, class UTiledItemSet*>* KnownItemSets = nullptr);
+
+	// Chunk streaming: move the placements of a chunk out of this data, and add them back later
+	// placements belong to the chunk of their position, same rule as instance partitions (FTiledInstancePartition)
+	// only visits the chunk's own placements, placements are removed by swap so the array order is not kept
+	FTiledLevelGameData TakeChunk(const FIntPoint& Chunk, int32 ChunkSize);
+	void AppendChunk(const FTiledLevelGameData& ChunkData);
+	void GetChunks(int32 ChunkSize, TSet<FIntPoint>& OutChunks) const;
+	void GetItemSets(TSet<class UTiledItemSet*>& OutItemSets) const;
+	static FIntPoint GetChunk(const FIntVector& Position, int32 ChunkSize)
+	{
+		return FIntPoint(FMath::FloorToInt(float(Position.X) / ChunkSize), FMath::FloorToInt(float(Position.Y) / ChunkSize));
+	}
+	int32 Num() const { return GetNumOfAllPlacements(); }
+
+	// rebuilt on demand if any placement array is changed without going through the functions above
+	const FTiledLevelOccupancyIndex& GetOccupancyIndex() const;
+	void MarkOccupancyIndexDirty()
+	{
+		bOccupancyIndexDirty = true;
+		ChunkIndexSize = 0;
+	}
+
+private:
+	int GetNumOfAllPlacements() const
+	{
+		return BlockPlacements.Num() + FloorPlacements.Num() + WallPlacements.Num() + EdgePlacements.Num() + PillarPlacements.Num() + PointPlacements.Num();
+	}
+	
+	mutable FTiledLevelOccupancyIndex OccupancyIndex;
+	mutable bool bOccupancyIndexDirty = true;
+
+	// chunk -> placement indices, built by the first TakeChunk with a chunk size (0: not built)
+	// AddPlacement, RemovePlacement and TakeChunk keep it, other changes have it rebuilt
+	TMap<FIntPoint, FTiledChunkPlacements> ChunkIndex;
+	int32 ChunkIndexSize = 0;
+	int32 ChunkIndexNum = 0;
+	bool IsChunkIndexValid() const { return ChunkIndexSize > 0 && ChunkIndexNum == GetNumOfAllPlacements(); }
+	void BuildChunkIndex(int32 ChunkSize);
+	template <typename T>
+	void AddToChunkIndex(const TArray<T>& Placements, int32 ArrayId);
 };
 
 UENUM()
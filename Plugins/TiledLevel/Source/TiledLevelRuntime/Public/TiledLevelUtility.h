@@ -4,8 +4,31 @@
 #include "CoreMinimal.h"
 #include "TiledLevelTypes.h"
 #include "Engine/EngineTypes.h"
+#include "Templates/Atomic.h"
 
 class ATiledLevel;
+struct FTiledMergeSource;
+
+// Occupancy board for the fill tools, one bit per tile and rows (X) are contiguous
+struct TILEDLEVELRUNTIME_API FTiledFillBoard
+{
+	FTiledFillBoard() = default;
+	explicit FTiledFillBoard(const FIntPoint& InSize, bool bValue = false) { Init(InSize, bValue); }
+
+	void Init(const FIntPoint& InSize, bool bValue = false)
+	{
+		Size = FIntPoint(FMath::Max(InSize.X, 0), FMath::Max(InSize.Y, 0));
+		Bits.Init(bValue, Size.X * Size.Y);
+	}
+	bool IsInside(int X, int Y) const { return X >= 0 && X < Size.X && Y >= 0 && Y < Size.Y; }
+	bool Get(int X, int Y) const { return Bits[Y * Size.X + X]; }
+	void Set(int X, int Y, bool bValue) { Bits[Y * Size.X + X] = bValue; }
+	const FIntPoint& GetSize() const { return Size; }
+
+private:
+	FIntPoint Size = FIntPoint(0, 0);
+	TBitArray<> Bits;
+};
 
 class TILEDLEVELRUNTIME_API FTiledLevelUtility
 {
@@ -52,9 +75,11 @@ public:
 	static FString GetFloorNameFromPosition(int FloorPositionIndex);
 
 	// Fill tool algorithms
-	static void FloodFill(TArray<TArray<int>>& InBoard, const FIntPoint& InBoardSize, int X , int Y, TArray<FIntPoint>& FilledTarget);
-	static void FloodFillByEdges(const TArray<FTiledLevelEdge>& BlockingEdges, TArray<TArray<int>>& InBoard, const FIntPoint& InBoardSize, int X, int Y, TArray<FIntPoint>& FilledTarget);
-	static void GetConsecutiveTiles(TArray<TArray<int>>& InBoard, FIntPoint InBoardSize, int X, int Y, TArray<FIntPoint>& OutTiles);
+	// iterative scanline fills, filled tiles are flipped on the board (false -> true for flood fill, true -> false for consecutive tiles)
+	static void FloodFill(FTiledFillBoard& InBoard, int X , int Y, TArray<FIntPoint>& FilledTarget);
+	// blocking edges are on floor 1 (Z = 1)
+	static void FloodFillByEdges(const TSet<FTiledLevelEdge>& BlockingEdges, FTiledFillBoard& InBoard, int X, int Y, TArray<FIntPoint>& FilledTarget);
+	static void GetConsecutiveTiles(FTiledFillBoard& InBoard, int X, int Y, TArray<FIntPoint>& OutTiles);
 	static TArray<float> GetWeightedCoefficient(TArray<float>& RawCoefficientArray);
 	static bool GetFeasibleFillTile(UTiledLevelItem* InItem, int& InRotationIndex, TArray<FIntPoint>& InCandidatePoints, FIntPoint& OutPoint);
 	static TArray<FTiledLevelEdge> GetAreaEdges(const TSet<FIntPoint>& Region, int Z = 1, bool IsOuter = true);
@@ -73,6 +98,18 @@ public:
     static struct FMeshDescription BuildMeshDescription(class UProceduralMeshComponent* ProcMeshComp);
 	// Copy from FProceduralMeshComponentDetails::ClickedOnConvertToStaticMesh and with minor modifications...
 	static class UProceduralMeshComponent* ConvertTiledLevelAssetToProcMesh(class UTiledLevelAsset* TargetAsset, int TargetLOD = 0, UObject* Outer = nullptr, EObjectFlags Flags = RF_NoFlags);
+	// Merge split in two, so the heavy part can run off the game thread:
+	// prepare gathers placements, source mesh sections and material paths (game thread), build fills the sections and makes the mesh description (any thread)
+	// the source keeps its meshes and materials from GC, release it on game thread
+	static TSharedRef<FTiledMergeSource> PrepareMergeSource(class UTiledLevelAsset* TargetAsset, int TargetLOD = 0);
+	static struct FMeshDescription BuildMergedMeshDescription(const FTiledMergeSource& Source, TArray<TArray<FVector>>& OutConvexVertices,
+		TArray<FString>& OutSectionMaterialPaths, const TAtomic<bool>* CancelFlag = nullptr);
+	// hash of everything the conversion above reads (placements, item set, tile size, source meshes), used to cache merge results
+	static FString GetMergeContentHash(class UTiledLevelAsset* TargetAsset);
+
+	// deterministic made up data for benchmark commands: one tile per position floor by floor, 60% tiles, 30% edges, 10% points
+	// items are picked from the item set if provided, otherwise random guids
+	static FTiledLevelGameData MakeBenchmarkGameData(int32 NumPlacements, const FVector& TileSize, class UTiledItemSet* ItemSet = nullptr);
 
 
 	
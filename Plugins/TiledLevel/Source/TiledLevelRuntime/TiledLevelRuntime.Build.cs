@@ -14,6 +14,7 @@ public class TiledLevelRuntime : ModuleRules
 				"Core",
 				"CoreUObject",
 				"Engine",
+				"NetCore",
 				"InputCore",
 				"ProceduralMeshComponent",
 				"MeshDescription",